@@ -34,6 +34,7 @@
 #include "svn_types.h"
 #include "svn_error.h"
 #include "svn_iter.h"
+#include "svn_io.h"
 #include "svn_config.h"
 #include "svn_string.h"
 
@@ -148,6 +149,21 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t failures;
 
+  /** Number of entries removed to make room for new ones.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t evictions;
+
+  /** Number of cache accesses that had to wait for a lock.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t lock_waits;
+
+  /** Total time in microseconds spent waiting for locks.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t lock_wait_time;
+
   /** Size of the data currently stored in the cache.
    * May be 0 if that information is not available.
    */
@@ -179,6 +195,25 @@ typedef struct svn_cache__info_t
    * highest array index.
    */
   apr_uint64_t histogram[32];
+
+  /** Name of the memory quota partition that the cache instance belongs
+   * to.  NULL if it does not belong to any.
+   * @see svn_cache__membuffer_set_partition()
+   */
+  const char *partition;
+
+  /** Memory quota of @a partition in bytes.  0 means "unlimited".
+   */
+  apr_uint64_t partition_quota;
+
+  /** Number of bytes currently used by all cache entries in @a partition,
+   * i.e. not only by the ones of this cache instance.
+   */
+  apr_uint64_t partition_used;
+
+  /** Whether @a partition_quota is a hard limit.
+   */
+  svn_boolean_t partition_hard_quota;
 } svn_cache__info_t;
 
 /**
@@ -310,6 +345,50 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place all cache structures,
+ * including the data buffers, into a new shared memory segment named
+ * @a path.  An existing segment of that name will be removed first.
+ *
+ * Processes forked from the calling process after this function returned
+ * will share the cache contents and its statistics with it.  Access is
+ * always serialized across processes and threads, i.e. there is no
+ * @c thread_safe parameter.
+ *
+ * The shared memory segment gets released together with @a result_pool.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if shared caches are not supported
+ * on this platform.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         const char *path,
+                                         apr_pool_t *result_pool);
+
+/**
+ * If @a enable is set, decide which items to keep in the main storage of
+ * @a cache based on an approximate history of the lookup frequencies of
+ * all keys, including those that are no longer cached (TinyLFU).  This
+ * is meant for workloads where large scans, e.g. by a full checkout or
+ * dump, compete with frequently used items; its effect on the hit rates
+ * has not been measured, yet.  tools/dev/cache-bench compares both
+ * policies.  Otherwise, only the hit counts of the currently cached items
+ * will be used, which is the default.
+ *
+ * The policy may be switched at any time.  The frequency history gets
+ * allocated in @a result_pool when the policy is enabled for the first
+ * time, i.e. @a result_pool must live as long as @a cache.  Caches in
+ * shared memory don't support this policy.
+ */
+svn_error_t *
+svn_cache__membuffer_set_tinylfu(svn_membuffer_t *cache,
+                                 svn_boolean_t enable,
+                                 apr_pool_t *result_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -378,6 +457,105 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
                                   apr_pool_t *result_pool,
                                   apr_pool_t *scratch_pool);
 
+/**
+ * Make all data stored through the membuffer-based @a cache count towards
+ * the memory quota partition named @a partition within the underlying
+ * #svn_membuffer_t.  All cache instances using the same @a partition name
+ * share the same quota.  Typically, @a partition identifies a repository.
+ *
+ * The partition may use up to @a quota bytes of the cache memory, with 0
+ * meaning "unlimited" (i.e. usage accounting only).  If @a hard_quota is
+ * set, data that would exceed @a quota will not be cached at all.  Otherwise,
+ * data of a partition exceeding its quota will not be promoted to the
+ * protected part of the cache and will be evicted first from there.
+ * The latest @a quota and @a hard_quota passed for a given @a partition
+ * apply to all cache instances using it.
+ *
+ * The number of partitions per #svn_membuffer_t is limited.  If that limit
+ * has been reached, or the cache is too small to support partitions, this
+ * function silently does nothing.
+ *
+ * This must be called before @a cache gets used by multiple threads.
+ * @a cache must have been created by svn_cache__create_membuffer_cache().
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_set_partition(svn_cache__t *cache,
+                                   const char *partition,
+                                   apr_uint64_t quota,
+                                   svn_boolean_t hard_quota,
+                                   apr_pool_t *scratch_pool);
+
+/**
+ * Make all accesses to the membuffer-based @a cache count towards the
+ * statistics category named @a category within the underlying
+ * #svn_membuffer_t.  All cache instances using the same @a category name
+ * share the same statistics.  Typically, @a category identifies the type
+ * of data being cached, e.g. "fsfs:DAG".
+ *
+ * The number of categories per #svn_membuffer_t is limited.  If that limit
+ * has been reached, this function silently does nothing.
+ *
+ * This must be called before @a cache gets used by multiple threads.
+ * @a cache must have been created by svn_cache__create_membuffer_cache().
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @see svn_cache__membuffer_get_category_info()
+ */
+svn_error_t *
+svn_cache__membuffer_set_category(svn_cache__t *cache,
+                                  const char *category,
+                                  apr_pool_t *scratch_pool);
+
+/**
+ * Add an on-disk tier to the membuffer @a cache, stored in the file at
+ * @a path.  That file will not grow beyond @a size bytes.  Items that are
+ * being evicted from @a cache may then be demoted to the file instead of
+ * simply being dropped and lookups will fall back to it before reporting
+ * a miss.  See svn_cache__membuffer_set_demotion() for which items will be
+ * demoted.
+ *
+ * The file works like a ring buffer, i.e. the oldest items get overwritten
+ * first.  Reads are checksum-validated and any damaged or otherwise
+ * unusable data is reported as a cache miss.  The file contents survives
+ * process restarts.  Only one process may use @a path at any time, so a
+ * @a cache in shared memory can't have an on-disk tier.  The file gets
+ * created accessible by its owner only and this function fails if another
+ * process has it open already.
+ *
+ * This must be called before @a cache gets used by multiple threads and
+ * at most once per @a cache.  Allocate the tier in @a result_pool, which
+ * must live at least as long as @a cache.  Use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_cache__membuffer_set_disk_cache(svn_membuffer_t *cache,
+                                    const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool);
+
+/**
+ * Demote evicted items of the statistics category of the membuffer-based
+ * @a cache to the on-disk tier of the underlying #svn_membuffer_t if their
+ * serialized size is at least @a min_size bytes.  Since this applies to
+ * the whole category, all cache instances sharing it will be affected.
+ * Use it for large items that are expensive to reconstruct.
+ *
+ * Do nothing if the #svn_membuffer_t has no on-disk tier or if @a cache
+ * has not been assigned a category.
+ *
+ * @a cache must have been created by svn_cache__create_membuffer_cache().
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @see svn_cache__membuffer_set_disk_cache(),
+ * svn_cache__membuffer_set_category()
+ */
+svn_error_t *
+svn_cache__membuffer_set_demotion(svn_cache__t *cache,
+                                  apr_size_t min_size,
+                                  apr_pool_t *scratch_pool);
+
 /**
  * Creates a null-cache instance in @a *cache_p, allocated from
  * @a result_pool.  The given @c id is the only data stored in it and can
@@ -544,6 +722,19 @@ svn_cache__format_info(const svn_cache__info_t *info,
                        svn_boolean_t access_only,
                        apr_pool_t *result_pool);
 
+/**
+ * Return the statistics given in @a info as text in the Prometheus
+ * exposition format.  If @a categories is not @c NULL, it must be an
+ * array of <tt>svn_cache__info_t *</tt> as returned by
+ * svn_cache__membuffer_get_category_info() and each of its elements will
+ * be reported as well, labeled with its @c id.  Allocations take place
+ * in @a result_pool.
+ */
+svn_string_t *
+svn_cache__format_metrics(const svn_cache__info_t *info,
+                          const apr_array_header_t *categories,
+                          apr_pool_t *result_pool);
+
 /**
  * Access the process-global (singleton) membuffer cache. The first call
  * will automatically allocate the cache using the current cache config.
@@ -554,6 +745,53 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Like svn_cache__get_global_membuffer_cache() but never create the cache.
+ * Return NULL if it has not been created (yet).
+ */
+struct svn_membuffer_t *
+svn_cache__get_existing_global_membuffer_cache(void);
+
+/**
+ * Create the process-global (singleton) membuffer cache using the current
+ * cache config but put it into the shared memory segment named @a path.
+ * See svn_cache__membuffer_cache_create_shared() for details.
+ *
+ * This must be called before svn_cache__get_global_membuffer_cache() and
+ * before forking the processes that shall share the cache.  Typically,
+ * servers call this during their initialization.  Do nothing if the
+ * configured cache size is 0.
+ */
+svn_error_t *
+svn_cache__create_shared_global_membuffer_cache(const char *path);
+
+/**
+ * Select the admission policy of the process-global membuffer cache.
+ * See svn_cache__membuffer_set_tinylfu() for details.  The setting will
+ * also be applied to a cache that has already been created.  Enabling
+ * TinyLFU for a cache in shared memory is an error.
+ *
+ * @note This complements svn_cache_config_set() because
+ * #svn_cache_config_t may not be extended.
+ */
+svn_error_t *
+svn_cache__config_set_tinylfu(svn_boolean_t enable);
+
+/**
+ * Add an on-disk tier of at most @a size bytes, stored in the file at
+ * @a path, to the process-global membuffer cache.  Create that cache
+ * if necessary.  See svn_cache__membuffer_set_disk_cache() for details.
+ * Do nothing if the configured cache size is 0.  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * Servers call this during their initialization.  It fails if the global
+ * cache lives in shared memory.
+ */
+svn_error_t *
+svn_cache__create_global_disk_cache(const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *scratch_pool);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -561,6 +799,26 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Return the access and size stats for each statistics category of the
+ * membuffer @a cache as an array of #svn_cache__info_t *.  The @c id of
+ * each element is the category name.  Size and entry totals as well as the
+ * histogram are not being filled in.  The result will be allocated in
+ * @a pool.
+ *
+ * @see svn_cache__membuffer_set_category()
+ */
+apr_array_header_t *
+svn_cache__membuffer_get_category_info(svn_membuffer_t *cache,
+                                       apr_pool_t *pool);
+
+/**
+ * Like svn_cache__membuffer_get_category_info() but for the global
+ * membuffer cache.  Return an empty array if there is no such cache.
+ */
+apr_array_header_t *
+svn_cache__membuffer_get_global_category_info(apr_pool_t *pool);
+
 /**
  * Remove all current contents from CACHE.
  *
@@ -570,6 +828,67 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache);
 
+/**
+ * A single key of a membuffer cache as recorded in a key snapshot.
+ *
+ * @see svn_cache__membuffer_save_keys(), svn_cache__load_keys()
+ */
+typedef struct svn_cache__key_record_t
+{
+  /** Key prefix of the cache front-end that stored the entry, i.e. the
+   * @c prefix passed to svn_cache__create_membuffer_cache(). */
+  const char *prefix;
+
+  /** The key within that cache front-end.  Fixed-size keys of up to 16
+   * bytes are padded with NULs to 16 bytes, all other keys to a multiple
+   * of 8 bytes.  Use only the first @c klen bytes as given to
+   * svn_cache__create_membuffer_cache(). */
+  const void *key;
+
+  /** Number of bytes in @a key. */
+  apr_size_t key_len;
+
+  /** Number of hits on the entry at the time the snapshot was taken. */
+  apr_uint32_t hits;
+} svn_cache__key_record_t;
+
+/**
+ * Write the keys of all entries currently in CACHE to STREAM, such that
+ * the cache users may later re-populate the cache after a restart by
+ * re-reading the underlying data.  The item data is not being saved.
+ * Use SCRATCH_POOL for temporary allocations.
+ *
+ * The snapshot is not atomic, i.e. other threads may modify CACHE while
+ * this function is running.
+ */
+svn_error_t *
+svn_cache__membuffer_save_keys(svn_stream_t *stream,
+                               svn_membuffer_t *cache,
+                               apr_pool_t *scratch_pool);
+
+/**
+ * Read a key snapshot written by svn_cache__membuffer_save_keys() from
+ * STREAM and return its contents as an array of svn_cache__key_record_t *
+ * in *RECORDS, most frequently used keys first.  Allocate the result in
+ * RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_cache__load_keys(apr_array_header_t **records,
+                     svn_stream_t *stream,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Write the keys of the process-global membuffer cache to a snapshot
+ * file at PATH, replacing any existing file atomically.  Do nothing if
+ * there is no global cache.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * @see svn_cache__membuffer_save_keys()
+ */
+svn_error_t *
+svn_cache__save_global_keys(const char *path,
+                            apr_pool_t *scratch_pool);
+
 /** @} */
 
 
@@ -108,6 +108,68 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Parse the svndiff window of format @a svndiff_version contained in
+ * the @a len bytes at @a data and return it in @a *window, allocated in
+ * @a pool.  @a data must contain exactly one window, without the svndiff
+ * stream header.
+ *
+ * Unlike svn_txdelta_read_svndiff_window(), this does not copy the window
+ * contents.  For @a svndiff_version 0, the new data of @a *window refers
+ * directly to @a data.  In that case, @a data must remain valid for as
+ * long as @a *window is being used and @a data[@a len] must be 0.
+ * Compressed windows get decompressed into @a pool and impose no such
+ * restrictions.
+ */
+svn_error_t *
+svn_txdelta__parse_svndiff_window(svn_txdelta_window_t **window,
+                                  const char *data,
+                                  apr_size_t len,
+                                  int svndiff_version,
+                                  apr_pool_t *pool);
+
+/** Compose the @a count delta windows in @a windows into a single window,
+ * allocated in @a pool.  The windows form a delta chain, i.e. the target
+ * view of @a windows[i] is the source view of @a windows[i+1], and the
+ * result transforms the source view of @a windows[0] into the target
+ * view of @a windows[@a count - 1].
+ *
+ * This is equivalent to calling svn_txdelta_compose_windows() repeatedly
+ * but resolves every op of the last window through the whole chain in a
+ * single pass.  No intermediate windows will be created.
+ *
+ * @a count must be at least 1.
+ */
+svn_txdelta_window_t *
+svn_txdelta__compose_window_chain(const svn_txdelta_window_t *const *windows,
+                                  int count,
+                                  apr_pool_t *pool);
+
+/** Like svn_txdelta_to_svndiff3() but hand the windows to a process-wide
+ * worker thread pool for compression.  The windows are still written to
+ * @a output in order and the output is identical to what
+ * svn_txdelta_to_svndiff3() produces.
+ *
+ * @a max_threads only determines how many windows this encoder keeps in
+ * flight:  The handler queues up to a small multiple of @a max_threads
+ * windows before it blocks, i.e. @a output may lag behind the windows
+ * passed to @a *handler until the final @c NULL window has been received.
+ * How many of these get compressed concurrently is limited by the shared
+ * thread pool, which has a fixed number of workers for all encoders in
+ * the process.  All writes to @a output happen from within @a *handler.
+ *
+ * If @a max_threads is 1 or less, if @a svndiff_version is 0 or if APR
+ * does not support threads, this is equivalent to
+ * svn_txdelta_to_svndiff3().
+ */
+void
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int max_threads,
+                                 apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
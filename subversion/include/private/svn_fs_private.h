@@ -212,6 +212,26 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *scratch_pool);
 
 
+/** Re-populate the global membuffer cache from the cache key snapshot
+ * at @a snapshot_path, as written by svn_cache__save_global_keys().
+ *
+ * All repositories referenced by the snapshot get opened with the
+ * @a fs_config and the items listed for them will be read again, most
+ * frequently used ones first.  Repositories or items that can't be read
+ * anymore are silently skipped and a missing snapshot file is not an
+ * error either.  This is meant to be run in a background thread right
+ * after a server start.
+ *
+ * Use @a cancel_func and @a cancel_baton to check for cancellation and
+ * @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_fs__warm_caches(const char *snapshot_path,
+                    apr_hash_t *fs_config,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool);
+
 /** @} */
 
 
@@ -85,6 +85,68 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/**
+ * Append the contents of @a from_file, starting at its current position,
+ * to @a to_file at its current position.  Leave both files positioned
+ * after the data copied.
+ *
+ * If both files are unbuffered and the platform supports it, let the
+ * kernel clone the file extents (e.g. Linux' FICLONE on btrfs and XFS) or
+ * copy the data in kernel space (copy_file_range()).  Otherwise, fall back
+ * to copying the data through a user-space buffer.  Set @a to_file_is_new
+ * if nothing has been written to @a to_file, yet.  It may then be buffered.
+ *
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton between
+ * chunks of data.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_copy_contents(apr_file_t *to_file,
+                           apr_file_t *from_file,
+                           svn_boolean_t to_file_is_new,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+
+/** Like svn_io_file_flush_to_disk() but, where the platform supports it,
+ * only flush the file contents and the meta data needed to read them back
+ * (e.g. the file size), not the access times and similar.  This is what
+ * fdatasync() does on POSIX systems.
+ *
+ * Use @a pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_flush_data_to_disk(apr_file_t *file,
+                                apr_pool_t *pool);
+
+/** Hint to the OS that the dirty pages of @a file should be written back
+ * to disk now, without waiting for it to complete.  A subsequent flush
+ * to disk will then take less time.  This is a no-op on platforms that
+ * don't support such hints and never fails.
+ */
+void
+svn_io__file_start_writeback(apr_file_t *file);
+
+
+/** Like svn_io_get_dirents3(), but if @a file_stats is TRUE, set the
+ * filesize and mtime fields only for entries of kind #svn_node_file
+ * (this includes symlinks).  If @a file_stats is FALSE, only check the
+ * node kinds, like with @c only_check_type.
+ *
+ * Where the directory listing itself reports the node kinds, this does
+ * not need to stat() sub-directories at all, and the remaining stat()
+ * calls are made relative to the open directory.
+ */
+svn_error_t *
+svn_io__get_dirents(apr_hash_t **dirents,
+                    const char *path,
+                    svn_boolean_t file_stats,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool);
+
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
@@ -94,7 +156,9 @@ svn_stream__aprfile(svn_stream_t *stream);
 /* Creates as *INSTALL_STREAM a stream that once completed can be installed
    using Windows checkouts much slower than Unix.
 
-   While writing the stream is temporarily stored in TMP_ABSPATH.
+   While writing the stream is temporarily stored in TMP_ABSPATH.  Where
+   supported (Linux' O_TMPFILE), that file remains anonymous until it
+   gets installed, i.e. there is nothing to clean up if it doesn't.
  */
 svn_error_t *
 svn_stream__create_for_install(svn_stream_t **install_stream,
@@ -114,6 +178,17 @@ svn_stream__install_stream(svn_stream_t *install_stream,
                            svn_boolean_t make_parents,
                            apr_pool_t *scratch_pool);
 
+/* Copy the contents of the file at SRC_ABSPATH to INSTALL_STREAM, which
+   must not have been written to.  Like svn_io_copy_file(), let the kernel
+   clone or copy the data where supported.  Check for cancellation with
+   CANCEL_FUNC and CANCEL_BATON, if not NULL. */
+svn_error_t *
+svn_stream__install_copy_file(svn_stream_t *install_stream,
+                              const char *src_abspath,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool);
+
 /* Deletes the install stream (when installing is not necessary after all) */
 svn_error_t *
 svn_stream__install_delete(svn_stream_t *install_stream,
@@ -135,6 +210,28 @@ svn_stream__from_aprfile(apr_file_t *file,
                          svn_boolean_t truncate_on_seek,
                          apr_pool_t *pool);
 
+/* Files at least this large will be memory mapped by
+   svn_stream__from_aprfile_mapped().  For smaller files, the page table
+   setup costs more than the read() calls it saves. */
+#define SVN__STREAM_MMAP_THRESHOLD 0x100000
+
+/* Set *STREAM to a read-only stream over the contents of FILE, which must
+   be positioned at its start.  If FILE is at least
+   SVN__STREAM_MMAP_THRESHOLD bytes large and the platform supports it, map
+   FILE into memory and serve all reads, skips, marks and seeks from the
+   mapping without further system calls.  Otherwise, this is equivalent to
+   svn_stream_from_aprfile2().
+
+   FILE will be closed when the stream gets closed.  It must not be
+   truncated while the stream is in use; pristine texts are a typical
+   use-case.  Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_stream__from_aprfile_mapped(svn_stream_t **stream,
+                                apr_file_t *file,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 #if defined(WIN32)
 
 /* ### Move to something like io.h or subr.h, to avoid making it
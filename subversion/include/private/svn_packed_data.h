@@ -160,6 +160,16 @@ void
 svn_packed__add_int(svn_packed__int_stream_t *stream,
                     apr_int64_t value);
 
+/* Write the COUNT unsigned integers in VALUES to STREAM.  This is
+ * equivalent to calling svn_packed__add_uint for each of them but lets
+ * the encoder process whole blocks of numbers at once.  Signed values
+ * may be passed as their apr_uint64_t casts.
+ */
+void
+svn_packed__add_uints(svn_packed__int_stream_t *stream,
+                      const apr_uint64_t *values,
+                      apr_size_t count);
+
 /* Write the sequence stating at DATA containing LEN bytes to STEAM.
  */
 void
@@ -235,6 +245,16 @@ svn_packed__get_uint(svn_packed__int_stream_t *stream);
 apr_int64_t
 svn_packed__get_int(svn_packed__int_stream_t *stream);
 
+/* Read the next COUNT numbers from STREAM as unsigned integers and store
+ * them in VALUES.  This is equivalent to calling svn_packed__get_uint
+ * COUNT times, i.e. entries beyond the end of the stream will be set to 0.
+ * Signed values can be recovered by casting to apr_int64_t.
+ */
+void
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count);
+
 /* Return the next byte sequence from STREAM and set *LEN to the length
  * of that sequence.  Sets *LEN to 0 when reading beyond the end of the
  * stream.
@@ -132,6 +132,20 @@ svn_ra_svn__set_capabilities(svn_ra_svn_conn_t *conn,
 int
 svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn);
 
+/** Allow up to @a compression_threads svndiff windows to be compressed
+ * concurrently when sending file contents over @a conn.  The default
+ * is 1.
+ */
+void
+svn_ra_svn__set_compression_threads(svn_ra_svn_conn_t *conn,
+                                    int compression_threads);
+
+/** Returns the value set by svn_ra_svn__set_compression_threads() for
+ * @a conn.
+ */
+int
+svn_ra_svn__compression_threads(svn_ra_svn_conn_t *conn);
+
 
 /**
  * Set the shim callbacks to be used by @a conn to @a shim_callbacks.
@@ -0,0 +1,152 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_simd.h
+ * @brief Compile-time and runtime selection of vectorized code paths
+ */
+
+#ifndef SVN_SIMD_H
+#define SVN_SIMD_H
+
+#include <apr.h>
+
+#include "svn_types.h"
+
+/* Determine which instruction set extensions the compiler lets us use.
+ *
+ * SSE2 is part of the x64 base line and NEON part of the AArch64 base line,
+ * i.e. code using those can be compiled unconditionally and needs no
+ * runtime check other than the user-specified feature mask.
+ *
+ * AVX2 code gets compiled with a function-level target attribute and
+ * may only be executed after svn_simd__get_features() reported the
+ * respective CPU support.
+ */
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SVN__SIMD_SSE2 1
+#  include <emmintrin.h>
+
+#  if defined(__clang__) \
+      || (defined(__GNUC__) \
+          && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#    define SVN__SIMD_AVX2 1
+#    define SVN__SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#    include <immintrin.h>
+#  elif defined(_MSC_VER) && _MSC_VER >= 1700
+#    define SVN__SIMD_AVX2 1
+#    define SVN__SIMD_TARGET_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(_M_ARM64) || (defined(__aarch64__) && defined(__ARM_NEON))
+#  define SVN__SIMD_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#ifndef SVN__SIMD_SSE2
+#  define SVN__SIMD_SSE2 0
+#endif
+#ifndef SVN__SIMD_AVX2
+#  define SVN__SIMD_AVX2 0
+#endif
+#ifndef SVN__SIMD_NEON
+#  define SVN__SIMD_NEON 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @defgroup svn_simd Runtime selection of vectorized code
+ * @{
+ */
+
+/** The SSE2 code paths may be used. */
+#define SVN_SIMD__SSE2  0x0001
+
+/** The AVX2 code paths may be used. */
+#define SVN_SIMD__AVX2  0x0002
+
+/** The NEON code paths may be used. */
+#define SVN_SIMD__NEON  0x0004
+
+/** All flags defined above. */
+#define SVN_SIMD__ALL   (SVN_SIMD__SSE2 | SVN_SIMD__AVX2 | SVN_SIMD__NEON)
+
+/**
+ * Return the set of SVN_SIMD__* flags for code paths that have been
+ * compiled in, are supported by the CPU we are running on and have not
+ * been disabled by svn_simd__set_feature_mask().
+ *
+ * The CPU detection runs only once; subsequent calls are very cheap,
+ * so it is fine to call this for every invocation of some vectorized
+ * function.
+ */
+apr_uint32_t
+svn_simd__get_features(void);
+
+/**
+ * Restrict the result of svn_simd__get_features() to the flags set in
+ * MASK and return the previous mask.  Passing 0 forces all callers into
+ * their scalar fallback code.  The default is #SVN_SIMD__ALL.
+ *
+ * This is mainly meant for testing, i.e. for comparing the vectorized
+ * results with the scalar ones.  It is not synchronized with other
+ * threads that may be running vectorized code concurrently.
+ */
+apr_uint32_t
+svn_simd__set_feature_mask(apr_uint32_t mask);
+
+/**
+ * Return the index of the lowest bit set in VALUE.  VALUE must not be 0.
+ *
+ * Use the #SVN_SIMD__LOWEST_BIT macro instead of calling this directly.
+ */
+unsigned
+svn_simd__lowest_bit(apr_uint32_t value);
+
+/**
+ * Return the index of the highest bit set in VALUE.  VALUE must not be 0.
+ *
+ * Use the #SVN_SIMD__HIGHEST_BIT macro instead of calling this directly.
+ */
+unsigned
+svn_simd__highest_bit(apr_uint32_t value);
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define SVN_SIMD__LOWEST_BIT(value) ((unsigned)__builtin_ctz(value))
+#  define SVN_SIMD__HIGHEST_BIT(value) (31 - (unsigned)__builtin_clz(value))
+#else
+#  define SVN_SIMD__LOWEST_BIT(value) svn_simd__lowest_bit(value)
+#  define SVN_SIMD__HIGHEST_BIT(value) svn_simd__highest_bit(value)
+#endif
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_SIMD_H */
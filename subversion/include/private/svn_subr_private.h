@@ -104,6 +104,23 @@ svn_spillbuf__create_extended(apr_size_t blocksize,
                               const char* dirpath,
                               apr_pool_t *result_pool);
 
+/* Create a spill buffer like svn_spillbuf__create(), which hands spilled
+   content to a background writer thread instead of writing it to the
+   spill file itself.  Thus, svn_spillbuf__write() won't wait for the disk
+   unless more than @a max_pending bytes are queued for writing.
+
+   Reads return the same data in the same order as they would without the
+   background writer; they wait for the writer if necessary.  Errors from
+   the writer are reported by subsequent writes and reads.  The spill file
+   returned by svn_spillbuf__get_file() may lag behind the content
+   written.  If threads are not available, this behaves like
+   svn_spillbuf__create().  */
+svn_spillbuf_t *
+svn_spillbuf__create_write_behind(apr_size_t blocksize,
+                                  apr_size_t maxsize,
+                                  apr_size_t max_pending,
+                                  apr_pool_t *result_pool);
+
 /* Determine how much content is stored in the spill buffer.  */
 svn_filesize_t
 svn_spillbuf__get_size(const svn_spillbuf_t *buf);
@@ -295,6 +312,76 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
                                            svn_stream_t *inner_stream,
                                            apr_pool_t *pool);
 
+/**
+ * Context that calculates checksums of several kinds over the same data
+ * in a single pass, e.g. MD5 and SHA-1 of a file's contents.
+ */
+typedef struct svn_checksum__multi_ctx_t svn_checksum__multi_ctx_t;
+
+/**
+ * Return a new context that calculates checksums of the @a count kinds
+ * given in @a kinds.  Each kind may be given only once.
+ *
+ * If @a use_thread is set and APR supports threads, large updates will
+ * run the checksum calculation for all but the first kind on a helper
+ * thread from the svn_thread_pool__get() pool.  Updates that find all of
+ * its threads busy run in the calling thread only.  Allocate the result
+ * in @a result_pool.
+ */
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(const svn_checksum_kind_t *kinds,
+                               int count,
+                               svn_boolean_t use_thread,
+                               apr_pool_t *result_pool);
+
+/**
+ * Reset the checksum calculation in @a ctx to the initial state.
+ */
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx);
+
+/**
+ * Update all checksums in @a ctx with the @a len bytes in @a data.
+ *
+ * Unlike separate svn_checksum_update() calls, this walks @a data only
+ * once, feeding cache-sized blocks to all digests in turn.
+ */
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len);
+
+/**
+ * Finalize the checksum calculation in @a ctx and return the result for
+ * @a kind in @a *checksum, allocated in @a result_pool.  @a kind must be
+ * one of the kinds given to svn_checksum__multi_ctx_create().  This may
+ * be called for each of those kinds, in any order.
+ */
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          svn_checksum_kind_t kind,
+                          apr_pool_t *result_pool);
+
+/**
+ * Return a stream that calculates the MD5 and the SHA-1 checksum over all
+ * data written to the @a inner_stream in a single pass.  When the returned
+ * stream gets closed, write the checksums to @a *md5_checksum and
+ * @a *sha1_checksum, respectively.  Either of them may be @c NULL, in
+ * which case that checksum will not be calculated.  @a use_thread is
+ * passed through to svn_checksum__multi_ctx_create().
+ * Allocate the result in @a pool.
+ *
+ * @note The stream returned only supports #svn_stream_write and
+ * #svn_stream_close.
+ */
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         svn_boolean_t use_thread,
+                                         apr_pool_t *pool);
+
 /**
  * Return a 32 bit FNV-1a checksum for the first @a len bytes in @a input.
  *
@@ -626,6 +713,32 @@ svn_root_pools__release_pool(apr_pool_t *pool,
 
 /** @} */
 
+/**
+ * @defgroup svn_thread_pool Shared helper thread pool API
+ * @{
+ */
+
+/* Maximum number of threads in the pool returned by svn_thread_pool__get.
+ */
+#define SVN_THREAD_POOL__MAX_THREADS 16
+
+/* Set *THREAD_POOL to the process-wide pool of helper threads that all
+ * libraries use to run tasks in the background.  Create it upon first use.
+ * Set *THREAD_POOL to NULL if APR has been compiled without threads.
+ *
+ * New threads get started for tasks pushed to the pool until there are
+ * #SVN_THREAD_POOL__MAX_THREADS of them.  If they are all busy, further
+ * tasks get queued.  They will not run in the pushing thread.  Idle
+ * threads terminate after a while.
+ *
+ * The pool gets destroyed when APR terminates.  Tasks must not wait for
+ * other tasks in the same pool as they might be queued behind them.
+ */
+svn_error_t *
+svn_thread_pool__get(struct apr_thread_pool **thread_pool);
+
+/** @} */
+
 /**
  * @defgroup svn_config_private Private configuration handling API
  * @{
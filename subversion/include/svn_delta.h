@@ -383,10 +383,36 @@ svn_txdelta_md5_digest(svn_txdelta_stream_t *stream);
  * is set, you may call svn_txdelta_md5_digest() to get an MD5 checksum
  * for @a target.
  *
+ * By default, every window of @a target data will only be compared to the
+ * window of @a source data at the same offset.  If @a match_whole_source
+ * is set and @a source supports svn_stream_mark(), the whole @a source
+ * will be read and indexed before the first window gets produced.  Each
+ * target window will then be compared to the source view that contains
+ * most of its content, i.e. content that moved across window boundaries
+ * can still be found.  Because the source views must still slide forward
+ * (see #svn_txdelta_window_t), content that moved towards the start of
+ * the file will only be found if it is close to its original position.
+ * The resulting windows may have a @c tview_len of 0.
+ *
  * Do any necessary allocation in a sub-pool of @a pool.
  *
+ * @since New in 1.12.
+ */
+void
+svn_txdelta3(svn_txdelta_stream_t **stream,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             svn_boolean_t calculate_checksum,
+             svn_boolean_t match_whole_source,
+             apr_pool_t *pool);
+
+/** Similar to svn_txdelta3 but with @a match_whole_source always being
+ * @c FALSE.
+ *
  * @since New in 1.8.
+ * @deprecated Provided for backward compatibility with the 1.11 API.
  */
+SVN_DEPRECATED
 void
 svn_txdelta2(svn_txdelta_stream_t **stream,
              svn_stream_t *source,
@@ -153,7 +153,7 @@ inner_dir_diff(const char *left_abspath,
 
   if (!right_only)
     {
-      err = svn_io_get_dirents3(&left_dirents, left_abspath, FALSE,
+      err = svn_io_get_dirents3(&left_dirents, left_abspath, TRUE,
                                 scratch_pool, iterpool);
 
       if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
@@ -171,7 +171,7 @@ inner_dir_diff(const char *left_abspath,
 
   if (!left_only)
     {
-      err = svn_io_get_dirents3(&right_dirents, right_abspath, FALSE,
+      err = svn_io_get_dirents3(&right_dirents, right_abspath, TRUE,
                                 scratch_pool, iterpool);
 
       if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
@@ -97,8 +97,8 @@ open_txdelta_stream(svn_txdelta_stream_t **txdelta_stream_p,
     }
 
   /* Get the delta stream (delta against the empty string). */
-  svn_txdelta2(txdelta_stream_p, svn_stream_empty(result_pool),
-               b->stream, FALSE, result_pool);
+  svn_txdelta3(txdelta_stream_p, svn_stream_empty(result_pool),
+               b->stream, FALSE, FALSE, result_pool);
   b->need_reset = TRUE;
   return SVN_NO_ERROR;
 }
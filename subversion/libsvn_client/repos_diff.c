@@ -48,6 +48,7 @@
 
 #include "client.h"
 
+#include "private/svn_io_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_editor.h"
@@ -850,9 +851,14 @@ lazy_open_source(svn_stream_t **stream,
                  apr_pool_t *scratch_pool)
 {
   struct file_baton *fb = baton;
-
-  SVN_ERR(svn_stream_open_readonly(stream, fb->path_start_revision,
-                                   result_pool, scratch_pool));
+  apr_file_t *file;
+
+  /* The start revision text is a fetched temporary file that nobody
+   * modifies anymore, so we may map it. */
+  SVN_ERR(svn_io_file_open(&file, fb->path_start_revision, APR_READ,
+                           APR_OS_DEFAULT, result_pool));
+  SVN_ERR(svn_stream__from_aprfile_mapped(stream, file, result_pool,
+                                          scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -1436,8 +1436,9 @@ apply_file_mods(apr_hash_t *base_props,
     target_stream = svn_stream_empty(scratch_pool);
   SVN_ERR(editor->apply_textdelta(file_baton, NULL /*base_checksum*/,
                                   scratch_pool, &handler, &handler_baton));
-  svn_txdelta2(&txdelta_stream, source_stream, target_stream,
-               FALSE /*calculate_checksum*/, scratch_pool);
+  svn_txdelta3(&txdelta_stream, source_stream, target_stream,
+               FALSE /*calculate_checksum*/, FALSE /*match_whole_source*/,
+               scratch_pool);
   SVN_ERR(svn_txdelta_send_txstream(txdelta_stream,
                                     handler, handler_baton, scratch_pool));
 
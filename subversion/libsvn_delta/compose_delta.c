@@ -30,6 +30,8 @@
 #include "svn_pools.h"
 #include "delta.h"
 
+#include "private/svn_delta_private.h"
+
 /* Define a MIN macro if this platform doesn't already have one. */
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -627,22 +629,29 @@ build_range_list(apr_size_t offset, apr_size_t limit, range_index_t *ndx)
 }
 
 
-/* Copy the instructions from WINDOW that define the range [OFFSET,
-   LIMIT) in WINDOW's target stream to TARGET_OFFSET in the window
+/* Copy the instructions from WINDOWS[LEVEL] that define the range
+   [OFFSET, LIMIT) in its target stream to TARGET_OFFSET in the window
    represented by BUILD_BATON. HINT is a position in the instructions
    array that helps finding the position for OFFSET. A safe default
-   is 0. Use NDX to find the instructions in WINDOW. Allocate space
-   in BUILD_BATON from POOL. */
+   is 0. Use NDXS[LEVEL] to find the instructions in the window.
+
+   WINDOWS[0] to WINDOWS[LEVEL] form a delta chain, i.e. the target of
+   each window is the source of the next one.  Source copies in any
+   window but WINDOWS[0] get resolved recursively against the previous
+   window in the chain.  Allocate space in BUILD_BATON from POOL. */
 
 static void
 copy_source_ops(apr_size_t offset, apr_size_t limit,
                 apr_size_t target_offset,
                 apr_size_t hint,
                 svn_txdelta__ops_baton_t *build_baton,
-                const svn_txdelta_window_t *window,
-                const offset_index_t *ndx,
+                const svn_txdelta_window_t *const *windows,
+                const offset_index_t *const *ndxs,
+                int level,
                 apr_pool_t *pool)
 {
+  const svn_txdelta_window_t *const window = windows[level];
+  const offset_index_t *const ndx = ndxs[level];
   apr_size_t op_ndx = search_offset_index(ndx, offset, hint);
   for (;; ++op_ndx)
     {
@@ -663,7 +672,16 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
       /* It would be extremely weird if the fixed-up op had zero length. */
       assert(fix_offset + fix_limit < op->length);
 
-      if (op->action_code != svn_txdelta_target)
+      if (op->action_code == svn_txdelta_source && level > 0)
+        {
+          /* The source of this window is the target of the previous
+             window in the chain.  Take the data from there. */
+          copy_source_ops(op->offset + fix_offset,
+                          op->offset + op->length - fix_limit,
+                          target_offset, 0,
+                          build_baton, windows, ndxs, level - 1, pool);
+        }
+      else if (op->action_code != svn_txdelta_target)
         {
           /* Delta ops that don't depend on the virtual target can be
              copied to the composite unchanged. */
@@ -691,7 +709,7 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                               op->offset + op->length - fix_limit,
                               target_offset,
                               op_ndx,
-                              build_baton, window, ndx, pool);
+                              build_baton, windows, ndxs, level, pool);
             }
           else
             {
@@ -716,7 +734,7 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                                 op->offset + ptn_overlap + length,
                                 tgt_off,
                                 op_ndx,
-                                build_baton, window, ndx, pool);
+                                build_baton, windows, ndxs, level, pool);
                 fix_off += length;
                 tgt_off += length;
               }
@@ -732,7 +750,8 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
                                   op->offset + length,
                                   tgt_off,
                                   op_ndx,
-                                  build_baton, window, ndx, pool);
+                                  build_baton, windows, ndxs, level,
+                                  pool);
                   fix_off += length;
                   tgt_off += length;
                 }
@@ -760,19 +779,30 @@ copy_source_ops(apr_size_t offset, apr_size_t limit,
 /* Bringing it all together. */
 
 
-svn_txdelta_window_t *
-svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
-                            const svn_txdelta_window_t *window_B,
-                            apr_pool_t *pool)
+/* Compose the COUNT windows in WINDOWS into a single window, allocated
+   in POOL.  WINDOWS[0] is the window closest to the base, i.e. the
+   target of WINDOWS[I] is the source of WINDOWS[I+1].  COUNT must be
+   at least 2. */
+static svn_txdelta_window_t *
+compose_window_chain(const svn_txdelta_window_t *const *windows,
+                     int count,
+                     apr_pool_t *pool)
 {
   svn_txdelta__ops_baton_t build_baton = { 0 };
   svn_txdelta_window_t *composite;
   apr_pool_t *subpool = svn_pool_create(pool);
-  offset_index_t *offset_index = create_offset_index(window_A, subpool);
+  const svn_txdelta_window_t *const window_B = windows[count - 1];
+  const offset_index_t **offset_indexes
+    = apr_palloc(subpool, (count - 1) * sizeof(*offset_indexes));
   range_index_t *range_index = create_range_index(subpool);
   apr_size_t target_offset = 0;
   int i;
 
+  /* The source views of all windows but the first one are virtual and
+     will be resolved through the target ops of their predecessors. */
+  for (i = 0; i < count - 1; ++i)
+    offset_indexes[i] = create_offset_index(windows[i], subpool);
+
   /* Read the description of the delta composition algorithm in
      notes/fs-improvements.txt before going any further.
      You have been warned. */
@@ -796,7 +826,7 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
         {
           /* NOTE: Remember that `offset' and `limit' refer to
              positions in window_B's _source_ stream, which is the
-             same as window_A's _target_ stream! */
+             same as the previous window's _target_ stream! */
           const apr_size_t offset = op->offset;
           const apr_size_t limit = op->offset + op->length;
           range_list_node_t *range_list, *range;
@@ -814,8 +844,8 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
                                        NULL, pool);
               else
                 copy_source_ops(range->offset, range->limit, tgt_off, 0,
-                                &build_baton, window_A, offset_index,
-                                pool);
+                                &build_baton, windows, offset_indexes,
+                                count - 2, pool);
 
               tgt_off += range->limit - range->offset;
             }
@@ -832,8 +862,31 @@ svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
   svn_pool_destroy(subpool);
 
   composite = svn_txdelta__make_window(&build_baton, pool);
-  composite->sview_offset = window_A->sview_offset;
-  composite->sview_len = window_A->sview_len;
+  composite->sview_offset = windows[0]->sview_offset;
+  composite->sview_len = windows[0]->sview_len;
   composite->tview_len = window_B->tview_len;
   return composite;
 }
+
+svn_txdelta_window_t *
+svn_txdelta_compose_windows(const svn_txdelta_window_t *window_A,
+                            const svn_txdelta_window_t *window_B,
+                            apr_pool_t *pool)
+{
+  const svn_txdelta_window_t *windows[2];
+  windows[0] = window_A;
+  windows[1] = window_B;
+
+  return compose_window_chain(windows, 2, pool);
+}
+
+svn_txdelta_window_t *
+svn_txdelta__compose_window_chain(const svn_txdelta_window_t *const *windows,
+                                  int count,
+                                  apr_pool_t *pool)
+{
+  if (count == 1)
+    return svn_txdelta_window_dup(windows[0], pool);
+
+  return compose_window_chain(windows, count, pool);
+}
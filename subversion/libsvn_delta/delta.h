@@ -88,6 +88,33 @@ void svn_txdelta__xdelta(svn_txdelta__ops_baton_t *build_baton,
                          apr_size_t target_len,
                          apr_pool_t *pool);
 
+/* Index over the whole delta source, used to find the best source view
+   for a given target window. */
+typedef struct svn_txdelta__source_index_t svn_txdelta__source_index_t;
+
+/* Read SOURCE until EOF and return an index over its contents in *INDEX_P.
+   Allocate the result in RESULT_POOL and temporaries in SCRATCH_POOL. */
+svn_error_t *
+svn_txdelta__source_index_create(svn_txdelta__source_index_t **index_p,
+                                 svn_stream_t *source,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool);
+
+/* Return the total length of the source that SOURCE_INDEX has been built
+   for. */
+svn_filesize_t
+svn_txdelta__source_index_get_len(
+  const svn_txdelta__source_index_t *source_index);
+
+/* Return the source offset at which a source view should start to cover
+   as much of the LEN bytes of target DATA as possible, according to
+   SOURCE_INDEX.
+   Return -1 if no common content could be found. */
+svn_filesize_t
+svn_txdelta__source_index_find(
+  const svn_txdelta__source_index_t *source_index,
+  const char *data,
+  apr_size_t len);
 
 #ifdef __cplusplus
 }
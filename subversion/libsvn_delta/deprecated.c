@@ -119,3 +119,13 @@ svn_delta_path_driver(const svn_delta_editor_t *editor,
                                                 callback_func, callback_baton,
                                                 scratch_pool));
 }
+
+void
+svn_txdelta2(svn_txdelta_stream_t **stream,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             svn_boolean_t calculate_checksum,
+             apr_pool_t *pool)
+{
+  svn_txdelta3(stream, source, target, calculate_checksum, FALSE, pool);
+}
@@ -24,14 +24,19 @@
 
 #include <assert.h>
 #include <string.h>
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+
 #include "svn_delta.h"
 #include "svn_io.h"
 #include "delta.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_error_private.h"
 #include "private/svn_delta_private.h"
+#include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
@@ -245,6 +250,32 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+/* Write the window data returned by encode_window() - HEADER,
+   INSTRUCTIONS and NEWDATA - to OUTPUT. */
+static svn_error_t *
+write_encoded_window(svn_stream_t *output,
+                     const svn_stringbuf_t *header,
+                     const svn_stringbuf_t *instructions,
+                     const svn_string_t *newdata)
+{
+  apr_size_t len;
+
+  len = header->len;
+  SVN_ERR(svn_stream_write(output, header->data, &len));
+  if (instructions->len > 0)
+    {
+      len = instructions->len;
+      SVN_ERR(svn_stream_write(output, instructions->data, &len));
+    }
+  if (newdata->len > 0)
+    {
+      len = newdata->len;
+      SVN_ERR(svn_stream_write(output, newdata->data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -285,21 +316,8 @@ window_handler(svn_txdelta_window_t *window, void *baton)
                         eb->version, eb->compression_level,
                         eb->scratch_pool));
 
-  /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
-  if (instructions->len > 0)
-    {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
-    }
-  if (newdata->len > 0)
-    {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
-    }
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(write_encoded_window(eb->output, header,
+                                              instructions, newdata));
 }
 
 void
@@ -344,6 +362,340 @@ svn_txdelta_to_svndiff(svn_stream_t *output,
                           SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
 }
 
+
+/* ----- Parallel text delta to svndiff ----- */
+
+#if APR_HAS_THREADS
+
+/* Number of windows per thread that a single encoder may keep in flight.
+ * Values above 1 let the caller compute the next delta window while the
+ * workers are still busy with the previous ones. */
+#define QUEUE_FACTOR 2
+
+/* A single window passing through the parallel encoder. */
+typedef struct encoder_job_t
+{
+  /* Pool private to this job slot.  Holds WINDOW and the encoder output.
+   * NULL until first use.  See create_job_pool(). */
+  apr_pool_t *pool;
+
+  /* Copy of the delta window to encode. */
+  svn_txdelta_window_t *window;
+
+  /* Results of encode_window().  Only valid after DONE has been set. */
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+  svn_error_t *result;
+
+  /* Set once the encoding completed.  Protected by the encoder's MUTEX. */
+  svn_boolean_t done;
+
+  /* The encoder that this job belongs to. */
+  struct parallel_encoder_baton *eb;
+} encoder_job_t;
+
+/* Baton type used by parallel_window_handler(). */
+struct parallel_encoder_baton
+{
+  /* Same as in encoder_baton. */
+  svn_stream_t *output;
+  svn_boolean_t header_done;
+  int version;
+  int compression_level;
+
+  /* Ring buffer of QUEUE_SIZE job slots.  The COUNT jobs starting at
+   * index FIRST have been submitted but not been written, yet.
+   * JOBS is NULL until the first window arrives. */
+  encoder_job_t *jobs;
+  int queue_size;
+  int first;
+  int count;
+
+  /* Synchronization between the workers and the writing thread. */
+  svn_mutex__t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* The shared thread pool.  NULL if it is not available. */
+  apr_thread_pool_t *thread_pool;
+
+  /* Pool that the baton has been allocated in. */
+  apr_pool_t *pool;
+};
+
+/* Mark JOB as done and wake up the thread waiting for it. */
+static svn_error_t *
+signal_job_done(encoder_job_t *job)
+{
+  struct parallel_encoder_baton *eb = job->eb;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__lock(eb->mutex));
+
+  job->done = TRUE;
+  status = apr_thread_cond_broadcast(eb->cond);
+  if (status)
+    err = svn_error_wrap_apr(status, _("Can't broadcast condition variable"));
+
+  return svn_error_trace(svn_mutex__unlock(eb->mutex, err));
+}
+
+/* Set *DONE if JOB has been encoded.  If WAIT is set, wait for that to
+ * happen first. */
+static svn_error_t *
+check_job_done(svn_boolean_t *done,
+               encoder_job_t *job,
+               svn_boolean_t wait)
+{
+  struct parallel_encoder_baton *eb = job->eb;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__lock(eb->mutex));
+
+  /* This loop implicitly handles spurious wake-ups. */
+  while (wait && !job->done)
+    {
+      apr_status_t status = apr_thread_cond_wait(eb->cond,
+                                                 svn_mutex__get(eb->mutex));
+      if (status)
+        {
+          err = svn_error_wrap_apr(status,
+                                   _("Can't wait on condition variable"));
+          break;
+        }
+    }
+
+  *done = job->done;
+
+  return svn_error_trace(svn_mutex__unlock(eb->mutex, err));
+}
+
+/* Thread-pool task:  Encode the encoder_job_t instance given by DATA. */
+static void * APR_THREAD_FUNC
+encode_task(apr_thread_t *tid,
+            void *data)
+{
+  encoder_job_t *job = data;
+
+  job->result = encode_window(&job->instructions, &job->header,
+                              &job->newdata, job->window, job->eb->version,
+                              job->eb->compression_level, job->pool);
+
+  /* If this fails, the writing thread will probably wait forever.  But
+     there is no way to tell it what the problem was. */
+  svn_error_clear(signal_job_done(job));
+
+  return NULL;
+}
+
+/* Write the leading jobs in EB that have been encoded to the output
+ * stream, in order.  Wait for the encoding to complete until no more
+ * than MAX_PENDING jobs remain in EB. */
+static svn_error_t *
+write_finished_jobs(struct parallel_encoder_baton *eb,
+                    int max_pending)
+{
+  while (eb->count > 0)
+    {
+      encoder_job_t *job = &eb->jobs[eb->first];
+      svn_boolean_t done;
+      svn_error_t *err;
+
+      SVN_ERR(check_job_done(&done, job, eb->count > max_pending));
+      if (!done)
+        break;
+
+      /* The slot may be reused from here on. */
+      eb->first = (eb->first + 1) % eb->queue_size;
+      eb->count--;
+
+      err = job->result;
+      job->result = SVN_NO_ERROR;
+      SVN_ERR(err);
+
+      SVN_ERR(write_encoded_window(eb->output, job->header,
+                                   job->instructions, job->newdata));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait for all encoder jobs in flight for the parallel_encoder_baton
+ * given by DATA, discard their results and release their pools.
+ * Must be run as a pre-cleanup hook because we need the synchronization
+ * objects. */
+static apr_status_t
+parallel_encoder_cleanup(void *data)
+{
+  struct parallel_encoder_baton *eb = data;
+  int i;
+
+  /* If waiting fails, the synchronization objects are broken and there
+     is nothing better we could do than to continue. */
+  for (; eb->count > 0; eb->count--)
+    {
+      encoder_job_t *job = &eb->jobs[eb->first];
+      svn_boolean_t done;
+
+      svn_error_clear(check_job_done(&done, job, TRUE));
+      svn_error_clear(job->result);
+      job->result = SVN_NO_ERROR;
+
+      eb->first = (eb->first + 1) % eb->queue_size;
+    }
+
+  for (i = 0; i < eb->queue_size; ++i)
+    if (eb->jobs[i].pool)
+      {
+        svn_pool_destroy(eb->jobs[i].pool);
+        eb->jobs[i].pool = NULL;
+      }
+
+  return APR_SUCCESS;
+}
+
+/* Set *POOL to a new job pool for EB.  It is a sub-pool of EB's pool but
+ * uses its own allocator because workers allocate from it while the
+ * writing thread keeps using EB's pool. */
+static svn_error_t *
+create_job_pool(apr_pool_t **pool,
+                struct parallel_encoder_baton *eb)
+{
+  apr_allocator_t *allocator;
+  apr_status_t status = apr_allocator_create(&allocator);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create allocator"));
+
+  apr_allocator_max_free_set(allocator, SVN_ALLOCATOR_RECOMMENDED_MAX_FREE);
+  *pool = svn_pool_create_ex(eb->pool, allocator);
+  apr_allocator_owner_set(allocator, *pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Allocate the job queue and synchronization objects of EB. */
+static svn_error_t *
+init_parallel_encoder(struct parallel_encoder_baton *eb)
+{
+  apr_status_t status;
+  int i;
+
+  SVN_ERR(svn_thread_pool__get(&eb->thread_pool));
+
+  SVN_ERR(svn_mutex__init(&eb->mutex, TRUE, eb->pool));
+  status = apr_thread_cond_create(&eb->cond, eb->pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  eb->jobs = apr_pcalloc(eb->pool, eb->queue_size * sizeof(*eb->jobs));
+  for (i = 0; i < eb->queue_size; ++i)
+    eb->jobs[i].eb = eb;
+
+  apr_pool_pre_cleanup_register(eb->pool, eb, parallel_encoder_cleanup);
+
+  return SVN_NO_ERROR;
+}
+
+/* Window handler returned by svn_txdelta__to_svndiff_parallel().
+   Produces the same output as window_handler(). */
+static svn_error_t *
+parallel_window_handler(svn_txdelta_window_t *window, void *baton)
+{
+  struct parallel_encoder_baton *eb = baton;
+  encoder_job_t *job;
+  apr_status_t status = APR_EINIT;
+
+  /* Make sure we write the header.  */
+  if (!eb->header_done)
+    {
+      apr_size_t len = SVNDIFF_HEADER_SIZE;
+      SVN_ERR(svn_stream_write(eb->output, get_svndiff_header(eb->version),
+                               &len));
+      eb->header_done = TRUE;
+    }
+
+  if (window == NULL)
+    {
+      /* We're done; write out all pending windows and clean up. */
+      if (eb->jobs)
+        {
+          SVN_ERR(write_finished_jobs(eb, 0));
+          parallel_encoder_cleanup(eb);
+        }
+
+      return svn_error_trace(svn_stream_close(eb->output));
+    }
+
+  if (eb->jobs == NULL)
+    SVN_ERR(init_parallel_encoder(eb));
+
+  /* Free at least one slot in the queue. */
+  SVN_ERR(write_finished_jobs(eb, eb->queue_size - 1));
+
+  job = &eb->jobs[(eb->first + eb->count) % eb->queue_size];
+  if (job->pool)
+    svn_pool_clear(job->pool);
+  else
+    SVN_ERR(create_job_pool(&job->pool, eb));
+
+  /* No worker uses this slot at the moment, so we don't need the lock. */
+  job->window = svn_txdelta_window_dup(window, job->pool);
+  job->result = SVN_NO_ERROR;
+  job->done = FALSE;
+  eb->count++;
+
+  if (eb->thread_pool)
+    status = apr_thread_pool_push(eb->thread_pool, encode_task, job, 0, eb);
+
+  /* Without a thread pool, encode the window ourselves.  If all threads
+   * are busy, the pool queues the job instead. */
+  if (status)
+    {
+      job->result = encode_window(&job->instructions, &job->header,
+                                  &job->newdata, job->window, eb->version,
+                                  eb->compression_level, job->pool);
+      job->done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+void
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int max_threads,
+                                 apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* svndiff0 does not compress anything, i.e. there is nothing worth to
+   * be offloaded to other threads. */
+  if (svndiff_version > 0 && max_threads > 1)
+    {
+      struct parallel_encoder_baton *eb = apr_pcalloc(pool, sizeof(*eb));
+      eb->output = output;
+      eb->header_done = FALSE;
+      eb->version = svndiff_version;
+      eb->compression_level = compression_level;
+      eb->queue_size = MIN(max_threads, SVN_THREAD_POOL__MAX_THREADS)
+                    * QUEUE_FACTOR;
+      eb->pool = pool;
+
+      *handler = parallel_window_handler;
+      *handler_baton = eb;
+      return;
+    }
+#endif
+
+  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
+                          compression_level, pool);
+}
+
 
 /* ----- svndiff to text delta ----- */
 
@@ -544,9 +896,13 @@ count_and_verify_instructions(int *ninst,
 
 /* Given the five integer fields of a window header and a pointer to
    the remainder of the window contents, fill in a delta window
-   structure *WINDOW.  New allocations will be performed in POOL;
-   the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   structure *WINDOW.  New allocations will be performed in POOL.
+
+   For svndiff0, the new_data field of *WINDOW will refer directly to
+   memory pointed to by DATA, i.e. DATA must remain valid for as long as
+   *WINDOW is being used.  Because an svn_string_t must have the invariant
+   data[len]=='\0', the caller must also make sure that the byte at
+   DATA[INSLEN + NEWLEN] is 0. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
@@ -599,9 +955,11 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
     }
   else
     {
-      /* Copy the data because an svn_string_t must have the invariant
-         data[len]=='\0'. */
-      new_data = svn_string_ncreate((const char*)insend, newlen, pool);
+      /* No need to copy the data as our caller guarantees the invariant
+         data[len]=='\0' and the life time of DATA. */
+      new_data = apr_palloc(pool, sizeof(*new_data));
+      new_data->data = (const char *)insend;
+      new_data->len = newlen;
     }
 
   /* Count the instructions and make sure they are all valid.  */
@@ -632,6 +990,59 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
   return SVN_NO_ERROR;
 }
 
+/* Decode the svndiff window header at P, which ends no later than END,
+ * into *SVIEW_OFFSET, *SVIEW_LEN, *TVIEW_LEN, *INSLEN and *NEWLEN.
+ * Return a pointer to the first byte after the header or NULL if END has
+ * been reached before the header was complete. */
+static const unsigned char *
+decode_window_header(svn_filesize_t *sview_offset,
+                     apr_size_t *sview_len,
+                     apr_size_t *tview_len,
+                     apr_size_t *inslen,
+                     apr_size_t *newlen,
+                     const unsigned char *p,
+                     const unsigned char *end)
+{
+  p = decode_file_offset(sview_offset, p, end);
+  if (p)
+    p = decode_size(sview_len, p, end);
+  if (p)
+    p = decode_size(tview_len, p, end);
+  if (p)
+    p = decode_size(inslen, p, end);
+  if (p)
+    p = decode_size(newlen, p, end);
+
+  return p;
+}
+
+/* Return an error if the window header fields SVIEW_OFFSET, SVIEW_LEN,
+ * TVIEW_LEN, INSLEN and NEWLEN exceed the svndiff limits or overflow. */
+static svn_error_t *
+check_window_header(svn_filesize_t sview_offset,
+                    apr_size_t sview_len,
+                    apr_size_t tview_len,
+                    apr_size_t inslen,
+                    apr_size_t newlen)
+{
+  if (tview_len > SVN_DELTA_WINDOW_SIZE ||
+      sview_len > SVN_DELTA_WINDOW_SIZE ||
+      /* for svndiff1, newlen includes the original length */
+      newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
+      inslen > MAX_INSTRUCTION_SECTION_LEN)
+    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                            _("Svndiff contains a too-large window"));
+
+  /* Check for integer overflow.  */
+  if (sview_offset < 0 || inslen + newlen < inslen
+      || sview_len + tview_len < sview_len
+      || (apr_size_t)sview_offset + sview_len < (apr_size_t)sview_offset)
+    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                            _("Svndiff contains corrupt window header"));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 write_handler(void *baton,
               const char *buffer,
@@ -679,6 +1090,9 @@ write_handler(void *baton,
   while (1)
     {
       svn_txdelta_window_t window;
+      svn_error_t *err;
+      char *window_end;
+      char terminator;
 
       /* Read the header, if we have enough bytes for that.  */
       p = (const unsigned char *) db->buffer->data;
@@ -690,42 +1104,13 @@ write_handler(void *baton,
           apr_size_t sview_len, tview_len, inslen, newlen;
           const unsigned char *hdr_start = p;
 
-          p = decode_file_offset(&sview_offset, p, end);
+          p = decode_window_header(&sview_offset, &sview_len, &tview_len,
+                                   &inslen, &newlen, p, end);
           if (p == NULL)
               break;
 
-          p = decode_size(&sview_len, p, end);
-          if (p == NULL)
-              break;
-
-          p = decode_size(&tview_len, p, end);
-          if (p == NULL)
-              break;
-
-          p = decode_size(&inslen, p, end);
-          if (p == NULL)
-              break;
-
-          p = decode_size(&newlen, p, end);
-          if (p == NULL)
-              break;
-
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
-              /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
-            return svn_error_create(
-                     SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
-                     _("Svndiff contains a too-large window"));
-
-          /* Check for integer overflow.  */
-          if (sview_offset < 0 || inslen + newlen < inslen
-              || sview_len + tview_len < sview_len
-              || (apr_size_t)sview_offset + sview_len < (apr_size_t)sview_offset)
-            return svn_error_create(
-                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
-                      _("Svndiff contains corrupt window header"));
+          SVN_ERR(check_window_header(sview_offset, sview_len, tview_len,
+                                      inslen, newlen));
 
           /* Check for source windows which slide backwards.  */
           if (sview_len > 0
@@ -755,11 +1140,23 @@ write_handler(void *baton,
       if ((apr_size_t) (end - p) < db->inslen + db->newlen)
         return SVN_NO_ERROR;
 
+      /* The window will refer to our buffer for its new data, so
+         temporarily terminate that section.  This is safe as the window
+         does not outlive the consumer call and the byte that we replace
+         belongs to the next window or is the buffer's own terminator. */
+      window_end = (char *)p + db->inslen + db->newlen;
+      terminator = *window_end;
+      *window_end = '\0';
+
       /* Decode the window and send it off. */
-      SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
-                            db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
-      SVN_ERR(db->consumer_func(&window, db->consumer_baton));
+      err = decode_window(&window, db->sview_offset, db->sview_len,
+                          db->tview_len, db->inslen, db->newlen, p,
+                          db->subpool, db->version);
+      if (!err)
+        err = db->consumer_func(&window, db->consumer_baton);
+
+      *window_end = terminator;
+      SVN_ERR(err);
 
       p += db->inslen + db->newlen;
 
@@ -921,22 +1318,8 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
-      /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
-    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
-                            _("Svndiff contains a too-large window"));
-
-  /* Check for integer overflow.  */
-  if (*sview_offset < 0 || *inslen + *newlen < *inslen
-      || *sview_len + *tview_len < *sview_len
-      || (apr_size_t)*sview_offset + *sview_len < (apr_size_t)*sview_offset)
-    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
-                            _("Svndiff contains corrupt window header"));
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(check_window_header(*sview_offset, *sview_len,
+                                             *tview_len, *inslen, *newlen));
 }
 
 svn_error_t *
@@ -952,16 +1335,55 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
   len = inslen + newlen;
-  buf = apr_palloc(pool, len);
+  buf = apr_palloc(pool, len + 1);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
   if (len < inslen + newlen)
     return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
                             _("Unexpected end of svndiff input"));
+
+  /* The window's new data will refer to BUF. */
+  buf[len] = '\0';
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
                        newlen, buf, pool, svndiff_version);
 }
 
+svn_error_t *
+svn_txdelta__parse_svndiff_window(svn_txdelta_window_t **window,
+                                  const char *data,
+                                  apr_size_t len,
+                                  int svndiff_version,
+                                  apr_pool_t *pool)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end = p + len;
+  svn_filesize_t sview_offset;
+  apr_size_t sview_len, tview_len, inslen, newlen;
+
+  /* Parse the header the same way write_handler() does. */
+  p = decode_window_header(&sview_offset, &sview_len, &tview_len,
+                           &inslen, &newlen, p, end);
+  if (p == NULL)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of svndiff input"));
+
+  SVN_ERR(check_window_header(sview_offset, sview_len, tview_len,
+                              inslen, newlen));
+
+  /* The buffer must contain exactly one window. */
+  if ((apr_size_t)(end - p) < inslen + newlen)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of svndiff input"));
+  if ((apr_size_t)(end - p) > inslen + newlen)
+    return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                            _("Svndiff window is followed by extra data"));
+
+  /* For svndiff0, the new data section is the tail of DATA and our
+     caller guarantees DATA[LEN] to be 0. */
+  *window = apr_palloc(pool, sizeof(**window));
+  return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
+                       newlen, p, pool, svndiff_version);
+}
 
 svn_error_t *
 svn_txdelta_skip_svndiff_window(apr_file_t *file,
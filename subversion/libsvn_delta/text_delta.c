@@ -32,6 +32,7 @@
 #include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_sorts.h"
 
 #include "delta.h"
 
@@ -62,6 +63,16 @@ struct txdelta_baton {
   svn_checksum_t *checksum;     /* If non-NULL, the checksum of TARGET. */
 
   apr_pool_t *result_pool;      /* For results (e.g. checksum) */
+
+  /* Only used if the windows shall be matched against the whole source,
+   * see svn_txdelta3().  In that case, BUF starts with the current source
+   * view and the source stream is positioned directly behind it. */
+  svn_txdelta__source_index_t *index; /* Created upon the first window. */
+  svn_filesize_t view_offset;   /* Offset of the current source view. */
+  apr_size_t view_len;          /* Length of the current source view. */
+  char *tbuf;                   /* Target data of the next window. */
+  apr_size_t tbuf_len;          /* 0 if there is no pending target data. */
+  svn_filesize_t wanted_offset; /* Preferred source view offset for TBUF. */
 };
 
 
@@ -396,6 +407,121 @@ txdelta_next_window(svn_txdelta_window_t **window,
 }
 
 
+/* Make sure that B->BUF contains the source view starting at OFFSET with
+   a length of up to LEN bytes.  OFFSET must be within or directly behind
+   the current source view and the new view must not end before the
+   current one.  Update the view information in B accordingly. */
+static svn_error_t *
+move_source_view(struct txdelta_baton *b,
+                 svn_filesize_t offset,
+                 apr_size_t len)
+{
+  apr_size_t kept = (apr_size_t)(b->view_offset + b->view_len - offset);
+  apr_size_t to_read = len - kept;
+
+  memmove(b->buf, b->buf + (offset - b->view_offset), kept);
+  SVN_ERR(svn_stream_read_full(b->source, b->buf + kept, &to_read));
+  if (to_read != len - kept)
+    return svn_error_create(SVN_ERR_INCOMPLETE_DATA, NULL,
+                            "Delta source ended unexpectedly");
+
+  b->view_offset = offset;
+  b->view_len = kept + to_read;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_next_window_fn_t for svn_txdelta3() with a
+   source index.  Every target window will be matched against the source
+   view suggested by the index.  If that view lies behind the current one,
+   move there using intermediate windows that consume source data but
+   produce no target data.  Without those, svn_txdelta_apply() would not
+   be able to follow as it expects the source views to be adjacent. */
+static svn_error_t *
+txdelta_next_indexed_window(svn_txdelta_window_t **window,
+                            void *baton,
+                            apr_pool_t *pool)
+{
+  struct txdelta_baton *b = baton;
+  svn_filesize_t source_len, view_end, offset;
+
+  /* Upon the first call, read the whole source to build the index and
+     then start over. */
+  if (b->index == NULL)
+    {
+      svn_stream_mark_t *mark;
+
+      SVN_ERR(svn_stream_mark(b->source, &mark, pool));
+      SVN_ERR(svn_txdelta__source_index_create(&b->index, b->source,
+                                               b->result_pool, pool));
+      SVN_ERR(svn_stream_seek(b->source, mark));
+
+      b->tbuf = apr_palloc(b->result_pool, SVN_DELTA_WINDOW_SIZE);
+    }
+
+  /* Read the next chunk of target data, unless some is still pending. */
+  if (b->tbuf_len == 0)
+    {
+      b->tbuf_len = SVN_DELTA_WINDOW_SIZE;
+      SVN_ERR(svn_stream_read_full(b->target, b->tbuf, &b->tbuf_len));
+
+      if (b->tbuf_len == 0)
+        {
+          /* No target data?  We're done; return the final window. */
+          if (b->context != NULL)
+            SVN_ERR(svn_checksum_final(&b->checksum, b->context,
+                                       b->result_pool));
+
+          *window = NULL;
+          b->more = FALSE;
+          return SVN_NO_ERROR;
+        }
+      else if (b->context != NULL)
+        SVN_ERR(svn_checksum_update(b->context, b->tbuf, b->tbuf_len));
+
+      b->wanted_offset = svn_txdelta__source_index_find(b->index, b->tbuf,
+                                                        b->tbuf_len);
+    }
+
+  source_len = svn_txdelta__source_index_get_len(b->index);
+  view_end = b->view_offset + b->view_len;
+
+  /* Move forward in steps of up to one window until we can reach the
+     preferred source view. */
+  if (b->wanted_offset > view_end && view_end < source_len)
+    {
+      svn_txdelta__ops_baton_t build_baton = { 0 };
+
+      offset = MIN(b->wanted_offset, view_end + SVN_DELTA_WINDOW_SIZE);
+      offset = MIN(offset, source_len);
+      SVN_ERR(move_source_view(b, view_end,
+                               (apr_size_t)(offset - view_end)));
+
+      build_baton.new_data = svn_stringbuf_create_empty(pool);
+      *window = svn_txdelta__make_window(&build_baton, pool);
+      (*window)->sview_offset = b->view_offset;
+      (*window)->sview_len = b->view_len;
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Use the preferred source view, if we can.  Otherwise, stick with the
+     start of the current one.  Either way, make it as long as possible. */
+  offset = MAX(b->wanted_offset, b->view_offset);
+  offset = MIN(offset, view_end);
+  SVN_ERR(move_source_view(b, offset,
+                           (apr_size_t)MIN(SVN_DELTA_WINDOW_SIZE,
+                                           source_len - offset)));
+
+  memcpy(b->buf + b->view_len, b->tbuf, b->tbuf_len);
+  *window = compute_window(b->buf, b->view_len, b->tbuf_len,
+                           b->view_offset, pool);
+  b->tbuf_len = 0;
+
+  return SVN_NO_ERROR;
+}
+
+
 static const unsigned char *
 txdelta_md5_digest(void *baton)
 {
@@ -467,10 +593,11 @@ svn_txdelta_run(svn_stream_t *source,
 
 
 void
-svn_txdelta2(svn_txdelta_stream_t **stream,
+svn_txdelta3(svn_txdelta_stream_t **stream,
              svn_stream_t *source,
              svn_stream_t *target,
              svn_boolean_t calculate_checksum,
+             svn_boolean_t match_whole_source,
              apr_pool_t *pool)
 {
   struct txdelta_baton *b = apr_pcalloc(pool, sizeof(*b));
@@ -485,8 +612,12 @@ svn_txdelta2(svn_txdelta_stream_t **stream,
              : NULL;
   b->result_pool = pool;
 
-  *stream = svn_txdelta_stream_create(b, txdelta_next_window,
-                                      txdelta_md5_digest, pool);
+  if (match_whole_source && svn_stream_supports_mark(source))
+    *stream = svn_txdelta_stream_create(b, txdelta_next_indexed_window,
+                                        txdelta_md5_digest, pool);
+  else
+    *stream = svn_txdelta_stream_create(b, txdelta_next_window,
+                                        txdelta_md5_digest, pool);
 }
 
 void
@@ -495,7 +626,7 @@ svn_txdelta(svn_txdelta_stream_t **stream,
             svn_stream_t *target,
             apr_pool_t *pool)
 {
-  svn_txdelta2(stream, source, target, TRUE, pool);
+  svn_txdelta3(stream, source, target, TRUE, FALSE, pool);
 }
 
 
@@ -23,6 +23,7 @@
 
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include <apr_general.h>        /* for APR_INLINE */
 #include <apr_hash.h>
@@ -30,6 +31,7 @@
 #include "svn_hash.h"
 #include "svn_delta.h"
 #include "private/svn_string_private.h"
+#include "private/svn_simd.h"
 #include "delta.h"
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
@@ -77,10 +79,11 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 }
 
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
-   at DATA.  Return the checksum value.  */
+   at DATA.  Return the checksum value.  This is the scalar implementation
+   that init_adler32() falls back to.  */
 
 static APR_INLINE apr_uint32_t
-init_adler32(const char *data)
+init_adler32_scalar(const char *data)
 {
   const unsigned char *input = (const unsigned char *)data;
   const unsigned char *last = input + MATCH_BLOCKSIZE;
@@ -103,6 +106,100 @@ init_adler32(const char *data)
   return s2 * 0x10000 + s1;
 }
 
+#if SVN__SIMD_SSE2
+
+/* SSE2 implementation of init_adler32_scalar(). */
+static apr_uint32_t
+init_adler32_sse2(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ramp = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  int i;
+
+  /* S1 is the plain sum of all bytes while S2 is the sum of all bytes
+   * weighted by their distance from the end of the block, i.e. the first
+   * byte is weighted by MATCH_BLOCKSIZE and the last one by 1. */
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+      __m128i weights = _mm_sub_epi16(_mm_set1_epi16(MATCH_BLOCKSIZE - i),
+                                      ramp);
+
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(bytes, zero));
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero),
+                                            weights));
+      weights = _mm_sub_epi16(weights, _mm_set1_epi16(8));
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero),
+                                            weights));
+    }
+
+  /* Horizontal sums. */
+  s1 = _mm_add_epi64(s1, _mm_srli_si128(s1, 8));
+  s2 = _mm_add_epi32(s2, _mm_srli_si128(s2, 8));
+  s2 = _mm_add_epi32(s2, _mm_srli_si128(s2, 4));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+#endif
+
+#if SVN__SIMD_NEON
+
+/* NEON implementation of init_adler32_scalar(). */
+static apr_uint32_t
+init_adler32_neon(const char *data)
+{
+  static const uint8_t weights[MATCH_BLOCKSIZE] =
+    {
+      64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49,
+      48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33,
+      32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+      16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1
+    };
+
+  uint16x8_t s1 = vdupq_n_u16(0);
+  uint32x4_t s2 = vdupq_n_u32(0);
+  int i;
+
+  /* Same as in init_adler32_sse2. */
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      uint8x16_t bytes = vld1q_u8((const uint8_t *)data + i);
+      uint8x16_t weight = vld1q_u8(weights + i);
+
+      s1 = vpadalq_u8(s1, bytes);
+      s2 = vpadalq_u16(s2, vmull_u8(vget_low_u8(bytes),
+                                    vget_low_u8(weight)));
+      s2 = vpadalq_u16(s2, vmull_high_u8(bytes, weight));
+    }
+
+  return vaddvq_u32(s2) * 0x10000 + vaddlvq_u16(s1);
+}
+
+#endif
+
+/* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
+   at DATA.  Return the checksum value.  SIMD is the set of vector
+   instruction set extensions as returned by svn_simd__get_features().  */
+
+static APR_INLINE apr_uint32_t
+init_adler32(const char *data, apr_uint32_t simd)
+{
+#if SVN__SIMD_SSE2
+  if (simd & SVN_SIMD__SSE2)
+    return init_adler32_sse2(data);
+#endif
+#if SVN__SIMD_NEON
+  if (simd & SVN_SIMD__NEON)
+    return init_adler32_neon(data);
+#endif
+
+  return init_adler32_scalar(data);
+}
+
 /* Information for a block of the delta source.  The length of the
    block is the smaller of MATCH_BLOCKSIZE and the difference between
    the size of the source data and the position of this block. */
@@ -206,11 +303,13 @@ find_block(const struct blocks *blocks,
 
 /* Initialize the matches table from DATA of size DATALEN.  This goes
    through every block of MATCH_BLOCKSIZE bytes in the source and
-   checksums it, inserting the result into the BLOCKS table.  */
+   checksums it, inserting the result into the BLOCKS table.  SIMD
+   selects the checksum implementation as in init_adler32().  */
 static void
 init_blocks_table(const char *data,
                   apr_size_t datalen,
                   struct blocks *blocks,
+                  apr_uint32_t simd,
                   apr_pool_t *pool)
 {
   apr_size_t nblocks;
@@ -254,7 +353,7 @@ init_blocks_table(const char *data,
      not use that shorter block for deltification (only indirectly
      as an extension of some previous block). */
   for (i = 0; i + MATCH_BLOCKSIZE <= datalen; i += MATCH_BLOCKSIZE)
-    add_block(blocks, init_adler32(data + i), i);
+    add_block(blocks, init_adler32(data + i, simd), i);
 }
 
 /* Try to find a match for the target data B in BLOCKS, and then
@@ -294,14 +393,17 @@ find_match(const struct blocks *blocks,
                                     b + bpos + MATCH_BLOCKSIZE,
                                     max_delta);
 
-  /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
-     content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+  /* See if we can extend backwards (usually max MATCH_BLOCKSIZE-1 steps
+     because A's content has been sampled only every MATCH_BLOCKSIZE
+     positions).  */
+  max_delta = bpos - pending_insert_start < apos
+            ? bpos - pending_insert_start
+            : apos;
+  max_delta = svn_cstring__reverse_match_length(a + apos, b + bpos,
+                                                max_delta);
+  apos -= max_delta;
+  bpos -= max_delta;
+  delta += max_delta;
 
   *aposp = apos;
   *bposp = bpos;
@@ -378,6 +480,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   struct blocks blocks;
   apr_uint32_t rolling;
   apr_size_t lo = 0, pending_insert_start = 0, upper;
+  apr_uint32_t simd = svn_simd__get_features();
 
   /* Optimization: directly compare window starts. If more than 4
    * bytes match, we can immediately create a matching windows.
@@ -403,10 +506,10 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   upper = bsize - MATCH_BLOCKSIZE; /* this is now known to be >= LO */
 
   /* Initialize the matches table.  */
-  init_blocks_table(a, asize, &blocks, pool);
+  init_blocks_table(a, asize, &blocks, simd, pool);
 
   /* Initialize our rolling checksum.  */
-  rolling = init_adler32(b + lo);
+  rolling = init_adler32(b + lo, simd);
   while (lo < upper)
     {
       apr_size_t matchlen;
@@ -471,7 +574,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
            * Ignore short buffers at the end of B.
            */
           if (lo + MATCH_BLOCKSIZE <= bsize)
-            rolling = init_adler32(b + lo);
+            rolling = init_adler32(b + lo, simd);
         }
     }
 
@@ -479,6 +582,269 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   store_delta_trailer(build_baton, a, asize, b, bsize, pending_insert_start, pool);
 }
 
+
+
+/* Cross-window source index.
+ *
+ * Indexing every source block like init_blocks_table() does would be far
+ * too expensive for sources of several 100MB.  Instead, we pick "anchor"
+ * blocks based on their content, i.e. those whose checksum happens to
+ * fulfill IS_ANCHOR.  Because the same criterion is applied to the target
+ * data, common content will produce the same anchors on both sides
+ * without the need to align or verify anything.
+ */
+
+/* On average, one out of ANCHOR_DISTANCE positions will be an anchor.
+   Must be a power of 2. */
+#define ANCHOR_DISTANCE 1024
+
+/* Stop collecting anchor hits for a target window after that many. */
+#define MAX_ANCHOR_HITS 1024
+
+/* An anchor in the source, i.e. an entry in svn_txdelta__source_index_t. */
+typedef struct anchor_t
+{
+  /* Pseudo-adler32 checksum of the MATCH_BLOCKSIZE bytes at POS. */
+  apr_uint32_t adlersum;
+
+  /* Offset of the anchor block within the source.  -1 for unused slots. */
+  svn_filesize_t pos;
+} anchor_t;
+
+struct svn_txdelta__source_index_t
+{
+  /* Open addressing hash table of all anchors.  Has MAX+1 entries. */
+  anchor_t *slots;
+
+  /* Largest valid index in SLOTS. */
+  apr_uint32_t max;
+
+  /* Number of used entries in SLOTS. */
+  apr_uint32_t used;
+
+  /* Total length of the source. */
+  svn_filesize_t source_len;
+
+  /* Pool to allocate SLOTS from. */
+  apr_pool_t *pool;
+};
+
+/* Return TRUE if the block with the pseudo-adler32 checksum ADLERSUM
+   shall be used as an anchor. */
+static APR_INLINE svn_boolean_t
+is_anchor(apr_uint32_t adlersum)
+{
+  /* Multiplicative hashing mixes all bits into the upper ones. */
+  return ((adlersum * 0x9e3779b1u) >> 22) == 0;
+}
+
+/* Allocate SLOT_COUNT empty slots in SOURCE_INDEX. */
+static void
+alloc_anchor_slots(svn_txdelta__source_index_t *source_index,
+                   apr_uint32_t slot_count)
+{
+  apr_uint32_t i;
+
+  source_index->max = slot_count - 1;
+  source_index->slots = apr_palloc(source_index->pool,
+                                   slot_count * sizeof(*source_index->slots));
+  for (i = 0; i < slot_count; ++i)
+    {
+      source_index->slots[i].adlersum = 0;
+      source_index->slots[i].pos = -1;
+    }
+}
+
+/* Insert an anchor with checksum ADLERSUM at POS into SOURCE_INDEX.  If
+   there is
+   already an anchor with the same checksum, keep the old one. */
+static void
+add_anchor(svn_txdelta__source_index_t *source_index,
+           apr_uint32_t adlersum,
+           svn_filesize_t pos)
+{
+  apr_uint32_t h;
+
+  /* Keep the load factor below 50%. */
+  if (source_index->used >= source_index->max / 2)
+    {
+      anchor_t *old_slots = source_index->slots;
+      apr_uint32_t old_count = source_index->max + 1;
+      apr_uint32_t i;
+
+      alloc_anchor_slots(source_index, 2 * old_count);
+      source_index->used = 0;
+      for (i = 0; i < old_count; ++i)
+        if (old_slots[i].pos != -1)
+          add_anchor(source_index, old_slots[i].adlersum, old_slots[i].pos);
+    }
+
+  for (h = hash_func(adlersum) & source_index->max;
+       source_index->slots[h].pos != -1;
+       h = (h + 1) & source_index->max)
+    if (source_index->slots[h].adlersum == adlersum)
+      return;
+
+  source_index->slots[h].adlersum = adlersum;
+  source_index->slots[h].pos = pos;
+  ++source_index->used;
+}
+
+/* Return the source position of the anchor with checksum ADLERSUM in
+   SOURCE_INDEX or -1 if there is no such anchor. */
+static svn_filesize_t
+find_anchor(const svn_txdelta__source_index_t *source_index,
+            apr_uint32_t adlersum)
+{
+  apr_uint32_t h;
+
+  for (h = hash_func(adlersum) & source_index->max;
+       source_index->slots[h].pos != -1;
+       h = (h + 1) & source_index->max)
+    if (source_index->slots[h].adlersum == adlersum)
+      return source_index->slots[h].pos;
+
+  return -1;
+}
+
+svn_error_t *
+svn_txdelta__source_index_create(svn_txdelta__source_index_t **index_p,
+                                 svn_stream_t *source,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  svn_txdelta__source_index_t *source_index
+    = apr_pcalloc(result_pool, sizeof(*source_index));
+  apr_uint32_t simd = svn_simd__get_features();
+
+  /* Read buffer.  Its first MATCH_BLOCKSIZE - 1 bytes carry over the end
+     of the previous chunk such that we can roll the checksum across
+     chunk boundaries. */
+  char *buffer = apr_palloc(scratch_pool,
+                            SVN_DELTA_WINDOW_SIZE + MATCH_BLOCKSIZE);
+  apr_size_t carry = 0;
+
+  source_index->pool = result_pool;
+  alloc_anchor_slots(source_index, 1024);
+
+  while (TRUE)
+    {
+      apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+      apr_size_t end, pos;
+      apr_uint32_t rolling;
+
+      SVN_ERR(svn_stream_read_full(source, buffer + carry, &len));
+      source_index->source_len += len;
+      end = carry + len;
+
+      if (end >= MATCH_BLOCKSIZE)
+        {
+          /* Check every block that ends within the data just read. */
+          rolling = init_adler32(buffer, simd);
+          for (pos = 0; TRUE; ++pos)
+            {
+              if (is_anchor(rolling))
+                add_anchor(source_index, rolling,
+                           source_index->source_len - end + pos);
+
+              if (pos + MATCH_BLOCKSIZE == end)
+                break;
+
+              rolling = adler32_replace(rolling, buffer[pos],
+                                        buffer[pos + MATCH_BLOCKSIZE]);
+            }
+
+          carry = MATCH_BLOCKSIZE - 1;
+        }
+      else
+        carry = end;
+
+      if (len < SVN_DELTA_WINDOW_SIZE)
+        break;
+
+      memmove(buffer, buffer + end - carry, carry);
+    }
+
+  *index_p = source_index;
+  return SVN_NO_ERROR;
+}
+
+svn_filesize_t
+svn_txdelta__source_index_get_len(
+  const svn_txdelta__source_index_t *source_index)
+{
+  return source_index->source_len;
+}
+
+/* Sort callback comparing svn_filesize_t values. */
+static int
+compare_offsets(const void *lhs,
+                const void *rhs)
+{
+  svn_filesize_t lhs_offset = *(const svn_filesize_t *)lhs;
+  svn_filesize_t rhs_offset = *(const svn_filesize_t *)rhs;
+
+  return lhs_offset < rhs_offset ? -1 : (lhs_offset > rhs_offset ? 1 : 0);
+}
+
+svn_filesize_t
+svn_txdelta__source_index_find(const svn_txdelta__source_index_t *source_index,
+                               const char *data,
+                               apr_size_t len)
+{
+  svn_filesize_t offsets[MAX_ANCHOR_HITS];
+  int count = 0;
+  int best = 0, best_count = 0;
+  int first, last;
+  apr_size_t pos;
+  apr_uint32_t rolling;
+
+  if (len < MATCH_BLOCKSIZE || source_index->used == 0)
+    return -1;
+
+  /* Find all anchors and remember at which source offset a view would
+     need to start to align the anchor in the source with the one in the
+     target. */
+  rolling = init_adler32(data, svn_simd__get_features());
+  for (pos = 0; count < MAX_ANCHOR_HITS; ++pos)
+    {
+      if (is_anchor(rolling))
+        {
+          svn_filesize_t source_pos = find_anchor(source_index, rolling);
+          if (source_pos != -1)
+            offsets[count++] = source_pos - (svn_filesize_t)pos;
+        }
+
+      if (pos + MATCH_BLOCKSIZE == len)
+        break;
+
+      rolling = adler32_replace(rolling, data[pos],
+                                data[pos + MATCH_BLOCKSIZE]);
+    }
+
+  if (count == 0)
+    return -1;
+
+  /* Anchors that got moved by the same edit will report (almost) the same
+     offset.  Return the start of the largest cluster.  Since anchors are
+     not being verified, some of them will be bogus but those should not
+     form larger clusters. */
+  qsort(offsets, count, sizeof(*offsets), compare_offsets);
+  for (first = 0, last = 0; last < count; ++last)
+    {
+      while (offsets[last] - offsets[first] >= ANCHOR_DISTANCE)
+        ++first;
+
+      if (last - first + 1 > best_count)
+        {
+          best = first;
+          best_count = last - first + 1;
+        }
+    }
+
+  return offsets[best] < 0 ? 0 : offsets[best];
+}
+
 void
 svn_txdelta__xdelta(svn_txdelta__ops_baton_t *build_baton,
                     const char *data,
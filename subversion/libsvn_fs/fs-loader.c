@@ -43,6 +43,7 @@
 #include "svn_sorts.h"
 
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
@@ -1663,6 +1664,82 @@ svn_fs_info_config_files(apr_array_header_t **files,
                                                        scratch_pool));
 }
 
+svn_error_t *
+svn_fs__warm_caches(const char *snapshot_path,
+                    apr_hash_t *fs_config,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *records;
+  svn_stream_t *stream;
+  struct fs_type_defn *fst;
+  svn_error_t *err;
+
+  /* No snapshot, no warm-up. */
+  err = svn_stream_open_readonly(&stream, snapshot_path, scratch_pool,
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  SVN_ERR(svn_cache__load_keys(&records, stream, scratch_pool,
+                               scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  /* BDB does not use the membuffer cache, so only check the modules
+     in front of it. */
+  for (fst = fs_modules; fst && fst != &base_defn; fst = fst->next)
+    {
+      fs_library_vtable_t *vtable;
+      apr_array_header_t *paths;
+      int i;
+
+      /* Modules that are not available can't have cached anything. */
+      err = get_library_vtable_direct(&vtable, fst, scratch_pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          continue;
+        }
+
+      if (!vtable->cached_fs_paths)
+        continue;
+
+      SVN_ERR(vtable->cached_fs_paths(&paths, records, scratch_pool,
+                                      scratch_pool));
+      for (i = 0; i < paths->nelts; ++i)
+        {
+          const char *path = APR_ARRAY_IDX(paths, i, const char *);
+          svn_fs_t *fs;
+
+          svn_pool_clear(iterpool);
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          /* Repositories may have been moved or deleted in the meantime.
+             Anything but cancellation is therefore not fatal. */
+          err = svn_fs_open2(&fs, path, fs_config, iterpool, iterpool);
+          if (!err && fs->vtable->warm_caches)
+            err = fs->vtable->warm_caches(fs, records, cancel_func,
+                                          cancel_baton, iterpool);
+
+          if (err && err->apr_err == SVN_ERR_CANCELLED)
+            return svn_error_trace(err);
+
+          svn_error_clear(err);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_deltify_revision(svn_fs_t *fs, svn_revnum_t revision, apr_pool_t *pool)
 {
@@ -159,6 +159,12 @@ typedef struct fs_library_vtable_t
   /* For svn_fs_info_fsfs_dup(). */
   void *(*info_fsap_dup)(const void *fsap_info,
                          apr_pool_t *result_pool);
+  /* For svn_fs__warm_caches().  Return the paths of all repositories of
+     this FSAP that are referenced by the cache key records. */
+  svn_error_t *(*cached_fs_paths)(apr_array_header_t **paths,
+                                  const apr_array_header_t *records,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
 } fs_library_vtable_t;
 
 /* This is the type of symbol an FS module defines to fetch the
@@ -266,6 +272,11 @@ typedef struct fs_vtable_t
   svn_error_t *(*bdb_set_errcall)(svn_fs_t *fs,
                                   void (*handler)(const char *errpfx,
                                                   char *msg));
+  svn_error_t *(*warm_caches)(svn_fs_t *fs,
+                              const apr_array_header_t *records,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool);
 } fs_vtable_t;
 
 
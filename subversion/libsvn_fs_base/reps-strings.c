@@ -1465,7 +1465,8 @@ svn_fs_base__rep_deltify(svn_fs_t *fs,
                                                 TRUE, trail, pool));
 
   /* Setup a stream to convert the textdelta data into svndiff windows. */
-  svn_txdelta2(&txdelta_stream, source_stream, target_stream, TRUE, pool);
+  svn_txdelta3(&txdelta_stream, source_stream, target_stream, TRUE, FALSE,
+               pool);
 
   if (bfd->format >= SVN_FS_BASE__MIN_SVNDIFF1_FORMAT)
     svn_txdelta_to_svndiff3(&new_target_handler, &new_target_handler_baton,
@@ -1252,8 +1252,7 @@ parse_raw_window(void **out,
                  void *baton,
                  apr_pool_t *result_pool)
 {
-  svn_string_t raw_window;
-  svn_stream_t *stream;
+  const char *raw_data;
 
   /* unparsed and parsed window */
   const svn_fs_fs__raw_cached_window_t *window
@@ -1261,15 +1260,19 @@ parse_raw_window(void **out,
   svn_fs_fs__txdelta_cached_window_t *result
     = apr_pcalloc(result_pool, sizeof(*result));
 
-  /* create a read stream taking the raw window as input */
-  raw_window.data = svn_temp_deserializer__ptr(window,
+  /* The raw window data lives in the cache and is only valid during this
+   * call.  Compressed windows get decompressed into RESULT_POOL anyway,
+   * so we may parse them in-place.  Uncompressed windows will refer to
+   * the buffer that we parse, so copy the data once. */
+  raw_data = svn_temp_deserializer__ptr(window,
                                 (const void * const *)&window->window.data);
-  raw_window.len = window->window.len;
-  stream = svn_stream_from_string(&raw_window, result_pool);
+  if (window->ver == 0)
+    raw_data = apr_pstrmemdup(result_pool, raw_data, window->window.len);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, window->ver,
-                                          result_pool));
+  SVN_ERR(svn_txdelta__parse_svndiff_window(&result->window, raw_data,
+                                            window->window.len, window->ver,
+                                            result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1672,6 +1675,23 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Return TRUE if get_combined_window() must produce the plain text
+   window for the I-th element in the RS_LIST of RB, so it can be put
+   into the combined window cache. */
+static svn_boolean_t
+must_cache_combined_window(struct rep_read_baton *rb,
+                           int i)
+{
+  rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+
+  /* Cache windows only if the whole rep content could be read as a
+     single chunk.  Only then will no other chunk need a deeper RS
+     list than the cached chunk. */
+  return rs->combined_cache
+      && (rb->chunk_index == 0) && (rs->current == rs->size)
+      && SVN_IS_VALID_REVNUM(rs->revision);
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1680,8 +1700,9 @@ get_combined_window(svn_stringbuf_t **result,
                     struct rep_read_baton *rb)
 {
   apr_pool_t *pool, *new_pool, *window_pool;
-  int i;
+  int i, last;
   apr_array_header_t *windows;
+  const svn_txdelta_window_t **chain;
   svn_stringbuf_t *source, *buf = rb->base_window;
   rep_state_t *rs;
   apr_pool_t *iterpool;
@@ -1711,16 +1732,32 @@ get_combined_window(svn_stringbuf_t **result,
         }
     }
 
-  /* Combine in the windows from the other delta reps. */
+  /* Combine in the windows from the other delta reps.
+     Instead of applying them one-by-one, compose all windows up to the
+     next one whose result we want to cache into a single window and
+     apply that one. */
+  chain = apr_palloc(window_pool, windows->nelts * sizeof(*chain));
   pool = svn_pool_create(rb->pool);
-  for (--i; i >= 0; --i)
+  for (--i; i >= 0; i = last - 1)
     {
       svn_txdelta_window_t *window;
+      int k;
 
       svn_pool_clear(iterpool);
 
-      rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
-      window = APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *);
+      /* Windows LAST to I will be combined in this iteration. */
+      for (last = i; last > 0; --last)
+        if (must_cache_combined_window(rb, last))
+          break;
+
+      for (k = i; k >= last; --k)
+        chain[i - k] = APR_ARRAY_IDX(windows, k, svn_txdelta_window_t *);
+
+      if (last == i)
+        window = APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *);
+      else
+        window = svn_txdelta__compose_window_chain(chain, i - last + 1,
+                                                   iterpool);
 
       /* Maybe, we've got a PLAIN start representation.  If we do, read
          as much data from it as the needed for the txdelta window's source
@@ -1754,14 +1791,12 @@ get_combined_window(svn_stringbuf_t **result,
                                 _("svndiff window length is "
                                   "corrupt"));
 
-      /* Cache windows only if the whole rep content could be read as a
-         single chunk.  Only then will no other chunk need a deeper RS
-         list than the cached chunk. */
-      if (   (rb->chunk_index == 0) && (rs->current == rs->size)
-          && SVN_IS_VALID_REVNUM(rs->revision))
+      rs = APR_ARRAY_IDX(rb->rs_list, last, rep_state_t *);
+      if (must_cache_combined_window(rb, last))
         SVN_ERR(set_cached_combined_window(buf, rs, new_pool));
 
-      rs->chunk_index++;
+      for (k = i; k >= last; --k)
+        APR_ARRAY_IDX(rb->rs_list, k, rep_state_t *)->chunk_index++;
 
       /* Cycle pools so that we only need to hold three windows at a time. */
       svn_pool_destroy(pool);
@@ -2538,7 +2573,7 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   /* Because source and target stream will already verify their content,
    * there is no need to do this once more.  In particular if the stream
    * content is being fetched from cache. */
-  svn_txdelta2(stream_p, source_stream, target_stream, FALSE, pool);
+  svn_txdelta3(stream_p, source_stream, target_stream, FALSE, FALSE, pool);
 
   return SVN_NO_ERROR;
 }
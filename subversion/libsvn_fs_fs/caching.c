@@ -22,6 +22,7 @@
 
 #include "fs.h"
 #include "fs_fs.h"
+#include "cached_data.h"
 #include "id.h"
 #include "dag.h"
 #include "tree.h"
@@ -39,6 +40,11 @@
 #include "private/svn_debug.h"
 #include "private/svn_subr_private.h"
 
+/* Evicted fulltexts and combined windows of at least this size will be
+ * kept in the on-disk cache tier, if there is one.  Smaller items are
+ * cheap enough to reconstruct. */
+#define DEMOTION_MIN_SIZE 0x1000
+
 /* Take the ORIGINAL string and replace all occurrences of ":" without
  * limiting the key space.  Allocate the result in POOL.
  */
@@ -66,6 +72,33 @@ normalize_key_part(const char *original,
   return normalized->data;
 }
 
+/* Reverse normalize_key_part() for the first LEN bytes of NORMALIZED.
+ * Allocate the result in POOL.
+ */
+static const char *
+denormalize_key_part(const char *normalized,
+                     apr_size_t len,
+                     apr_pool_t *pool)
+{
+  apr_size_t i;
+  svn_stringbuf_t *original = svn_stringbuf_create_ensure(len, pool);
+
+  for (i = 0; i < len; ++i)
+    {
+      char c = normalized[i];
+      if (c == '%' && i + 1 < len)
+        {
+          c = normalized[++i];
+          if (c == '_')
+            c = ':';
+        }
+
+      svn_stringbuf_appendbyte(original, c);
+    }
+
+  return original->data;
+}
+
 /* *CACHE_TXDELTAS, *CACHE_FULLTEXTS, *CACHE_NODEPROPS flags will be set
    according to FS->CONFIG. *CACHE_NAMESPACE receives the cache prefix to
    use.
@@ -128,6 +161,51 @@ read_config(const char **cache_namespace,
 }
 
 
+/* Return the key prefix shared by all caches of FS within the cache
+ * namespace CACHE_NAMESPACE.  Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_cache_prefix(svn_fs_t *fs,
+                 const char *cache_namespace,
+                 apr_pool_t *result_pool)
+{
+  return apr_pstrcat(result_pool,
+                     "ns:", cache_namespace,
+                     ":fsfs:", fs->uuid,
+                     "/", normalize_key_part(fs->path, result_pool),
+                     ":",
+                     SVN_VA_NULL);
+}
+
+/* Return the name of the membuffer cache quota partition for FS.
+ * Unlike the cache prefix, it does not depend on the cache namespace,
+ * i.e. all caches of the same repository share the same partition.
+ * Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_cache_partition(svn_fs_t *fs,
+                    apr_pool_t *result_pool)
+{
+  return apr_pstrcat(result_pool,
+                     "fsfs:", fs->uuid,
+                     "/", normalize_key_part(fs->path, result_pool),
+                     SVN_VA_NULL);
+}
+
+/* Return the name of the membuffer cache statistics category for the
+ * cache with the given PREFIX.  All our prefixes end with ":<cache type>",
+ * so all caches of the same type get reported together, regardless of
+ * repository.  Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_cache_category(const char *prefix,
+                   apr_pool_t *result_pool)
+{
+  const char *type = strrchr(prefix, ':');
+  return apr_pstrcat(result_pool, "fsfs:", type ? type + 1 : prefix,
+                     SVN_VA_NULL);
+}
+
 /* Implements svn_cache__error_handler_t
  * This variant clears the error after logging it.
  */
@@ -278,7 +356,8 @@ init_callbacks(svn_cache__t *cache,
 
 /* Sets *CACHE_P to cache instance based on provided options.
  * Creates memcache if MEMCACHE is not NULL. Creates membuffer cache if
- * MEMBUFFER is not NULL. Fallbacks to inprocess cache if MEMCACHE and
+ * MEMBUFFER is not NULL and puts it into FS' memory quota partition.
+ * Fallbacks to inprocess cache if MEMCACHE and
  * MEMBUFFER are NULL and pages is non-zero.  Sets *CACHE_P to NULL
  * otherwise.  Use the given PRIORITY class for the new cache.  If it
  * is 0, then use the default priority class.  HAS_NAMESPACE indicates
@@ -306,6 +385,7 @@ create_cache(svn_cache__t **cache_p,
              apr_pool_t *result_pool,
              apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_cache__error_handler_t error_handler = no_handler
                                            ? NULL
                                            : warn_and_fail_on_cache_errors;
@@ -329,6 +409,18 @@ create_cache(svn_cache__t **cache_p,
                 cache_p, membuffer, serializer, deserializer,
                 klen, prefix, priority, FALSE, has_namespace,
                 result_pool, scratch_pool));
+
+      /* Account for the data of all repositories individually and apply
+       * the configured quota (if any). */
+      SVN_ERR(svn_cache__membuffer_set_partition(
+                *cache_p, get_cache_partition(fs, scratch_pool),
+                (apr_uint64_t)ffd->memory_quota * 0x100000,
+                ffd->hard_memory_quota, scratch_pool));
+
+      /* Report cache statistics per cache type. */
+      SVN_ERR(svn_cache__membuffer_set_category(
+                *cache_p, get_cache_category(prefix, scratch_pool),
+                scratch_pool));
     }
   else if (pages)
     {
@@ -351,11 +443,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  const char *prefix = apr_pstrcat(pool,
-                                   "fsfs:", fs->uuid,
-                                   "/", normalize_key_part(fs->path, pool),
-                                   ":",
-                                   SVN_VA_NULL);
+  const char *prefix;
   svn_membuffer_t *membuffer;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
@@ -372,7 +460,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                       fs,
                       pool));
 
-  prefix = apr_pstrcat(pool, "ns:", cache_namespace, ":", prefix, SVN_VA_NULL);
+  prefix = get_cache_prefix(fs, cache_namespace, pool);
   has_namespace = strlen(cache_namespace) > 0;
 
   membuffer = svn_cache__get_global_membuffer_cache();
@@ -547,6 +635,12 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            no_handler,
                            fs->pool, pool));
 
+      /* Reconstructing large fulltexts from their delta chains is
+       * expensive.  Prefer re-reading them from the on-disk tier. */
+      if (membuffer && !ffd->memcache)
+        SVN_ERR(svn_cache__membuffer_set_demotion(ffd->fulltext_cache,
+                                                  DEMOTION_MIN_SIZE, pool));
+
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
                            membuffer,
@@ -654,6 +748,10 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+
+      if (membuffer)
+        SVN_ERR(svn_cache__membuffer_set_demotion(ffd->combined_window_cache,
+                                                  DEMOTION_MIN_SIZE, pool));
     }
   else
     {
@@ -897,3 +995,224 @@ svn_fs_fs__reset_txn_caches(svn_fs_t *fs)
   fs_fs_data_t *ffd = fs->fsap_data;
   ffd->txn_dir_cache = NULL;
 }
+
+svn_error_t *
+svn_fs_fs__cached_fs_paths(apr_array_header_t **paths,
+                           const apr_array_header_t *records,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  apr_hash_t *found = apr_hash_make(scratch_pool);
+  const char *last_prefix = NULL;
+  int i;
+
+  *paths = apr_array_make(result_pool, 1, sizeof(const char *));
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      const char *start;
+      const char *end;
+      const char *path;
+
+      /* Records of the same cache share the same prefix string. */
+      if (record->prefix == last_prefix)
+        continue;
+      last_prefix = record->prefix;
+
+      /* The prefix is "ns:<namespace>:fsfs:<uuid>/<path>:<cache type>",
+       * see get_cache_prefix().  Namespace and path have been normalized,
+       * i.e. they don't contain ':', and UUIDs don't contain '/'. */
+      if (strncmp(record->prefix, "ns:", 3) != 0)
+        continue;
+
+      start = strchr(record->prefix + 3, ':');
+      if (!start || strncmp(start, ":fsfs:", 6) != 0)
+        continue;
+
+      start = strchr(start + 6, '/');
+      end = start ? strchr(start, ':') : NULL;
+      if (!end)
+        continue;
+
+      path = denormalize_key_part(start + 1, end - start - 1, scratch_pool);
+      if (!svn_hash_gets(found, path))
+        {
+          svn_hash_sets(found, path, path);
+          APR_ARRAY_PUSH(*paths, const char *) = apr_pstrdup(result_pool,
+                                                             path);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the node revision with the cache key KEY from FS.  Also read its
+ * directory contents, text and properties if their keys are in DIRS,
+ * TEXTS and PROPS, respectively.  This populates the respective caches.
+ * Use CANCEL_FUNC and CANCEL_BATON to check for cancellation while
+ * reading the text.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+warm_node_revision(svn_fs_t *fs,
+                   const pair_cache_key_t *key,
+                   apr_hash_t *dirs,
+                   apr_hash_t *texts,
+                   apr_hash_t *props,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__id_part_t unused = { 0 };
+  svn_fs_fs__id_part_t rev_item;
+  node_revision_t *noderev;
+  pair_cache_key_t rep_key = { 0 };
+
+  /* Node and copy IDs are not part of the cache key and not needed to
+   * read the node revision. */
+  rev_item.revision = key->revision;
+  rev_item.number = key->second;
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs,
+                                       svn_fs_fs__id_rev_create(&unused,
+                                                                &unused,
+                                                                &rev_item,
+                                                                scratch_pool),
+                                       scratch_pool, scratch_pool));
+
+  if (noderev->data_rep && SVN_IS_VALID_REVNUM(noderev->data_rep->revision))
+    {
+      rep_key.revision = noderev->data_rep->revision;
+      rep_key.second = noderev->data_rep->item_index;
+
+      if (   noderev->kind == svn_node_dir
+          && apr_hash_get(dirs, &rep_key, sizeof(rep_key)))
+        {
+          apr_array_header_t *entries;
+          SVN_ERR(svn_fs_fs__rep_contents_dir(&entries, fs, noderev,
+                                              scratch_pool, scratch_pool));
+        }
+      else if (   noderev->kind == svn_node_file
+               && apr_hash_get(texts, &rep_key, sizeof(rep_key)))
+        {
+          svn_stream_t *contents;
+          SVN_ERR(svn_fs_fs__get_contents(&contents, fs, noderev->data_rep,
+                                          TRUE, scratch_pool));
+          SVN_ERR(svn_stream_copy3(contents, svn_stream_empty(scratch_pool),
+                                   cancel_func, cancel_baton,
+                                   scratch_pool));
+        }
+    }
+
+  if (noderev->prop_rep && SVN_IS_VALID_REVNUM(noderev->prop_rep->revision))
+    {
+      rep_key.revision = noderev->prop_rep->revision;
+      rep_key.second = noderev->prop_rep->item_index;
+
+      if (apr_hash_get(props, &rep_key, sizeof(rep_key)))
+        {
+          apr_hash_t *proplist;
+          SVN_ERR(svn_fs_fs__get_proplist(&proplist, fs, noderev,
+                                          scratch_pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__warm_caches(svn_fs_t *fs,
+                       const apr_array_header_t *records,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *dirs = apr_hash_make(scratch_pool);
+  apr_hash_t *texts = apr_hash_make(scratch_pool);
+  apr_hash_t *props = apr_hash_make(scratch_pool);
+  svn_boolean_t cache_txdeltas;
+  svn_boolean_t cache_fulltexts;
+  svn_boolean_t cache_nodeprops;
+  const char *cache_namespace;
+  const char *prefix;
+  apr_size_t prefix_len;
+  int i;
+
+  SVN_ERR(read_config(&cache_namespace,
+                      &cache_txdeltas,
+                      &cache_fulltexts,
+                      &cache_nodeprops,
+                      fs,
+                      scratch_pool));
+  prefix = get_cache_prefix(fs, cache_namespace, scratch_pool);
+  prefix_len = strlen(prefix);
+
+  /* Directories, texts and properties can only be found through their
+   * node revisions.  So, collect their keys first. */
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      const char *type = record->prefix + prefix_len;
+
+      if (   strncmp(record->prefix, prefix, prefix_len) != 0
+          || record->key_len < sizeof(pair_cache_key_t))
+        continue;
+
+      if (strcmp(type, "DIR") == 0)
+        apr_hash_set(dirs, record->key, sizeof(pair_cache_key_t), record);
+      else if (strcmp(type, "TEXT") == 0)
+        apr_hash_set(texts, record->key, sizeof(pair_cache_key_t), record);
+      else if (strcmp(type, "PROP") == 0)
+        apr_hash_set(props, record->key, sizeof(pair_cache_key_t), record);
+    }
+
+  /* Replay, most frequently used items first.  Index pages, rep headers
+   * etc. will be loaded along the way. */
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      const char *type = record->prefix + prefix_len;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      if (strncmp(record->prefix, prefix, prefix_len) != 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      if (   strcmp(type, "RRI") == 0
+          && record->key_len >= sizeof(svn_revnum_t))
+        {
+          svn_revnum_t revision;
+          svn_fs_id_t *root_id;
+
+          memcpy(&revision, record->key, sizeof(revision));
+          err = svn_fs_fs__rev_get_root(&root_id, fs, revision,
+                                        iterpool, iterpool);
+        }
+      else if (   strcmp(type, "NODEREVS") == 0
+               && record->key_len >= sizeof(pair_cache_key_t))
+        {
+          pair_cache_key_t key;
+
+          memcpy(&key, record->key, sizeof(key));
+          err = warm_node_revision(fs, &key, dirs, texts, props,
+                                   cancel_func, cancel_baton, iterpool);
+        }
+
+      /* The repository may have changed since the snapshot was taken,
+       * e.g. because it has been packed.  Skip items that we can't read
+       * anymore. */
+      if (err && err->apr_err == SVN_ERR_CANCELLED)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -46,6 +46,7 @@
 #include "util.h"
 #include "verify.h"
 #include "svn_private_config.h"
+#include "private/svn_batch_fsync.h"
 #include "private/svn_fs_util.h"
 
 #include "../libsvn_fs/fs-loader.h"
@@ -279,7 +280,8 @@ static fs_vtable_t fs_vtable = {
   fs_info,
   svn_fs_fs__verify_root,
   fs_freeze,
-  fs_set_errcall
+  fs_set_errcall,
+  svn_fs_fs__warm_caches
 };
 
 
@@ -602,7 +604,8 @@ static fs_library_vtable_t library_vtable = {
   fs_logfiles,
   NULL /* parse_id */,
   fs_set_svn_fs_open,
-  fs_info_dup
+  fs_info_dup,
+  svn_fs_fs__cached_fs_paths
 };
 
 svn_error_t *
@@ -625,6 +628,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_batch_fsync__init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -100,6 +100,8 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_MEMORY_QUOTA       "memory-quota"
+#define CONFIG_OPTION_HARD_MEMORY_QUOTA  "hard-memory-quota"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -119,6 +121,7 @@ extern "C" {
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_COMPRESSION_THREADS "compression-threads"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -360,6 +363,14 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Maximum number of MB that this repository's data shall occupy in the
+     shared membuffer cache.  0 means "no limit". */
+  apr_int64_t memory_quota;
+
+  /* If TRUE, data exceeding MEMORY_QUOTA will not be cached at all.
+     Otherwise, it is merely the first to be evicted. */
+  svn_boolean_t hard_memory_quota;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -499,6 +510,9 @@ typedef struct fs_fs_data_t
   /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Maximum number of txdelta windows to compress concurrently. */
+  int delta_compression_threads;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
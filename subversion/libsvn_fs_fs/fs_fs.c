@@ -747,6 +747,7 @@ read_config(fs_fs_data_t *ffd,
             apr_pool_t *scratch_pool)
 {
   svn_config_t *config;
+  apr_int64_t compression_threads;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -925,6 +926,12 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  SVN_ERR(svn_config_get_int64(config, &compression_threads,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_COMPRESSION_THREADS, 1));
+  ffd->delta_compression_threads
+    = (int)MIN(MAX(1, compression_threads), SVN_THREAD_POOL__MAX_THREADS);
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -945,6 +952,14 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  SVN_ERR(svn_config_get_int64(config, &ffd->memory_quota,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_MEMORY_QUOTA, 0));
+  ffd->memory_quota = MAX(0, ffd->memory_quota);
+  SVN_ERR(svn_config_get_bool(config, &ffd->hard_memory_quota,
+                              CONFIG_SECTION_CACHES,
+                              CONFIG_OPTION_HARD_MEMORY_QUOTA, FALSE));
+
   return SVN_NO_ERROR;
 }
 
@@ -977,6 +992,18 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### All repositories served by the same process share the same in-memory"   NL
+"### cache.  To prevent a single busy repository from evicting the data of"  NL
+"### all others, its share of that cache can be limited to a given number"   NL
+"### of MB.  Usage is always being tracked per repository, regardless of"    NL
+"### whether a quota has been set.  The default is 0, meaning no limit."     NL
+"# " CONFIG_OPTION_MEMORY_QUOTA " = 0"                                       NL
+"### By default, the quota is a soft limit: Data exceeding it may still"     NL
+"### be cached but will be the first to be evicted when memory becomes"      NL
+"### scarce.  Uncomment this line to not cache data exceeding the quota"     NL
+"### at all."                                                                NL
+"# " CONFIG_OPTION_HARD_MEMORY_QUOTA " = true"                               NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1079,6 +1106,18 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### Compressing large files can make commits CPU-bound.  Values above 1"   NL
+"### allow the delta windows of a single file to be compressed in parallel"  NL
+"### while it is being written.  Larger values keep more windows of each"    NL
+"### file in flight.  The compression itself runs on a single pool of 16"    NL
+"### threads that is shared by all files written by the process, i.e. the"   NL
+"### effective parallelism per file may be lower than the value given."      NL
+"### This setting has no effect on the resulting data and is ignored if"     NL
+"### compression has been disabled."                                         NL
+"### Valid values are 1 (no parallel compression, the default) to 16."       NL
+"### Versions prior to Subversion 1.12 will ignore this option."             NL
+"# " CONFIG_OPTION_COMPRESSION_THREADS " = 1"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
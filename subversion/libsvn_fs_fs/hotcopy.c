@@ -22,6 +22,9 @@
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "svn_hash.h"
+
+#include "private/svn_batch_fsync.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
@@ -237,21 +240,56 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
   return SVN_NO_ERROR;
 }
 
+/* Schedule the directory DIR_ABSPATH and all files in it for fsync in
+ * BATCH.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+schedule_dir_fsync(svn_batch_fsync__t *batch,
+                   const char *dir_abspath,
+                   apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, dir_abspath, TRUE,
+                              scratch_pool, scratch_pool));
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      if (dirent->kind == svn_node_file)
+        {
+          const char *path = svn_dirent_join(dir_abspath, name,
+                                             scratch_pool);
+          SVN_ERR(svn_batch_fsync__add_file(batch, path, scratch_pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, path, scratch_pool));
+        }
+    }
+
+  SVN_ERR(svn_batch_fsync__new_path(batch, dir_abspath, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy an un-packed revision or revprop file for revision REV from SRC_SUBDIR
  * to DST_SUBDIR. Assume a sharding layout based on MAX_FILES_PER_DIR.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change the
  * value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not required.
- * Use SCRATCH_POOL for temporary allocations. */
+ * If BATCH is not NULL, schedule any new file and directory for fsync in
+ * it.  Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
                         const char *src_subdir,
                         const char *dst_subdir,
                         svn_revnum_t rev,
                         int max_files_per_dir,
+                        svn_batch_fsync__t *batch,
                         apr_pool_t *scratch_pool)
 {
   const char *src_subdir_shard = src_subdir,
              *dst_subdir_shard = dst_subdir;
+  const char *filename = apr_psprintf(scratch_pool, "%ld", rev);
+  svn_boolean_t skipped = TRUE;
 
   if (max_files_per_dir)
     {
@@ -265,13 +303,29 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
           SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, scratch_pool));
           SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard,
                                     scratch_pool));
+          if (batch)
+            SVN_ERR(svn_batch_fsync__new_path(batch, dst_subdir_shard,
+                                              scratch_pool));
         }
     }
 
-  SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
+  SVN_ERR(hotcopy_io_dir_file_copy(&skipped,
                                    src_subdir_shard, dst_subdir_shard,
-                                   apr_psprintf(scratch_pool, "%ld", rev),
-                                   scratch_pool));
+                                   filename, scratch_pool));
+
+  if (!skipped)
+    {
+      if (skipped_p)
+        *skipped_p = FALSE;
+
+      if (batch)
+        {
+          const char *dst_path = svn_dirent_join(dst_subdir_shard, filename,
+                                                 scratch_pool);
+          SVN_ERR(svn_batch_fsync__add_file(batch, dst_path, scratch_pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, dst_path, scratch_pool));
+        }
+    }
 
   return SVN_NO_ERROR;
 }
@@ -284,6 +338,7 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
  * SKIPPED_P may be NULL if not required.
+ * If BATCH is not NULL, schedule all copied data for fsync in it.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
@@ -292,6 +347,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
                           int max_files_per_dir,
+                          svn_batch_fsync__t *batch,
                           apr_pool_t *scratch_pool)
 {
   const char *src_subdir;
@@ -301,6 +357,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
   svn_revnum_t revprop_rev;
   apr_pool_t *iterpool;
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
+  svn_boolean_t skipped = TRUE;
 
   /* Copy the packed shard. */
   src_subdir = svn_dirent_join(src_fs->path, PATH_REVS_DIR, scratch_pool);
@@ -309,11 +366,16 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                               rev / max_files_per_dir);
   src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
                                             scratch_pool);
-  SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, src_subdir_packed_shard,
+  SVN_ERR(hotcopy_io_copy_dir_recursively(&skipped, src_subdir_packed_shard,
                                           dst_subdir, packed_shard,
                                           TRUE /* copy_perms */,
                                           NULL /* cancel_func */, NULL,
                                           scratch_pool));
+  if (!skipped && batch)
+    SVN_ERR(schedule_dir_fsync(batch,
+                               svn_dirent_join(dst_subdir, packed_shard,
+                                               scratch_pool),
+                               scratch_pool));
 
   /* Copy revprops belonging to revisions in this pack. */
   src_subdir = svn_dirent_join(src_fs->path, PATH_REVPROPS_DIR, scratch_pool);
@@ -330,33 +392,49 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
         {
           svn_pool_clear(iterpool);
 
-          SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
+          SVN_ERR(hotcopy_copy_shard_file(&skipped, src_subdir, dst_subdir,
                                           revprop_rev, max_files_per_dir,
-                                          iterpool));
+                                          batch, iterpool));
         }
       svn_pool_destroy(iterpool);
     }
   else
     {
+      svn_boolean_t revprops_skipped = TRUE;
+
       /* revprop for revision 0 will never be packed */
       if (rev == 0)
-        SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
+        SVN_ERR(hotcopy_copy_shard_file(&skipped, src_subdir, dst_subdir,
                                         0, max_files_per_dir,
-                                        scratch_pool));
+                                        batch, scratch_pool));
 
       /* packed revprops folder */
       packed_shard = apr_psprintf(scratch_pool, "%ld" PATH_EXT_PACKED_SHARD,
                                   rev / max_files_per_dir);
       src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
                                                 scratch_pool);
-      SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p,
+      SVN_ERR(hotcopy_io_copy_dir_recursively(&revprops_skipped,
                                               src_subdir_packed_shard,
                                               dst_subdir, packed_shard,
                                               TRUE /* copy_perms */,
                                               NULL /* cancel_func */, NULL,
                                               scratch_pool));
+      if (!revprops_skipped && batch)
+        SVN_ERR(schedule_dir_fsync(batch,
+                                   svn_dirent_join(dst_subdir, packed_shard,
+                                                   scratch_pool),
+                                   scratch_pool));
+
+      skipped = skipped && revprops_skipped;
     }
 
+  if (skipped_p && !skipped)
+    *skipped_p = FALSE;
+
+  /* The copied shard must be on disk before we point readers to it. */
+  if (batch)
+    SVN_ERR(svn_batch_fsync__run(batch, scratch_pool));
+
   /* If necessary, update the min-unpacked rev file in the hotcopy. */
   if (*dst_min_unpacked_rev < rev + max_files_per_dir)
     {
@@ -563,6 +641,12 @@ hotcopy_revisions(svn_fs_t *src_fs,
   svn_revnum_t dst_min_unpacked_rev;
   svn_revnum_t rev;
   apr_pool_t *iterpool;
+  svn_batch_fsync__t *batch = NULL;
+
+  /* Flush all copied files to disk before making them visible through
+     'current'.  Skip the bookkeeping entirely if we wouldn't flush. */
+  if (dst_ffd->flush_to_disk)
+    SVN_ERR(svn_batch_fsync__create(&batch, TRUE, pool));
 
   /* Copy the min unpacked rev, and read its value. */
   if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -616,7 +700,7 @@ hotcopy_revisions(svn_fs_t *src_fs,
       SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
                                         src_fs, dst_fs,
                                         rev, max_files_per_dir,
-                                        iterpool));
+                                        batch, iterpool));
 
       pack_end_rev = rev + max_files_per_dir - 1;
 
@@ -694,12 +778,12 @@ hotcopy_revisions(svn_fs_t *src_fs,
       SVN_ERR(hotcopy_copy_shard_file(&skipped,
                                       src_revs_dir, dst_revs_dir, rev,
                                       max_files_per_dir,
-                                      iterpool));
+                                      batch, iterpool));
       /* Copy the revprop file. */
       SVN_ERR(hotcopy_copy_shard_file(&skipped,
                                       src_revprops_dir, dst_revprops_dir,
                                       rev, max_files_per_dir,
-                                      iterpool));
+                                      batch, iterpool));
 
       /* Whenever this revision did not previously exist in the destination,
        * checkpoint the progress via 'current' (do that once per full shard
@@ -708,6 +792,8 @@ hotcopy_revisions(svn_fs_t *src_fs,
         {
           if (max_files_per_dir && (rev % max_files_per_dir == 0))
             {
+              if (batch)
+                SVN_ERR(svn_batch_fsync__run(batch, iterpool));
               SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
                                                iterpool));
             }
@@ -718,6 +804,10 @@ hotcopy_revisions(svn_fs_t *src_fs,
     }
   svn_pool_destroy(iterpool);
 
+  /* The caller will update 'current' to include all remaining revisions. */
+  if (batch)
+    SVN_ERR(svn_batch_fsync__run(batch, pool));
+
   /* We assume that all revisions were copied now, i.e. we didn't exit the
    * above loop early. 'rev' was last incremented during exit of the loop. */
   SVN_ERR_ASSERT(rev == src_youngest + 1);
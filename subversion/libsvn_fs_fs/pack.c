@@ -25,6 +25,7 @@
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
+#include "private/svn_batch_fsync.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -233,9 +234,6 @@ typedef struct pack_context_t
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
-
-  /* ensure that all filesystem changes are written to disk. */
-  svn_boolean_t flush_to_disk;
 } pack_context_t;
 
 /* Create and initialize a new pack context for packing shard SHARD_REV in
@@ -243,7 +241,7 @@ typedef struct pack_context_t
  * and return the structure in *CONTEXT.
  *
  * Limit the number of items being copied per iteration to MAX_ITEMS.
- * Set FLUSH_TO_DISK, CANCEL_FUNC and CANCEL_BATON as well.
+ * Set CANCEL_FUNC and CANCEL_BATON as well.
  */
 static svn_error_t *
 initialize_pack_context(pack_context_t *context,
@@ -252,7 +250,6 @@ initialize_pack_context(pack_context_t *context,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
                         int max_items,
-                        svn_boolean_t flush_to_disk,
                         svn_cancel_func_t cancel_func,
                         void *cancel_baton,
                         apr_pool_t *pool)
@@ -281,8 +278,6 @@ initialize_pack_context(pack_context_t *context,
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
 
-  context->flush_to_disk = flush_to_disk;
-
   /* Create the new directory and pack file. */
   context->shard_dir = shard_dir;
   context->pack_file_dir = pack_file_dir;
@@ -412,9 +407,7 @@ close_pack_context(pack_context_t *context,
   SVN_ERR(svn_io_remove_file2(proto_l2p_index_path, FALSE, pool));
   SVN_ERR(svn_io_remove_file2(proto_p2l_index_path, FALSE, pool));
 
-  /* Ensure that packed file is written to disk.*/
-  if (context->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(context->pack_file, pool));
+  /* The caller will flush the packed file to disk. */
   SVN_ERR(svn_io_file_close(context->pack_file, pool));
 
   return SVN_NO_ERROR;
@@ -1538,9 +1531,8 @@ append_revision(pack_context_t *context,
  *
  * Pack the revision shard starting at SHARD_REV in filesystem FS from
  * SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.  Limit
- * the extra memory consumption to MAX_MEM bytes.  If FLUSH_TO_DISK is
- * non-zero, do not return until the data has actually been written on
- * the disk.  CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * the extra memory consumption to MAX_MEM bytes.  CANCEL_FUNC and
+ * CANCEL_BATON are what you think they are.
  */
 static svn_error_t *
 pack_log_addressed(svn_fs_t *fs,
@@ -1548,7 +1540,6 @@ pack_log_addressed(svn_fs_t *fs,
                    const char *shard_dir,
                    svn_revnum_t shard_rev,
                    apr_size_t max_mem,
-                   svn_boolean_t flush_to_disk,
                    svn_cancel_func_t cancel_func,
                    void *cancel_baton,
                    apr_pool_t *pool)
@@ -1581,7 +1572,7 @@ pack_log_addressed(svn_fs_t *fs,
 
   /* set up a pack context */
   SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir, shard_dir,
-                                  shard_rev, max_items, flush_to_disk,
+                                  shard_rev, max_items,
                                   cancel_func, cancel_baton, pool));
 
   /* phase 1: determine the size of the revisions to pack */
@@ -1706,16 +1697,14 @@ svn_fs_fs__get_packed_offset(apr_off_t *rev_offset,
  *
  * Pack the revision shard starting at SHARD_REV containing exactly
  * MAX_FILES_PER_DIR revisions from SHARD_PATH into the PACK_FILE_DIR,
- * using POOL for allocations.  If FLUSH_TO_DISK is non-zero, do not
- * return until the data has actually been written on the disk.
- * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * using POOL for allocations.  CANCEL_FUNC and CANCEL_BATON are what you
+ * think they are.
  */
 static svn_error_t *
 pack_phys_addressed(const char *pack_file_dir,
                     const char *shard_path,
                     svn_revnum_t start_rev,
                     int max_files_per_dir,
-                    svn_boolean_t flush_to_disk,
                     svn_cancel_func_t cancel_func,
                     void *cancel_baton,
                     apr_pool_t *pool)
@@ -1750,7 +1739,6 @@ pack_phys_addressed(const char *pack_file_dir,
   /* Iterate over the revisions in this shard, squashing them together. */
   for (rev = start_rev; rev <= end_rev; rev++)
     {
-      svn_stream_t *rev_stream;
       const char *path;
       apr_off_t offset;
       apr_file_t *rev_file;
@@ -1768,31 +1756,20 @@ pack_phys_addressed(const char *pack_file_dir,
                                 "%" APR_OFF_T_FMT "\n", offset));
 
       /* Copy all the bits from the rev file to the end of the pack file.
-       * Use unbuffered apr_file_t since we're going to write using 16kb
-       * chunks. */
+       * Use unbuffered apr_file_t such that the kernel may copy or clone
+       * the data without passing it through user space. */
       SVN_ERR(svn_io_file_open(&rev_file, path, APR_READ, APR_OS_DEFAULT,
                                iterpool));
-      rev_stream = svn_stream_from_aprfile2(rev_file, FALSE, iterpool);
-      SVN_ERR(svn_stream_copy3(rev_stream,
-                               svn_stream_from_aprfile2(pack_file, TRUE,
-                                                        iterpool),
-                               cancel_func, cancel_baton, iterpool));
+      SVN_ERR(svn_io__file_copy_contents(pack_file, rev_file, FALSE,
+                                         cancel_func, cancel_baton,
+                                         iterpool));
+      SVN_ERR(svn_io_file_close(rev_file, iterpool));
     }
 
-  /* Close stream over APR file. */
+  /* Close stream over APR file.  The caller will flush both files to
+   * disk and make them read-only. */
   SVN_ERR(svn_stream_close(manifest_stream));
-
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, pool));
   SVN_ERR(svn_io_file_close(manifest_file, pool));
-
-  /* disallow write access to the manifest file */
-  SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, iterpool));
-
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
   SVN_ERR(svn_io_file_close(pack_file, pool));
 
   svn_pool_destroy(iterpool);
@@ -1824,11 +1801,14 @@ pack_rev_shard(svn_fs_t *fs,
                void *cancel_baton,
                apr_pool_t *pool)
 {
-  const char *pack_file_path;
+  const char *pack_file_path, *manifest_file_path;
   svn_revnum_t shard_rev = (svn_revnum_t) (shard * max_files_per_dir);
+  svn_boolean_t log_addressing = svn_fs_fs__use_log_addressing(fs);
+  svn_batch_fsync__t *batch;
 
   /* Some useful paths. */
   pack_file_path = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
+  manifest_file_path = svn_dirent_join(pack_file_dir, PATH_MANIFEST, pool);
 
   /* Remove any existing pack file for this shard, since it is incomplete. */
   SVN_ERR(svn_io_remove_dir2(pack_file_dir, TRUE, cancel_func, cancel_baton,
@@ -1838,17 +1818,31 @@ pack_rev_shard(svn_fs_t *fs,
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, pool));
 
   /* Index information files */
-  if (svn_fs_fs__use_log_addressing(fs))
+  if (log_addressing)
     SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path,
-                               shard_rev, max_mem, flush_to_disk,
+                               shard_rev, max_mem,
                                cancel_func, cancel_baton, pool));
   else
     SVN_ERR(pack_phys_addressed(pack_file_dir, shard_path, shard_rev,
-                                max_files_per_dir, flush_to_disk,
+                                max_files_per_dir,
                                 cancel_func, cancel_baton, pool));
 
+  /* Ensure that the pack file, the manifest and their directory entries
+   * are written to disk before the caller removes the non-packed shard.
+   * Flush them all in one go. */
+  SVN_ERR(svn_batch_fsync__create(&batch, flush_to_disk, pool));
+  SVN_ERR(svn_batch_fsync__add_file(batch, pack_file_path, pool));
+  if (!log_addressing)
+    SVN_ERR(svn_batch_fsync__add_file(batch, manifest_file_path, pool));
+  SVN_ERR(svn_batch_fsync__new_path(batch, pack_file_path, pool));
+  SVN_ERR(svn_batch_fsync__new_path(batch, pack_file_dir, pool));
+  SVN_ERR(svn_batch_fsync__run(batch, pool));
+
+  /* Disallow write access to the pack and manifest files. */
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, pool));
   SVN_ERR(svn_io_set_file_read_only(pack_file_path, FALSE, pool));
+  if (!log_addressing)
+    SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, pool));
 
   return SVN_NO_ERROR;
 }
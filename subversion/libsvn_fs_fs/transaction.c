@@ -43,6 +43,8 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_batch_fsync.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -1902,6 +1904,11 @@ fnv1a_checksum_finalize(apr_uint32_t *digest,
   return SVN_NO_ERROR;
 }
 
+/* Checksums calculated over representation contents.  Representations
+   that don't need a SHA1 use only the first entry. */
+static const svn_checksum_kind_t rep_checksum_kinds[]
+  = { svn_checksum_md5, svn_checksum_sha1 };
+
 /* This baton is used by the representation writing streams.  It keeps
    track of the checksum information as well as the total size of the
    representation so far. */
@@ -1935,8 +1942,8 @@ struct rep_write_baton
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the fulltext, calculated in a single pass. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
@@ -1958,8 +1965,7 @@ rep_write_contents(void *baton,
 {
   struct rep_write_baton *b = baton;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
   /* If we are writing a delta, use that stream. */
@@ -2184,8 +2190,10 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
       svndiff_version = 0;
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  svn_txdelta__to_svndiff_parallel(handler, handler_baton, output,
+                                   svndiff_version,
+                                   ffd->delta_compression_level,
+                                   ffd->delta_compression_threads, pool);
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2208,8 +2216,8 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   b = apr_pcalloc(pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  b->checksum_ctx = svn_checksum__multi_ctx_create(rep_checksum_kinds, 2,
+                                                   TRUE, pool);
 
   b->fs = fs;
   b->result_pool = pool;
@@ -2483,24 +2491,27 @@ get_shared_rep(representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CHECKSUM_CTX into REP.
+ * SHA1 results are only be set if HAS_SHA1 is set, in which case
+ * CHECKSUM_CTX must have calculated them.
  * Use POOL for allocations.
  */
 static svn_error_t *
 digests_final(representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__multi_ctx_t *checksum_ctx,
+              svn_boolean_t has_sha1,
               apr_pool_t *pool)
 {
   svn_checksum_t *checksum;
 
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, pool));
+  SVN_ERR(svn_checksum__multi_final(&checksum, checksum_ctx,
+                                    svn_checksum_md5, pool));
   memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+  rep->has_sha1 = has_sha1;
   if (rep->has_sha1)
     {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, pool));
+      SVN_ERR(svn_checksum__multi_final(&checksum, checksum_ctx,
+                                        svn_checksum_sha1, pool));
       memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
     }
 
@@ -2536,8 +2547,7 @@ rep_write_contents_close(void *baton)
   rep->revision = SVN_INVALID_REVNUM;
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, TRUE, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2713,10 +2723,11 @@ struct write_container_baton
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
+  /* MD5 and, optionally, SHA1 of the contents. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* SHA1 calculation is optional. If not needed, this will be FALSE. */
+  svn_boolean_t has_sha1;
 };
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2729,9 +2740,7 @@ write_container_handler(void *baton,
 {
   struct write_container_baton *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2809,9 +2818,10 @@ write_container_rep(representation_t *rep,
   else
     fnv1a_checksum_ctx = NULL;
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->has_sha1 = item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP;
+  whb->checksum_ctx = svn_checksum__multi_ctx_create(rep_checksum_kinds,
+                                                     whb->has_sha1 ? 2 : 1,
+                                                     FALSE, scratch_pool);
 
   stream = svn_stream_create(whb, scratch_pool);
   svn_stream_set_write(stream, write_container_handler);
@@ -2821,7 +2831,8 @@ write_container_rep(representation_t *rep,
   SVN_ERR(writer(stream, collection, scratch_pool));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, whb->has_sha1,
+                        scratch_pool));
 
   /* Update size info. */
   rep->expanded_size = whb->size;
@@ -2953,9 +2964,10 @@ write_container_delta_rep(representation_t *rep,
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->has_sha1 = item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP;
+  whb->checksum_ctx = svn_checksum__multi_ctx_create(rep_checksum_kinds,
+                                                     whb->has_sha1 ? 2 : 1,
+                                                     FALSE, scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2965,7 +2977,8 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, whb->has_sha1,
+                        scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -3594,12 +3607,12 @@ verify_locks(svn_fs_t *fs,
 
 /* Writes final revision properties to file PATH applying permissions
    from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   removing any temporary properties associated with the commit flags.
+   The caller is responsible for flushing PATH to disk. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3638,9 +3651,6 @@ write_final_revprop(const char *path,
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
-
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
   SVN_ERR(svn_io_file_close(revprop_file, pool));
 
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
@@ -3755,6 +3765,7 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_hash_t *changed_paths;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
+  svn_batch_fsync__t *batch;
 
   /* Re-Read the current repository format.  All our repo upgrade and
      config evaluation strategies are such that existing information in
@@ -3837,9 +3848,10 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
+  /* The proto-rev file will be flushed to disk together with the other
+     new files further down. */
   SVN_ERR(svn_io_file_close(proto_file, pool));
+  SVN_ERR(svn_batch_fsync__create(&batch, ffd->flush_to_disk, pool));
 
   /* We don't unlock the prototype revision file immediately to avoid a
      race with another caller writing to the prototype revision file
@@ -3863,6 +3875,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,17 +3892,35 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, new_dir, pool));
         }
     }
 
-  /* Move the finished rev file into place.
+  /* Write final revprops file.  A left-over file from a failed commit
+     will simply be overwritten. */
+  SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
+  old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
+  revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
+  SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
+                              cb->txn, pool));
+
+  /* Flush the contents of the new rev and revprop files as well as all
+     new directory entries to disk in one go.  The rev file must be
+     durable before we rename it and everything must be durable before
+     we bump 'current'. */
+  proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
+  SVN_ERR(svn_batch_fsync__add_file(batch, proto_filename, pool));
+  SVN_ERR(svn_batch_fsync__add_file(batch, revprop_filename, pool));
+  SVN_ERR(svn_batch_fsync__new_path(batch, revprop_filename, pool));
+  SVN_ERR(svn_batch_fsync__run(batch, pool));
+
+  /* Move the finished rev file into place.  Since its contents are on
+     disk already, this only needs to sync the directory.
 
      ### This "breaks" the transaction by removing the protorev file
      ### but the revision is not yet complete.  If this commit does
      ### not complete for any reason the transaction will be lost. */
-  old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
-  proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
   SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
                                      old_rev_filename, ffd->flush_to_disk,
                                      pool));
@@ -3900,12 +3931,6 @@ commit_body(void *baton, apr_pool_t *pool)
      remove the transaction directory later. */
   SVN_ERR(unlock_proto_rev(cb->fs, txn_id, proto_file_lockcookie, pool));
 
-  /* Write final revprops file. */
-  SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
-  revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
-  SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
-
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
     {
@@ -2437,7 +2437,8 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   /* Because source and target stream will already verify their content,
    * there is no need to do this once more.  In particular if the stream
    * content is being fetched from cache. */
-  svn_txdelta2(stream_p, source_stream, target_stream, FALSE, result_pool);
+  svn_txdelta3(stream_p, source_stream, target_stream, FALSE, FALSE,
+               result_pool);
 
   return SVN_NO_ERROR;
 }
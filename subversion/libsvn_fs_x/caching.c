@@ -22,6 +22,7 @@
 
 #include "fs.h"
 #include "fs_x.h"
+#include "cached_data.h"
 #include "id.h"
 #include "dag_cache.h"
 #include "index.h"
@@ -69,6 +70,33 @@ normalize_key_part(const char *original,
   return normalized->data;
 }
 
+/* Reverse normalize_key_part() for the first LEN bytes of NORMALIZED.
+ * Allocate the result in RESULT_POOL.
+ */
+static const char *
+denormalize_key_part(const char *normalized,
+                     apr_size_t len,
+                     apr_pool_t *result_pool)
+{
+  apr_size_t i;
+  svn_stringbuf_t *original = svn_stringbuf_create_ensure(len, result_pool);
+
+  for (i = 0; i < len; ++i)
+    {
+      char c = normalized[i];
+      if (c == '%' && i + 1 < len)
+        {
+          c = normalized[++i];
+          if (c == '_')
+            c = ':';
+        }
+
+      svn_stringbuf_appendbyte(original, c);
+    }
+
+  return original->data;
+}
+
 /* *CACHE_TXDELTAS, *CACHE_FULLTEXTS, *CACHE_REVPROPS and *CACHE_NODEPROPS
    flags will be set according to FS->CONFIG.  *CACHE_NAMESPACE receives
    the cache prefix to use.
@@ -150,6 +178,25 @@ read_config(const char **cache_namespace,
   return SVN_NO_ERROR;
 }
 
+/* Return the key prefix shared by all caches of FS within the cache
+ * namespace CACHE_NAMESPACE.  Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_cache_prefix(svn_fs_t *fs,
+                 const char *cache_namespace,
+                 apr_pool_t *result_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  return apr_pstrcat(result_pool,
+                     "ns:", cache_namespace,
+                     ":fsx:", fs->uuid,
+                     "--", ffd->instance_id,
+                     "/", normalize_key_part(fs->path, result_pool),
+                     ":",
+                     SVN_VA_NULL);
+}
+
 
 /* Implements svn_cache__error_handler_t
  * This variant clears the error after logging it.
@@ -378,13 +425,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
                             apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
-  const char *prefix = apr_pstrcat(scratch_pool,
-                                   "fsx:", fs->uuid,
-                                   "--", ffd->instance_id,
-                                   "/", normalize_key_part(fs->path,
-                                                           scratch_pool),
-                                   ":",
-                                   SVN_VA_NULL);
+  const char *prefix;
   svn_membuffer_t *membuffer;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
@@ -403,8 +444,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
                       fs,
                       scratch_pool));
 
-  prefix = apr_pstrcat(scratch_pool, "ns:", cache_namespace, ":", prefix,
-                       SVN_VA_NULL);
+  prefix = get_cache_prefix(fs, cache_namespace, scratch_pool);
   has_namespace = strlen(cache_namespace) > 0;
 
   membuffer = svn_cache__get_global_membuffer_cache();
@@ -680,3 +720,213 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_fs_x__cached_fs_paths(apr_array_header_t **paths,
+                          const apr_array_header_t *records,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  apr_hash_t *found = apr_hash_make(scratch_pool);
+  const char *last_prefix = NULL;
+  int i;
+
+  *paths = apr_array_make(result_pool, 1, sizeof(const char *));
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      const char *start;
+      const char *end;
+      const char *path;
+
+      /* Records of the same cache share the same prefix string. */
+      if (record->prefix == last_prefix)
+        continue;
+      last_prefix = record->prefix;
+
+      /* The prefix is "ns:<namespace>:fsx:<uuid>--<instance>/<path>:<type>",
+       * see get_cache_prefix().  Namespace and path have been normalized,
+       * i.e. they don't contain ':', and the IDs don't contain '/'. */
+      if (strncmp(record->prefix, "ns:", 3) != 0)
+        continue;
+
+      start = strchr(record->prefix + 3, ':');
+      if (!start || strncmp(start, ":fsx:", 5) != 0)
+        continue;
+
+      start = strchr(start + 5, '/');
+      end = start ? strchr(start, ':') : NULL;
+      if (!end)
+        continue;
+
+      path = denormalize_key_part(start + 1, end - start - 1, scratch_pool);
+      if (!svn_hash_gets(found, path))
+        {
+          svn_hash_sets(found, path, path);
+          APR_ARRAY_PUSH(*paths, const char *) = apr_pstrdup(result_pool,
+                                                             path);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the node revision with the cache key KEY from FS.  Also read its
+ * directory contents, text and properties if their keys are in DIRS,
+ * TEXTS and PROPS, respectively.  This populates the respective caches.
+ * Use CANCEL_FUNC and CANCEL_BATON to check for cancellation while
+ * reading the text.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+warm_node_revision(svn_fs_t *fs,
+                   const svn_fs_x__pair_cache_key_t *key,
+                   apr_hash_t *dirs,
+                   apr_hash_t *texts,
+                   apr_hash_t *props,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  svn_fs_x__id_t id;
+  svn_fs_x__noderev_t *noderev;
+  svn_fs_x__pair_cache_key_t rep_key;
+
+  id.change_set = svn_fs_x__change_set_by_rev((svn_revnum_t)key->revision);
+  id.number = key->second;
+  SVN_ERR(svn_fs_x__get_node_revision(&noderev, fs, &id, scratch_pool,
+                                      scratch_pool));
+
+  if (noderev->data_rep && !svn_fs_x__is_txn(noderev->data_rep->id.change_set))
+    {
+      /* Directories are keyed by their representation ID. */
+      if (   noderev->kind == svn_node_dir
+          && apr_hash_get(dirs, &noderev->data_rep->id,
+                          sizeof(noderev->data_rep->id)))
+        {
+          apr_array_header_t *entries;
+          SVN_ERR(svn_fs_x__rep_contents_dir(&entries, fs, noderev,
+                                             scratch_pool, scratch_pool));
+        }
+
+      rep_key.revision
+        = svn_fs_x__get_revnum(noderev->data_rep->id.change_set);
+      rep_key.second = noderev->data_rep->id.number;
+      if (   noderev->kind == svn_node_file
+          && apr_hash_get(texts, &rep_key, sizeof(rep_key)))
+        {
+          svn_stream_t *contents;
+          SVN_ERR(svn_fs_x__get_contents(&contents, fs, noderev->data_rep,
+                                         TRUE, scratch_pool));
+          SVN_ERR(svn_stream_copy3(contents, svn_stream_empty(scratch_pool),
+                                   cancel_func, cancel_baton,
+                                   scratch_pool));
+        }
+    }
+
+  if (noderev->prop_rep && !svn_fs_x__is_txn(noderev->prop_rep->id.change_set))
+    {
+      rep_key.revision
+        = svn_fs_x__get_revnum(noderev->prop_rep->id.change_set);
+      rep_key.second = noderev->prop_rep->id.number;
+
+      if (apr_hash_get(props, &rep_key, sizeof(rep_key)))
+        {
+          apr_hash_t *proplist;
+          SVN_ERR(svn_fs_x__get_proplist(&proplist, fs, noderev,
+                                         scratch_pool, scratch_pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__warm_caches(svn_fs_t *fs,
+                      const apr_array_header_t *records,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *dirs = apr_hash_make(scratch_pool);
+  apr_hash_t *texts = apr_hash_make(scratch_pool);
+  apr_hash_t *props = apr_hash_make(scratch_pool);
+  svn_boolean_t cache_txdeltas;
+  svn_boolean_t cache_fulltexts;
+  svn_boolean_t cache_revprops;
+  svn_boolean_t cache_nodeprops;
+  const char *cache_namespace;
+  const char *prefix;
+  apr_size_t prefix_len;
+  int i;
+
+  SVN_ERR(read_config(&cache_namespace,
+                      &cache_txdeltas,
+                      &cache_fulltexts,
+                      &cache_revprops,
+                      &cache_nodeprops,
+                      fs,
+                      scratch_pool));
+  prefix = get_cache_prefix(fs, cache_namespace, scratch_pool);
+  prefix_len = strlen(prefix);
+
+  /* Directories, texts and properties can only be found through their
+   * node revisions.  So, collect their keys first.  All of them are
+   * 16 bytes. */
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      const char *type = record->prefix + prefix_len;
+
+      if (   strncmp(record->prefix, prefix, prefix_len) != 0
+          || record->key_len < sizeof(svn_fs_x__pair_cache_key_t))
+        continue;
+
+      if (strcmp(type, "DIR") == 0)
+        apr_hash_set(dirs, record->key, sizeof(svn_fs_x__id_t), record);
+      else if (strcmp(type, "TEXT") == 0)
+        apr_hash_set(texts, record->key, sizeof(svn_fs_x__pair_cache_key_t),
+                     record);
+      else if (strcmp(type, "PROP") == 0)
+        apr_hash_set(props, record->key, sizeof(svn_fs_x__pair_cache_key_t),
+                     record);
+    }
+
+  /* Replay, most frequently used items first.  Index pages, rep headers
+   * etc. will be loaded along the way.  Node revisions in packed shards
+   * are cached in containers, which we can't replay. */
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      svn_fs_x__pair_cache_key_t key;
+      svn_error_t *err;
+
+      if (   strncmp(record->prefix, prefix, prefix_len) != 0
+          || strcmp(record->prefix + prefix_len, "NODEREVS") != 0
+          || record->key_len < sizeof(key))
+        continue;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      memcpy(&key, record->key, sizeof(key));
+      err = warm_node_revision(fs, &key, dirs, texts, props,
+                               cancel_func, cancel_baton, iterpool);
+
+      /* The repository may have changed since the snapshot was taken,
+       * e.g. because it has been packed.  Skip items that we can't read
+       * anymore. */
+      if (err && err->apr_err == SVN_ERR_CANCELLED)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
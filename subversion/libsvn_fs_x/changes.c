@@ -324,12 +324,15 @@ svn_fs_x__write_changes_container(svn_stream_t *stream,
     {
       const binary_change_t *change
         = &APR_ARRAY_IDX(changes->changes, i, binary_change_t);
+      apr_uint64_t values[4];
 
-      svn_packed__add_uint(changes_stream, change->flags);
-      svn_packed__add_uint(changes_stream, change->path);
+      values[0] = (apr_uint64_t)change->flags;
+      values[1] = change->path;
 
-      svn_packed__add_int(changes_stream, change->copyfrom_rev);
-      svn_packed__add_uint(changes_stream, change->copyfrom_path);
+      values[2] = (apr_uint64_t)change->copyfrom_rev;
+      values[3] = change->copyfrom_path;
+
+      svn_packed__add_uints(changes_stream, values, 4);
     }
 
   /* write to disk */
@@ -377,12 +380,15 @@ svn_fs_x__read_changes_container(svn_fs_x__changes_t **changes_p,
   for (i = 0; i < count; ++i)
     {
       binary_change_t change;
+      apr_uint64_t values[4];
+
+      svn_packed__get_uints(changes_stream, values, 4);
 
-      change.flags = (int)svn_packed__get_uint(changes_stream);
-      change.path = (apr_size_t)svn_packed__get_uint(changes_stream);
+      change.flags = (int)values[0];
+      change.path = (apr_size_t)values[1];
 
-      change.copyfrom_rev = (svn_revnum_t)svn_packed__get_int(changes_stream);
-      change.copyfrom_path = (apr_size_t)svn_packed__get_uint(changes_stream);
+      change.copyfrom_rev = (svn_revnum_t)(apr_int64_t)values[2];
+      change.copyfrom_path = (apr_size_t)values[3];
 
       APR_ARRAY_PUSH(changes->changes, binary_change_t) = change;
     }
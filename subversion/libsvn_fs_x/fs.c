@@ -32,7 +32,7 @@
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
-#include "batch_fsync.h"
+#include "private/svn_batch_fsync.h"
 #include "fs.h"
 #include "fs_x.h"
 #include "pack.h"
@@ -310,7 +310,8 @@ static fs_vtable_t fs_vtable = {
   x_info,
   svn_fs_x__verify_root,
   x_freeze,
-  x_set_errcall
+  x_set_errcall,
+  svn_fs_x__warm_caches
 };
 
 
@@ -641,7 +642,8 @@ static fs_library_vtable_t library_vtable = {
   x_logfiles,
   NULL /* parse_id */,
   x_set_svn_fs_open,
-  x_info_dup
+  x_info_dup,
+  svn_fs_x__cached_fs_paths
 };
 
 svn_error_t *
@@ -665,7 +667,7 @@ svn_fs_x__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(x_version(), checklist, svn_ver_equal));
 
-  SVN_ERR(svn_fs_x__batch_fsync_init(common_pool));
+  SVN_ERR(svn_batch_fsync__init(common_pool));
 
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
@@ -104,6 +104,7 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION_THREADS "compression-threads"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -394,6 +395,9 @@ typedef struct svn_fs_x__data_t
   /* Compression level to use with txdelta storage format in new revs. */
   int delta_compression_level;
 
+  /* Maximum number of txdelta windows to compress concurrently. */
+  int delta_compression_threads;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -262,6 +262,7 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  apr_int64_t compression_threads;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -288,6 +289,11 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->delta_compression_level
     = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                 SVN_DELTA_COMPRESSION_LEVEL_MAX);
+  SVN_ERR(svn_config_get_int64(config, &compression_threads,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_COMPRESSION_THREADS, 1));
+  ffd->delta_compression_threads
+    = (int)MIN(MAX(1, compression_threads), SVN_THREAD_POOL__MAX_THREADS);
 
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
@@ -457,6 +463,17 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Compressing large files can make commits CPU-bound.  Values above 1"   NL
+"### allow the delta windows of a single file to be compressed in parallel"  NL
+"### while it is being written.  Larger values keep more windows of each"    NL
+"### file in flight.  The compression itself runs on a single pool of 16"    NL
+"### threads that is shared by all files written by the process, i.e. the"   NL
+"### effective parallelism per file may be lower than the value given."      NL
+"### This setting has no effect on the resulting data and is ignored if"     NL
+"### compression has been disabled."                                         NL
+"### Valid values are 1 (no parallel compression, the default) to 16."       NL
+"# " CONFIG_OPTION_COMPRESSION_THREADS " = 1"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -217,4 +217,26 @@ svn_error_t *
 svn_fs_x__initialize_caches(svn_fs_t *fs,
                             apr_pool_t *scratch_pool);
 
+/* Set *PATHS to the distinct paths of all FSX repositories referenced
+   by the cache key RECORDS (svn_cache__key_record_t *).  Allocate the
+   result in RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_x__cached_fs_paths(apr_array_header_t **paths,
+                          const apr_array_header_t *records,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Re-read the items of FS that are referenced by the cache key RECORDS
+   (svn_cache__key_record_t *), in the order given, and thereby put them
+   into FS's caches again.  Records of other repositories and items that
+   can't be read anymore are being skipped.  Currently, node revisions
+   as well as directories, texts and properties referenced by those are
+   being supported.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_x__warm_caches(svn_fs_t *fs,
+                      const apr_array_header_t *records,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
 #endif
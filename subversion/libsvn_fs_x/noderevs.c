@@ -479,13 +479,16 @@ write_reps(svn_packed__int_stream_t *rep_stream,
     {
       svn_fs_x__representation_t *rep
         = &APR_ARRAY_IDX(reps, i, svn_fs_x__representation_t);
+      apr_uint64_t values[5];
 
-      svn_packed__add_uint(rep_stream, rep->has_sha1);
+      values[0] = rep->has_sha1;
 
-      svn_packed__add_uint(rep_stream, rep->id.change_set);
-      svn_packed__add_uint(rep_stream, rep->id.number);
-      svn_packed__add_uint(rep_stream, rep->size);
-      svn_packed__add_uint(rep_stream, rep->expanded_size);
+      values[1] = rep->id.change_set;
+      values[2] = rep->id.number;
+      values[3] = rep->size;
+      values[4] = rep->expanded_size;
+
+      svn_packed__add_uints(rep_stream, values, 5);
 
       svn_packed__add_bytes(digest_stream,
                             (const char *)rep->md5_digest,
@@ -537,9 +540,12 @@ svn_fs_x__write_noderevs_container(svn_stream_t *stream,
   for (i = 0; i < container->ids->nelts; ++i)
     {
       svn_fs_x__id_t *id = &APR_ARRAY_IDX(container->ids, i, svn_fs_x__id_t);
+      apr_uint64_t values[2];
+
+      values[0] = (apr_uint64_t)id->change_set;
+      values[1] = id->number;
 
-      svn_packed__add_int(ids_stream, id->change_set);
-      svn_packed__add_uint(ids_stream, id->number);
+      svn_packed__add_uints(ids_stream, values, 2);
     }
 
   /* serialize rep arrays */
@@ -550,25 +556,28 @@ svn_fs_x__write_noderevs_container(svn_stream_t *stream,
     {
       const binary_noderev_t *noderev
         = &APR_ARRAY_IDX(container->noderevs, i, binary_noderev_t);
+      apr_uint64_t values[14];
+
+      values[0] = noderev->flags;
 
-      svn_packed__add_uint(noderevs_stream, noderev->flags);
+      values[1] = (apr_uint64_t)noderev->id;
+      values[2] = (apr_uint64_t)noderev->node_id;
+      values[3] = (apr_uint64_t)noderev->copy_id;
+      values[4] = (apr_uint64_t)noderev->predecessor_id;
+      values[5] = (apr_uint64_t)noderev->predecessor_count;
 
-      svn_packed__add_uint(noderevs_stream, noderev->id);
-      svn_packed__add_uint(noderevs_stream, noderev->node_id);
-      svn_packed__add_uint(noderevs_stream, noderev->copy_id);
-      svn_packed__add_uint(noderevs_stream, noderev->predecessor_id);
-      svn_packed__add_uint(noderevs_stream, noderev->predecessor_count);
+      values[6] = noderev->copyfrom_path;
+      values[7] = (apr_uint64_t)noderev->copyfrom_rev;
+      values[8] = noderev->copyroot_path;
+      values[9] = (apr_uint64_t)noderev->copyroot_rev;
 
-      svn_packed__add_uint(noderevs_stream, noderev->copyfrom_path);
-      svn_packed__add_int(noderevs_stream, noderev->copyfrom_rev);
-      svn_packed__add_uint(noderevs_stream, noderev->copyroot_path);
-      svn_packed__add_int(noderevs_stream, noderev->copyroot_rev);
+      values[10] = (apr_uint64_t)noderev->prop_rep;
+      values[11] = (apr_uint64_t)noderev->data_rep;
 
-      svn_packed__add_uint(noderevs_stream, noderev->prop_rep);
-      svn_packed__add_uint(noderevs_stream, noderev->data_rep);
+      values[12] = noderev->created_path;
+      values[13] = (apr_uint64_t)noderev->mergeinfo_count;
 
-      svn_packed__add_uint(noderevs_stream, noderev->created_path);
-      svn_packed__add_uint(noderevs_stream, noderev->mergeinfo_count);
+      svn_packed__add_uints(noderevs_stream, values, 14);
     }
 
   /* write to disk */
@@ -601,13 +610,16 @@ read_reps(apr_array_header_t **reps_p,
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__representation_t rep;
+      apr_uint64_t values[5];
 
-      rep.has_sha1 = (svn_boolean_t)svn_packed__get_uint(rep_stream);
+      svn_packed__get_uints(rep_stream, values, 5);
 
-      rep.id.change_set = (svn_revnum_t)svn_packed__get_uint(rep_stream);
-      rep.id.number = svn_packed__get_uint(rep_stream);
-      rep.size = svn_packed__get_uint(rep_stream);
-      rep.expanded_size = svn_packed__get_uint(rep_stream);
+      rep.has_sha1 = (svn_boolean_t)values[0];
+
+      rep.id.change_set = (svn_revnum_t)values[1];
+      rep.id.number = values[2];
+      rep.size = values[3];
+      rep.expanded_size = values[4];
 
       /* when extracting the checksums, beware of buffer under/overflows
          caused by disk data corruption. */
@@ -682,9 +694,12 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__id_t id;
+      apr_uint64_t values[2];
+
+      svn_packed__get_uints(ids_stream, values, 2);
 
-      id.change_set = (svn_revnum_t)svn_packed__get_int(ids_stream);
-      id.number = svn_packed__get_uint(ids_stream);
+      id.change_set = (svn_revnum_t)(apr_int64_t)values[0];
+      id.number = values[1];
 
       APR_ARRAY_PUSH(noderevs->ids, svn_fs_x__id_t) = id;
     }
@@ -701,25 +716,28 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
   for (i = 0; i < count; ++i)
     {
       binary_noderev_t noderev;
+      apr_uint64_t values[14];
+
+      svn_packed__get_uints(noderevs_stream, values, 14);
 
-      noderev.flags = (apr_uint32_t)svn_packed__get_uint(noderevs_stream);
+      noderev.flags = (apr_uint32_t)values[0];
 
-      noderev.id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.node_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.copy_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_count = (int)svn_packed__get_uint(noderevs_stream);
+      noderev.id = (int)values[1];
+      noderev.node_id = (int)values[2];
+      noderev.copy_id = (int)values[3];
+      noderev.predecessor_id = (int)values[4];
+      noderev.predecessor_count = (int)values[5];
 
-      noderev.copyfrom_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyfrom_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
-      noderev.copyroot_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyroot_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
+      noderev.copyfrom_path = (apr_size_t)values[6];
+      noderev.copyfrom_rev = (svn_revnum_t)(apr_int64_t)values[7];
+      noderev.copyroot_path = (apr_size_t)values[8];
+      noderev.copyroot_rev = (svn_revnum_t)(apr_int64_t)values[9];
 
-      noderev.prop_rep = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.data_rep = (int)svn_packed__get_uint(noderevs_stream);
+      noderev.prop_rep = (int)values[10];
+      noderev.data_rep = (int)values[11];
 
-      noderev.created_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.mergeinfo_count = svn_packed__get_uint(noderevs_stream);
+      noderev.created_path = (apr_size_t)values[12];
+      noderev.mergeinfo_count = values[13];
 
       APR_ARRAY_PUSH(noderevs->noderevs, binary_noderev_t) = noderev;
     }
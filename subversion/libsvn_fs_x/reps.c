@@ -732,10 +732,14 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
   for (i = 0; i < builder->bases->nelts; ++i)
     {
       const base_t *base = &APR_ARRAY_IDX(builder->bases, i, base_t);
-      svn_packed__add_int(bases_stream, base->revision);
-      svn_packed__add_uint(bases_stream, base->item_index);
-      svn_packed__add_uint(bases_stream, base->priority);
-      svn_packed__add_uint(bases_stream, base->rep);
+      apr_uint64_t values[4];
+
+      values[0] = (apr_uint64_t)base->revision;
+      values[1] = base->item_index;
+      values[2] = (apr_uint64_t)base->priority;
+      values[3] = base->rep;
+
+      svn_packed__add_uints(bases_stream, values, 4);
     }
 
   /* serialize reps */
@@ -752,8 +756,12 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
     {
       const instruction_t *instruction
         = &APR_ARRAY_IDX(builder->instructions, i, instruction_t);
-      svn_packed__add_int(instructions_stream, instruction->offset);
-      svn_packed__add_uint(instructions_stream, instruction->count);
+      apr_uint64_t values[2];
+
+      values[0] = (apr_uint64_t)instruction->offset;
+      values[1] = instruction->count;
+
+      svn_packed__add_uints(instructions_stream, values, 2);
     }
 
   /* other elements */
@@ -808,10 +816,14 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   for (i = 0; i < reps->base_count; ++i)
     {
       base_t *base = bases + i;
-      base->revision = (svn_revnum_t)svn_packed__get_int(bases_stream);
-      base->item_index = svn_packed__get_uint(bases_stream);
-      base->priority = (int)svn_packed__get_uint(bases_stream);
-      base->rep = (apr_uint32_t)svn_packed__get_uint(bases_stream);
+      apr_uint64_t values[4];
+
+      svn_packed__get_uints(bases_stream, values, 4);
+
+      base->revision = (svn_revnum_t)(apr_int64_t)values[0];
+      base->item_index = values[1];
+      base->priority = (int)values[2];
+      base->rep = (apr_uint32_t)values[3];
     }
 
   /* de-serialize instructions */
@@ -826,10 +838,12 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   for (i = 0; i < reps->instruction_count; ++i)
     {
       instruction_t *instruction = instructions + i;
-      instruction->offset
-        = (apr_int32_t)svn_packed__get_int(instructions_stream);
-      instruction->count
-        = (apr_uint32_t)svn_packed__get_uint(instructions_stream);
+      apr_uint64_t values[2];
+
+      svn_packed__get_uints(instructions_stream, values, 2);
+
+      instruction->offset = (apr_int32_t)(apr_int64_t)values[0];
+      instruction->count = (apr_uint32_t)values[1];
     }
 
   /* de-serialize reps */
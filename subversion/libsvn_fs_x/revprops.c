@@ -1049,7 +1049,7 @@ write_non_packed_revprop(const char **final_path,
                          svn_fs_t *fs,
                          svn_revnum_t rev,
                          apr_hash_t *proplist,
-                         svn_fs_x__batch_fsync_t *batch,
+                         svn_batch_fsync__t *batch,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool)
 {
@@ -1057,8 +1057,8 @@ write_non_packed_revprop(const char **final_path,
   *final_path = svn_fs_x__path_revprops(fs, rev, result_pool);
 
   *tmp_path = apr_pstrcat(result_pool, *final_path, ".tmp", SVN_VA_NULL);
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *tmp_path,
-                                          scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(&file, batch, *tmp_path,
+                                     scratch_pool));
 
   SVN_ERR(svn_fs_x__write_non_packed_revprops(file, proplist, scratch_pool));
 
@@ -1082,7 +1082,7 @@ switch_to_new_revprop(svn_fs_t *fs,
                       const char *perms_reference,
                       apr_array_header_t *files_to_delete,
                       svn_boolean_t bump_generation,
-                      svn_fs_x__batch_fsync_t *batch,
+                      svn_batch_fsync__t *batch,
                       apr_pool_t *scratch_pool)
 {
   /* Now, we may actually be replacing revprops. Make sure that all other
@@ -1092,12 +1092,12 @@ switch_to_new_revprop(svn_fs_t *fs,
 
   /* Ensure the new file contents makes it to disk before switching over to
    * it. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_batch_fsync__run(batch, scratch_pool));
 
   /* Make the revision visible to all processes and threads. */
   SVN_ERR(svn_fs_x__move_into_place(tmp_path, final_path, perms_reference,
                                     batch, scratch_pool));
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_batch_fsync__run(batch, scratch_pool));
 
   /* Indicate that the update (if relevant) has been completed. */
   if (bump_generation)
@@ -1173,7 +1173,7 @@ repack_file_open(apr_file_t **file,
                  packed_revprops_t *revprops,
                  svn_revnum_t start_rev,
                  apr_array_header_t **files_to_delete,
-                 svn_fs_x__batch_fsync_t *batch,
+                 svn_batch_fsync__t *batch,
                  apr_pool_t *result_pool,
                  apr_pool_t *scratch_pool)
 {
@@ -1207,8 +1207,8 @@ repack_file_open(apr_file_t **file,
 
   /* open the file */
   new_path = get_revprop_pack_filepath(revprops, &new_entry, scratch_pool);
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(file, batch, new_path,
-                                          scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(file, batch, new_path,
+                                     scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -1236,7 +1236,7 @@ write_packed_revprop(const char **final_path,
                      svn_fs_t *fs,
                      svn_revnum_t rev,
                      apr_hash_t *proplist,
-                     svn_fs_x__batch_fsync_t *batch,
+                     svn_batch_fsync__t *batch,
                      apr_pool_t *result_pool,
                      apr_pool_t *scratch_pool)
 {
@@ -1283,8 +1283,8 @@ write_packed_revprop(const char **final_path,
       *final_path = get_revprop_pack_filepath(revprops, &revprops->entry,
                                               result_pool);
       *tmp_path = apr_pstrcat(result_pool, *final_path, ".tmp", SVN_VA_NULL);
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *tmp_path,
-                                              scratch_pool));
+      SVN_ERR(svn_batch_fsync__open_file(&file, batch, *tmp_path,
+                                         scratch_pool));
       SVN_ERR(repack_revprops(fs, revprops, 0, count,
                               new_total_size, file, scratch_pool));
     }
@@ -1367,8 +1367,8 @@ write_packed_revprop(const char **final_path,
       *final_path = svn_dirent_join(revprops->folder, PATH_MANIFEST,
                                     result_pool);
       *tmp_path = apr_pstrcat(result_pool, *final_path, ".tmp", SVN_VA_NULL);
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *tmp_path,
-                                              scratch_pool));
+      SVN_ERR(svn_batch_fsync__open_file(&file, batch, *tmp_path,
+                                         scratch_pool));
       SVN_ERR(write_manifest(file, revprops->manifest, scratch_pool));
     }
 
@@ -1389,14 +1389,14 @@ svn_fs_x__set_revision_proplist(svn_fs_t *fs,
   const char *tmp_path;
   const char *perms_reference;
   apr_array_header_t *files_to_delete = NULL;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_batch_fsync__t *batch;
   svn_fs_x__data_t *ffd = fs->fsap_data;
 
   SVN_ERR(svn_fs_x__ensure_revision_exists(rev, fs, scratch_pool));
 
   /* Perform all fsyncs through this instance. */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
+  SVN_ERR(svn_batch_fsync__create(&batch, ffd->flush_to_disk,
+                                  scratch_pool));
 
   /* this info will not change while we hold the global FS write lock */
   is_packed = svn_fs_x__is_packed_revprop(fs, rev);
@@ -1513,7 +1513,7 @@ copy_revprops(svn_fs_t *fs,
               apr_array_header_t *sizes,
               apr_size_t total_size,
               int compression_level,
-              svn_fs_x__batch_fsync_t *batch,
+              svn_batch_fsync__t *batch,
               svn_cancel_func_t cancel_func,
               void *cancel_baton,
               apr_pool_t *scratch_pool)
@@ -1548,11 +1548,11 @@ copy_revprops(svn_fs_t *fs,
     }
 
   /* Create the auto-fsync'ing pack file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&pack_file, batch,
-                                          svn_dirent_join(pack_file_dir,
-                                                          pack_filename,
-                                                          scratch_pool),
-                                          scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(&pack_file, batch,
+                                     svn_dirent_join(pack_file_dir,
+                                                     pack_filename,
+                                                     scratch_pool),
+                                     scratch_pool));
 
   /* write all to disk */
   SVN_ERR(write_packed_data_checksummed(root, pack_file, scratch_pool));
@@ -1570,7 +1570,7 @@ svn_fs_x__pack_revprops_shard(svn_fs_t *fs,
                               int max_files_per_dir,
                               apr_int64_t max_pack_size,
                               int compression_level,
-                              svn_fs_x__batch_fsync_t *batch,
+                              svn_batch_fsync__t *batch,
                               svn_cancel_func_t cancel_func,
                               void *cancel_baton,
                               apr_pool_t *scratch_pool)
@@ -1592,8 +1592,8 @@ svn_fs_x__pack_revprops_shard(svn_fs_t *fs,
                                        scratch_pool);
 
   /* Create the manifest file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&manifest_file, batch,
-                                          manifest_file_path, scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(&manifest_file, batch,
+                                     manifest_file_path, scratch_pool));
 
   /* revisions to handle. Special case: revision 0 */
   start_rev = (svn_revnum_t) (shard * max_files_per_dir);
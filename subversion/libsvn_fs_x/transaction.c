@@ -42,9 +42,10 @@
 #include "lock.h"
 #include "rep-cache.h"
 #include "index.h"
-#include "batch_fsync.h"
+#include "private/svn_batch_fsync.h"
 #include "revprops.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -1974,6 +1975,11 @@ svn_fs_x__add_change(svn_fs_t *fs,
   return svn_io_file_close(file, scratch_pool);
 }
 
+/* Checksums calculated over representation contents.  Representations
+   that don't need a SHA1 use only the first entry. */
+static const svn_checksum_kind_t rep_checksum_kinds[]
+  = { svn_checksum_md5, svn_checksum_sha1 };
+
 /* This baton is used by the representation writing streams.  It keeps
    track of the checksum information as well as the total size of the
    representation so far. */
@@ -2007,8 +2013,8 @@ typedef struct rep_write_baton_t
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the fulltext, calculated in a single pass. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
   /* Receives the low-level checksum when closing REP_STREAM. */
   apr_uint32_t fnv1a_checksum;
@@ -2031,8 +2037,7 @@ rep_write_contents(void *baton,
 {
   rep_write_baton_t *b = baton;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
   return svn_stream_write(b->delta_stream, data, len);
@@ -2257,10 +2262,8 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
 
   b = apr_pcalloc(result_pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1,
-                                                 result_pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5,
-                                                result_pool);
+  b->checksum_ctx = svn_checksum__multi_ctx_create(rep_checksum_kinds, 2,
+                                                   TRUE, result_pool);
 
   b->fs = fs;
   b->result_pool = result_pool;
@@ -2309,12 +2312,14 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
                             apr_pool_cleanup_null);
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
-                          &whb,
-                          svn_stream_disown(b->rep_stream, b->result_pool),
-                          diff_version,
-                          ffd->delta_compression_level,
-                          result_pool);
+  svn_txdelta__to_svndiff_parallel(&wh,
+                                   &whb,
+                                   svn_stream_disown(b->rep_stream,
+                                                     b->result_pool),
+                                   diff_version,
+                                   ffd->delta_compression_level,
+                                   ffd->delta_compression_threads,
+                                   result_pool);
 
   b->delta_stream = svn_txdelta_target_push(wh, whb, source,
                                             b->result_pool);
@@ -2551,24 +2556,27 @@ get_shared_rep(svn_fs_x__representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CHECKSUM_CTX into REP.
+ * SHA1 results are only be set if HAS_SHA1 is set, in which case
+ * CHECKSUM_CTX must have calculated them.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 digests_final(svn_fs_x__representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__multi_ctx_t *checksum_ctx,
+              svn_boolean_t has_sha1,
               apr_pool_t *scratch_pool)
 {
   svn_checksum_t *checksum;
 
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, scratch_pool));
+  SVN_ERR(svn_checksum__multi_final(&checksum, checksum_ctx,
+                                    svn_checksum_md5, scratch_pool));
   memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+  rep->has_sha1 = has_sha1;
   if (rep->has_sha1)
     {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, scratch_pool));
+      SVN_ERR(svn_checksum__multi_final(&checksum, checksum_ctx,
+                                        svn_checksum_sha1, scratch_pool));
       memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
     }
 
@@ -2603,8 +2611,7 @@ rep_write_contents_close(void *baton)
   rep->id.change_set = svn_fs_x__change_set_by_txn(txn_id);
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, TRUE, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2778,10 +2785,11 @@ typedef struct write_container_baton_t
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
+  /* MD5 and, optionally, SHA1 of the contents. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* SHA1 calculation is optional. If not needed, this will be FALSE. */
+  svn_boolean_t has_sha1;
 } write_container_baton_t;
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2794,9 +2802,7 @@ write_container_handler(void *baton,
 {
   write_container_baton_t *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2929,9 +2935,10 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_X__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->has_sha1 = item_type != SVN_FS_X__ITEM_TYPE_DIR_REP;
+  whb->checksum_ctx = svn_checksum__multi_ctx_create(rep_checksum_kinds,
+                                                     whb->has_sha1 ? 2 : 1,
+                                                     FALSE, scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2941,7 +2948,8 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, whb->has_sha1,
+                        scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -3481,7 +3489,7 @@ static svn_error_t *
 write_final_revprop(const char **path,
                     svn_fs_txn_t *txn,
                     svn_revnum_t revision,
-                    svn_fs_x__batch_fsync_t *batch,
+                    svn_batch_fsync__t *batch,
                     apr_pool_t *result_pool,
                     apr_pool_t *scratch_pool)
 {
@@ -3514,7 +3522,7 @@ write_final_revprop(const char **path,
 
   /* Create a file at the final revprops location. */
   *path = svn_fs_x__path_revprops(txn->fs, revision, result_pool);
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *path, scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(&file, batch, *path, scratch_pool));
 
   /* Write the new contents to the final revprops file. */
   SVN_ERR(svn_fs_x__write_non_packed_revprops(file, props, scratch_pool));
@@ -3571,7 +3579,7 @@ svn_fs_x__add_index_data(svn_fs_t *fs,
 static svn_error_t *
 auto_create_shard(svn_fs_t *fs,
                   svn_revnum_t revision,
-                  svn_fs_x__batch_fsync_t *batch,
+                  svn_batch_fsync__t *batch,
                   apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
@@ -3588,7 +3596,7 @@ auto_create_shard(svn_fs_t *fs,
       SVN_ERR(svn_io_copy_perms(svn_dirent_join(fs->path, PATH_REVS_DIR,
                                                 scratch_pool),
                                 new_dir, scratch_pool));
-      SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_dir, scratch_pool));
+      SVN_ERR(svn_batch_fsync__new_path(batch, new_dir, scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -3600,7 +3608,7 @@ auto_create_shard(svn_fs_t *fs,
 
    Note that the lifetime of *FILE is determined by BATCH instead of
    SCRATCH_POOL.  It will be invalidated by either BATCH being cleaned up
-   itself of by running svn_fs_x__batch_fsync_run on it.
+   itself of by running svn_batch_fsync__run on it.
 
    This function will "destroy" the transaction by removing its prototype
    revision file, so it can at most be called once per transaction.  Also,
@@ -3615,7 +3623,7 @@ get_writable_final_rev(apr_file_t **file,
                        svn_fs_t *fs,
                        svn_fs_x__txn_id_t txn_id,
                        svn_revnum_t revision,
-                       svn_fs_x__batch_fsync_t *batch,
+                       svn_batch_fsync__t *batch,
                        apr_pool_t *scratch_pool)
 {
   get_writable_proto_rev_baton_t baton;
@@ -3642,13 +3650,13 @@ get_writable_final_rev(apr_file_t **file,
                                                        scratch_pool),
                                    unlock_proto_rev(fs, txn_id, lockcookie,
                                                     scratch_pool)));
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, final_rev_filename,
-                                         scratch_pool));
+  SVN_ERR(svn_batch_fsync__new_path(batch, final_rev_filename,
+                                    scratch_pool));
 
   /* Now open the prototype revision file and seek to the end.
      Note that BATCH always seeks to position 0 before returning the file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(file, batch, final_rev_filename,
-                                          scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(file, batch, final_rev_filename,
+                                     scratch_pool));
   SVN_ERR(svn_io_file_seek(*file, APR_END, &end_offset, scratch_pool));
 
   /* We don't want unused sections (such as leftovers from failed delta
@@ -3665,7 +3673,7 @@ get_writable_final_rev(apr_file_t **file,
 static svn_error_t *
 write_next_file(svn_fs_t *fs,
                 svn_revnum_t revision,
-                svn_fs_x__batch_fsync_t *batch,
+                svn_batch_fsync__t *batch,
                 apr_pool_t *scratch_pool)
 {
   apr_file_t *file;
@@ -3674,7 +3682,7 @@ write_next_file(svn_fs_t *fs,
   char *buf;
 
   /* Create / open the 'next' file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, scratch_pool));
+  SVN_ERR(svn_batch_fsync__open_file(&file, batch, path, scratch_pool));
 
   /* Write its contents. */
   buf = apr_psprintf(scratch_pool, "%ld\n", revision);
@@ -3691,7 +3699,7 @@ write_next_file(svn_fs_t *fs,
 static svn_error_t *
 bump_current(svn_fs_t *fs,
              svn_revnum_t new_rev,
-             svn_fs_x__batch_fsync_t *batch,
+             svn_batch_fsync__t *batch,
              apr_pool_t *scratch_pool)
 {
   const char *current_filename;
@@ -3700,7 +3708,7 @@ bump_current(svn_fs_t *fs,
   SVN_ERR(write_next_file(fs, new_rev, batch, scratch_pool));
 
   /* Commit all changes to disk. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_batch_fsync__run(batch, scratch_pool));
 
   /* Make the revision visible to all processes and threads. */
   current_filename = svn_fs_x__path_current(fs, scratch_pool);
@@ -3709,7 +3717,7 @@ bump_current(svn_fs_t *fs,
                                     batch, scratch_pool));
 
   /* Make the new revision permanently visible. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_batch_fsync__run(batch, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -3776,7 +3784,7 @@ commit_body(void *baton,
   apr_off_t initial_offset, changed_path_offset;
   svn_fs_x__txn_id_t txn_id = svn_fs_x__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_batch_fsync__t *batch;
   apr_array_header_t *directory_ids
     = apr_array_make(scratch_pool, 4, sizeof(svn_fs_x__pair_cache_key_t));
 
@@ -3822,8 +3830,8 @@ commit_body(void *baton,
 
   /* Use this to force all data to be flushed to physical storage
      (to the degree our environment will allow). */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
+  SVN_ERR(svn_batch_fsync__create(&batch, ffd->flush_to_disk,
+                                  scratch_pool));
 
   /* Set up the target directory. */
   SVN_ERR(auto_create_shard(cb->fs, new_rev, batch, subpool));
@@ -751,7 +751,8 @@ svn_ra__file_revs_from_log(svn_ra_session_t *ra_session,
         {
           /* Get the content delta. Don't calculate checksums as we don't
            * use them. */
-          svn_txdelta2(&delta_stream, last_stream, stream, FALSE, lastpool);
+          svn_txdelta3(&delta_stream, last_stream, stream, FALSE, FALSE,
+                       lastpool);
 
           /* And send. */
           SVN_ERR(svn_txdelta_send_txstream(delta_stream, delta_handler,
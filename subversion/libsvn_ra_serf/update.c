@@ -257,6 +257,7 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
 
 #define SPILLBUF_BLOCKSIZE 4096
 #define SPILLBUF_MAXBUFFSIZE 131072
+#define SPILLBUF_MAXPENDING 1048576
 
 #define PARSE_CHUNK_SIZE 8000 /* Copied from xml.c ### Needs tuning */
 
@@ -2294,9 +2295,12 @@ update_delay_handler(serf_request_t *request,
             }
         }
 
-      /* Let's start using the spill infrastructure */
-      udb->spillbuf = svn_spillbuf__create(SPILLBUF_BLOCKSIZE,
+      /* Let's start using the spill infrastructure.  Don't let the disk
+         I/O stall the network reader. */
+      udb->spillbuf = svn_spillbuf__create_write_behind(
+                                           SPILLBUF_BLOCKSIZE,
                                            SPILLBUF_MAXBUFFSIZE,
+                                           SPILLBUF_MAXPENDING,
                                            udb->report->pool);
     }
 
@@ -40,6 +40,7 @@
 #include "svn_private_config.h"
 
 #include "private/svn_atomic.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_editor.h"
 #include "private/svn_string_private.h"
@@ -351,9 +352,10 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   svn_stream_set_write(diff_stream, ra_svn_svndiff_handler);
   svn_stream_set_close(diff_stream, ra_svn_svndiff_close_handler);
 
-  svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream,
-                          svn_ra_svn__svndiff_version(b->conn),
-                          b->conn->compression_level, pool);
+  svn_txdelta__to_svndiff_parallel(wh, wh_baton, diff_stream,
+                                   svn_ra_svn__svndiff_version(b->conn),
+                                   b->conn->compression_level,
+                                   b->conn->compression_threads, pool);
   return SVN_NO_ERROR;
 }
 
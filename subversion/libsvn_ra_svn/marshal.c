@@ -214,6 +214,7 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
   conn->compression_level = compression_level;
+  conn->compression_threads = 1;
   conn->zero_copy_limit = zero_copy_limit;
   conn->pool = result_pool;
 
@@ -283,6 +284,19 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   return 0;
 }
 
+void
+svn_ra_svn__set_compression_threads(svn_ra_svn_conn_t *conn,
+                                    int compression_threads)
+{
+  conn->compression_threads = compression_threads;
+}
+
+int
+svn_ra_svn__compression_threads(svn_ra_svn_conn_t *conn)
+{
+  return conn->compression_threads;
+}
+
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn)
 {
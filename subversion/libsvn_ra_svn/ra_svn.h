@@ -113,6 +113,7 @@ struct svn_ra_svn_conn_st {
   /* server settings */
   apr_hash_t *capabilities;
   int compression_level;
+  int compression_threads;
   apr_size_t zero_copy_limit;
 
   /* who's on the other side of the connection? */
@@ -26,6 +26,7 @@
 #include <zlib.h>
 
 #include "private/svn_adler32.h"
+#include "private/svn_simd.h"
 
 /**
  * An Adler-32 implementation per RFC1950.
@@ -41,6 +42,248 @@
  */
 #define ADLER_MOD_BASE 65521
 
+/*
+ * The largest number of bytes that can be summed up before S2 has to be
+ * reduced modulo ADLER_MOD_BASE to prevent a 32 bit overflow.  This is
+ * the same limit that zlib uses.
+ */
+#define ADLER_NMAX 5552
+
+/*
+ * Update CHECKSUM with the LEN bytes at INPUT using plain C code.
+ * LEN must be less than ADLER_NMAX.
+ */
+static apr_uint32_t
+adler32_scalar(apr_uint32_t checksum,
+               const unsigned char *input,
+               apr_size_t len)
+{
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+  apr_uint32_t b;
+
+  /* Some loop unrolling
+   * (approx. one clock tick per byte + 2 ticks loop overhead)
+   */
+  for (; len >= 8; len -= 8, input += 8)
+    {
+      s1 += input[0]; s2 += s1;
+      s1 += input[1]; s2 += s1;
+      s1 += input[2]; s2 += s1;
+      s1 += input[3]; s2 += s1;
+      s1 += input[4]; s2 += s1;
+      s1 += input[5]; s2 += s1;
+      s1 += input[6]; s2 += s1;
+      s1 += input[7]; s2 += s1;
+    }
+
+  /* Adler-32 calculation as a simple two ticks per iteration loop.
+   */
+  while (len--)
+    {
+      b = *input++;
+      s1 += b;
+      s2 += s1;
+    }
+
+  return ((s2 % ADLER_MOD_BASE) << 16) | (s1 % ADLER_MOD_BASE);
+}
+
+/*
+ * The vector implementations below all work the same way: Within a run
+ * of at most ADLER_NMAX bytes, S1 is simply the sum of all bytes.  Every
+ * byte also gets added to S2 once for each byte that follows it in the
+ * run, plus once for itself.  So, for each chunk of vector size, we add
+ * the chunk's bytes weighted by their distance from the end of the chunk
+ * to S2, and keep track of the sum of the previous chunks' S1 values.
+ * Those have to be added once per byte in the current chunk.
+ *
+ * Each function processes CHUNKS vectors starting at INPUT and returns
+ * the updated CHECKSUM.
+ */
+
+#if SVN__SIMD_AVX2
+
+/* Bytes per vector in adler32_avx2(). */
+#define AVX2_CHUNK 32
+
+static SVN__SIMD_TARGET_AVX2 apr_uint32_t
+adler32_avx2(apr_uint32_t checksum,
+             const unsigned char *input,
+             apr_size_t chunks)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                           24, 23, 22, 21, 20, 19, 18, 17,
+                                           16, 15, 14, 13, 12, 11, 10,  9,
+                                            8,  7,  6,  5,  4,  3,  2,  1);
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  while (chunks)
+    {
+      apr_size_t n = chunks < ADLER_NMAX / AVX2_CHUNK
+                   ? chunks
+                   : ADLER_NMAX / AVX2_CHUNK;
+      __m256i v_ps = zero;
+      __m256i v_s1 = zero;
+      __m256i v_s2 = zero;
+      __m128i sum;
+
+      chunks -= n;
+      s2 += s1 * (apr_uint32_t)(n * AVX2_CHUNK);
+
+      for (; n; --n, input += AVX2_CHUNK)
+        {
+          __m256i bytes = _mm256_loadu_si256((const __m256i *)input);
+
+          /* _mm256_maddubs_epi16 cannot saturate as 255 * (32 + 31)
+           * fits into a signed 16 bit integer. */
+          v_ps = _mm256_add_epi32(v_ps, v_s1);
+          v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+          v_s2 = _mm256_add_epi32(v_s2,
+                   _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights),
+                                     ones));
+        }
+
+      v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+
+      /* Horizontal sums.  The 64 bit results of _mm256_sad_epu8 all fit
+       * into their lower 32 bits. */
+      sum = _mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                          _mm256_extracti128_si256(v_s1, 1));
+      sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+      s1 += (apr_uint32_t)_mm_cvtsi128_si32(sum);
+
+      sum = _mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                          _mm256_extracti128_si256(v_s2, 1));
+      sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+      sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+      s2 += (apr_uint32_t)_mm_cvtsi128_si32(sum);
+
+      s1 %= ADLER_MOD_BASE;
+      s2 %= ADLER_MOD_BASE;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+#endif
+
+#if SVN__SIMD_SSE2
+
+/* Bytes per vector in adler32_sse2(). */
+#define SSE2_CHUNK 16
+
+static apr_uint32_t
+adler32_sse2(apr_uint32_t checksum,
+             const unsigned char *input,
+             apr_size_t chunks)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+  const __m128i weights_hi = _mm_setr_epi16( 8,  7,  6,  5,  4,  3,  2, 1);
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  while (chunks)
+    {
+      apr_size_t n = chunks < ADLER_NMAX / SSE2_CHUNK
+                   ? chunks
+                   : ADLER_NMAX / SSE2_CHUNK;
+      __m128i v_ps = zero;
+      __m128i v_s1 = zero;
+      __m128i v_s2 = zero;
+
+      chunks -= n;
+      s2 += s1 * (apr_uint32_t)(n * SSE2_CHUNK);
+
+      for (; n; --n, input += SSE2_CHUNK)
+        {
+          __m128i bytes = _mm_loadu_si128((const __m128i *)input);
+
+          /* SSE2 has no unsigned byte multiply, so expand to 16 bits. */
+          v_ps = _mm_add_epi32(v_ps, v_s1);
+          v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes, zero));
+          v_s2 = _mm_add_epi32(v_s2,
+                               _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero),
+                                              weights_lo));
+          v_s2 = _mm_add_epi32(v_s2,
+                               _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero),
+                                              weights_hi));
+        }
+
+      v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 4));
+
+      /* Horizontal sums. */
+      v_s1 = _mm_add_epi32(v_s1, _mm_srli_si128(v_s1, 8));
+      s1 += (apr_uint32_t)_mm_cvtsi128_si32(v_s1);
+
+      v_s2 = _mm_add_epi32(v_s2, _mm_srli_si128(v_s2, 8));
+      v_s2 = _mm_add_epi32(v_s2, _mm_srli_si128(v_s2, 4));
+      s2 += (apr_uint32_t)_mm_cvtsi128_si32(v_s2);
+
+      s1 %= ADLER_MOD_BASE;
+      s2 %= ADLER_MOD_BASE;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+#endif
+
+#if SVN__SIMD_NEON
+
+/* Bytes per vector in adler32_neon(). */
+#define NEON_CHUNK 16
+
+static apr_uint32_t
+adler32_neon(apr_uint32_t checksum,
+             const unsigned char *input,
+             apr_size_t chunks)
+{
+  static const uint8_t weight_values[NEON_CHUNK] =
+    { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+
+  const uint8x16_t weights = vld1q_u8(weight_values);
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  while (chunks)
+    {
+      apr_size_t n = chunks < ADLER_NMAX / NEON_CHUNK
+                   ? chunks
+                   : ADLER_NMAX / NEON_CHUNK;
+      uint32x4_t v_ps = vdupq_n_u32(0);
+      uint32x4_t v_s1 = vdupq_n_u32(0);
+      uint32x4_t v_s2 = vdupq_n_u32(0);
+
+      chunks -= n;
+      s2 += s1 * (apr_uint32_t)(n * NEON_CHUNK);
+
+      for (; n; --n, input += NEON_CHUNK)
+        {
+          uint8x16_t bytes = vld1q_u8(input);
+
+          v_ps = vaddq_u32(v_ps, v_s1);
+          v_s1 = vpadalq_u16(v_s1, vpaddlq_u8(bytes));
+          v_s2 = vpadalq_u16(v_s2, vmull_u8(vget_low_u8(bytes),
+                                            vget_low_u8(weights)));
+          v_s2 = vpadalq_u16(v_s2, vmull_high_u8(bytes, weights));
+        }
+
+      v_s2 = vaddq_u32(v_s2, vshlq_n_u32(v_ps, 4));
+
+      s1 = (s1 + vaddvq_u32(v_s1)) % ADLER_MOD_BASE;
+      s2 = (s2 + vaddvq_u32(v_s2)) % ADLER_MOD_BASE;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+#endif
+
 /*
  * Start with CHECKSUM and update the checksum by processing a chunk
  * of DATA sized LEN.
@@ -48,11 +291,49 @@
 apr_uint32_t
 svn__adler32(apr_uint32_t checksum, const char *data, apr_off_t len)
 {
+  const unsigned char *input = (const unsigned char *)data;
+
+  /* Short buffers are not worth the setup overhead of the vector code.
+   * Fall through to the zlib code if vector code is not available. */
+  if (len >= 64)
+    {
+      apr_uint32_t features = svn_simd__get_features();
+      apr_size_t processed = 0;
+
+#if SVN__SIMD_AVX2
+      if (features & SVN_SIMD__AVX2)
+        {
+          processed = (apr_size_t)len & ~(apr_size_t)(AVX2_CHUNK - 1);
+          checksum = adler32_avx2(checksum, input, processed / AVX2_CHUNK);
+        }
+      else
+#endif
+#if SVN__SIMD_SSE2
+      if (features & SVN_SIMD__SSE2)
+        {
+          processed = (apr_size_t)len & ~(apr_size_t)(SSE2_CHUNK - 1);
+          checksum = adler32_sse2(checksum, input, processed / SSE2_CHUNK);
+        }
+#endif
+#if SVN__SIMD_NEON
+      if (features & SVN_SIMD__NEON)
+        {
+          processed = (apr_size_t)len & ~(apr_size_t)(NEON_CHUNK - 1);
+          checksum = adler32_neon(checksum, input, processed / NEON_CHUNK);
+        }
+#endif
+
+      /* The remainder is shorter than a single vector. */
+      if (processed)
+        return adler32_scalar(checksum, input + processed,
+                              (apr_size_t)len - processed);
+    }
+
   /* The actual limit can be set somewhat higher but should
    * not be lower because the SIMD code would not be used
    * in that case.
    *
-   * However, it must be lower than 5552 to make sure our local
+   * However, it must be lower than ADLER_NMAX to make sure our local
    * implementation does not suffer from overflows.
    */
   if (len >= 80)
@@ -67,35 +348,6 @@ svn__adler32(apr_uint32_t checksum, const char *data, apr_off_t len)
     }
   else
     {
-      const unsigned char *input = (const unsigned char *)data;
-      apr_uint32_t s1 = checksum & 0xFFFF;
-      apr_uint32_t s2 = checksum >> 16;
-      apr_uint32_t b;
-
-      /* Some loop unrolling
-       * (approx. one clock tick per byte + 2 ticks loop overhead)
-       */
-      for (; len >= 8; len -= 8, input += 8)
-        {
-          s1 += input[0]; s2 += s1;
-          s1 += input[1]; s2 += s1;
-          s1 += input[2]; s2 += s1;
-          s1 += input[3]; s2 += s1;
-          s1 += input[4]; s2 += s1;
-          s1 += input[5]; s2 += s1;
-          s1 += input[6]; s2 += s1;
-          s1 += input[7]; s2 += s1;
-        }
-
-      /* Adler-32 calculation as a simple two ticks per iteration loop.
-       */
-      while (len--)
-        {
-          b = *input++;
-          s1 += b;
-          s2 += s1;
-        }
-
-      return ((s2 % ADLER_MOD_BASE) << 16) | (s1 % ADLER_MOD_BASE);
+      return adler32_scalar(checksum, input, (apr_size_t)len);
     }
 }
@@ -23,14 +23,15 @@
 #include <apr_thread_pool.h>
 #include <apr_thread_cond.h>
 
-#include "batch_fsync.h"
 #include "svn_pools.h"
 #include "svn_hash.h"
 #include "svn_dirent_uri.h"
 #include "svn_private_config.h"
 
 #include "private/svn_atomic.h"
+#include "private/svn_batch_fsync.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_io_private.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 
@@ -177,14 +178,22 @@ waitable_counter__reset(waitable_counter_t *counter)
   return SVN_NO_ERROR;
 }
 
-/* Entry type for the svn_fs_x__batch_fsync_t collection.  There is one
+/* Entry type for the svn_batch_fsync__t collection.  There is one
  * instance per file handle.
  */
 typedef struct to_sync_t
 {
-  /* Open handle of the file / directory to fsync. */
+  /* Open handle of the file / directory to fsync.  NULL for files added
+   * through svn_batch_fsync__add_file until the flush task opens them. */
   apr_file_t *file;
 
+  /* Path of the file / directory to fsync, allocated in POOL. */
+  const char *path;
+
+  /* Directories need a full fsync.  For files, we only need their data
+   * and the meta data required to read it back. */
+  svn_boolean_t is_dir;
+
   /* Pool to use with FILE.  It is private to FILE such that it can be
    * used safely together with FILE in a separate thread. */
   apr_pool_t *pool;
@@ -197,7 +206,7 @@ typedef struct to_sync_t
 } to_sync_t;
 
 /* The actual collection object. */
-struct svn_fs_x__batch_fsync_t
+struct svn_batch_fsync__t
 {
   /* Maps open file handles: C-string path to to_sync_t *. */
   apr_hash_t *files;
@@ -214,99 +223,77 @@ struct svn_fs_x__batch_fsync_t
  */
 #if APR_HAS_THREADS
 
-/* Number of microseconds that an unused thread remains in the pool before
- * being terminated.
- *
- * Higher values are useful if clients frequently send small requests and
- * you want to minimize the latency for those.
- */
-#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
-
-/* Maximum number of threads in THREAD_POOL, i.e. number of paths we can
- * fsync concurrently throughout the process. */
-#define MAX_THREADS 16
-
-/* Thread pool to execute the fsync tasks. */
+/* The shared thread pool that executes the fsync tasks.  NULL before
+ * svn_batch_fsync__init() and after the cleanup of its OWNING_POOL. */
 static apr_thread_pool_t *thread_pool = NULL;
 
 #endif
 
-/* Keep track on whether we already created the THREAD_POOL . */
+/* Keep track on whether we already initialized THREAD_POOL. */
 static svn_atomic_t thread_pool_initialized = FALSE;
 
+/* Set once the OWNING_POOL passed to svn_batch_fsync__init() has been
+ * cleaned up, e.g. during process shutdown.  From then on, batches get
+ * flushed sequentially. */
+static svn_boolean_t thread_pool_shut_down = FALSE;
+
 /* We open non-directory files with these flags. */
 #define FILE_FLAGS (APR_READ | APR_WRITE | APR_BUFFERED | APR_CREATE)
 
-#if APR_HAS_THREADS
-
-/* Destructor function that implicitly cleans up any running threads
-   in the TRHEAD_POOL *once*.
+/* Files added through svn_batch_fsync__add_file get opened with these
+ * flags.  POSIX lets us fsync read-only handles and files.  Elsewhere,
+ * flush_entry() makes read-only files temporarily writable. */
+#ifdef SVN_ON_POSIX
+#define ADDED_FILE_FLAGS (APR_READ)
+#else
+#define ADDED_FILE_FLAGS (APR_READ | APR_WRITE)
+#endif
 
-   Must be run as a pre-cleanup hook.
- */
+/* Pool cleanup function:  Stop using THREAD_POOL.  The pool itself is
+ * shared with other modules and gets destroyed when APR terminates. */
 static apr_status_t
-thread_pool_pre_cleanup(void *data)
+thread_pool_cleanup(void *data)
 {
-  apr_thread_pool_t *tp = thread_pool;
-  if (!thread_pool)
-    return APR_SUCCESS;
-
+#if APR_HAS_THREADS
   thread_pool = NULL;
+#endif
   thread_pool_initialized = FALSE;
+  thread_pool_shut_down = TRUE;
 
-  return apr_thread_pool_destroy(tp);
+  return APR_SUCCESS;
 }
 
-#endif
-
-/* Core implementation of svn_fs_x__batch_fsync_init. */
+/* Core implementation of svn_batch_fsync__init. */
 static svn_error_t *
-create_thread_pool(void *baton,
-                   apr_pool_t *owning_pool)
+init_thread_pool(void *baton,
+                 apr_pool_t *owning_pool)
 {
 #if APR_HAS_THREADS
-  /* The thread-pool must be allocated from a thread-safe pool.
-     GLOBAL_POOL may be single-threaded, though. */
-  apr_pool_t *pool = svn_pool_create(NULL);
-
-  /* This thread pool will get cleaned up automatically when GLOBAL_POOL
-     gets cleared.  No additional cleanup callback is needed. */
-  WRAP_APR_ERR(apr_thread_pool_create(&thread_pool, 0, MAX_THREADS, pool),
-               _("Can't create fsync thread pool in FSX"));
-
-  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
-     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
-     containing the thread objects would already be invalid. */
-  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
-  apr_pool_pre_cleanup_register(owning_pool, NULL, thread_pool_pre_cleanup);
-
-  /* let idle threads linger for a while in case more requests are
-     coming in */
-  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
-
-  /* don't queue requests unless we reached the worker thread limit */
-  apr_thread_pool_threshold_set(thread_pool, 0);
-
+  SVN_ERR(svn_thread_pool__get(&thread_pool));
 #endif
+  thread_pool_shut_down = FALSE;
+
+  apr_pool_cleanup_register(owning_pool, NULL, thread_pool_cleanup,
+                            apr_pool_cleanup_null);
 
   return SVN_NO_ERROR;
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_init(apr_pool_t *owning_pool)
+svn_batch_fsync__init(apr_pool_t *owning_pool)
 {
   /* Protect against multiple calls. */
   return svn_error_trace(svn_atomic__init_once(&thread_pool_initialized,
-                                               create_thread_pool,
+                                               init_thread_pool,
                                                NULL, owning_pool));
 }
 
-/* Destructor for svn_fs_x__batch_fsync_t.  Releases all global pool memory
+/* Destructor for svn_batch_fsync__t.  Releases all global pool memory
  * and closes all open file handles. */
 static apr_status_t
 fsync_batch_cleanup(void *data)
 {
-  svn_fs_x__batch_fsync_t *batch = data;
+  svn_batch_fsync__t *batch = data;
   apr_hash_index_t *hi;
 
   /* Close all files (implicitly) and release memory. */
@@ -322,11 +309,11 @@ fsync_batch_cleanup(void *data)
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_create(svn_fs_x__batch_fsync_t **result_p,
-                             svn_boolean_t flush_to_disk,
-                             apr_pool_t *result_pool)
+svn_batch_fsync__create(svn_batch_fsync__t **result_p,
+                        svn_boolean_t flush_to_disk,
+                        apr_pool_t *result_pool)
 {
-  svn_fs_x__batch_fsync_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  svn_batch_fsync__t *result = apr_pcalloc(result_pool, sizeof(*result));
   result->files = svn_hash__make(result_pool);
   result->flush_to_disk = flush_to_disk;
 
@@ -339,19 +326,41 @@ svn_fs_x__batch_fsync_create(svn_fs_x__batch_fsync_t **result_p,
   return SVN_NO_ERROR;
 }
 
+/* Return a new to_sync_t instance for PATH in BATCH, allocated in a new
+ * thread-safe pool.  IS_DIR is the respective to_sync_t member. */
+static to_sync_t *
+create_to_sync(svn_batch_fsync__t *batch,
+               const char *path,
+               svn_boolean_t is_dir)
+{
+  /* To be able to process each file in a separate thread, they must use
+   * separate, thread-safe pools.  Allocating a sub-pool from the standard
+   * memory pool achieves exactly that. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  to_sync_t *to_sync = apr_pcalloc(pool, sizeof(*to_sync));
+
+  to_sync->path = apr_pstrdup(pool, path);
+  to_sync->is_dir = is_dir;
+  to_sync->pool = pool;
+  to_sync->result = SVN_NO_ERROR;
+  to_sync->counter = batch->counter;
+
+  return to_sync;
+}
+
 /* If BATCH does not contain a handle for PATH, yet, create one with FLAGS
- * and add it to BATCH.  Set *FILE to the open file handle.
- * Use SCRATCH_POOL for temporaries.
+ * and add it to BATCH.  Set *FILE to the open file handle.  IS_DIR tells
+ * whether PATH is a directory.  Use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 internal_open_file(apr_file_t **file,
-                   svn_fs_x__batch_fsync_t *batch,
+                   svn_batch_fsync__t *batch,
                    const char *path,
                    apr_int32_t flags,
+                   svn_boolean_t is_dir,
                    apr_pool_t *scratch_pool)
 {
   svn_error_t *err;
-  apr_pool_t *pool;
   to_sync_t *to_sync;
 #ifdef SVN_ON_POSIX
   svn_boolean_t is_new_file;
@@ -359,8 +368,17 @@ internal_open_file(apr_file_t **file,
 
   /* If we already have a handle for PATH, return that. */
   to_sync = svn_hash_gets(batch->files, path);
+  if (to_sync && to_sync->file)
+    {
+      *file = to_sync->file;
+      return SVN_NO_ERROR;
+    }
+
+  /* PATH has been scheduled by svn_batch_fsync__add_file.  Open it now. */
   if (to_sync)
     {
+      SVN_ERR(svn_io_file_open(&to_sync->file, path, flags, APR_OS_DEFAULT,
+                               to_sync->pool));
       *file = to_sync->file;
       return SVN_NO_ERROR;
     }
@@ -370,7 +388,7 @@ internal_open_file(apr_file_t **file,
    * exists.  If it doesn't, be sure to schedule parent folder updates, if
    * required on this platform.
    *
-   * See svn_fs_x__batch_fsync_new_path() for when such extra fsyncs may be
+   * See svn_batch_fsync__new_path() for when such extra fsyncs may be
    * needed at all. */
 
 #ifdef SVN_ON_POSIX
@@ -387,22 +405,15 @@ internal_open_file(apr_file_t **file,
 
 #endif
 
-  /* To be able to process each file in a separate thread, they must use
-   * separate, thread-safe pools.  Allocating a sub-pool from the standard
-   * memory pool achieves exactly that. */
-  pool = svn_pool_create(NULL);
-  err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT, pool);
+  to_sync = create_to_sync(batch, path, is_dir);
+  err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT, to_sync->pool);
   if (err)
     {
-      svn_pool_destroy(pool);
+      svn_pool_destroy(to_sync->pool);
       return svn_error_trace(err);
     }
 
-  to_sync = apr_pcalloc(pool, sizeof(*to_sync));
   to_sync->file = *file;
-  to_sync->pool = pool;
-  to_sync->result = SVN_NO_ERROR;
-  to_sync->counter = batch->counter;
 
   svn_hash_sets(batch->files,
                 apr_pstrdup(apr_hash_pool_get(batch->files), path),
@@ -414,7 +425,7 @@ internal_open_file(apr_file_t **file,
 #ifdef SVN_ON_POSIX
 
   if (is_new_file)
-    SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, path, scratch_pool));
+    SVN_ERR(svn_batch_fsync__new_path(batch, path, scratch_pool));
 
 #endif
 
@@ -422,14 +433,14 @@ internal_open_file(apr_file_t **file,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_open_file(apr_file_t **file,
-                                svn_fs_x__batch_fsync_t *batch,
-                                const char *filename,
-                                apr_pool_t *scratch_pool)
+svn_batch_fsync__open_file(apr_file_t **file,
+                           svn_batch_fsync__t *batch,
+                           const char *filename,
+                           apr_pool_t *scratch_pool)
 {
   apr_off_t offset = 0;
 
-  SVN_ERR(internal_open_file(file, batch, filename, FILE_FLAGS,
+  SVN_ERR(internal_open_file(file, batch, filename, FILE_FLAGS, FALSE,
                              scratch_pool));
   SVN_ERR(svn_io_file_seek(*file, APR_SET, &offset, scratch_pool));
 
@@ -437,9 +448,28 @@ svn_fs_x__batch_fsync_open_file(apr_file_t **file,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_new_path(svn_fs_x__batch_fsync_t *batch,
-                               const char *path,
-                               apr_pool_t *scratch_pool)
+svn_batch_fsync__add_file(svn_batch_fsync__t *batch,
+                          const char *filename,
+                          apr_pool_t *scratch_pool)
+{
+  /* Scheduling the same file twice is a no-op. */
+  if (svn_hash_gets(batch->files, filename))
+    return SVN_NO_ERROR;
+
+  /* Don't keep the file open.  The flush task will open it and close it
+   * again as soon as it has been flushed.  That way, there is no limit on
+   * the number of files scheduled in BATCH. */
+  svn_hash_sets(batch->files,
+                apr_pstrdup(apr_hash_pool_get(batch->files), filename),
+                create_to_sync(batch, filename, FALSE));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_batch_fsync__new_path(svn_batch_fsync__t *batch,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
 {
   apr_file_t *file;
 
@@ -448,17 +478,23 @@ svn_fs_x__batch_fsync_new_path(svn_fs_x__batch_fsync_t *batch,
   /* On POSIX, we need to sync the parent directory because it contains
    * the name for the file / folder given by PATH. */
   path = svn_dirent_dirname(path, scratch_pool);
-  SVN_ERR(internal_open_file(&file, batch, path, APR_READ, scratch_pool));
+  SVN_ERR(internal_open_file(&file, batch, path, APR_READ, TRUE,
+                             scratch_pool));
 
 #else
 
   svn_node_kind_t kind;
 
   /* On non-POSIX systems, we assume that sync'ing the given PATH is the
-   * right thing to do.  Also, we assume that only files may be sync'ed. */
+   * right thing to do.  Also, we assume that only files may be sync'ed.
+   * Files scheduled through svn_batch_fsync__add_file are covered already
+   * and must not be opened for writing here. */
+  if (svn_hash_gets(batch->files, path))
+    return SVN_NO_ERROR;
+
   SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
   if (kind == svn_node_file)
-    SVN_ERR(internal_open_file(&file, batch, path, FILE_FLAGS,
+    SVN_ERR(internal_open_file(&file, batch, path, FILE_FLAGS, FALSE,
                                scratch_pool));
 
 #endif
@@ -466,6 +502,61 @@ svn_fs_x__batch_fsync_new_path(svn_fs_x__batch_fsync_t *batch,
   return SVN_NO_ERROR;
 }
 
+/* Flush the file or directory given by TO_SYNC to disk.  If it has not
+ * been opened, yet, open it temporarily. */
+static svn_error_t *
+flush_entry(to_sync_t *to_sync)
+{
+  apr_file_t *file;
+  svn_error_t *err;
+#ifndef SVN_ON_POSIX
+  apr_finfo_t finfo;
+  svn_boolean_t read_only;
+#endif
+
+  if (to_sync->file)
+    {
+      if (to_sync->is_dir)
+        return svn_error_trace(svn_io_file_flush_to_disk(to_sync->file,
+                                                         to_sync->pool));
+
+      return svn_error_trace(svn_io__file_flush_data_to_disk(to_sync->file,
+                                                             to_sync->pool));
+    }
+
+#ifndef SVN_ON_POSIX
+  /* We need write access to flush the file.  Read-only files, e.g. the
+   * revision files copied by hotcopy, must be made writable for that. */
+  SVN_ERR(svn_io_stat(&finfo, to_sync->path, APR_FINFO_PROT | APR_FINFO_OWNER,
+                      to_sync->pool));
+  SVN_ERR(svn_io__is_finfo_read_only(&read_only, &finfo, to_sync->pool));
+  if (read_only)
+    SVN_ERR(svn_io_set_file_read_write(to_sync->path, FALSE,
+                                       to_sync->pool));
+#endif
+
+  err = svn_io_file_open(&file, to_sync->path, ADDED_FILE_FLAGS,
+                         APR_OS_DEFAULT, to_sync->pool);
+  if (!err)
+    {
+      /* Flush before closing.  Keep the calls in separate statements;
+       * the evaluation order of function arguments is unspecified. */
+      err = svn_io__file_flush_data_to_disk(file, to_sync->pool);
+      err = svn_error_compose_create(err,
+                                     svn_io_file_close(file, to_sync->pool));
+    }
+
+#ifndef SVN_ON_POSIX
+  if (read_only)
+    err = svn_error_compose_create(err,
+                                   svn_io_set_file_read_only(to_sync->path,
+                                                             FALSE,
+                                                             to_sync->pool));
+#endif
+
+  return svn_error_trace(err);
+}
+
 /* Thread-pool task Flush the to_sync_t instance given by DATA. */
 static void * APR_THREAD_FUNC
 flush_task(apr_thread_t *tid,
@@ -473,8 +564,8 @@ flush_task(apr_thread_t *tid,
 {
   to_sync_t *to_sync = data;
 
-  to_sync->result = svn_error_trace(svn_io_file_flush_to_disk
-                                        (to_sync->file, to_sync->pool));
+  to_sync->result = svn_error_compose_create(to_sync->result,
+                                             flush_entry(to_sync));
 
   /* As soon as the increment call returns, TO_SYNC may be invalid
      (the main thread may have woken up and released the struct.
@@ -489,8 +580,8 @@ flush_task(apr_thread_t *tid,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
-                          apr_pool_t *scratch_pool)
+svn_batch_fsync__run(svn_batch_fsync__t *batch,
+                     apr_pool_t *scratch_pool)
 {
   apr_hash_index_t *hi;
 
@@ -503,6 +594,15 @@ svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
    */
   svn_error_t *chain = SVN_NO_ERROR;
 
+#if APR_HAS_THREADS
+
+  /* Forgot to call _init()?  Once the owning pool has been cleaned up,
+   * e.g. during process shutdown, we flush sequentially instead. */
+  if (batch->flush_to_disk && !thread_pool_shut_down)
+    SVN_ERR_ASSERT(thread_pool);
+
+#endif
+
   /* First, flush APR-internal buffers. This should minimize / prevent the
    * introduction of additional meta-data changes during the next phase.
    * We might otherwise issue redundant fsyncs.
@@ -512,8 +612,51 @@ svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
        hi = apr_hash_next(hi))
     {
       to_sync_t *to_sync = apr_hash_this_val(hi);
-      to_sync->result = svn_error_trace(svn_io_file_flush
-                                           (to_sync->file, to_sync->pool));
+      if (to_sync->file)
+        to_sync->result = svn_error_trace(svn_io_file_flush
+                                             (to_sync->file, to_sync->pool));
+    }
+
+  /* Let the OS start writing back all file contents at once, before we
+   * wait for any of them.  This gives the I/O scheduler the chance to
+   * merge and reorder the requests.  It is merely a hint, so we ignore
+   * any errors when opening the files here - the actual flush will
+   * report them. */
+  if (batch->flush_to_disk)
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      for (hi = apr_hash_first(scratch_pool, batch->files);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          to_sync_t *to_sync = apr_hash_this_val(hi);
+          if (to_sync->is_dir)
+            continue;
+
+          if (to_sync->file)
+            {
+              svn_io__file_start_writeback(to_sync->file);
+            }
+          else
+            {
+              apr_file_t *file;
+              svn_error_t *err;
+
+              svn_pool_clear(iterpool);
+              err = svn_io_file_open(&file, to_sync->path, ADDED_FILE_FLAGS,
+                                     APR_OS_DEFAULT, iterpool);
+              if (err)
+                {
+                  svn_error_clear(err);
+                }
+              else
+                {
+                  svn_io__file_start_writeback(file);
+                  svn_error_clear(svn_io_file_close(file, iterpool));
+                }
+            }
+        }
+      svn_pool_destroy(iterpool);
     }
 
   /* Make sure the task completion counter is set to 0. */
@@ -531,20 +674,20 @@ svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
 
 #if APR_HAS_THREADS
 
-          /* Forgot to call _init() or cleaned up the owning pool too early?
-           */
-          SVN_ERR_ASSERT(thread_pool);
-
           /* If there are multiple fsyncs to perform, run them in parallel.
-           * Otherwise, skip the thread-pool and synchronization overhead. */
-          if (apr_hash_count(batch->files) > 1)
+           * Otherwise, skip the thread-pool and synchronization overhead.
+           * The same applies if the thread pool has already been shut
+           * down, e.g. during process shutdown. */
+          if (!thread_pool_shut_down && apr_hash_count(batch->files) > 1)
             {
               apr_status_t status = APR_SUCCESS;
               status = apr_thread_pool_push(thread_pool, flush_task, to_sync,
                                             0, NULL);
               if (status)
-                to_sync->result = svn_error_wrap_apr(status,
-                                                     _("Can't push task"));
+                to_sync->result = svn_error_compose_create(
+                                    to_sync->result,
+                                    svn_error_wrap_apr(status,
+                                                       _("Can't push task")));
               else
                 tasks++;
             }
@@ -553,9 +696,8 @@ svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
 #endif
 
             {
-              to_sync->result = svn_error_trace(svn_io_file_flush_to_disk
-                                                  (to_sync->file,
-                                                   to_sync->pool));
+              to_sync->result = svn_error_compose_create(to_sync->result,
+                                                   flush_entry(to_sync));
             }
         }
     }
@@ -573,10 +715,13 @@ svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
       to_sync_t *to_sync = apr_hash_this_val(hi);
       if (batch->flush_to_disk)
         chain = svn_error_compose_create(chain, to_sync->result);
+      else
+        svn_error_clear(to_sync->result);
 
-      chain = svn_error_compose_create(chain,
-                                       svn_io_file_close(to_sync->file,
-                                                         scratch_pool));
+      if (to_sync->file)
+        chain = svn_error_compose_create(chain,
+                                         svn_io_file_close(to_sync->file,
+                                                           scratch_pool));
       svn_pool_destroy(to_sync->pool);
     }
 
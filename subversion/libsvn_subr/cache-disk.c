@@ -0,0 +1,836 @@
+/*
+ * cache-disk.c: on-disk tier for the membuffer cache
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_hash.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+
+#include "cache.h"
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
+
+/* The on-disk tier is a single file that gets written like a ring buffer:
+ * records are appended until the configured size limit would be exceeded.
+ * Then, writing continues at the beginning of the file, overwriting the
+ * oldest records.  Nothing is ever modified in place.
+ *
+ * The file starts with FILE_HEADER_SIZE bytes that identify the format.
+ * Each record consists of a record_header_t followed by the item data,
+ * the key prefix string and the full key.  Records are padded to
+ * RECORD_ALIGNMENT bytes.  Placing the data directly behind the header
+ * means that the data is sufficiently aligned for in-place deserialization
+ * after we read the whole record into a pool-allocated buffer.
+ *
+ * The index of the valid records is kept in memory only.  When the file
+ * gets opened, the index is being rebuilt from the record headers, so
+ * the cache contents survives process restarts.  All integers are stored
+ * in native byte order as this file is meant to be local to the machine.
+ *
+ * Every read validates the record's checksum and key.  Records that
+ * fail the validation get dropped from the index and reported as misses.
+ * The checksum only guards against corruption, not against manipulation.
+ * Since the data gets deserialized in place, the file is created to be
+ * accessible by its owner only.  Other processes sharing the file would
+ * overwrite each other's records, hence we hold an exclusive lock on it
+ * for as long as it is open.
+ *
+ * Items get demoted while the membuffer holds a segment lock, so adding
+ * them must not wait for any I/O.  svn_cache__disk_put() only copies the
+ * record into an in-memory queue.  svn_cache__disk_flush() writes the
+ * queued records to the file later.  The queue consists of two buffers:
+ * new records get appended to one of them while the other one is being
+ * written.  Queued records can be read like those in the file.
+ */
+
+/* Format identification at the beginning of the file. */
+#define FILE_MAGIC "SVN membuffer disk cache v1\n"
+
+/* Offset of the first record in the file. */
+#define FILE_HEADER_SIZE 64
+
+/* Records begin at multiples of this. */
+#define RECORD_ALIGNMENT 16
+
+/* Upper limit for the size of each of the two queue buffers.  Larger
+ * records will not be stored. */
+#define MAX_QUEUE_SIZE 0x400000
+
+/* Marks the beginning of each record. */
+#define RECORD_MAGIC APR_UINT64_C(0x53564e4c33524543)
+
+/* Align VALUE to the next RECORD_ALIGNMENT boundary. */
+#define ALIGN_RECORD(value) \
+  (((value) + RECORD_ALIGNMENT - 1) & ~(apr_uint64_t)(RECORD_ALIGNMENT - 1))
+
+/* Header of each record in the file. */
+typedef struct record_header_t
+{
+  /* Always RECORD_MAGIC. */
+  apr_uint64_t magic;
+
+  /* Order in which the records have been written, starting at 1. */
+  apr_uint64_t sequence;
+
+  /* Entry key fingerprint as provided by the membuffer cache. */
+  apr_uint64_t fingerprint[2];
+
+  /* Lengths of the item data, the key prefix and the full key. */
+  apr_uint32_t data_len;
+  apr_uint32_t prefix_len;
+  apr_uint32_t key_len;
+
+  /* FNV-1a checksum over the whole record with this field set to 0. */
+  apr_uint32_t checksum;
+} record_header_t;
+
+/* Index entry describing a single record in the file. */
+typedef struct disk_entry_t
+{
+  /* Key of the index hash. */
+  apr_uint64_t fingerprint[2];
+
+  /* Copied from the record header. */
+  apr_uint64_t sequence;
+
+  /* Position and aligned size of the record within the file. */
+  apr_off_t offset;
+  apr_uint32_t size;
+
+  /* Whether this entry is in the index hash.  Records that have been
+   * superseded by newer ones for the same key are not. */
+  svn_boolean_t live;
+
+  /* Next newer entry in the write order, or next unused entry. */
+  struct disk_entry_t *next;
+} disk_entry_t;
+
+/* One of the two buffers of the write queue. */
+typedef struct queue_t
+{
+  /* Complete records, placed directly behind each other.  Their sequence
+   * numbers and checksums will be set when they get written. */
+  char *data;
+
+  /* Number of bytes used in DATA. */
+  apr_size_t used;
+} queue_t;
+
+struct svn_cache__disk_t
+{
+  /* The cache file, opened for reading and writing. */
+  apr_file_t *file;
+
+  /* Maximum size of the file in bytes. */
+  apr_off_t capacity;
+
+  /* Where the next record will be written. */
+  apr_off_t write_pos;
+
+  /* Sequence number of the next record. */
+  apr_uint64_t next_sequence;
+
+  /* Maps fingerprints to live disk_entry_t. */
+  apr_hash_t *index;
+
+  /* All entries in write order, i.e. OLDEST gets overwritten next.
+   * Both are NULL if the list is empty. */
+  disk_entry_t *oldest;
+  disk_entry_t *newest;
+
+  /* Recycled entries, linked through their NEXT member. */
+  disk_entry_t *unused;
+
+  /* Pool for the index and all other long-lived data. */
+  apr_pool_t *pool;
+
+  /* Pool for temporaries, cleared at the end of each operation. */
+  apr_pool_t *scratch_pool;
+
+  /* Serializes all access to the members above, i.e. all file I/O. */
+  svn_mutex__t *mutex;
+
+  /* The write queue buffers, each QUEUE_SIZE bytes.  New records get
+   * appended to QUEUE[FILLING].  The other one is either empty or being
+   * written by svn_cache__disk_flush(). */
+  queue_t queue[2];
+  apr_size_t queue_size;
+  int filling;
+
+  /* Serializes all access to the queue members above.  Never held while
+   * doing I/O and never held together with MUTEX. */
+  svn_mutex__t *queue_mutex;
+
+  /* Non-zero while some thread is running svn_cache__disk_flush(). */
+  volatile svn_atomic_t flushing;
+};
+
+
+/* Return an unused index entry from DISK. */
+static disk_entry_t *
+alloc_entry(svn_cache__disk_t *disk)
+{
+  disk_entry_t *entry = disk->unused;
+  if (entry)
+    disk->unused = entry->next;
+  else
+    entry = apr_palloc(disk->pool, sizeof(*entry));
+
+  return entry;
+}
+
+/* Remove the oldest entry from DISK's list and index. */
+static void
+drop_oldest(svn_cache__disk_t *disk)
+{
+  disk_entry_t *entry = disk->oldest;
+
+  disk->oldest = entry->next;
+  if (disk->oldest == NULL)
+    disk->newest = NULL;
+
+  if (entry->live)
+    apr_hash_set(disk->index, entry->fingerprint, sizeof(entry->fingerprint),
+                 NULL);
+
+  entry->next = disk->unused;
+  disk->unused = entry;
+}
+
+/* Remove ENTRY from DISK's index, e.g. because its record turned out to
+ * be invalid.  The record space will be reclaimed in due course. */
+static void
+drop_from_index(svn_cache__disk_t *disk,
+                disk_entry_t *entry)
+{
+  apr_hash_set(disk->index, entry->fingerprint, sizeof(entry->fingerprint),
+               NULL);
+  entry->live = FALSE;
+}
+
+/* Append a new entry for the record at OFFSET with SIZE bytes and the
+ * given SEQUENCE and FINGERPRINT to DISK's list and index.  It replaces
+ * any older entry for the same FINGERPRINT. */
+static void
+add_entry(svn_cache__disk_t *disk,
+          const apr_uint64_t fingerprint[2],
+          apr_uint64_t sequence,
+          apr_off_t offset,
+          apr_uint32_t size)
+{
+  disk_entry_t *entry = alloc_entry(disk);
+  disk_entry_t *old_entry = apr_hash_get(disk->index, fingerprint,
+                                         sizeof(entry->fingerprint));
+
+  /* The hash keeps referring to the key in OLD_ENTRY, so we must remove
+   * it before adding the new one. */
+  if (old_entry)
+    drop_from_index(disk, old_entry);
+
+  entry->fingerprint[0] = fingerprint[0];
+  entry->fingerprint[1] = fingerprint[1];
+  entry->sequence = sequence;
+  entry->offset = offset;
+  entry->size = size;
+  entry->live = TRUE;
+  entry->next = NULL;
+
+  if (disk->newest)
+    disk->newest->next = entry;
+  else
+    disk->oldest = entry;
+  disk->newest = entry;
+
+  apr_hash_set(disk->index, entry->fingerprint, sizeof(entry->fingerprint),
+               entry);
+}
+
+/* Make room for a record of SIZE bytes at DISK->WRITE_POS, wrapping
+ * around to the beginning of the file if necessary.  Drop all entries
+ * whose records would get overwritten. */
+static void
+make_room(svn_cache__disk_t *disk,
+          apr_uint32_t size)
+{
+  if (disk->write_pos + size > disk->capacity)
+    {
+      /* Records between the current position and the end of the file
+       * are the oldest ones.  We give up on them as they would otherwise
+       * need to be skipped in the overlap test below. */
+      apr_off_t old_pos = disk->write_pos;
+      while (disk->oldest && disk->oldest->offset >= old_pos)
+        drop_oldest(disk);
+
+      disk->write_pos = FILE_HEADER_SIZE;
+    }
+
+  /* The oldest records follow directly after WRITE_POS. */
+  while (   disk->oldest
+         && disk->oldest->offset < disk->write_pos + size
+         && disk->oldest->offset + disk->oldest->size > disk->write_pos)
+    drop_oldest(disk);
+}
+
+/* Return the checksum over the RECORD of LEN bytes.  The checksum field
+ * in its header will be set to 0. */
+static apr_uint32_t
+record_checksum(char *record,
+                apr_size_t len)
+{
+  ((record_header_t *)record)->checksum = 0;
+  return svn__fnv1a_32x4(record, len);
+}
+
+/* Return the aligned size of a record for the lengths given in HEADER. */
+static apr_uint64_t
+record_size(const record_header_t *header)
+{
+  return ALIGN_RECORD((apr_uint64_t)sizeof(*header)
+                      + header->data_len
+                      + header->prefix_len
+                      + header->key_len);
+}
+
+/* Write the file header to DISK, discarding all previous contents.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+reset_file(svn_cache__disk_t *disk,
+           apr_pool_t *scratch_pool)
+{
+  char header[FILE_HEADER_SIZE] = { 0 };
+  apr_off_t offset = 0;
+
+  memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC) - 1);
+
+  SVN_ERR(svn_io_file_trunc(disk->file, 0, scratch_pool));
+  SVN_ERR(svn_io_file_seek(disk->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(disk->file, header, sizeof(header), NULL,
+                                 scratch_pool));
+
+  disk->write_pos = FILE_HEADER_SIZE;
+  disk->next_sequence = 1;
+
+  return SVN_NO_ERROR;
+}
+
+/* Comparison function for qsort ordering the disk_entry_t * in LHS and RHS
+ * by their sequence numbers. */
+static int
+compare_sequence(const void *lhs,
+                 const void *rhs)
+{
+  const disk_entry_t *lhs_entry = *(const disk_entry_t * const *)lhs;
+  const disk_entry_t *rhs_entry = *(const disk_entry_t * const *)rhs;
+
+  if (lhs_entry->sequence < rhs_entry->sequence)
+    return -1;
+
+  return lhs_entry->sequence > rhs_entry->sequence ? 1 : 0;
+}
+
+/* Rebuild the index of DISK from the record headers in its file.  Stop
+ * at the first invalid header.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+read_index(svn_cache__disk_t *disk,
+           apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool, 16, sizeof(disk_entry_t *));
+  char magic[FILE_HEADER_SIZE];
+  apr_size_t bytes_read;
+  svn_boolean_t eof;
+  apr_off_t offset = 0;
+  apr_off_t file_size;
+  int i;
+
+  SVN_ERR(svn_io_file_seek(disk->file, APR_END, &offset, scratch_pool));
+  file_size = offset;
+
+  /* Start from scratch if this is not one of our files. */
+  offset = 0;
+  SVN_ERR(svn_io_file_seek(disk->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(disk->file, magic, sizeof(magic),
+                                 &bytes_read, &eof, scratch_pool));
+  if (   bytes_read < sizeof(magic)
+      || memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC) - 1))
+    return svn_error_trace(reset_file(disk, scratch_pool));
+
+  /* Collect all records that are plausible.  Their contents will only be
+   * verified when being read. */
+  disk->write_pos = FILE_HEADER_SIZE;
+  disk->next_sequence = 1;
+  offset = FILE_HEADER_SIZE;
+  while (offset + (apr_off_t)sizeof(record_header_t) <= file_size)
+    {
+      record_header_t header;
+      apr_uint64_t size;
+      disk_entry_t *entry;
+
+      SVN_ERR(svn_io_file_read_full2(disk->file, &header, sizeof(header),
+                                     &bytes_read, &eof, scratch_pool));
+      if (bytes_read < sizeof(header) || header.magic != RECORD_MAGIC)
+        break;
+
+      size = record_size(&header);
+      if (   header.sequence == 0
+          || offset + size > (apr_uint64_t)disk->capacity
+          || offset + size > (apr_uint64_t)file_size)
+        break;
+
+      entry = apr_palloc(scratch_pool, sizeof(*entry));
+      entry->fingerprint[0] = header.fingerprint[0];
+      entry->fingerprint[1] = header.fingerprint[1];
+      entry->sequence = header.sequence;
+      entry->offset = offset;
+      entry->size = (apr_uint32_t)size;
+      APR_ARRAY_PUSH(entries, disk_entry_t *) = entry;
+
+      /* Continue with the next record. */
+      offset += size;
+      SVN_ERR(svn_io_file_seek(disk->file, APR_SET, &offset, scratch_pool));
+    }
+
+  /* Restore the write order.  Later records supersede earlier ones. */
+  qsort(entries->elts, entries->nelts, entries->elt_size, compare_sequence);
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      disk_entry_t *entry = APR_ARRAY_IDX(entries, i, disk_entry_t *);
+      add_entry(disk, entry->fingerprint, entry->sequence, entry->offset,
+                entry->size);
+
+      disk->write_pos = entry->offset + entry->size;
+      disk->next_sequence = entry->sequence + 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t size,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_cache__disk_t *disk = apr_pcalloc(result_pool, sizeof(*disk));
+  svn_error_t *err;
+
+  /* We need room for at least a few records. */
+  if (size < 16 * FILE_HEADER_SIZE || size > APR_INT64_MAX)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid size %s for the disk cache '%s'"),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT, size),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  disk->capacity = (apr_off_t)size;
+  disk->index = apr_hash_make(result_pool);
+  disk->pool = result_pool;
+  disk->scratch_pool = svn_pool_create(result_pool);
+  SVN_ERR(svn_mutex__init(&disk->mutex, TRUE, result_pool));
+
+  /* Both queue buffers get allocated up-front, so enqueuing a record
+   * never needs to allocate memory. */
+  disk->queue_size = (apr_size_t)MIN((size - FILE_HEADER_SIZE) / 4,
+                                     MAX_QUEUE_SIZE);
+  disk->queue[0].data = apr_palloc(result_pool, disk->queue_size);
+  disk->queue[1].data = apr_palloc(result_pool, disk->queue_size);
+  SVN_ERR(svn_mutex__init(&disk->queue_mutex, TRUE, result_pool));
+
+  SVN_ERR(svn_io_file_open(&disk->file, path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_FPROT_UREAD | APR_FPROT_UWRITE, result_pool));
+
+  /* The lock gets released when the file is being closed. */
+  err = svn_io_lock_open_file(disk->file, TRUE, TRUE, result_pool);
+  if (err)
+    {
+      if (APR_STATUS_IS_EAGAIN(err->apr_err)
+          || APR_STATUS_IS_EACCES(err->apr_err))
+        err = svn_error_createf(SVN_ERR_INCORRECT_PARAMS, err,
+                                _("The disk cache '%s' is already in use "
+                                  "by another process"),
+                                svn_dirent_local_style(path, scratch_pool));
+
+      return svn_error_compose_create(err,
+                                      svn_io_file_close(disk->file,
+                                                        scratch_pool));
+    }
+
+  SVN_ERR(read_index(disk, scratch_pool));
+
+  *disk_p = disk;
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__disk_put with the queue mutex being held. */
+static svn_error_t *
+disk_put(svn_cache__disk_t *disk,
+         const apr_uint64_t fingerprint[2],
+         const char *prefix,
+         const void *key,
+         apr_size_t key_len,
+         const void *data,
+         apr_size_t data_len)
+{
+  queue_t *queue = &disk->queue[disk->filling];
+  record_header_t *header;
+  apr_size_t prefix_len = strlen(prefix);
+  apr_uint64_t size;
+  char *record;
+
+  /* Very large items would flush too much of the cache.  This check
+   * also guarantees that the lengths fit into the record header.  Also,
+   * drop the item if the queue is full. */
+  size = ALIGN_RECORD((apr_uint64_t)sizeof(*header) + data_len + prefix_len
+                      + key_len);
+  if (size > disk->queue_size - queue->used)
+    return SVN_NO_ERROR;
+
+  /* Assemble the record at the end of the queue. */
+  record = queue->data + queue->used;
+  memset(record, 0, (apr_size_t)size);
+
+  header = (record_header_t *)record;
+  header->magic = RECORD_MAGIC;
+  header->fingerprint[0] = fingerprint[0];
+  header->fingerprint[1] = fingerprint[1];
+  header->data_len = (apr_uint32_t)data_len;
+  header->prefix_len = (apr_uint32_t)prefix_len;
+  header->key_len = (apr_uint32_t)key_len;
+
+  memcpy(record + sizeof(*header), data, data_len);
+  memcpy(record + sizeof(*header) + data_len, prefix, prefix_len);
+  memcpy(record + sizeof(*header) + data_len + prefix_len, key, key_len);
+
+  queue->used += (apr_size_t)size;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_put(svn_cache__disk_t *disk,
+                    const apr_uint64_t fingerprint[2],
+                    const char *prefix,
+                    const void *key,
+                    apr_size_t key_len,
+                    const void *data,
+                    apr_size_t data_len)
+{
+  SVN_MUTEX__WITH_LOCK(disk->queue_mutex,
+                       disk_put(disk, fingerprint, prefix, key, key_len,
+                                data, data_len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the queued RECORD to DISK and add it to the index.  The mutex
+ * must be held. */
+static svn_error_t *
+write_record(svn_cache__disk_t *disk,
+             char *record)
+{
+  record_header_t *header = (record_header_t *)record;
+  apr_uint64_t size = record_size(header);
+  apr_off_t offset;
+  svn_error_t *err;
+
+  header->sequence = disk->next_sequence;
+  header->checksum = record_checksum(record, (apr_size_t)size);
+
+  make_room(disk, (apr_uint32_t)size);
+  offset = disk->write_pos;
+  err = svn_io_file_seek(disk->file, APR_SET, &offset, disk->scratch_pool);
+  if (!err)
+    err = svn_io_file_write_full(disk->file, record, (apr_size_t)size, NULL,
+                                 disk->scratch_pool);
+
+  svn_pool_clear(disk->scratch_pool);
+
+  /* The record may have been written partially.  Since we may have
+   * overwritten parts of other records, they are gone from the index
+   * already.  All we need to do is not to index this one. */
+  SVN_ERR(err);
+
+  add_entry(disk, header->fingerprint, disk->next_sequence, disk->write_pos,
+            (apr_uint32_t)size);
+  disk->write_pos += size;
+  disk->next_sequence++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Swap the queue buffers of DISK and return the one that has been filled
+ * so far in *QUEUE.  Set it to NULL if that is empty.  The queue mutex
+ * must be held. */
+static svn_error_t *
+swap_queues(queue_t **queue,
+            svn_cache__disk_t *disk)
+{
+  *queue = &disk->queue[disk->filling];
+  if ((*queue)->used == 0)
+    *queue = NULL;
+  else
+    disk->filling = 1 - disk->filling;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark QUEUE as being empty.  The queue mutex must be held. */
+static svn_error_t *
+reset_queue(queue_t *queue)
+{
+  queue->used = 0;
+  return SVN_NO_ERROR;
+}
+
+/* Write all records in QUEUE to DISK and empty QUEUE afterwards.  Records
+ * that could not be written are lost. */
+static svn_error_t *
+write_queue(svn_cache__disk_t *disk,
+            queue_t *queue)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_error_t *lock_err;
+  apr_size_t offset;
+
+  /* Records stay readable from QUEUE until they are in the index.
+   * Release the mutex after each record to let readers in. */
+  for (offset = 0; !err && offset < queue->used; )
+    {
+      char *record = queue->data + offset;
+      offset += (apr_size_t)record_size((record_header_t *)record);
+
+      err = svn_mutex__lock(disk->mutex);
+      if (!err)
+        err = svn_mutex__unlock(disk->mutex, write_record(disk, record));
+    }
+
+  /* The queue must be empty before it may be swapped again. */
+  lock_err = svn_mutex__lock(disk->queue_mutex);
+  if (!lock_err)
+    lock_err = svn_mutex__unlock(disk->queue_mutex, reset_queue(queue));
+
+  return svn_error_compose_create(err, lock_err);
+}
+
+svn_error_t *
+svn_cache__disk_flush(svn_cache__disk_t *disk)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* Someone else is already writing.  They will also pick up what we
+   * might have added to the queue, unless they are about to finish.
+   * Then, our records will be written with the next flush. */
+  if (svn_atomic_cas(&disk->flushing, TRUE, FALSE) != FALSE)
+    return SVN_NO_ERROR;
+
+  while (!err)
+    {
+      queue_t *queue;
+
+      err = svn_mutex__lock(disk->queue_mutex);
+      if (!err)
+        err = svn_mutex__unlock(disk->queue_mutex,
+                                swap_queues(&queue, disk));
+      if (err || queue == NULL)
+        break;
+
+      err = write_queue(disk, queue);
+    }
+
+  svn_atomic_set(&disk->flushing, FALSE);
+  return svn_error_trace(err);
+}
+
+/* Look up the newest record for FINGERPRINT, PREFIX and the KEY_LEN bytes
+ * of KEY in QUEUE.  If found, return a copy of its data allocated in
+ * RESULT_POOL in *DATA and its length in *DATA_LEN.  Otherwise, leave
+ * both unchanged. */
+static void
+queue_get(void **data,
+          apr_size_t *data_len,
+          const queue_t *queue,
+          const apr_uint64_t fingerprint[2],
+          const char *prefix,
+          const void *key,
+          apr_size_t key_len,
+          apr_pool_t *result_pool)
+{
+  apr_size_t prefix_len = strlen(prefix);
+  const record_header_t *found = NULL;
+  apr_size_t offset;
+
+  for (offset = 0; offset < queue->used; )
+    {
+      const record_header_t *header
+        = (const record_header_t *)(queue->data + offset);
+      const char *record_data = (const char *)header + sizeof(*header);
+
+      if (   header->fingerprint[0] == fingerprint[0]
+          && header->fingerprint[1] == fingerprint[1]
+          && header->prefix_len == prefix_len
+          && header->key_len == key_len
+          && !memcmp(record_data + header->data_len, prefix, prefix_len)
+          && !memcmp(record_data + header->data_len + prefix_len, key,
+                     key_len))
+        found = header;
+
+      offset += (apr_size_t)record_size(header);
+    }
+
+  if (found)
+    {
+      *data = apr_pmemdup(result_pool, (const char *)found + sizeof(*found),
+                          found->data_len);
+      *data_len = found->data_len;
+    }
+}
+
+/* Implement the queue lookup of svn_cache__disk_get with the queue mutex
+ * being held.  Set *DATA to NULL if the item has not been queued. */
+static svn_error_t *
+disk_get_queued(void **data,
+                apr_size_t *data_len,
+                svn_cache__disk_t *disk,
+                const apr_uint64_t fingerprint[2],
+                const char *prefix,
+                const void *key,
+                apr_size_t key_len,
+                apr_pool_t *result_pool)
+{
+  *data = NULL;
+  *data_len = 0;
+
+  /* Records in the buffer being filled are the more recent ones. */
+  queue_get(data, data_len, &disk->queue[disk->filling], fingerprint,
+            prefix, key, key_len, result_pool);
+  if (*data == NULL)
+    queue_get(data, data_len, &disk->queue[1 - disk->filling], fingerprint,
+              prefix, key, key_len, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__disk_get with the mutex being held. */
+static svn_error_t *
+disk_get(void **data,
+         apr_size_t *data_len,
+         svn_cache__disk_t *disk,
+         const apr_uint64_t fingerprint[2],
+         const char *prefix,
+         const void *key,
+         apr_size_t key_len,
+         apr_pool_t *result_pool)
+{
+  disk_entry_t *entry = apr_hash_get(disk->index, fingerprint,
+                                     2 * sizeof(*fingerprint));
+  apr_size_t prefix_len = strlen(prefix);
+  const record_header_t *header;
+  apr_off_t offset;
+  char *record;
+  apr_size_t bytes_read = 0;
+  svn_boolean_t eof;
+  svn_error_t *err;
+
+  *data = NULL;
+  *data_len = 0;
+
+  if (entry == NULL)
+    return SVN_NO_ERROR;
+
+  record = apr_palloc(result_pool, entry->size);
+  offset = entry->offset;
+  err = svn_io_file_seek(disk->file, APR_SET, &offset, disk->scratch_pool);
+  if (!err)
+    err = svn_io_file_read_full2(disk->file, record, entry->size,
+                                 &bytes_read, &eof, disk->scratch_pool);
+
+  svn_pool_clear(disk->scratch_pool);
+  SVN_ERR(err);
+
+  /* Verify that this is an intact record for the same key. */
+  header = (const record_header_t *)record;
+  if (   bytes_read < entry->size
+      || header->magic != RECORD_MAGIC
+      || header->sequence != entry->sequence
+      || header->fingerprint[0] != fingerprint[0]
+      || header->fingerprint[1] != fingerprint[1]
+      || header->prefix_len != prefix_len
+      || header->key_len != key_len
+      || record_size(header) != entry->size)
+    {
+      drop_from_index(disk, entry);
+      return SVN_NO_ERROR;
+    }
+
+  {
+    apr_uint32_t checksum = header->checksum;
+    if (   record_checksum(record, entry->size) != checksum
+        || memcmp(record + sizeof(*header) + header->data_len,
+                  prefix, prefix_len)
+        || memcmp(record + sizeof(*header) + header->data_len + prefix_len,
+                  key, key_len))
+      {
+        drop_from_index(disk, entry);
+        return SVN_NO_ERROR;
+      }
+  }
+
+  *data = record + sizeof(*header);
+  *data_len = header->data_len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__disk_get(void **data,
+                    apr_size_t *data_len,
+                    svn_cache__disk_t *disk,
+                    const apr_uint64_t fingerprint[2],
+                    const char *prefix,
+                    const void *key,
+                    apr_size_t key_len,
+                    apr_pool_t *result_pool)
+{
+  /* Records are in the index before they get removed from the queue,
+   * so checking the queue first will not miss any of them. */
+  SVN_MUTEX__WITH_LOCK(disk->queue_mutex,
+                       disk_get_queued(data, data_len, disk, fingerprint,
+                                       prefix, key, key_len, result_pool));
+  if (*data == NULL)
+    SVN_MUTEX__WITH_LOCK(disk->mutex,
+                         disk_get(data, data_len, disk, fingerprint, prefix,
+                                  key, key_len, result_pool));
+
+  return SVN_NO_ERROR;
+}
@@ -23,10 +23,12 @@
 
 #include <assert.h>
 #include <apr_md5.h>
+#include <apr_shm.h>
 #include <apr_thread_rwlock.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_dirent_uri.h"
 #include "svn_private_config.h"
 #include "svn_hash.h"
 #include "svn_string.h"
@@ -35,6 +37,8 @@
 #include "private/svn_atomic.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_mutex.h"
+#include "private/svn_packed_data.h"
+#include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 
@@ -63,8 +67,14 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.
+ *
+ * Caches may in fact be shared between processes: all cache structures
+ * then get allocated from a single shared memory segment that is being
+ * created before the server forks its worker processes.  Those inherit
+ * the mapping at the same address, so even the few native pointers stay
+ * valid.  Segment locks become robust, process-shared mutexes in that
+ * case.  See svn_cache__membuffer_cache_create_shared().
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -125,10 +135,18 @@
  * is then unique, too, and can never conflict.  No full key construction,
  * storage and comparison is needed in that case.
  *
- * All access to the cached data needs to be serialized. Because we want
- * to scale well despite that bottleneck, we simply segment the cache into
- * a number of independent caches (segments). Items will be multiplexed based
- * on their hash key.
+ * All modifications to the cached data need to be serialized. Because we
+ * want to scale well despite that bottleneck, we simply segment the cache
+ * into a number of independent caches (segments). Items will be multiplexed
+ * based on their hash key.
+ *
+ * Lookups (get and has_key) don't need to take the segment lock, though.
+ * Every entry group chain has a version number that writers make odd while
+ * they modify the chain or any of the items referenced by it.  Readers
+ * remember the version, copy the data and then check that the version did
+ * not change in the meantime.  Only if it did, they retry and eventually
+ * fall back to taking the read lock.  See mark_group_dirty() and
+ * membuffer_cache_get_optimistic() for details.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +164,72 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Lock-free lookups require a full memory barrier, which we can only
+ * provide for some compilers.  Everywhere else, readers will always take
+ * the lock.  The debug tags can't be verified on data that is being
+ * modified concurrently, hence disable the optimistic reads in that case.
+ */
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && (defined(__GNUC__) || defined(__clang__))
+#  define USE_OPTIMISTIC_READS 1
+#  define MEMORY_BARRIER() __sync_synchronize()
+#elif APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && defined(_MSC_VER)
+#  define USE_OPTIMISTIC_READS 1
+#  define MEMORY_BARRIER() MemoryBarrier()
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Number of lock-free lookup attempts before falling back to the
+ * read lock.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 2
+
+/* Maximum number of entry group chains that a single write operation
+ * marks as modified individually.  Beyond that, the whole segment gets
+ * marked.
+ */
+#define MAX_DIRTY_GROUPS 16
+
+/* Caches in shared memory get created before the processes sharing them
+ * are being forked, i.e. all pointers within the cache structures remain
+ * valid in those processes.  The segment locks must work across processes
+ * without any per-process initialization and a process terminating while
+ * holding a lock must not block all others.  Robust, process-shared POSIX
+ * mutexes provide just that.
+ */
+#if APR_HAS_THREADS && APR_HAS_FORK && APR_HAS_SHARED_MEMORY \
+    && APR_HAS_PROC_PTHREAD_SERIALIZE
+#  include <errno.h>
+#  include <pthread.h>
+#  include <unistd.h>
+#  if defined(_POSIX_THREAD_ROBUST_PRIO_INHERIT) \
+      && _POSIX_THREAD_ROBUST_PRIO_INHERIT > 0
+#    define USE_SHARED_MEMORY 1
+#  endif
+#endif
+
+#ifndef USE_SHARED_MEMORY
+#  define USE_SHARED_MEMORY 0
+#endif
+
+/* Number of rows in the access frequency sketch used by the TinyLFU
+ * admission policy, i.e. the number of counters per key.
+ */
+#define SKETCH_DEPTH 4
+
+/* The sketch counters saturate at this value.  Keys accessed more often
+ * than that within a sample period are simply "hot".
+ */
+#define SKETCH_MAX_COUNT 15
+
+/* The sketch counters get halved after this many increments per cache
+ * entry, i.e. the sample period is this factor times the number of
+ * entries in a segment.
+ */
+#define SKETCH_SAMPLE_FACTOR 10
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -190,6 +274,10 @@
  */
 #define NO_INDEX APR_UINT32_MAX
 
+/* 16 bit variant of NO_INDEX.
+ */
+#define NO_SHORT_INDEX 0xffff
+
 /* To save space in our group structure, we only use 32 bit size values
  * and, therefore, limit the size of each entry to just below 4GB.
  * Supporting larger items is not a good idea as the data transfer
@@ -220,6 +308,16 @@ typedef struct entry_key_t
    * prefix pool (see prefix_pool_t).  NO_INDEX if the key prefix is not
    * shared, otherwise KEY_LEN==0 is implied. */
   apr_uint32_t prefix_idx;
+
+  /* Index of the memory quota partition (see partition_t) that this entry
+   * is being accounted for.  NO_SHORT_INDEX if none.  This is not part of
+   * the key identity and is simply inherited from the cache front-end. */
+  apr_uint16_t partition;
+
+  /* Index of the statistics category (see category_stats_t) that this
+   * entry is being accounted for.  NO_SHORT_INDEX if none.  Like PARTITION,
+   * this is inherited from the cache front-end. */
+  apr_uint16_t category;
 } entry_key_t;
 
 /* A full key, i.e. the combination of the cache's key prefix with some
@@ -240,15 +338,213 @@ typedef struct full_key_t
   svn_membuf_t full_key;
 } full_key_t;
 
+/* Source of the memory used by the cache structures.  Either everything
+ * gets allocated from POOL or it will be carved out of a single memory
+ * block, e.g. a shared memory segment.  Use membuffer_alloc() to allocate
+ * from it.
+ */
+typedef struct membuffer_alloc_t
+{
+  /* Pool to allocate from, if NEXT is NULL. */
+  apr_pool_t *pool;
+
+  /* Next unused byte within the memory block.  NULL, if allocations
+   * shall be made from POOL. */
+  char *next;
+
+  /* Number of bytes left at NEXT. */
+  apr_size_t remaining;
+} membuffer_alloc_t;
+
+/* Return a chunk of SIZE bytes from ALLOC and zero it, if CLEAR is set.
+ * Chunks from a memory block will be aligned to ITEM_ALIGNMENT.  Return
+ * NULL if there is not enough memory left.
+ */
+static void *
+membuffer_alloc(membuffer_alloc_t *alloc,
+                apr_size_t size,
+                svn_boolean_t clear)
+{
+  void *result;
+
+  if (alloc->next == NULL)
+    return clear ? apr_pcalloc(alloc->pool, size)
+                 : apr_palloc(alloc->pool, size);
+
+  size = (size + ITEM_ALIGNMENT - 1) & ~(apr_size_t)(ITEM_ALIGNMENT - 1);
+  if (size > alloc->remaining)
+    return NULL;
+
+  result = alloc->next;
+  alloc->next += size;
+  alloc->remaining -= size;
+
+  if (clear)
+    memset(result, 0, size);
+
+  return result;
+}
+
+#if USE_SHARED_MEMORY
+
+/* Initialize the robust, process-shared mutex at MUTEX.
+ */
+static svn_error_t *
+shared_mutex_init(pthread_mutex_t *mutex)
+{
+  pthread_mutexattr_t attr;
+  int rc = pthread_mutexattr_init(&attr);
+  if (rc == 0)
+    {
+      rc = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+      if (rc == 0)
+        rc = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+      if (rc == 0)
+        rc = pthread_mutex_init(mutex, &attr);
+
+      pthread_mutexattr_destroy(&attr);
+    }
+
+  if (rc)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                              _("Can't create shared cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Acquire MUTEX.  If SUCCESS is not NULL, don't wait for MUTEX to become
+ * available but set *SUCCESS to FALSE instead; leave it untouched
+ * otherwise.  If the previous owner terminated while holding the lock,
+ * set *OWNER_DIED.  The data protected by MUTEX may then be inconsistent.
+ */
+static svn_error_t *
+shared_mutex_lock(pthread_mutex_t *mutex,
+                  svn_boolean_t *success,
+                  svn_boolean_t *owner_died)
+{
+  int rc = success ? pthread_mutex_trylock(mutex)
+                   : pthread_mutex_lock(mutex);
+  if (rc == EBUSY && success)
+    {
+      *success = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  if (rc == EOWNERDEAD)
+    {
+      *owner_died = TRUE;
+      rc = pthread_mutex_consistent(mutex);
+    }
+
+  if (rc)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                              _("Can't lock shared cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Release MUTEX.  Return ERR upon success.
+ */
+static svn_error_t *
+shared_mutex_unlock(pthread_mutex_t *mutex,
+                    svn_error_t *err)
+{
+  int rc = pthread_mutex_unlock(mutex);
+  if (err)
+    return err;
+
+  if (rc)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                              _("Can't unlock shared cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a new shared memory segment of SIZE bytes named after PATH and
+ * make ALLOC hand out memory from it.  Remove any existing segment of
+ * that name first; processes still using it will keep their mapping.
+ * The new segment will be released together with POOL.
+ */
+static svn_error_t *
+create_shared_memory(membuffer_alloc_t *alloc,
+                     const char *path,
+                     apr_size_t size,
+                     apr_pool_t *pool)
+{
+  apr_shm_t *shm;
+  apr_status_t status;
+
+  /* Most likely, there is nothing to remove. */
+  apr_shm_remove(path, pool);
+
+  status = apr_shm_create(&shm, size, path, pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't create shared memory cache '%s'"),
+                              svn_dirent_local_style(path, pool));
+
+  alloc->next = apr_shm_baseaddr_get(shm);
+  alloc->remaining = apr_shm_size_get(shm);
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* USE_SHARED_MEMORY */
+
+/* Maximum number of memory quota partitions per cache.  With one
+ * partition per repository, this should be plenty.
+ */
+#define MAX_PARTITIONS 1024
+
+/* Maximum number of statistics categories per cache.  With one category
+ * per cache type, this should be plenty.
+ */
+#define MAX_CATEGORIES 64
+
+/* A named share of the cache memory, e.g. all entries of one repository.
+ * Partitions are registered with and stored in the prefix pool.
+ */
+typedef struct partition_t
+{
+  /* Index of the partition name in the prefix pool's VALUES. */
+  apr_uint32_t name_idx;
+
+  /* If set, entries that would exceed QUOTA will not be cached at all.
+   * Otherwise, entries of a partition exceeding its QUOTA will not be
+   * promoted to L2 and will be the first to be evicted from there. */
+  svn_boolean_t hard_quota;
+
+  /* Maximum number of bytes that the partition's entries should occupy
+   * in the whole cache.  0 means "no limit". */
+  apr_uint64_t quota;
+
+  /* Number of ITEM_ALIGNMENT sized chunks currently occupied by the
+   * partition's entries in all cache segments.  Since segments are
+   * locked independently, this must only be modified atomically. */
+  volatile svn_atomic_t used;
+} partition_t;
+
 /* A limited capacity, thread-safe pool of unique C strings.  Operations on
  * this data structure are defined by prefix_pool_* functions.  The only
- * "public" member is VALUES (r/o access only).
+ * "public" members are VALUES and PARTITIONS (r/o access only).
  */
 typedef struct prefix_pool_t
 {
-  /* Map C string to a pointer into VALUES with the same contents. */
+  /* Map C string to a pointer into VALUES with the same contents.
+   * NULL for pools in shared memory, which use SLOTS instead. */
   apr_hash_t *map;
 
+  /* Open addressing hash table containing the indexes of all VALUES.
+   * Unused slots are NO_INDEX.  Only used if MAP is NULL. */
+  apr_uint32_t *slots;
+
+  /* Number of elements in SLOTS.  This is a power of two and at least
+   * twice VALUES_MAX, unless the latter is 0. */
+  apr_uint32_t slot_count;
+
+  /* Memory to copy the strings in VALUES to, if MAP is NULL. */
+  membuffer_alloc_t strings;
+
   /* Pointer to an array of strings. These are the contents of this pool
    * and each one of them is referenced by MAP.  Valid indexes are 0 to
    * VALUES_USED - 1.  May be NULL if VALUES_MAX is 0. */
@@ -267,19 +563,43 @@ typedef struct prefix_pool_t
    * the implementation may . */
   apr_size_t bytes_used;
 
+  /* Array of MAX_PARTITIONS partition descriptions, of which the first
+   * PARTITIONS_USED are valid.  NULL if partitions are not supported. */
+  partition_t *partitions;
+
+  /* Number of valid entries in PARTITIONS. */
+  apr_uint32_t partitions_used;
+
+  /* Array of MAX_CATEGORIES indexes into VALUES, i.e. the names of the
+   * statistics categories, of which the first CATEGORIES_USED are valid.
+   * NULL if categories are not supported. */
+  apr_uint32_t *categories;
+
+  /* Number of valid entries in CATEGORIES. */
+  apr_uint32_t categories_used;
+
   /* The serialization object. */
   svn_mutex__t *mutex;
+
+#if USE_SHARED_MEMORY
+  /* Replaces MUTEX for pools in shared memory.  NULL otherwise. */
+  pthread_mutex_t *shared_mutex;
+#endif
 } prefix_pool_t;
 
 /* Set *PREFIX_POOL to a new instance that tries to limit allocation to
  * BYTES_MAX bytes.  If MUTEX_REQUIRED is set and multi-threading is
  * supported, serialize all access to the new instance.  Allocate the
- * object from *RESULT_POOL. */
+ * object from ALLOC.
+ *
+ * If ALLOC hands out chunks of a memory block, the instance will be
+ * suitable for shared memory and all of its BYTES_MAX will come from
+ * ALLOC.  Access will then always be serialized.  */
 static svn_error_t *
 prefix_pool_create(prefix_pool_t **prefix_pool,
                    apr_size_t bytes_max,
                    svn_boolean_t mutex_required,
-                   apr_pool_t *result_pool)
+                   membuffer_alloc_t *alloc)
 {
   enum
     {
@@ -294,12 +614,29 @@ prefix_pool_create(prefix_pool_t **prefix_pool,
   apr_size_t capacity = MIN(APR_UINT32_MAX,
                             bytes_max / ESTIMATED_BYTES_PER_ENTRY);
 
+  svn_boolean_t shared = alloc->next != NULL;
+  prefix_pool_t *result;
+  membuffer_alloc_t block;
+
+  /* Within shared memory, the strings will use whatever remains from
+   * BYTES_MAX after allocating the fixed-size structures.  The slot table
+   * is always less than 16 bytes per entry. */
+  if (shared)
+    {
+      block.pool = alloc->pool;
+      block.next = membuffer_alloc(alloc, bytes_max, FALSE);
+      block.remaining = block.next ? bytes_max : 0;
+      alloc = &block;
+    }
+
   /* Construct the result struct. */
-  prefix_pool_t *result = apr_pcalloc(result_pool, sizeof(*result));
-  result->map = svn_hash__make(result_pool);
+  result = membuffer_alloc(alloc, sizeof(*result), TRUE);
+  if (result == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
 
   result->values = capacity
-                 ? apr_pcalloc(result_pool, capacity * sizeof(const char *))
+                 ? membuffer_alloc(alloc, capacity * sizeof(const char *),
+                                   TRUE)
                  : NULL;
   result->values_max = (apr_uint32_t)capacity;
   result->values_used = 0;
@@ -307,13 +644,121 @@ prefix_pool_create(prefix_pool_t **prefix_pool,
   result->bytes_max = bytes_max;
   result->bytes_used = capacity * sizeof(svn_membuf_t);
 
-  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, result_pool));
+  /* Partition names live in VALUES, hence no partitions without them.
+   * In shared memory, don't let the partitions take more than a quarter
+   * of the string space. */
+  result->partitions
+    = capacity && (!shared || MAX_PARTITIONS * sizeof(partition_t)
+                                <= bytes_max / 4)
+    ? membuffer_alloc(alloc, MAX_PARTITIONS * sizeof(partition_t), TRUE)
+    : NULL;
+  result->partitions_used = 0;
+
+  result->categories
+    = capacity
+    ? membuffer_alloc(alloc, MAX_CATEGORIES * sizeof(apr_uint32_t), FALSE)
+    : NULL;
+  result->categories_used = 0;
+
+  if (shared)
+    {
+      result->map = NULL;
+
+      if (capacity)
+        {
+          result->slot_count = 1;
+          while (result->slot_count < 2 * capacity)
+            result->slot_count *= 2;
+
+          result->slots = membuffer_alloc(alloc,
+                                          result->slot_count
+                                            * sizeof(*result->slots),
+                                          FALSE);
+          if (result->slots)
+            memset(result->slots, 0xff,
+                   result->slot_count * sizeof(*result->slots));
+          else
+            result->slot_count = 0;
+        }
+
+      SVN_ERR(svn_mutex__init(&result->mutex, FALSE, alloc->pool));
+
+#if USE_SHARED_MEMORY
+      result->shared_mutex = membuffer_alloc(alloc,
+                                             sizeof(*result->shared_mutex),
+                                             FALSE);
+      if (result->shared_mutex == NULL)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      SVN_ERR(shared_mutex_init(result->shared_mutex));
+#endif
+
+      /* Everything else is string space. */
+      result->strings = *alloc;
+    }
+  else
+    {
+      result->map = svn_hash__make(alloc->pool);
+      SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, alloc->pool));
+    }
 
   /* Done. */
   *prefix_pool = result;
   return SVN_NO_ERROR;
 }
 
+/* Implement prefix_pool_get_internal() for PREFIX_POOL instances in
+ * shared memory, i.e. with a NULL MAP.
+ */
+static svn_error_t *
+prefix_pool_get_shared(apr_uint32_t *prefix_idx,
+                       prefix_pool_t *prefix_pool,
+                       const char *prefix)
+{
+  apr_ssize_t prefix_len = strlen(prefix);
+  apr_uint32_t mask = prefix_pool->slot_count - 1;
+  apr_uint32_t slot;
+  apr_uint32_t idx;
+  char *value;
+
+  *prefix_idx = NO_INDEX;
+  if (prefix_pool->slot_count == 0)
+    return SVN_NO_ERROR;
+
+  /* Linear probing.  The table has more than twice as many slots as
+   * there may be values, so we will always hit an empty slot. */
+  for (slot = apr_hashfunc_default(prefix, &prefix_len) & mask;
+       prefix_pool->slots[slot] != NO_INDEX;
+       slot = (slot + 1) & mask)
+    {
+      idx = prefix_pool->slots[slot];
+      if (strcmp(prefix_pool->values[idx], prefix) == 0)
+        {
+          *prefix_idx = idx;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Capacity checks. */
+  if (prefix_pool->values_used == prefix_pool->values_max)
+    return SVN_NO_ERROR;
+
+  value = membuffer_alloc(&prefix_pool->strings, prefix_len + 1, FALSE);
+  if (value == NULL)
+    return SVN_NO_ERROR;
+
+  /* Add new entry.  Fill the slot last such that a process terminating
+   * in the middle of this will not leave a corrupted table behind. */
+  memcpy(value, prefix, prefix_len + 1);
+  idx = prefix_pool->values_used;
+  prefix_pool->values[idx] = value;
+  ++prefix_pool->values_used;
+  prefix_pool->slots[slot] = idx;
+
+  *prefix_idx = idx;
+  return SVN_NO_ERROR;
+}
+
 /* Set *PREFIX_IDX to the offset in PREFIX_POOL->VALUES that contains the
  * value PREFIX.  If none exists, auto-insert it.  If we can't due to
  * capacity exhaustion, set *PREFIX_IDX to NO_INDEX.
@@ -339,6 +784,10 @@ prefix_pool_get_internal(apr_uint32_t *prefix_idx,
   apr_size_t bytes_needed;
   apr_pool_t *pool;
 
+  if (prefix_pool->map == NULL)
+    return svn_error_trace(prefix_pool_get_shared(prefix_idx, prefix_pool,
+                                                  prefix));
+
   /* Lookup.  If we already know that prefix, return its index. */
   value = apr_hash_get(prefix_pool->map, prefix, prefix_len);
   if (value != NULL)
@@ -384,6 +833,20 @@ prefix_pool_get(apr_uint32_t *prefix_idx,
                 prefix_pool_t *prefix_pool,
                 const char *prefix)
 {
+#if USE_SHARED_MEMORY
+  if (prefix_pool->shared_mutex)
+    {
+      /* Incomplete insertions by terminated processes are harmless. */
+      svn_boolean_t owner_died = FALSE;
+      SVN_ERR(shared_mutex_lock(prefix_pool->shared_mutex, NULL,
+                                &owner_died));
+      return shared_mutex_unlock(prefix_pool->shared_mutex,
+                                 prefix_pool_get_internal(prefix_idx,
+                                                          prefix_pool,
+                                                          prefix));
+    }
+#endif
+
   SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
                        prefix_pool_get_internal(prefix_idx, prefix_pool,
                                                 prefix));
@@ -391,6 +854,146 @@ prefix_pool_get(apr_uint32_t *prefix_idx,
   return SVN_NO_ERROR;
 }
 
+/* Set *PARTITION to the index of the partition named NAME in
+ * PREFIX_POOL->PARTITIONS and set its QUOTA and HARD_QUOTA.  If no such
+ * partition exists, auto-insert it.  If we can't due to capacity
+ * exhaustion, set *PARTITION to NO_INDEX.
+ * To be called by partition_get() only. */
+static svn_error_t *
+partition_get_internal(apr_uint32_t *partition,
+                       prefix_pool_t *prefix_pool,
+                       const char *name,
+                       apr_uint64_t quota,
+                       svn_boolean_t hard_quota)
+{
+  apr_uint32_t name_idx;
+  apr_uint32_t i;
+  partition_t *entry;
+
+  *partition = NO_INDEX;
+  if (prefix_pool->partitions == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(prefix_pool_get_internal(&name_idx, prefix_pool, name));
+  if (name_idx == NO_INDEX)
+    return SVN_NO_ERROR;
+
+  /* This is only called when constructing cache front-ends, so a linear
+   * search is good enough. */
+  for (i = 0; i < prefix_pool->partitions_used; ++i)
+    if (prefix_pool->partitions[i].name_idx == name_idx)
+      break;
+
+  entry = &prefix_pool->partitions[i];
+  if (i == prefix_pool->partitions_used)
+    {
+      if (i == MAX_PARTITIONS)
+        return SVN_NO_ERROR;
+
+      /* Initialize the entry before making it visible such that a process
+       * terminating in the middle of this will not leave garbage behind. */
+      entry->name_idx = name_idx;
+      entry->used = 0;
+      ++prefix_pool->partitions_used;
+    }
+
+  /* The latest configuration wins. */
+  entry->quota = quota;
+  entry->hard_quota = hard_quota;
+
+  *partition = i;
+  return SVN_NO_ERROR;
+}
+
+/* Thread-safe wrapper around partition_get_internal. */
+static svn_error_t *
+partition_get(apr_uint32_t *partition,
+              prefix_pool_t *prefix_pool,
+              const char *name,
+              apr_uint64_t quota,
+              svn_boolean_t hard_quota)
+{
+#if USE_SHARED_MEMORY
+  if (prefix_pool->shared_mutex)
+    {
+      svn_boolean_t owner_died = FALSE;
+      SVN_ERR(shared_mutex_lock(prefix_pool->shared_mutex, NULL,
+                                &owner_died));
+      return shared_mutex_unlock(prefix_pool->shared_mutex,
+                                 partition_get_internal(partition,
+                                                        prefix_pool, name,
+                                                        quota, hard_quota));
+    }
+#endif
+
+  SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
+                       partition_get_internal(partition, prefix_pool, name,
+                                              quota, hard_quota));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CATEGORY to the index of the statistics category named NAME in
+ * PREFIX_POOL->CATEGORIES.  If no such category exists, auto-insert it.
+ * If we can't due to capacity exhaustion, set *CATEGORY to NO_INDEX.
+ * To be called by category_get() only. */
+static svn_error_t *
+category_get_internal(apr_uint32_t *category,
+                      prefix_pool_t *prefix_pool,
+                      const char *name)
+{
+  apr_uint32_t name_idx;
+  apr_uint32_t i;
+
+  *category = NO_INDEX;
+  if (prefix_pool->categories == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(prefix_pool_get_internal(&name_idx, prefix_pool, name));
+  if (name_idx == NO_INDEX)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < prefix_pool->categories_used; ++i)
+    if (prefix_pool->categories[i] == name_idx)
+      break;
+
+  if (i == prefix_pool->categories_used)
+    {
+      if (i == MAX_CATEGORIES)
+        return SVN_NO_ERROR;
+
+      prefix_pool->categories[i] = name_idx;
+      ++prefix_pool->categories_used;
+    }
+
+  *category = i;
+  return SVN_NO_ERROR;
+}
+
+/* Thread-safe wrapper around category_get_internal. */
+static svn_error_t *
+category_get(apr_uint32_t *category,
+             prefix_pool_t *prefix_pool,
+             const char *name)
+{
+#if USE_SHARED_MEMORY
+  if (prefix_pool->shared_mutex)
+    {
+      svn_boolean_t owner_died = FALSE;
+      SVN_ERR(shared_mutex_lock(prefix_pool->shared_mutex, NULL,
+                                &owner_died));
+      return shared_mutex_unlock(prefix_pool->shared_mutex,
+                                 category_get_internal(category,
+                                                       prefix_pool, name));
+    }
+#endif
+
+  SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
+                       category_get_internal(category, prefix_pool, name));
+
+  return SVN_NO_ERROR;
+}
+
 /* Debugging / corruption detection support.
  * If you define this macro, the getter functions will performed expensive
  * checks on the item data, requested keys and entry types. If there is
@@ -692,6 +1295,37 @@ typedef struct cache_level_t
 
 } cache_level_t;
 
+/* Access statistics of a single statistics category within a cache
+ * segment.  Like the TOTAL_* counters in svn_membuffer_t, these are purely
+ * informational and updates are not synchronized for readers.
+ */
+typedef struct category_stats_t
+{
+  /* Number of lookups. */
+  apr_uint64_t gets;
+
+  /* Number of lookups that found an entry. */
+  apr_uint64_t hits;
+
+  /* Number of entries written. */
+  apr_uint64_t sets;
+
+  /* Number of entries removed to make room for others. */
+  apr_uint64_t evictions;
+
+  /* Number of bytes currently used by this category's entries. */
+  apr_uint64_t used_size;
+
+  /* Number of entries currently cached for this category. */
+  apr_uint64_t used_entries;
+
+  /* Number of accesses that had to wait for the segment lock. */
+  apr_uint64_t lock_waits;
+
+  /* Total time in microseconds spent waiting for the segment lock. */
+  apr_uint64_t lock_wait_time;
+} category_stats_t;
+
 /* The cache header structure.
  */
 struct svn_membuffer_t
@@ -796,6 +1430,28 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of entries evicted to make room for new ones.
+   * Purely statistical information that may be used for profiling only.
+   */
+  apr_uint64_t total_evictions;
+
+  /* Number of times that acquiring the segment lock had to wait and the
+   * total time in microseconds spent waiting.  Not available with simple
+   * mutexes.  Purely statistical information.
+   */
+  apr_uint64_t lock_waits;
+  apr_uint64_t lock_wait_time;
+
+  /* Lock wait time in microseconds that has not been attributed to any
+   * statistics category, yet.  See count_read() and count_write().
+   */
+  apr_uint64_t unattributed_lock_wait;
+
+  /* Per-category statistics, MAX_CATEGORIES elements.  Indexes are the
+   * same as in PREFIX_POOL->CATEGORIES.  Never NULL.
+   */
+  category_stats_t *category_stats;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -813,27 +1469,421 @@ struct svn_membuffer_t
   svn_boolean_t allow_blocking_writes;
 #endif
 
+#if USE_SHARED_MEMORY
+  /* Process-shared lock replacing LOCK if the cache lives in shared
+   * memory.  NULL otherwise.  It is an exclusive lock, i.e. there is no
+   * concurrency between readers unless OPTIMISTIC_READS is set.
+   */
+  pthread_mutex_t *shared_lock;
+#endif
+
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* If set, lookups will try to read the data without acquiring LOCK.
+   * Requires the segment to be thread-safe and USE_OPTIMISTIC_READS.
+   */
+  svn_boolean_t optimistic_reads;
+
+  /* Version numbers of the entry group chains, indexed by the group index
+   * of the first group in the respective chain, i.e. GROUP_COUNT elements.
+   * Odd values indicate that the chain is currently being modified.
+   * NULL if OPTIMISTIC_READS is not set.
+   */
+  volatile svn_atomic_t *group_versions;
+
+  /* Version number of the segment as a whole.  Odd while the segment
+   * gets cleared or a writer modifies more than MAX_DIRTY_GROUPS chains.
+   */
+  volatile svn_atomic_t segment_version;
+
+  /* Indexes of the chains marked as being modified by the current writer.
+   * Only valid while holding the write lock.
+   */
+  apr_uint32_t dirty_groups[MAX_DIRTY_GROUPS];
+
+  /* Number of valid elements in DIRTY_GROUPS.
+   */
+  apr_uint32_t dirty_group_count;
+
+  /* If set, L2 admission and eviction are based on the access frequency
+   * estimates from SKETCH instead of the entries' hit counts (TinyLFU).
+   */
+  svn_boolean_t use_sketch;
+
+  /* Count-min sketch of the recent lookup frequencies per key, including
+   * keys that are not in the cache (anymore).  SKETCH_DEPTH rows of
+   * SKETCH_MASK + 1 saturating counters each.  NULL until the TinyLFU
+   * policy gets enabled for the first time and only updated while
+   * USE_SKETCH is set.  Increments are not synchronized as an
+   * approximation is all we need anyway.
+   */
+  unsigned char *sketch;
+
+  /* Number of counters per SKETCH row minus 1.  The row size is a power
+   * of two.
+   */
+  apr_uint32_t sketch_mask;
+
+  /* Number of sketch updates since the counters have last been halved.
+   * Does not grow beyond SKETCH_SAMPLE_SIZE.
+   */
+  svn_atomic_t sketch_additions;
+
+  /* Halve all sketch counters once SKETCH_ADDITIONS reaches this value.
+   * This happens during the next write to the segment, i.e. while we
+   * hold the write lock.
+   */
+  apr_uint32_t sketch_sample_size;
+
+  /* On-disk tier that evicted items may be demoted to instead of being
+   * dropped.  Shared by all segments.  NULL if there is none.
+   */
+  svn_cache__disk_t *disk;
+
+  /* Minimum item size per statistics category for evicted items to be
+   * demoted to DISK, MAX_CATEGORIES elements with the same indexes as
+   * CATEGORY_STATS.  0 means "don't demote".  Shared by all segments.
+   * NULL if DISK is NULL.
+   */
+  apr_size_t *demotion_sizes;
 };
 
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Return the description of the quota partition with index PARTITION in
+ * CACHE or NULL, if PARTITION is NO_INDEX or otherwise invalid.
+ */
+static APR_INLINE partition_t *
+get_partition(svn_membuffer_t *cache, apr_uint32_t partition)
+{
+  return partition < cache->prefix_pool->partitions_used
+       ? &cache->prefix_pool->partitions[partition]
+       : NULL;
+}
+
+/* Account for SIZE bytes being added to the quota partition PARTITION
+ * in CACHE.  This is a no-op for NO_INDEX.
+ */
+static APR_INLINE void
+partition_add_usage(svn_membuffer_t *cache,
+                    apr_uint32_t partition,
+                    apr_size_t size)
+{
+  partition_t *p = get_partition(cache, partition);
+  if (p)
+    apr_atomic_add32(&p->used,
+                     (apr_uint32_t)(ALIGN_VALUE(size) / ITEM_ALIGNMENT));
+}
+
+/* Account for SIZE bytes being removed from the quota partition PARTITION
+ * in CACHE.  This is a no-op for NO_INDEX.
+ */
+static APR_INLINE void
+partition_remove_usage(svn_membuffer_t *cache,
+                       apr_uint32_t partition,
+                       apr_size_t size)
+{
+  partition_t *p = get_partition(cache, partition);
+  if (p)
+    apr_atomic_sub32(&p->used,
+                     (apr_uint32_t)(ALIGN_VALUE(size) / ITEM_ALIGNMENT));
+}
+
+/* Return TRUE if the quota partition PARTITION in CACHE has a quota
+ * and would exceed it when ADDITIONAL_SIZE bytes were added to it.
+ * Always return FALSE for NO_INDEX.
+ */
+static svn_boolean_t
+partition_exceeds_quota(svn_membuffer_t *cache,
+                        apr_uint32_t partition,
+                        apr_size_t additional_size)
+{
+  partition_t *p = get_partition(cache, partition);
+  apr_uint64_t used;
+
+  if (p == NULL || p->quota == 0)
+    return FALSE;
+
+  used = (apr_uint64_t)svn_atomic_read(&p->used) * ITEM_ALIGNMENT;
+  return used + ALIGN_VALUE(additional_size) > p->quota;
+}
+
+/* Return TRUE if entries of the quota partition PARTITION in CACHE
+ * shall not be cached if that would exceed the quota.
+ */
+static APR_INLINE svn_boolean_t
+partition_has_hard_quota(svn_membuffer_t *cache,
+                         apr_uint32_t partition)
+{
+  partition_t *p = get_partition(cache, partition);
+  return p && p->hard_quota;
+}
+
+/* Return the statistics of category CATEGORY in segment CACHE or NULL, if
+ * CATEGORY is NO_SHORT_INDEX.
+ */
+static APR_INLINE category_stats_t *
+get_category_stats(svn_membuffer_t *cache, apr_uint32_t category)
+{
+  return category < MAX_CATEGORIES ? &cache->category_stats[category] : NULL;
+}
+
+/* Attribute any lock wait time recorded in CACHE to STATS.  Concurrent
+ * readers may pick up each other's wait times but that does not matter
+ * for the overall figures.
+ */
+static APR_INLINE void
+attribute_lock_wait(svn_membuffer_t *cache, category_stats_t *stats)
+{
+  if (cache->unattributed_lock_wait)
+    {
+      stats->lock_waits++;
+      stats->lock_wait_time += cache->unattributed_lock_wait;
+      cache->unattributed_lock_wait = 0;
+    }
+}
+
+/* Count a lookup of KEY in CACHE.  Statistics only.
+ */
+static APR_INLINE void
+count_read(svn_membuffer_t *cache, const entry_key_t *key)
+{
+  category_stats_t *stats = get_category_stats(cache, key->category);
+
+  cache->total_reads++;
+  if (stats)
+    {
+      stats->gets++;
+      attribute_lock_wait(cache, stats);
+    }
+}
+
+/* Count a write of KEY to CACHE.  Statistics only.
+ */
+static APR_INLINE void
+count_write(svn_membuffer_t *cache, const entry_key_t *key)
+{
+  category_stats_t *stats = get_category_stats(cache, key->category);
+
+  cache->total_writes++;
+  if (stats)
+    {
+      stats->sets++;
+      attribute_lock_wait(cache, stats);
+    }
+}
+
+/* Account for SIZE bytes in ENTRY_COUNT entries being added to the
+ * statistics category CATEGORY in CACHE.  Use negative values for removal.
+ */
+static APR_INLINE void
+category_add_usage(svn_membuffer_t *cache,
+                   apr_uint32_t category,
+                   apr_int64_t size,
+                   int entry_count)
+{
+  category_stats_t *stats = get_category_stats(cache, category);
+  if (stats)
+    {
+      stats->used_size += size;
+      stats->used_entries += entry_count;
+    }
+}
+
+/* Remove the contributions of all entries in segment CACHE from their
+ * respective quota partitions.  Call this before dropping the segment
+ * contents wholesale.
+ *
+ * Note: This function requires the write lock.
+ */
+static void
+release_partition_usage(svn_membuffer_t *cache)
+{
+  cache_level_t *levels[2];
+  apr_size_t max_entries = (apr_size_t)(cache->group_count
+                                        + cache->spare_group_count)
+                         * GROUP_SIZE;
+  apr_size_t to_visit = max_entries;
+  int i;
+
+  if (cache->prefix_pool->partitions_used == 0)
+    return;
+
+  levels[0] = &cache->l1;
+  levels[1] = &cache->l2;
+
+  /* The lists may be corrupted if a process terminated while modifying
+   * them.  Never visit more entries than there could possibly be. */
+  for (i = 0; i < 2; ++i)
+    {
+      apr_uint32_t idx = levels[i]->first;
+      for (; idx < max_entries && to_visit > 0; --to_visit)
+        {
+          entry_t *entry
+            = &cache->directory[idx / GROUP_SIZE].entries[idx % GROUP_SIZE];
+          partition_remove_usage(cache, entry->key.partition, entry->size);
+          idx = entry->next;
+        }
+    }
+}
+
+/* Remove all contents from the segment CACHE.
+ *
+ * Note: This function requires the write lock.
+ */
+static void
+reset_segment(svn_membuffer_t *cache)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (cache->group_count + cache->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+  int i;
+
+  /* The entries are about to vanish without going through drop_entry(). */
+  release_partition_usage(cache);
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  cache->first_spare_group = NO_INDEX;
+  cache->max_spare_used = 0;
+
+  memset(cache->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  cache->l1.first = NO_INDEX;
+  cache->l1.last = NO_INDEX;
+  cache->l1.next = NO_INDEX;
+  cache->l1.current_data = cache->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  cache->l2.first = NO_INDEX;
+  cache->l2.last = NO_INDEX;
+  cache->l2.next = NO_INDEX;
+  cache->l2.current_data = cache->l2.start_offset;
+
+  /* Reset content counters. */
+  cache->data_used = 0;
+  cache->used_entries = 0;
+
+  for (i = 0; i < MAX_CATEGORIES; ++i)
+    {
+      cache->category_stats[i].used_size = 0;
+      cache->category_stats[i].used_entries = 0;
+    }
+}
+
+/* Record that acquiring the lock of CACHE had to wait since START.
+ *
+ * Note: This function requires the lock.
+ */
+static void
+count_lock_wait(svn_membuffer_t *cache, apr_time_t start)
+{
+  apr_time_t waited = apr_time_now() - start;
+
+  cache->lock_waits++;
+  cache->lock_wait_time += waited;
+  cache->unattributed_lock_wait += waited;
+}
+
+#if USE_SHARED_MEMORY
+
+/* Some process terminated while holding the lock to segment CACHE.
+ * Drop all contents as they may be inconsistent and clean up whatever
+ * version marks the other process may have left behind.
+ *
+ * Note: This function requires the write lock.
+ */
+static void
+recover_segment(svn_membuffer_t *cache)
+{
+  /* Invalidate all ongoing lock-free reads. */
+  if ((cache->segment_version & 1) == 0)
+    svn_atomic_inc(&cache->segment_version);
+
+  reset_segment(cache);
+
+#if USE_OPTIMISTIC_READS
+  if (cache->optimistic_reads)
+    {
+      apr_uint32_t i;
+      for (i = 0; i < cache->group_count; ++i)
+        if (cache->group_versions[i] & 1)
+          svn_atomic_inc(&cache->group_versions[i]);
+    }
+#endif
+
+  /* Segment may be used again. */
+  cache->dirty_group_count = 0;
+  svn_atomic_inc(&cache->segment_version);
+}
+
+/* Acquire the process-shared lock for CACHE.  If SUCCESS is not NULL and
+ * CACHE does not allow for blocking writes, don't wait for the lock but
+ * set *SUCCESS to FALSE if somebody else is holding it.
+ */
+static svn_error_t *
+shared_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
+{
+  svn_boolean_t owner_died = FALSE;
+  svn_boolean_t got_lock = TRUE;
+
+  /* Try without waiting first, so we can tell whether we had to wait. */
+  SVN_ERR(shared_mutex_lock(cache->shared_lock, &got_lock, &owner_died));
+  if (!got_lock)
+    {
+      if (success && !cache->allow_blocking_writes)
+        {
+          *success = FALSE;
+          return SVN_NO_ERROR;
+        }
+      else
+        {
+          apr_time_t start = apr_time_now();
+          SVN_ERR(shared_mutex_lock(cache->shared_lock, NULL, &owner_died));
+          count_lock_wait(cache, start);
+        }
+    }
+
+  if (owner_died)
+    recover_segment(cache);
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* USE_SHARED_MEMORY */
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(shared_lock_cache(cache, NULL));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   if (cache->lock)
   {
-    apr_status_t status = apr_thread_rwlock_rdlock(cache->lock);
+    /* Try without waiting first, so we can tell whether we had to wait. */
+    apr_status_t status = apr_thread_rwlock_tryrdlock(cache->lock);
+    if (SVN_LOCK_IS_BUSY(status))
+      {
+        apr_time_t start = apr_time_now();
+        status = apr_thread_rwlock_rdlock(cache->lock);
+        if (!status)
+          count_lock_wait(cache, start);
+      }
+
     if (status)
       return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
   }
@@ -851,20 +1901,27 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(shared_lock_cache(cache, success));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   if (cache->lock)
     {
-      apr_status_t status;
-      if (cache->allow_blocking_writes)
-        {
-          status = apr_thread_rwlock_wrlock(cache->lock);
-        }
-      else
+      apr_status_t status = apr_thread_rwlock_trywrlock(cache->lock);
+      if (SVN_LOCK_IS_BUSY(status))
         {
-          status = apr_thread_rwlock_trywrlock(cache->lock);
-          if (SVN_LOCK_IS_BUSY(status))
+          if (cache->allow_blocking_writes)
+            {
+              apr_time_t start = apr_time_now();
+              status = apr_thread_rwlock_wrlock(cache->lock);
+              if (!status)
+                count_lock_wait(cache, start);
+            }
+          else
             {
               *success = FALSE;
               status = APR_SUCCESS;
@@ -888,10 +1945,23 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(shared_lock_cache(cache, NULL));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+  apr_status_t status = apr_thread_rwlock_trywrlock(cache->lock);
+  if (SVN_LOCK_IS_BUSY(status))
+    {
+      apr_time_t start = apr_time_now();
+      status = apr_thread_rwlock_wrlock(cache->lock);
+      if (!status)
+        count_lock_wait(cache, start);
+    }
+
   if (status)
     return svn_error_wrap_apr(status,
                               _("Can't write-lock cache mutex"));
@@ -908,6 +1978,11 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return shared_mutex_unlock(cache->shared_lock, err);
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -959,7 +2034,7 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  SVN_ERR(unlock_cache(cache, publish_changes(cache, (expr)))); \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1001,6 +2076,12 @@ initialize_group(svn_membuffer_t *cache, apr_uint32_t group_index)
       header->previous = NO_INDEX;
     }
 
+  /* Lock-free readers must not see the "initialized" bit before the
+   * group headers. */
+#if USE_OPTIMISTIC_READS
+  MEMORY_BARRIER();
+#endif
+
   /* set the "initialized" bit for these groups */
   bit_mask
     = (unsigned char)(1 << ((group_index / GROUP_INIT_GRANULARITY) % 8));
@@ -1097,25 +2178,102 @@ get_entry(svn_membuffer_t *cache, apr_uint32_t idx)
   return &cache->directory[idx / GROUP_SIZE].entries[idx % GROUP_SIZE];
 }
 
-/* Get the entry references for the given ENTRY.
+/* Get the entry references for the given ENTRY.
+ */
+static APR_INLINE apr_uint32_t
+get_index(svn_membuffer_t *cache, entry_t *entry)
+{
+  apr_size_t group_index
+    = ((char *)entry - (char *)cache->directory) / sizeof(entry_group_t);
+
+  return (apr_uint32_t)group_index * GROUP_SIZE
+       + (apr_uint32_t)(entry - cache->directory[group_index].entries);
+}
+
+/* Return the cache level of ENTRY in CACHE.
+ */
+static cache_level_t *
+get_cache_level(svn_membuffer_t *cache, entry_t *entry)
+{
+  return entry->offset < cache->l1.size ? &cache->l1
+                                        : &cache->l2;
+}
+
+/* Return the index of the first group in the chain that contains the
+ * group with index GROUP_INDEX in CACHE.
+ */
+static apr_uint32_t
+get_chain_head(svn_membuffer_t *cache, apr_uint32_t group_index)
+{
+  while (cache->directory[group_index].header.previous != NO_INDEX)
+    group_index = cache->directory[group_index].header.previous;
+
+  return group_index;
+}
+
+/* Mark the entry group chain starting at GROUP_INDEX in CACHE as being
+ * modified, i.e. lock-free readers will not use any data referenced by
+ * it until the current writer calls publish_changes().  This must be
+ * called before any modification to the chain's group headers, its
+ * entries or the data they reference.
+ *
+ * Note: This function requires the write lock.
+ */
+static void
+mark_group_dirty(svn_membuffer_t *cache, apr_uint32_t group_index)
+{
+#if USE_OPTIMISTIC_READS
+  /* Nothing to do if we already marked the chain or the whole segment. */
+  if (   !cache->optimistic_reads
+      || (cache->group_versions[group_index] & 1)
+      || (cache->segment_version & 1))
+    return;
+
+  if (cache->dirty_group_count < MAX_DIRTY_GROUPS)
+    {
+      cache->dirty_groups[cache->dirty_group_count++] = group_index;
+      svn_atomic_inc(&cache->group_versions[group_index]);
+    }
+  else
+    {
+      svn_atomic_inc(&cache->segment_version);
+    }
+#endif
+}
+
+/* Mark the entry group chain in CACHE that contains ENTRY as being
+ * modified.  See mark_group_dirty().
  */
-static APR_INLINE apr_uint32_t
-get_index(svn_membuffer_t *cache, entry_t *entry)
+static void
+mark_entry_dirty(svn_membuffer_t *cache, entry_t *entry)
 {
-  apr_size_t group_index
-    = ((char *)entry - (char *)cache->directory) / sizeof(entry_group_t);
-
-  return (apr_uint32_t)group_index * GROUP_SIZE
-       + (apr_uint32_t)(entry - cache->directory[group_index].entries);
+#if USE_OPTIMISTIC_READS
+  if (cache->optimistic_reads)
+    mark_group_dirty(cache,
+                     get_chain_head(cache, get_index(cache, entry)
+                                           / GROUP_SIZE));
+#endif
 }
 
-/* Return the cache level of ENTRY in CACHE.
+/* Make all changes of the current writer to CACHE visible to lock-free
+ * readers again.  Return ERR.
+ *
+ * Note: This function requires the write lock.
  */
-static cache_level_t *
-get_cache_level(svn_membuffer_t *cache, entry_t *entry)
+static svn_error_t *
+publish_changes(svn_membuffer_t *cache, svn_error_t *err)
 {
-  return entry->offset < cache->l1.size ? &cache->l1
-                                        : &cache->l2;
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t i;
+  for (i = 0; i < cache->dirty_group_count; ++i)
+    svn_atomic_inc(&cache->group_versions[cache->dirty_groups[i]]);
+  cache->dirty_group_count = 0;
+
+  if (cache->segment_version & 1)
+    svn_atomic_inc(&cache->segment_version);
+#endif
+
+  return err;
 }
 
 /* Insert ENTRY to the chain of items that belong to LEVEL in CACHE.  IDX
@@ -1217,10 +2375,17 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
 
   cache_level_t *level = get_cache_level(cache, entry);
 
+  /* we are about to modify ENTRY's group chain
+   */
+  mark_group_dirty(cache, get_chain_head(cache, group_index));
+
   /* update global cache usage counters
    */
   cache->used_entries--;
   cache->data_used -= entry->size;
+  partition_remove_usage(cache, entry->key.partition, entry->size);
+  category_add_usage(cache, entry->key.category, -(apr_int64_t)entry->size,
+                     -1);
 
   /* extend the insertion window, if the entry happens to border it
    */
@@ -1289,6 +2454,77 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
     free_spare_group(cache, last_group);
 }
 
+/* Return the minimum size for items of statistics category CATEGORY
+ * in CACHE to be demoted to the on-disk tier.  Return 0 if they shall
+ * not be demoted.
+ */
+static APR_INLINE apr_size_t
+get_demotion_size(svn_membuffer_t *cache, apr_uint16_t category)
+{
+  return cache->demotion_sizes && category < MAX_CATEGORIES
+       ? cache->demotion_sizes[category]
+       : 0;
+}
+
+/* Copy the used ENTRY from the CACHE to its on-disk tier, if its category
+ * and size qualify.  Failures are not fatal as the entry is about to be
+ * removed anyway.  Since we hold the segment's write lock, this only
+ * queues the data.  flush_demoted() will write it after the lock has been
+ * released.
+ */
+static void
+demote_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  apr_size_t min_size = get_demotion_size(cache, entry->key.category);
+  apr_size_t item_size = entry->size - entry->key.key_len;
+  const char *data = (const char *)cache->data + entry->offset;
+
+  if (min_size == 0 || item_size < min_size)
+    return;
+
+  /* Use the same key representation as get_demoted(). */
+  if (entry->key.prefix_idx == NO_INDEX)
+    svn_error_clear(svn_cache__disk_put(cache->disk, entry->key.fingerprint,
+                                        "", data, entry->key.key_len,
+                                        data + entry->key.key_len,
+                                        item_size));
+  else
+    svn_error_clear(svn_cache__disk_put(
+                      cache->disk, entry->key.fingerprint,
+                      cache->prefix_pool->values[entry->key.prefix_idx],
+                      entry->key.fingerprint,
+                      sizeof(entry->key.fingerprint),
+                      data, item_size));
+}
+
+/* Write the entries that demote_entry() queued for the on-disk tier of
+ * CACHE to disk.  Must not be called while holding a segment lock.
+ * Failures are not fatal.
+ */
+static void
+flush_demoted(svn_membuffer_t *cache)
+{
+  if (cache->disk)
+    svn_error_clear(svn_cache__disk_flush(cache->disk));
+}
+
+/* Remove the used ENTRY from the CACHE to make room for other entries.
+ * This is the same as drop_entry() but counts as an eviction and gives
+ * the entry a chance to be demoted to the on-disk tier.
+ */
+static void
+evict_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  category_stats_t *stats = get_category_stats(cache, entry->key.category);
+
+  cache->total_evictions++;
+  if (stats)
+    stats->evictions++;
+
+  demote_entry(cache, entry);
+  drop_entry(cache, entry);
+}
+
 /* Insert ENTRY into the chain of used dictionary entries. The entry's
  * offset and size members must already have been initialized. Also,
  * the offset must match the beginning of the insertion window.
@@ -1310,10 +2546,16 @@ insert_entry(svn_membuffer_t *cache, entry_t *entry)
   assert(idx == group_index * GROUP_SIZE + group->header.used);
   level->current_data = ALIGN_VALUE(entry->offset + entry->size);
 
+  /* we are about to modify ENTRY's group chain
+   */
+  mark_group_dirty(cache, get_chain_head(cache, group_index));
+
   /* update usage counters
    */
   cache->used_entries++;
   cache->data_used += entry->size;
+  partition_add_usage(cache, entry->key.partition, entry->size);
+  category_add_usage(cache, entry->key.category, entry->size, 1);
   entry->hit_count = 0;
   group->header.used++;
 
@@ -1347,14 +2589,126 @@ get_group_index(svn_membuffer_t **cache,
   return (key0 % APR_UINT64_C(5030895599)) % segment0->group_count;
 }
 
+/* Set INDEXES to the positions of the counters for KEY within the
+ * frequency sketch of CACHE, one for each row.
+ */
+static void
+get_sketch_indexes(apr_size_t indexes[SKETCH_DEPTH],
+                   svn_membuffer_t *cache,
+                   const entry_key_t *key)
+{
+  apr_uint32_t h1, h2;
+  int i;
+
+  /* Short keys are being stored verbatim in the fingerprint, so they need
+   * some mixing before we can use them as a hash value. */
+  apr_uint64_t hash = key->fingerprint[0]
+                    ^ (key->fingerprint[1] * APR_UINT64_C(0x9e3779b97f4a7c15))
+                    ^ key->prefix_idx;
+  hash ^= hash >> 33;
+  hash *= APR_UINT64_C(0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= APR_UINT64_C(0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+
+  /* Derive the row positions by double hashing. */
+  h1 = (apr_uint32_t)hash;
+  h2 = (apr_uint32_t)(hash >> 32) | 1;
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    indexes[i] = (apr_size_t)i * ((apr_size_t)cache->sketch_mask + 1)
+               + ((h1 + (apr_uint32_t)i * h2) & cache->sketch_mask);
+}
+
+/* Count a lookup of KEY in the frequency sketch of CACHE, if the TinyLFU
+ * policy is enabled.  This may be called without holding any lock.
+ */
+static void
+sketch_increment(svn_membuffer_t *cache,
+                 const entry_key_t *key)
+{
+  apr_size_t indexes[SKETCH_DEPTH];
+  unsigned char *sketch = cache->use_sketch ? cache->sketch : NULL;
+  int i;
+
+  if (sketch == NULL)
+    return;
+
+  get_sketch_indexes(indexes, cache, key);
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    if (sketch[indexes[i]] < SKETCH_MAX_COUNT)
+      sketch[indexes[i]]++;
+
+  /* Concurrent callers may overshoot a bit, which is harmless. */
+  if (svn_atomic_read(&cache->sketch_additions) < cache->sketch_sample_size)
+    svn_atomic_inc(&cache->sketch_additions);
+}
+
+/* Halve all counters in the frequency sketch of CACHE if the sample
+ * period is over.  The caller must hold the write lock to CACHE, i.e.
+ * this is amortized over the writes and no two threads will age the
+ * sketch at the same time.  Lock-free readers may still increment
+ * counters while we are at it; the worst that can happen is that a
+ * counter misses either that increment or its halving.
+ */
+static void
+sketch_age(svn_membuffer_t *cache)
+{
+  apr_size_t count = SKETCH_DEPTH * ((apr_size_t)cache->sketch_mask + 1);
+  apr_size_t k;
+
+  if (   cache->sketch == NULL
+      || svn_atomic_read(&cache->sketch_additions)
+           < cache->sketch_sample_size)
+    return;
+
+  for (k = 0; k < count; ++k)
+    cache->sketch[k] >>= 1;
+
+  svn_atomic_set(&cache->sketch_additions, cache->sketch_sample_size / 2);
+}
+
+/* Return the estimated number of recent accesses to KEY in CACHE.
+ */
+static apr_uint32_t
+sketch_estimate(svn_membuffer_t *cache,
+                const entry_key_t *key)
+{
+  apr_size_t indexes[SKETCH_DEPTH];
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+  int i;
+
+  get_sketch_indexes(indexes, cache, key);
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    result = MIN(result, cache->sketch[indexes[i]]);
+
+  return result;
+}
+
+/* Return the "worth" of ENTRY in CACHE as used by the L2 admission and
+ * eviction decisions.  With the TinyLFU policy, this is the estimated
+ * access frequency of its key, which includes accesses before ENTRY has
+ * been (re-)inserted into the cache.  Otherwise, it's ENTRY's hit count.
+ */
+static apr_uint32_t
+get_entry_hits(svn_membuffer_t *cache, entry_t *entry)
+{
+  return cache->use_sketch && cache->sketch
+       ? sketch_estimate(cache, &entry->key)
+       : entry->hit_count;
+}
+
 /* Reduce the hit count of ENTRY and update the accumulated hit info
- * in CACHE accordingly.
+ * in CACHE accordingly.  With the TinyLFU policy, this is a no-op as
+ * the frequency sketch ages by itself.
  */
 static APR_INLINE void
 let_entry_age(svn_membuffer_t *cache, entry_t *entry)
 {
   apr_uint32_t hits_removed = (entry->hit_count + 1) >> 1;
 
+  if (cache->use_sketch && cache->sketch)
+    return;
+
   if (hits_removed)
     {
       entry->hit_count -= hits_removed;
@@ -1407,6 +2761,11 @@ find_entry(svn_membuffer_t *cache,
    */
   group = &cache->directory[group_index];
 
+  /* If we are going to modify the group chain, tell lock-free readers.
+   */
+  if (find_empty)
+    mark_group_dirty(cache, group_index);
+
   /* If the entry group has not been initialized, yet, there is no data.
    */
   if (! is_group_initialized(cache, group_index))
@@ -1538,7 +2897,7 @@ find_entry(svn_membuffer_t *cache,
             if (entry != &to_shrink->entries[i])
               let_entry_age(cache, &to_shrink->entries[i]);
 
-          drop_entry(cache, entry);
+          evict_entry(cache, entry);
         }
 
       /* initialize entry for the new key
@@ -1559,6 +2918,9 @@ move_entry(svn_membuffer_t *cache, entry_t *entry)
   apr_size_t size = ALIGN_VALUE(entry->size);
   cache_level_t *level = get_cache_level(cache, entry);
 
+  /* Lock-free readers must not use the data while we move it. */
+  mark_entry_dirty(cache, entry);
+
   /* This entry survived this cleansing run. Reset half of its
    * hit count so that its removal gets more likely in the next
    * run unless someone read / hit this entry in the meantime.
@@ -1600,6 +2962,9 @@ promote_entry(svn_membuffer_t *cache, entry_t *entry)
   assert(get_cache_level(cache, entry) == &cache->l1);
   assert(idx == cache->l1.next);
 
+  /* Lock-free readers must not use the data while we move it. */
+  mark_entry_dirty(cache, entry);
+
   /* copy item from the current location in L1 to the start of L2's
    * insertion window */
   memmove(cache->data + cache->l2.current_data,
@@ -1647,9 +3012,15 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
   apr_uint64_t drop_hits = 0;
 
   /* estimated "worth" of the new entry */
-  apr_uint64_t drop_hits_limit = (to_fit_in->hit_count + 1)
+  apr_uint32_t to_fit_in_hits = get_entry_hits(cache, to_fit_in);
+  apr_uint64_t drop_hits_limit = (to_fit_in_hits + 1)
                                * (apr_uint64_t)to_fit_in->priority;
 
+  /* Partitions that exceed their quota must not grow their share of L2
+   * at the expense of others. */
+  if (partition_exceeds_quota(cache, to_fit_in->key.partition, 0))
+    return FALSE;
+
   /* This loop will eventually terminate because every cache entry
    * would get dropped eventually:
    *
@@ -1702,7 +3073,9 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
       else
         {
           svn_boolean_t keep;
+          apr_uint32_t entry_hits;
           entry = get_entry(cache, cache->l2.next);
+          entry_hits = get_entry_hits(cache, entry);
 
           if (to_fit_in->priority < SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
             {
@@ -1710,11 +3083,18 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * entry is of even lower prio and has fewer hits.
                */
               if (   entry->priority > to_fit_in->priority
-                  || entry->hit_count > to_fit_in->hit_count)
+                  || entry_hits > to_fit_in_hits)
                 return FALSE;
             }
 
-          if (entry->priority <= SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
+          if (partition_exceeds_quota(cache, entry->key.partition, 0))
+            {
+              /* Entries of partitions exceeding their quota are the first
+               * ones to go - no matter what their priority is.
+               */
+              keep = FALSE;
+            }
+          else if (entry->priority <= SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
             {
               /* Be quick to remove low-prio entries - even if the incoming
                * one is low-prio as well.  This makes room for more important
@@ -1731,7 +3111,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * The new entry may still find room by ousting other entries.
                */
               keep = to_fit_in->priority == entry->priority
-                   ? entry->hit_count >= to_fit_in->hit_count
+                   ? entry_hits >= to_fit_in_hits
                    : entry->priority > to_fit_in->priority;
             }
 
@@ -1753,9 +3133,9 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * provide the same data but in a further stage of processing.
                */
               if (entry->priority > SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
-                drop_hits += entry->hit_count * (apr_uint64_t)entry->priority;
+                drop_hits += entry_hits * (apr_uint64_t)entry->priority;
 
-              drop_entry(cache, entry);
+              evict_entry(cache, entry);
             }
         }
     }
@@ -1823,7 +3203,7 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
               if (keep)
                 promote_entry(cache, entry);
               else
-                drop_entry(cache, entry);
+                evict_entry(cache, entry);
             }
         }
     }
@@ -1832,31 +3212,37 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Implement svn_cache__membuffer_cache_create() and, if SHM_PATH is not
+ * NULL, svn_cache__membuffer_cache_create_shared().  In the latter case,
+ * all segments will be thread-safe regardless of THREAD_SAFE.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       const char *shm_path,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
-  prefix_pool_t *prefix_pool;
+  prefix_pool_t *prefix_pool = NULL;
+  membuffer_alloc_t alloc;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
   apr_uint32_t main_group_count;
   apr_uint32_t spare_group_count;
   apr_uint32_t group_init_size;
+  apr_uint32_t sketch_width;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  apr_size_t prefix_pool_size = total_size / 100;
+  total_size -= prefix_pool_size;
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1910,9 +3296,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,6 +3346,46 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* The frequency sketch rows shall have about one counter per entry. */
+  sketch_width = 64;
+  while (   sketch_width < APR_UINT32_MAX / 2
+         && sketch_width * 2 <= (apr_uint64_t)group_count * GROUP_SIZE)
+    sketch_width *= 2;
+
+  /* All allocations come from POOL, unless we need to put everything into
+   * a shared memory segment.  The latter must be large enough to hold all
+   * of the structures allocated below.  Every chunk is being aligned. */
+  alloc.pool = pool;
+  alloc.next = NULL;
+  alloc.remaining = 0;
+
+#if USE_SHARED_MEMORY
+  if (shm_path)
+    {
+      apr_size_t shm_size
+        = ALIGN_VALUE(prefix_pool_size)
+        + ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count
+            * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+               + ALIGN_VALUE(group_init_size)
+               + (apr_size_t)ALIGN_VALUE(data_size)
+               + ALIGN_VALUE(main_group_count * sizeof(svn_atomic_t))
+               + ALIGN_VALUE(MAX_CATEGORIES * sizeof(category_stats_t))
+               + ALIGN_VALUE(sizeof(pthread_mutex_t)));
+
+      SVN_ERR(create_shared_memory(&alloc, shm_path, shm_size, pool));
+    }
+#endif
+
+  SVN_ERR(prefix_pool_create(&prefix_pool, prefix_pool_size,
+                             thread_safe, &alloc));
+
+  /* allocate cache as an array of segments / cache objects */
+  c = membuffer_alloc(&alloc, segment_count * sizeof(*c), FALSE);
+  if (c == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1978,12 +3401,14 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = membuffer_alloc(&alloc,
+                                         group_count * sizeof(entry_group_t),
+                                         FALSE);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = membuffer_alloc(&alloc, group_init_size,
+                                                 TRUE);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +3429,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = membuffer_alloc(&alloc,
+                                    (apr_size_t)ALIGN_VALUE(data_size),
+                                    FALSE);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2012,11 +3439,21 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].total_evictions = 0;
+      c[seg].lock_waits = 0;
+      c[seg].lock_wait_time = 0;
+      c[seg].unattributed_lock_wait = 0;
+      c[seg].category_stats
+        = membuffer_alloc(&alloc, MAX_CATEGORIES * sizeof(category_stats_t),
+                          TRUE);
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL
+          || c[seg].directory == NULL
+          || c[seg].group_initialized == NULL
+          || c[seg].category_stats == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
@@ -2032,7 +3469,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
       /* Same for read-write lock. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shm_path)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
@@ -2044,8 +3481,52 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
 #endif
+
+#if USE_SHARED_MEMORY
+      /* Caches in shared memory are always being accessed concurrently. */
+      c[seg].shared_lock = NULL;
+      if (shm_path)
+        {
+          c[seg].shared_lock = membuffer_alloc(&alloc,
+                                               sizeof(*c[seg].shared_lock),
+                                               FALSE);
+          if (c[seg].shared_lock == NULL)
+            return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+          SVN_ERR(shared_mutex_init(c[seg].shared_lock));
+        }
+#endif
+
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+
+      /* Lock-free reads make only sense if there is a lock to avoid.
+       * The version numbers must be initialized as "not being modified". */
+      c[seg].optimistic_reads = (thread_safe || shm_path != NULL)
+                              && USE_OPTIMISTIC_READS;
+      c[seg].group_versions
+        = c[seg].optimistic_reads
+        ? membuffer_alloc(&alloc, main_group_count * sizeof(svn_atomic_t),
+                          TRUE)
+        : NULL;
+      if (c[seg].optimistic_reads && c[seg].group_versions == NULL)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+      c[seg].segment_version = 0;
+      c[seg].dirty_group_count = 0;
+
+      /* The frequency sketch gets allocated upon first use. */
+      c[seg].use_sketch = FALSE;
+      c[seg].sketch = NULL;
+      c[seg].sketch_mask = sketch_width - 1;
+      c[seg].sketch_additions = 0;
+      c[seg].sketch_sample_size
+        = (apr_uint32_t)MIN((apr_uint64_t)group_count * GROUP_SIZE
+                              * SKETCH_SAMPLE_FACTOR,
+                            APR_UINT32_MAX / 2);
+
+      /* No on-disk tier until svn_cache__membuffer_set_disk_cache(). */
+      c[seg].disk = NULL;
+      c[seg].demotion_sizes = NULL;
     }
 
   /* done here
@@ -2054,58 +3535,425 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes, NULL,
+                                                pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         const char *path,
+                                         apr_pool_t *pool)
+{
+#if USE_SHARED_MEMORY
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE,
+                                                allow_blocking_writes, path,
+                                                pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory caches are not supported "
+                            "on this platform"));
+#endif
+}
+
+/* Set the TinyLFU SKETCH of segment CACHE, unless it already has one, and
+ * select whether to USE_SKETCH.  The caller must hold the write lock.
+ */
+static svn_error_t *
+set_sketch(svn_membuffer_t *cache,
+           unsigned char *sketch,
+           svn_boolean_t use_sketch)
+{
+  if (cache->sketch == NULL)
+    cache->sketch = sketch;
+
+  cache->use_sketch = use_sketch;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_set_tinylfu(svn_membuffer_t *cache,
+                                 svn_boolean_t enable,
+                                 apr_pool_t *result_pool)
+{
+  apr_size_t sketch_size
+    = SKETCH_DEPTH * ((apr_size_t)cache->sketch_mask + 1);
+  apr_uint32_t seg;
+
+#if USE_SHARED_MEMORY
+  /* Other processes could not reach our sketch. */
+  if (enable && cache->shared_lock)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("Can't use TinyLFU admission for a cache in "
+                              "shared memory"));
+#endif
+
+  /* Entries keep their hit counts and the sketch keeps its contents, so
+   * switching back and forth is harmless.  The sketch memory, once
+   * allocated, remains until RESULT_POOL gets cleaned up. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      unsigned char *sketch = NULL;
+      if (enable && cache[seg].sketch == NULL)
+        sketch = apr_pcalloc(result_pool, sketch_size);
+
+      SVN_ERR(force_write_lock_cache(&cache[seg]));
+      SVN_ERR(unlock_cache(&cache[seg],
+                           set_sketch(&cache[seg], sketch, enable)));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
+  /* Clear segment by segment.  This implies that other thread may read
+     and write to other segments after we cleared them and before the
+     last segment is done.
+
+     However, that is no different from a write request coming through
+     right after we cleared all segments because dependencies between
+     cache entries (recursive lookup / access locks) are not allowed.
+   */
+  for (seg = 0; seg < segment_count; ++seg)
+    {
+      /* Unconditionally acquire the write lock. */
+      SVN_ERR(force_write_lock_cache(&cache[seg]));
+
+      /* Invalidate all ongoing lock-free reads. */
+      svn_atomic_inc(&cache[seg].segment_version);
+
+      reset_segment(&cache[seg]);
+
+      /* Segment may be used again. */
+      svn_atomic_inc(&cache[seg].segment_version);
+      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+    }
+
+  /* done here */
+  return SVN_NO_ERROR;
+}
+
+/* Format version of the key snapshots written by
+ * svn_cache__membuffer_save_keys().
+ */
+#define KEY_SNAPSHOT_FORMAT 1
+
+/* Collects the keys of a membuffer cache while it is being walked by
+ * svn_cache__membuffer_save_keys().
+ */
+typedef struct key_snapshot_t
+{
+  /* Maps the prefix strings to their index (apr_size_t *) within
+   * PREFIXES. */
+  apr_hash_t *prefix_map;
+
+  /* Maps the prefix pool indexes (apr_uint32_t) to the respective
+   * prefix_info_t. */
+  apr_hash_t *prefix_infos;
+
+  /* The serialized snapshot: format version, all prefix strings,
+   * and per key its prefix index, hit count and variable key part. */
+  svn_packed__data_root_t *root;
+  svn_packed__int_stream_t *header;
+  svn_packed__byte_stream_t *prefixes;
+  svn_packed__int_stream_t *prefix_indexes;
+  svn_packed__int_stream_t *hits;
+  svn_packed__byte_stream_t *keys;
+
+  /* All allocations go here. */
+  apr_pool_t *pool;
+} key_snapshot_t;
+
+/* Prefix pool entry as seen by a key_snapshot_t.
+ */
+typedef struct prefix_info_t
+{
+  /* Index within key_snapshot_t.PREFIXES. */
+  apr_size_t index;
+
+  /* Same as svn_membuffer_cache_t.PREFIX.FINGERPRINT of all caches using
+   * this prefix. */
+  apr_uint64_t fingerprint[2];
+} prefix_info_t;
+
+/* Return the index of PREFIX within the prefix table of SNAPSHOT and add
+ * it to that table if necessary.
+ */
+static apr_size_t
+get_snapshot_prefix_index(key_snapshot_t *snapshot,
+                          const char *prefix)
+{
+  apr_size_t *index = svn_hash_gets(snapshot->prefix_map, prefix);
+  if (index == NULL)
+    {
+      index = apr_palloc(snapshot->pool, sizeof(*index));
+      *index = apr_hash_count(snapshot->prefix_map);
+      svn_packed__add_bytes(snapshot->prefixes, prefix, strlen(prefix));
+      svn_hash_sets(snapshot->prefix_map,
+                    apr_pstrdup(snapshot->pool, prefix), index);
+    }
+
+  return *index;
+}
+
+/* Return the prefix info for the shared prefix with index PREFIX_IDX
+ * in CACHE and add it to SNAPSHOT, if necessary.
+ */
+static svn_error_t *
+get_snapshot_prefix_info(prefix_info_t **info,
+                         key_snapshot_t *snapshot,
+                         svn_membuffer_t *cache,
+                         apr_uint32_t prefix_idx)
+{
+  *info = apr_hash_get(snapshot->prefix_infos, &prefix_idx,
+                       sizeof(prefix_idx));
+  if (*info == NULL)
+    {
+      const char *prefix = cache->prefix_pool->values[prefix_idx];
+      svn_checksum_t *checksum;
+      apr_uint32_t *key = apr_pmemdup(snapshot->pool, &prefix_idx,
+                                      sizeof(prefix_idx));
+
+      *info = apr_pcalloc(snapshot->pool, sizeof(**info));
+      (*info)->index = get_snapshot_prefix_index(snapshot, prefix);
+
+      /* Same as in svn_cache__create_membuffer_cache(). */
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, prefix,
+                           strlen(prefix), snapshot->pool));
+      memcpy((*info)->fingerprint, checksum->digest,
+             sizeof((*info)->fingerprint));
+
+      apr_hash_set(snapshot->prefix_infos, key, sizeof(*key), *info);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Reconstruct the variable key part of the entry with the shared prefix
+ * INFO and the entry key KEY into DATA.  This reverses combine_key().
+ */
+static void
+restore_short_key(apr_uint64_t data[2],
+                  const entry_key_t *key,
+                  const prefix_info_t *info)
+{
+  data[0] = key->fingerprint[0] ^ info->fingerprint[0];
+  data[1] = key->fingerprint[1] ^ info->fingerprint[1];
+
+  data[0] ^= data[1] & APR_UINT64_C(0xffffffffffff0000);
+  data[1] ^= data[0] & 0xffff;
+  data[1] = (data[1] >> 27) | (data[1] << 37);
+}
+
+/* Add the keys of all entries in CACHE (a single segment) to SNAPSHOT.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+add_segment_keys(key_snapshot_t *snapshot,
+                 svn_membuffer_t *cache)
+{
+  const cache_level_t *levels[2];
+  int i;
+
+  levels[0] = &cache->l1;
+  levels[1] = &cache->l2;
+
+  for (i = 0; i < 2; ++i)
+    {
+      apr_uint32_t idx;
+      for (idx = levels[i]->first; idx != NO_INDEX;
+           idx = get_entry(cache, idx)->next)
+        {
+          entry_t *entry = get_entry(cache, idx);
+          apr_size_t prefix_index;
+
+          if (entry->key.key_len == 0)
+            {
+              /* Short key with a shared prefix. */
+              prefix_info_t *info;
+              apr_uint64_t data[2];
+
+              SVN_ERR(get_snapshot_prefix_info(&info, snapshot, cache,
+                                               entry->key.prefix_idx));
+              restore_short_key(data, &entry->key, info);
+
+              prefix_index = info->index;
+              svn_packed__add_bytes(snapshot->keys, (const char *)data,
+                                    sizeof(data));
+            }
+          else
+            {
+              /* The full key has been stored in front of the item data.
+               * It is the NUL-terminated prefix followed by the key,
+               * each padded to ITEM_ALIGNMENT. */
+              const char *full_key = (const char *)cache->data + entry->offset;
+              apr_size_t prefix_len = ALIGN_VALUE(strlen(full_key) + 1);
+
+              if (prefix_len > entry->key.key_len)
+                continue;
+
+              prefix_index = get_snapshot_prefix_index(snapshot, full_key);
+              svn_packed__add_bytes(snapshot->keys, full_key + prefix_len,
+                                    entry->key.key_len - prefix_len);
+            }
+
+          svn_packed__add_uint(snapshot->prefix_indexes, prefix_index);
+          svn_packed__add_uint(snapshot->hits, entry->hit_count);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
 
-  /* Clear segment by segment.  This implies that other thread may read
-     and write to other segments after we cleared them and before the
-     last segment is done.
+svn_error_t *
+svn_cache__membuffer_save_keys(svn_stream_t *stream,
+                               svn_membuffer_t *cache,
+                               apr_pool_t *scratch_pool)
+{
+  key_snapshot_t snapshot;
+  apr_uint32_t seg;
 
-     However, that is no different from a write request coming through
-     right after we cleared all segments because dependencies between
-     cache entries (recursive lookup / access locks) are not allowed.
-   */
-  for (seg = 0; seg < segment_count; ++seg)
-    {
-      /* Unconditionally acquire the write lock. */
-      SVN_ERR(force_write_lock_cache(&cache[seg]));
+  snapshot.pool = scratch_pool;
+  snapshot.prefix_map = svn_hash__make(scratch_pool);
+  snapshot.prefix_infos = apr_hash_make(scratch_pool);
+  snapshot.root = svn_packed__data_create_root(scratch_pool);
+  snapshot.header = svn_packed__create_int_stream(snapshot.root, FALSE,
+                                                  FALSE);
+  snapshot.prefix_indexes = svn_packed__create_int_stream(snapshot.root,
+                                                          FALSE, FALSE);
+  snapshot.hits = svn_packed__create_int_stream(snapshot.root, FALSE,
+                                                FALSE);
+  snapshot.prefixes = svn_packed__create_bytes_stream(snapshot.root);
+  snapshot.keys = svn_packed__create_bytes_stream(snapshot.root);
+
+  svn_packed__add_uint(snapshot.header, KEY_SNAPSHOT_FORMAT);
+
+  /* Other threads may modify other segments while we walk this one but
+   * the snapshot does not need to be atomic. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    WITH_READ_LOCK(&cache[seg], add_segment_keys(&snapshot, &cache[seg]));
+
+  return svn_error_trace(svn_packed__data_write(stream, snapshot.root,
+                                                scratch_pool));
+}
+
+/* Implements the comparison function for svn_sort__array.
+ * Sort svn_cache__key_record_t * by decreasing hit count. */
+static int
+compare_key_records(const void *lhs,
+                    const void *rhs)
+{
+  const svn_cache__key_record_t *lhs_record
+    = *(const svn_cache__key_record_t * const *)lhs;
+  const svn_cache__key_record_t *rhs_record
+    = *(const svn_cache__key_record_t * const *)rhs;
 
-      /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
+  if (lhs_record->hits == rhs_record->hits)
+    return 0;
 
-      memset(cache[seg].group_initialized, 0, group_init_size);
+  return lhs_record->hits > rhs_record->hits ? -1 : 1;
+}
 
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
+svn_error_t *
+svn_cache__load_keys(apr_array_header_t **records,
+                     svn_stream_t *stream,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_packed__data_root_t *root;
+  svn_packed__int_stream_t *header;
+  svn_packed__int_stream_t *prefix_indexes;
+  svn_packed__int_stream_t *hits;
+  svn_packed__byte_stream_t *prefix_stream;
+  svn_packed__byte_stream_t *keys;
+  apr_array_header_t *prefixes;
+  apr_uint64_t format;
+  apr_size_t count;
+  apr_size_t i;
 
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
+  SVN_ERR(svn_packed__data_read(&root, stream, scratch_pool, scratch_pool));
+
+  header = svn_packed__first_int_stream(root);
+  prefix_indexes = header ? svn_packed__next_int_stream(header) : NULL;
+  hits = prefix_indexes ? svn_packed__next_int_stream(prefix_indexes) : NULL;
+  prefix_stream = svn_packed__first_byte_stream(root);
+  keys = prefix_stream ? svn_packed__next_byte_stream(prefix_stream) : NULL;
+  if (!hits || !keys)
+    return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                            _("Incomplete cache key snapshot"));
+
+  format = svn_packed__get_uint(header);
+  if (format != KEY_SNAPSHOT_FORMAT)
+    return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+                             _("Unsupported cache key snapshot format "
+                               "%" APR_UINT64_T_FMT), format);
+
+  /* The prefixes are being shared between all records. */
+  count = svn_packed__byte_block_count(prefix_stream);
+  prefixes = apr_array_make(scratch_pool, (int)count, sizeof(const char *));
+  for (i = 0; i < count; ++i)
+    {
+      apr_size_t len;
+      const char *prefix = svn_packed__get_bytes(prefix_stream, &len);
+      APR_ARRAY_PUSH(prefixes, const char *)
+        = apr_pstrmemdup(result_pool, prefix, len);
+    }
 
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+  count = svn_packed__int_count(prefix_indexes);
+  if (   svn_packed__int_count(hits) != count
+      || svn_packed__byte_block_count(keys) != count)
+    return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                            _("Inconsistent cache key snapshot"));
 
-      /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+  *records = apr_array_make(result_pool, (int)count,
+                            sizeof(svn_cache__key_record_t *));
+  for (i = 0; i < count; ++i)
+    {
+      svn_cache__key_record_t *record = apr_palloc(result_pool,
+                                                   sizeof(*record));
+      apr_uint64_t prefix_index = svn_packed__get_uint(prefix_indexes);
+      const char *key;
+
+      if (prefix_index >= (apr_uint64_t)prefixes->nelts)
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Invalid prefix in cache key snapshot"));
+
+      record->prefix = APR_ARRAY_IDX(prefixes, (int)prefix_index,
+                                     const char *);
+      record->hits = (apr_uint32_t)svn_packed__get_uint(hits);
+      key = svn_packed__get_bytes(keys, &record->key_len);
+      record->key = apr_pmemdup(result_pool, key, record->key_len);
+
+      APR_ARRAY_PUSH(*records, svn_cache__key_record_t *) = record;
     }
 
-  /* done here */
+  /* Most frequently used keys first. */
+  svn_sort__array(*records, compare_key_records);
+
   return SVN_NO_ERROR;
 }
 
@@ -2143,14 +3991,15 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Given the SIZE and PRIORITY of a new item, return the cache level
-   (L1 or L2) in fragment CACHE that this item shall be inserted into.
-   If we can't find nor make enough room for the item, return NULL.
+/* Given the SIZE, PRIORITY and quota PARTITION of a new item, return the
+   cache level (L1 or L2) in fragment CACHE that this item shall be inserted
+   into.  If we can't find nor make enough room for the item, return NULL.
  */
 static cache_level_t *
 select_level(svn_membuffer_t *cache,
              apr_size_t size,
-             apr_uint32_t priority)
+             apr_uint32_t priority,
+             apr_uint32_t partition)
 {
   if (cache->max_entry_size >= size)
     {
@@ -2167,6 +4016,7 @@ select_level(svn_membuffer_t *cache,
       entry_t dummy_entry = { { { 0 } } };
       dummy_entry.priority = priority;
       dummy_entry.size = size;
+      dummy_entry.key.partition = partition;
 
       return ensure_data_insertable_l2(cache, &dummy_entry)
            ? &cache->l2
@@ -2209,6 +4059,10 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
    * membuffer in single-threaded mode. */
   assert(0 == svn_atomic_inc(&cache->write_lock_count));
 
+  /* Catch up with the aging of the TinyLFU sketch while we have the
+   * write lock. */
+  sketch_age(cache);
+
   /* Quick check make sure arithmetics will work further down the road. */
   size = item_size + to_find->entry_key.key_len;
   if (size < item_size)
@@ -2219,15 +4073,43 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
       buffer = NULL;
     }
 
+  /* Items that would push their partition beyond its hard quota don't get
+   * cached at all.  Any old entry will be removed, though.  This applies
+   * to in-place overwrites as well.  Replacing an entry of the same
+   * partition only adds the difference in size.
+   */
+  if (   buffer
+      && partition_has_hard_quota(cache, to_find->entry_key.partition))
+    {
+      apr_size_t growth = size;
+      if (entry && entry->key.partition == to_find->entry_key.partition)
+        growth = ALIGN_VALUE(size) > ALIGN_VALUE(entry->size)
+               ? ALIGN_VALUE(size) - ALIGN_VALUE(entry->size)
+               : 0;
+
+      if (   growth
+          && partition_exceeds_quota(cache, to_find->entry_key.partition,
+                                     growth))
+        buffer = NULL;
+    }
+
   /* if there is an old version of that entry and the new data fits into
    * the old spot, just re-use that space. */
   if (entry && buffer && ALIGN_VALUE(entry->size) >= size)
     {
+      /* We are going to overwrite the data in-place. */
+      mark_entry_dirty(cache, entry);
+
       /* Careful! We need to cast SIZE to the full width of CACHE->DATA_USED
        * lest we run into trouble with 32 bit underflow *not* treated as a
        * negative value.
        */
       cache->data_used += (apr_uint64_t)size - entry->size;
+      partition_remove_usage(cache, entry->key.partition, entry->size);
+      entry->key.partition = to_find->entry_key.partition;
+      partition_add_usage(cache, entry->key.partition, size);
+      category_add_usage(cache, entry->key.category,
+                         (apr_int64_t)size - (apr_int64_t)entry->size, 0);
       entry->size = size;
       entry->priority = priority;
 
@@ -2247,7 +4129,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      count_write(cache, &to_find->entry_key);
 
       /* Putting the decrement into an assert() to make it disappear
        * in production code. */
@@ -2257,7 +4139,9 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
 
   /* if necessary, enlarge the insertion window.
    */
-  level = buffer ? select_level(cache, size, priority) : NULL;
+  level = buffer
+        ? select_level(cache, size, priority, to_find->entry_key.partition)
+        : NULL;
   if (level)
     {
       /* Remove old data for this key, if that exists.
@@ -2291,7 +4175,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      count_write(cache, &to_find->entry_key);
     }
   else
     {
@@ -2310,6 +4194,44 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Try to insert the serialized item given in BUFFER with SIZE bytes and
+ * use the KEY to uniquely identify it.  Same as membuffer_cache_set()
+ * but for data that has already been serialized.  BUFFER may be NULL.
+ * Temporary allocations may be done in POOL.
+ */
+static svn_error_t *
+membuffer_cache_set_buffer(svn_membuffer_t *cache,
+                           const full_key_t *key,
+                           void *buffer,
+                           apr_size_t size,
+                           apr_uint32_t priority,
+                           DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                           apr_pool_t *scratch_pool)
+{
+  apr_uint32_t group_index;
+
+  /* find the entry group that will hold the key.
+   */
+  group_index = get_group_index(&cache, &key->entry_key);
+
+  /* The actual cache data access needs to sync'ed
+   */
+  WITH_WRITE_LOCK(cache,
+                  membuffer_cache_set_internal(cache,
+                                               key,
+                                               group_index,
+                                               buffer,
+                                               size,
+                                               priority,
+                                               DEBUG_CACHE_MEMBUFFER_TAG
+                                               scratch_pool));
+
+  /* Inserting the item may have demoted other entries. */
+  flush_demoted(cache);
+
+  return SVN_NO_ERROR;
+}
+
 /* Try to insert the ITEM and use the KEY to uniquely identify it.
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated to the KEY,
@@ -2328,31 +4250,18 @@ membuffer_cache_set(svn_membuffer_t *cache,
                     DEBUG_CACHE_MEMBUFFER_TAG_ARG
                     apr_pool_t *scratch_pool)
 {
-  apr_uint32_t group_index;
   void *buffer = NULL;
   apr_size_t size = 0;
 
-  /* find the entry group that will hold the key.
-   */
-  group_index = get_group_index(&cache, &key->entry_key);
-
   /* Serialize data data.
    */
   if (item)
     SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
 
-  /* The actual cache data access needs to sync'ed
-   */
-  WITH_WRITE_LOCK(cache,
-                  membuffer_cache_set_internal(cache,
-                                               key,
-                                               group_index,
-                                               buffer,
-                                               size,
-                                               priority,
-                                               DEBUG_CACHE_MEMBUFFER_TAG
-                                               scratch_pool));
-  return SVN_NO_ERROR;
+  return svn_error_trace(membuffer_cache_set_buffer(cache, key, buffer, size,
+                                                    priority,
+                                                    DEBUG_CACHE_MEMBUFFER_TAG
+                                                    scratch_pool));
 }
 
 /* Count a hit in ENTRY within CACHE.
@@ -2366,8 +4275,213 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
    * few billion hits. */
   svn_atomic_inc(&entry->hit_count);
 
-  /* That one is for stats only. */
+  /* These are for stats only. */
   cache->total_hits++;
+  if (entry->key.category < MAX_CATEGORIES)
+    cache->category_stats[entry->key.category].hits++;
+}
+
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of find_entry for FIND_EMPTY==FALSE.  Look for the
+ * entry identified by TO_FIND in group GROUP_INDEX of CACHE and return a
+ * copy of it in *RESULT.  Return a pointer to the original entry or NULL,
+ * if it could not be found.
+ *
+ * Since the directory and the data buffer may be modified concurrently,
+ * the result is only valid if the versions of the group chain and the
+ * segment did not change until the caller is done using it.  However, this
+ * function will never access memory outside the cache's buffers.
+ */
+static entry_t *
+find_entry_optimistic(entry_t *result,
+                      svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find)
+{
+  apr_uint32_t total_groups = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  entry_group_t *group = &cache->directory[group_index];
+  int chain_length;
+
+  /* If the entry group has not been initialized, yet, there is no data.
+   * Pairs with the barrier in initialize_group().
+   */
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  MEMORY_BARRIER();
+
+  /* Any inconsistency that we see here is due to a concurrent writer
+   * and will be detected by our caller.  Don't follow garbage links.
+   */
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      apr_uint32_t used = (apr_uint32_t)MIN(group->header.used, GROUP_SIZE);
+      apr_uint32_t next = group->header.next;
+      apr_uint32_t i;
+
+      for (i = 0; i < used; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            /* Take a snapshot and re-check it. */
+            *result = group->entries[i];
+            if (!entry_keys_match(&result->key, &to_find->entry_key))
+              return NULL;
+
+            /* Stay within the data buffer. */
+            if (   result->offset > data_size
+                || result->size > data_size - result->offset
+                || ALIGN_VALUE(result->size) > data_size - result->offset
+                || result->key.key_len > result->size)
+              return NULL;
+
+            /* Check for key conflicts as find_entry does. */
+            if (   result->key.key_len
+                && memcmp(to_find->full_key.data,
+                          cache->data + result->offset,
+                          result->key.key_len) != 0)
+              return NULL;
+
+            return &group->entries[i];
+          }
+
+      /* end of chain? */
+      if (next >= total_groups)
+        return NULL;
+
+      group = &cache->directory[next];
+    }
+
+  return NULL;
+}
+
+#endif
+
+/* Try to do the same as membuffer_cache_get_internal but without taking
+ * the read lock.  Return FALSE, if that failed due to concurrent writes
+ * to the same entry group chain.  In that case, the output parameters
+ * are undefined.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+#if USE_OPTIMISTIC_READS
+  int attempt;
+  if (!cache->optimistic_reads)
+    return FALSE;
+
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      entry_t snapshot;
+      entry_t *entry;
+
+      /* Don't even try while writers are busy. */
+      apr_uint32_t segment_version
+        = svn_atomic_read(&cache->segment_version);
+      apr_uint32_t group_version
+        = svn_atomic_read(&cache->group_versions[group_index]);
+      if ((segment_version | group_version) & 1)
+        continue;
+
+      MEMORY_BARRIER();
+
+      /* Copy the data just like membuffer_cache_get_internal.
+       */
+      entry = find_entry_optimistic(&snapshot, cache, group_index, to_find);
+      if (entry)
+        {
+          apr_size_t size = ALIGN_VALUE(snapshot.size)
+                          - snapshot.key.key_len;
+          *buffer = apr_palloc(result_pool, size);
+          memcpy(*buffer,
+                 cache->data + snapshot.offset + snapshot.key.key_len,
+                 size);
+          *item_size = snapshot.size - snapshot.key.key_len;
+        }
+      else
+        {
+          *buffer = NULL;
+          *item_size = 0;
+        }
+
+      MEMORY_BARRIER();
+
+      /* If nobody modified the chain or the segment, the result is valid.
+       */
+      if (   segment_version == svn_atomic_read(&cache->segment_version)
+          && group_version
+               == svn_atomic_read(&cache->group_versions[group_index]))
+        {
+          /* Statistics only.  A concurrent writer may have moved ENTRY
+           * in the meantime, in which case we count a hit for the wrong
+           * entry.  That is harmless. */
+          count_read(cache, &to_find->entry_key);
+          if (entry)
+            increment_hit_counters(cache, entry);
+
+          return TRUE;
+        }
+    }
+#endif
+
+  return FALSE;
+}
+
+/* Try to do the same as membuffer_cache_has_key_internal but without
+ * taking the read lock.  Return FALSE, if that failed due to concurrent
+ * writes to the same entry group chain.  In that case, *FOUND is
+ * undefined.
+ */
+static svn_boolean_t
+membuffer_cache_has_key_optimistic(svn_membuffer_t *cache,
+                                   apr_uint32_t group_index,
+                                   const full_key_t *to_find,
+                                   svn_boolean_t *found)
+{
+#if USE_OPTIMISTIC_READS
+  int attempt;
+  if (!cache->optimistic_reads)
+    return FALSE;
+
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      entry_t snapshot;
+      entry_t *entry;
+
+      apr_uint32_t segment_version
+        = svn_atomic_read(&cache->segment_version);
+      apr_uint32_t group_version
+        = svn_atomic_read(&cache->group_versions[group_index]);
+      if ((segment_version | group_version) & 1)
+        continue;
+
+      MEMORY_BARRIER();
+      entry = find_entry_optimistic(&snapshot, cache, group_index, to_find);
+      MEMORY_BARRIER();
+
+      if (   segment_version == svn_atomic_read(&cache->segment_version)
+          && group_version
+               == svn_atomic_read(&cache->group_versions[group_index]))
+        {
+          /* See membuffer_cache_has_key_internal for why we count hits. */
+          if (entry)
+            increment_hit_counters(cache, entry);
+
+          *found = entry != NULL;
+          return TRUE;
+        }
+    }
+#endif
+
+  return FALSE;
 }
 
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
@@ -2394,7 +4508,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   /* The actual cache data access needs to sync'ed
    */
   entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
   if (entry == NULL)
     {
       /* no such entry found.
@@ -2453,14 +4567,20 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  sketch_increment(cache, &key->entry_key);
+
+  /* Lock-free lookup first.  Take the read lock only upon conflicts.
+   */
+  if (!membuffer_cache_get_optimistic(cache, group_index, key, &buffer,
+                                      &size, result_pool))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2515,13 +4635,16 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
-  cache->total_reads++;
+  count_read(cache, &key->entry_key);
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_has_key_internal(cache,
-                                                  group_index,
-                                                  key,
-                                                  found));
+  /* Lock-free lookup first.  Take the read lock only upon conflicts.
+   */
+  if (!membuffer_cache_has_key_optimistic(cache, group_index, key, found))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_has_key_internal(cache,
+                                                    group_index,
+                                                    key,
+                                                    found));
 
   return SVN_NO_ERROR;
 }
@@ -2549,7 +4672,7 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
                                      apr_pool_t *result_pool)
 {
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
   if (entry == NULL)
     {
       *item = NULL;
@@ -2600,6 +4723,7 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                             apr_pool_t *result_pool)
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  sketch_increment(cache, &key->entry_key);
 
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_partial_internal
@@ -2632,7 +4756,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
   /* cache item lookup
    */
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
 
   /* this function is a no-op if the item is not in cache
    */
@@ -2647,7 +4771,10 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
       apr_size_t item_size = entry->size - key_len;
 
       increment_hit_counters(cache, entry);
-      cache->total_writes++;
+      count_write(cache, &to_find->entry_key);
+
+      /* FUNC may modify the data in-place. */
+      mark_entry_dirty(cache, entry);
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
 
@@ -2748,8 +4875,11 @@ membuffer_cache_set_partial(svn_membuffer_t *cache,
                       DEBUG_CACHE_MEMBUFFER_TAG
                       scratch_pool));
 
-  /* done here -> unlock the cache
+  /* done here -> the cache has been unlocked.  Growing the item may have
+   * demoted other entries.
    */
+  flush_demoted(cache);
+
   return SVN_NO_ERROR;
 }
 
@@ -2917,6 +5047,61 @@ combine_key(svn_membuffer_cache_t *cache,
     = data[1] ^ cache->prefix.fingerprint[1];
 }
 
+/* Look up the item for CACHE->COMBINED_KEY in the on-disk tier of CACHE's
+ * membuffer.  If found, return its serialized data in *BUFFER and its
+ * size in *SIZE, and put the item back into the membuffer.  Otherwise,
+ * set *BUFFER to NULL.  Allocate the result in RESULT_POOL.
+ *
+ * Problems with the on-disk tier are never fatal and simply result in
+ * a cache miss.
+ */
+static svn_error_t *
+get_demoted(void **buffer,
+            apr_size_t *size,
+            svn_membuffer_cache_t *cache,
+            DEBUG_CACHE_MEMBUFFER_TAG_ARG
+            apr_pool_t *result_pool)
+{
+  svn_membuffer_t *membuffer = cache->membuffer;
+  const entry_key_t *key = &cache->combined_key.entry_key;
+  svn_error_t *err;
+
+  *buffer = NULL;
+  *size = 0;
+  if (get_demotion_size(membuffer, key->category) == 0)
+    return SVN_NO_ERROR;
+
+  /* Use the same key representation as demote_entry(). */
+  if (key->prefix_idx == NO_INDEX)
+    err = svn_cache__disk_get(buffer, size, membuffer->disk,
+                              key->fingerprint, "",
+                              cache->combined_key.full_key.data,
+                              key->key_len, result_pool);
+  else
+    err = svn_cache__disk_get(buffer, size, membuffer->disk,
+                              key->fingerprint,
+                              get_prefix_key(cache),
+                              key->fingerprint, sizeof(key->fingerprint),
+                              result_pool);
+
+  if (err)
+    {
+      svn_error_clear(err);
+      *buffer = NULL;
+      *size = 0;
+    }
+
+  /* Promote the item back into memory.  This has to happen before the
+   * caller deserializes BUFFER in-place. */
+  if (*buffer)
+    SVN_ERR(membuffer_cache_set_buffer(membuffer, &cache->combined_key,
+                                       *buffer, *size, cache->priority,
+                                       DEBUG_CACHE_MEMBUFFER_TAG
+                                       result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Implement svn_cache__vtable_t.get (not thread-safe)
  */
 static svn_error_t *
@@ -2952,6 +5137,18 @@ svn_membuffer_cache_get(void **value_p,
                               DEBUG_CACHE_MEMBUFFER_TAG
                               result_pool));
 
+  /* Evicted items may still be available from the on-disk tier. */
+  if (*value_p == NULL && cache->membuffer->disk)
+    {
+      void *buffer;
+      apr_size_t size;
+
+      SVN_ERR(get_demoted(&buffer, &size, cache, DEBUG_CACHE_MEMBUFFER_TAG
+                          result_pool));
+      if (buffer)
+        SVN_ERR(cache->deserializer(value_p, buffer, size, result_pool));
+    }
+
   /* return result */
   *found = *value_p != NULL;
 
@@ -3069,6 +5266,21 @@ svn_membuffer_cache_get_partial(void **value_p,
                                       DEBUG_CACHE_MEMBUFFER_TAG
                                       result_pool));
 
+  /* Evicted items may still be available from the on-disk tier. */
+  if (!*found && cache->membuffer->disk)
+    {
+      void *buffer;
+      apr_size_t size;
+
+      SVN_ERR(get_demoted(&buffer, &size, cache, DEBUG_CACHE_MEMBUFFER_TAG
+                          result_pool));
+      if (buffer)
+        {
+          SVN_ERR(func(value_p, buffer, size, baton, result_pool));
+          *found = TRUE;
+        }
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -3132,6 +5344,10 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
   info->used_entries += segment->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
 
+  info->evictions += segment->total_evictions;
+  info->lock_waits += segment->lock_waits;
+  info->lock_wait_time += segment->lock_wait_time;
+
   if (include_histogram)
     for (i = 0; i < segment->group_count; ++i)
       if (is_group_initialized(segment, i))
@@ -3157,12 +5373,27 @@ svn_membuffer_cache_get_info(void *cache_void,
                              apr_pool_t *result_pool)
 {
   svn_membuffer_cache_t *cache = cache_void;
+  partition_t *partition;
   apr_uint32_t i;
 
   /* cache front-end specific data */
 
   info->id = apr_pstrdup(result_pool, get_prefix_key(cache));
 
+  partition = get_partition(cache->membuffer,
+                            cache->combined_key.entry_key.partition);
+  if (partition)
+    {
+      prefix_pool_t *prefix_pool = cache->membuffer->prefix_pool;
+
+      info->partition = apr_pstrdup(result_pool,
+                                    prefix_pool->values[partition->name_idx]);
+      info->partition_quota = partition->quota;
+      info->partition_hard_quota = partition->hard_quota;
+      info->partition_used
+        = (apr_uint64_t)svn_atomic_read(&partition->used) * ITEM_ALIGNMENT;
+    }
+
   /* collect info from shared cache back-end */
 
   for (i = 0; i < cache->membuffer->segment_count; ++i)
@@ -3407,6 +5638,11 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
   else
     cache->prefix.prefix_idx = NO_INDEX;
 
+  /* No quota nor per-category statistics until the respective
+   * svn_cache__membuffer_set_* functions get called. */
+  cache->prefix.partition = NO_SHORT_INDEX;
+  cache->prefix.category = NO_SHORT_INDEX;
+
   /* If key combining is not guaranteed to produce unique results, we have
    * to handle full keys.  Otherwise, leave it NULL. */
   if (cache->prefix.prefix_idx == NO_INDEX)
@@ -3429,6 +5665,8 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
        * by combine_key(). */
       cache->combined_key.entry_key.prefix_idx = cache->prefix.prefix_idx;
       cache->combined_key.entry_key.key_len = 0;
+      cache->combined_key.entry_key.partition = NO_SHORT_INDEX;
+      cache->combined_key.entry_key.category = NO_SHORT_INDEX;
     }
 
   /* initialize the generic cache wrapper
@@ -3444,6 +5682,120 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_set_partition(svn_cache__t *cache,
+                                   const char *partition,
+                                   apr_uint64_t quota,
+                                   svn_boolean_t hard_quota,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_membuffer_cache_t *membuffer_cache;
+  apr_uint32_t partition_idx;
+
+  SVN_ERR_ASSERT(   cache->vtable == &membuffer_cache_vtable
+                 || cache->vtable == &membuffer_cache_synced_vtable);
+
+  membuffer_cache = cache->cache_internal;
+  SVN_ERR(partition_get(&partition_idx,
+                        membuffer_cache->membuffer->prefix_pool,
+                        partition, quota, hard_quota));
+
+  /* The combined key gets copied into every new entry. */
+  if (partition_idx == NO_INDEX)
+    partition_idx = NO_SHORT_INDEX;
+
+  membuffer_cache->prefix.partition = (apr_uint16_t)partition_idx;
+  membuffer_cache->combined_key.entry_key.partition
+    = (apr_uint16_t)partition_idx;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_set_category(svn_cache__t *cache,
+                                  const char *category,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_membuffer_cache_t *membuffer_cache;
+  apr_uint32_t category_idx;
+
+  SVN_ERR_ASSERT(   cache->vtable == &membuffer_cache_vtable
+                 || cache->vtable == &membuffer_cache_synced_vtable);
+
+  membuffer_cache = cache->cache_internal;
+  SVN_ERR(category_get(&category_idx,
+                       membuffer_cache->membuffer->prefix_pool,
+                       category));
+
+  /* Same as for partitions. */
+  if (category_idx == NO_INDEX)
+    category_idx = NO_SHORT_INDEX;
+
+  membuffer_cache->prefix.category = (apr_uint16_t)category_idx;
+  membuffer_cache->combined_key.entry_key.category
+    = (apr_uint16_t)category_idx;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_set_disk_cache(svn_membuffer_t *membuffer,
+                                    const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool)
+{
+  svn_cache__disk_t *disk;
+  apr_size_t *demotion_sizes;
+  apr_uint32_t seg;
+
+#if USE_SHARED_MEMORY
+  /* Other processes could not reach our file index. */
+  if (membuffer->shared_lock)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("Can't add an on-disk tier to a cache in "
+                              "shared memory"));
+#endif
+
+  if (membuffer->disk)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("The cache already has an on-disk tier"));
+
+  SVN_ERR(svn_cache__disk_open(&disk, path, size, result_pool,
+                               scratch_pool));
+  demotion_sizes = apr_pcalloc(result_pool,
+                               MAX_CATEGORIES * sizeof(*demotion_sizes));
+
+  for (seg = 0; seg < membuffer->segment_count; ++seg)
+    {
+      membuffer[seg].demotion_sizes = demotion_sizes;
+      membuffer[seg].disk = disk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_set_demotion(svn_cache__t *cache,
+                                  apr_size_t min_size,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_membuffer_cache_t *membuffer_cache;
+  apr_uint16_t category;
+
+  SVN_ERR_ASSERT(   cache->vtable == &membuffer_cache_vtable
+                 || cache->vtable == &membuffer_cache_synced_vtable);
+
+  membuffer_cache = cache->cache_internal;
+  category = membuffer_cache->prefix.category;
+
+  /* All segments share the same settings. */
+  if (membuffer_cache->membuffer->demotion_sizes && category < MAX_CATEGORIES)
+    membuffer_cache->membuffer->demotion_sizes[category] = MAX(min_size, 1);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
@@ -3472,9 +5824,62 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   /* collect info from shared cache back-end */
 
-  for (i = 0; i < membuffer->segment_count; ++i)
+  for (i = 0; membuffer && i < membuffer->segment_count; ++i)
     svn_error_clear(svn_membuffer_get_global_segment_info(membuffer + i,
                                                           info));
 
   return info;
 }
+
+apr_array_header_t *
+svn_cache__membuffer_get_category_info(svn_membuffer_t *membuffer,
+                                       apr_pool_t *pool)
+{
+  apr_uint32_t i, k;
+  apr_array_header_t *result;
+  apr_uint32_t count;
+
+  if (membuffer == NULL || membuffer->prefix_pool->categories == NULL)
+    return apr_array_make(pool, 0, sizeof(svn_cache__info_t *));
+
+  /* Categories only ever get added, so we may see fewer than there are
+   * but never invalid ones. */
+  count = MIN(membuffer->prefix_pool->categories_used, MAX_CATEGORIES);
+  result = apr_array_make(pool, count, sizeof(svn_cache__info_t *));
+
+  for (k = 0; k < count; ++k)
+    {
+      svn_cache__info_t *info = apr_pcalloc(pool, sizeof(*info));
+      apr_uint32_t name_idx = membuffer->prefix_pool->categories[k];
+      info->id = apr_pstrdup(pool,
+                             membuffer->prefix_pool->values[name_idx]);
+
+      /* Like the global statistics, this data is collected without
+       * locking the segments. */
+      for (i = 0; i < membuffer->segment_count; ++i)
+        {
+          const category_stats_t *stats
+            = &membuffer[i].category_stats[k];
+
+          info->gets += stats->gets;
+          info->hits += stats->hits;
+          info->sets += stats->sets;
+          info->evictions += stats->evictions;
+          info->used_size += stats->used_size;
+          info->used_entries += stats->used_entries;
+          info->lock_waits += stats->lock_waits;
+          info->lock_wait_time += stats->lock_wait_time;
+        }
+
+      APR_ARRAY_PUSH(result, svn_cache__info_t *) = info;
+    }
+
+  return result;
+}
+
+apr_array_header_t *
+svn_cache__membuffer_get_global_category_info(apr_pool_t *pool)
+{
+  return svn_cache__membuffer_get_category_info(
+           svn_cache__get_existing_global_membuffer_cache(), pool);
+}
@@ -22,6 +22,7 @@
  */
 
 #include "cache.h"
+#include "private/svn_string_private.h"
 
 svn_error_t *
 svn_cache__set_error_handler(svn_cache__t *cache,
@@ -258,6 +259,26 @@ svn_cache__format_info(const svn_cache__info_t *info,
                  / (double)(info->total_entries ? info->total_entries : 1);
 
   const char *histogram = "";
+  const char *partition = "";
+  if (!access_only && info->partition)
+    {
+      if (info->partition_quota)
+        partition = apr_psprintf(result_pool,
+                                 "quota   : %" APR_UINT64_T_FMT " MB"
+                                 " of %" APR_UINT64_T_FMT " MB (%s)"
+                                 " used by partition %s\n",
+                                 info->partition_used / _1MB,
+                                 info->partition_quota / _1MB,
+                                 info->partition_hard_quota ? "hard" : "soft",
+                                 info->partition);
+      else
+        partition = apr_psprintf(result_pool,
+                                 "quota   : %" APR_UINT64_T_FMT " MB"
+                                 " (unlimited) used by partition %s\n",
+                                 info->partition_used / _1MB,
+                                 info->partition);
+    }
+
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -296,11 +317,14 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "evicted : %" APR_UINT64_T_FMT " entries\n"
+                            "waits   : %" APR_UINT64_T_FMT " lock waits, %"
+                            APR_UINT64_T_FMT " ms total\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
                             "          %" APR_UINT64_T_FMT " entries (%5.2f%%)"
-                            " of %" APR_UINT64_T_FMT " total\n%s",
+                            " of %" APR_UINT64_T_FMT " total\n%s%s",
 
                             info->id,
 
@@ -308,6 +332,8 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->hits, hit_rate,
                             info->sets, write_rate,
                             info->failures,
+                            info->evictions,
+                            info->lock_waits, info->lock_wait_time / 1000,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
@@ -315,5 +341,127 @@ svn_cache__format_info(const svn_cache__info_t *info,
 
                             info->used_entries, data_entry_rate,
                             info->total_entries,
+                            partition,
                             histogram);
 }
+
+/* Metrics reported by svn_cache__format_metrics().  The order must match
+ * get_metric().
+ */
+static const struct
+{
+  const char *name;
+  const char *type;
+  const char *help;
+} metrics[] =
+  {
+    { "svn_cache_gets_total", "counter", "Number of cache lookups." },
+    { "svn_cache_hits_total", "counter", "Number of successful lookups." },
+    { "svn_cache_misses_total", "counter", "Number of failed lookups." },
+    { "svn_cache_sets_total", "counter", "Number of items written." },
+    { "svn_cache_evictions_total", "counter",
+      "Number of items removed to make room for others." },
+    { "svn_cache_lock_waits_total", "counter",
+      "Number of accesses that had to wait for a cache lock." },
+    { "svn_cache_lock_wait_microseconds_total", "counter",
+      "Time spent waiting for cache locks." },
+    { "svn_cache_used_bytes", "gauge", "Size of the cached items." },
+    { "svn_cache_used_entries", "gauge", "Number of cached items." }
+  };
+
+/* Return the value of the metric with index METRIC in INFO.
+ */
+static apr_uint64_t
+get_metric(const svn_cache__info_t *info,
+           int metric)
+{
+  switch (metric)
+    {
+      case 0: return info->gets;
+      case 1: return info->hits;
+      case 2: return info->gets > info->hits ? info->gets - info->hits : 0;
+      case 3: return info->sets;
+      case 4: return info->evictions;
+      case 5: return info->lock_waits;
+      case 6: return info->lock_wait_time;
+      case 7: return info->used_size;
+      default: return info->used_entries;
+    }
+}
+
+/* Append NAME to TEXT as a metrics label value, i.e. escape backslashes,
+ * double quotes and line feeds.
+ */
+static void
+append_label_value(svn_stringbuf_t *text,
+                   const char *name)
+{
+  for (; *name; ++name)
+    {
+      if (*name == '\\' || *name == '"')
+        svn_stringbuf_appendbyte(text, '\\');
+
+      if (*name == '\n')
+        svn_stringbuf_appendcstr(text, "\\n");
+      else
+        svn_stringbuf_appendbyte(text, *name);
+    }
+}
+
+svn_string_t *
+svn_cache__format_metrics(const svn_cache__info_t *info,
+                          const apr_array_header_t *categories,
+                          apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
+  int metric;
+  int i;
+
+  for (metric = 0; metric < (int)(sizeof(metrics) / sizeof(metrics[0]));
+       ++metric)
+    {
+      svn_stringbuf_appendcstr(text,
+                               apr_psprintf(result_pool,
+                                            "# HELP %s %s\n"
+                                            "# TYPE %s %s\n"
+                                            "%s %" APR_UINT64_T_FMT "\n",
+                                            metrics[metric].name,
+                                            metrics[metric].help,
+                                            metrics[metric].name,
+                                            metrics[metric].type,
+                                            metrics[metric].name,
+                                            get_metric(info, metric)));
+
+      for (i = 0; categories && i < categories->nelts; ++i)
+        {
+          const svn_cache__info_t *category
+            = APR_ARRAY_IDX(categories, i, const svn_cache__info_t *);
+
+          svn_stringbuf_appendcstr(text, metrics[metric].name);
+          svn_stringbuf_appendcstr(text, "{category=\"");
+          append_label_value(text, category->id);
+          svn_stringbuf_appendcstr(text,
+                                   apr_psprintf(result_pool,
+                                                "\"} %" APR_UINT64_T_FMT "\n",
+                                                get_metric(category, metric)));
+        }
+    }
+
+  /* Capacity is only known for the cache as a whole. */
+  svn_stringbuf_appendcstr(text,
+                           apr_psprintf(result_pool,
+                                        "# HELP svn_cache_data_bytes"
+                                        " Memory available for cached items.\n"
+                                        "# TYPE svn_cache_data_bytes gauge\n"
+                                        "svn_cache_data_bytes %"
+                                        APR_UINT64_T_FMT "\n"
+                                        "# HELP svn_cache_total_entries"
+                                        " Maximum number of cached items.\n"
+                                        "# TYPE svn_cache_total_entries gauge\n"
+                                        "svn_cache_total_entries %"
+                                        APR_UINT64_T_FMT "\n",
+                                        info->data_size,
+                                        info->total_entries));
+
+  return svn_stringbuf__morph_into_string(text);
+}
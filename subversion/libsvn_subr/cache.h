@@ -112,6 +112,62 @@ struct svn_cache__t {
 };
 
 
+/* On-disk cache tier used by the membuffer cache to keep items that it
+ * had to evict.  All functions are thread-safe. */
+typedef struct svn_cache__disk_t svn_cache__disk_t;
+
+/* Open the on-disk cache tier at PATH and return it in *DISK_P.  Create
+ * the file if it does not exist.  The file will not grow beyond SIZE
+ * bytes.  Entries from previous runs remain available as long as the
+ * file format matches.  The file gets created with owner-only permissions
+ * and is locked exclusively until RESULT_POOL gets cleaned up; fail if
+ * another process holds that lock.  Allocate the result in RESULT_POOL and
+ * use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_cache__disk_open(svn_cache__disk_t **disk_p,
+                     const char *path,
+                     apr_uint64_t size,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Store DATA_LEN bytes of serialized item DATA in DISK under the key
+ * identified by FINGERPRINT, the key PREFIX string and the KEY_LEN bytes
+ * of KEY.  This only queues the item in memory and never waits for I/O.
+ * Items that are too large for DISK or that don't fit into the queue
+ * anymore will silently be ignored.
+ */
+svn_error_t *
+svn_cache__disk_put(svn_cache__disk_t *disk,
+                    const apr_uint64_t fingerprint[2],
+                    const char *prefix,
+                    const void *key,
+                    apr_size_t key_len,
+                    const void *data,
+                    apr_size_t data_len);
+
+/* Write all items queued by svn_cache__disk_put() to the file of DISK.
+ * Return immediately if another thread is already doing that.
+ */
+svn_error_t *
+svn_cache__disk_flush(svn_cache__disk_t *disk);
+
+/* Look up the item for FINGERPRINT, PREFIX and the KEY_LEN bytes of KEY
+ * in DISK.  If found and intact, return a copy of its serialized data
+ * allocated in RESULT_POOL in *DATA and its length in *DATA_LEN.
+ * Otherwise, set *DATA to NULL.
+ */
+svn_error_t *
+svn_cache__disk_get(void **data,
+                    apr_size_t *data_len,
+                    svn_cache__disk_t *disk,
+                    const apr_uint64_t fingerprint[2],
+                    const char *prefix,
+                    const void *key,
+                    apr_size_t key_len,
+                    apr_pool_t *result_pool);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
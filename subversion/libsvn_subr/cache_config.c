@@ -26,8 +26,11 @@
 #include "private/svn_atomic.h"
 #include "private/svn_cache.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -64,6 +67,22 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* If not NULL, initialize_cache() will put the global membuffer cache
+ * into the shared memory segment of that name.
+ */
+static const char *shared_cache_path = NULL;
+
+/* The process-global (singleton) membuffer cache, its initialization
+ * state and whether it lives in shared memory.
+ */
+static svn_membuffer_t *global_cache = NULL;
+static svn_atomic_t global_cache_initialized = 0;
+static svn_boolean_t global_cache_is_shared = FALSE;
+
+/* Admission policy to use for the global membuffer cache.
+ */
+static svn_boolean_t use_tinylfu = FALSE;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +139,28 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      if (shared_cache_path)
+        err = svn_cache__membuffer_cache_create_shared(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            FALSE,
+            shared_cache_path,
+            pool);
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
+
+      /* The TinyLFU sketch shall live as long as the cache itself. */
+      if (!err && use_tinylfu && !shared_cache_path)
+        err = svn_cache__membuffer_set_tinylfu(cache, TRUE, pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -145,6 +178,7 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 
       /* done */
       *cache_p = cache;
+      global_cache_is_shared = shared_cache_path != NULL;
     }
 
   return SVN_NO_ERROR;
@@ -158,11 +192,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void)
 {
-  static svn_membuffer_t *cache = NULL;
-  static svn_atomic_t initialized = 0;
-
   svn_error_t *err
-    = svn_atomic__init_once(&initialized, initialize_cache, &cache, NULL);
+    = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                            &global_cache, NULL);
   if (err)
     {
       /* no caches today ... */
@@ -170,7 +202,40 @@ svn_cache__get_global_membuffer_cache(void)
       return NULL;
     }
 
-  return cache;
+  return global_cache;
+}
+
+svn_membuffer_t *
+svn_cache__get_existing_global_membuffer_cache(void)
+{
+  /* GLOBAL_CACHE only gets set once the cache is fully initialized. */
+  return global_cache;
+}
+
+svn_error_t *
+svn_cache__create_shared_global_membuffer_cache(const char *path)
+{
+  svn_error_t *err;
+
+  if (use_tinylfu)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("Can't use TinyLFU admission for a cache in "
+                              "shared memory"));
+
+  /* PATH only needs to be valid during the initialization. */
+  shared_cache_path = path;
+  err = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                              &global_cache, NULL);
+  shared_cache_path = NULL;
+  SVN_ERR(err);
+
+  /* Someone else may have been faster and created a private cache. */
+  if (global_cache && !global_cache_is_shared)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("The in-memory cache has already been "
+                              "created and can't be shared anymore"));
+
+  return SVN_NO_ERROR;
 }
 
 void
@@ -179,3 +244,63 @@ svn_cache_config_set(const svn_cache_config_t *settings)
   cache_settings = *settings;
 }
 
+svn_error_t *
+svn_cache__config_set_tinylfu(svn_boolean_t enable)
+{
+  /* Don't trigger the creation of the global cache.  Like the cache
+   * itself, a sketch allocated here lives until the process ends. */
+  if (global_cache)
+    SVN_ERR(svn_cache__membuffer_set_tinylfu(global_cache, enable,
+                                             svn_pool_create(NULL)));
+
+  use_tinylfu = enable;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__create_global_disk_cache(const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *cache = svn_cache__get_global_membuffer_cache();
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  /* Nothing to put in front of the disk. */
+  if (!cache)
+    return SVN_NO_ERROR;
+
+  /* Like the global cache itself, the tier lives until the process ends.
+   * It serializes all access to its own root pool. */
+  pool = svn_pool_create(NULL);
+  err = svn_cache__membuffer_set_disk_cache(cache, path, size, pool,
+                                            scratch_pool);
+  if (err)
+    svn_pool_destroy(pool);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_cache__save_global_keys(const char *path,
+                            apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream;
+  const char *tmp_path;
+
+  /* Don't trigger the creation of the global cache. */
+  if (!global_cache)
+    return SVN_NO_ERROR;
+
+  /* Readers shall never see a partially written snapshot. */
+  SVN_ERR(svn_stream_open_unique(&stream, &tmp_path,
+                                 svn_dirent_dirname(path, scratch_pool),
+                                 svn_io_file_del_none,
+                                 scratch_pool, scratch_pool));
+  SVN_ERR(svn_cache__membuffer_save_keys(stream, global_cache,
+                                         scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  return svn_error_trace(svn_io_file_rename2(tmp_path, path, FALSE,
+                                             scratch_pool));
+}
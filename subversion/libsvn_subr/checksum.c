@@ -27,15 +27,20 @@
 
 #include <apr_md5.h>
 #include <apr_sha1.h>
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
 
 #include "svn_checksum.h"
 #include "svn_error.h"
 #include "svn_ctype.h"
+#include "svn_pools.h"
 #include "svn_sorts.h"
 
 #include "checksum.h"
 #include "fnv1a.h"
 
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 
 #include "svn_private_config.h"
@@ -718,6 +723,277 @@ svn_checksum_is_empty_checksum(svn_checksum_t *checksum)
     }
 }
 
+/* Single-pass calculation of multiple checksums.
+ */
+
+/* Number of bytes that svn_checksum__multi_update() feeds to each digest
+ * in turn.  Small enough to still be in the L1 cache when the next digest
+ * reads them. */
+#define MULTI_BLOCK_SIZE 0x2000
+
+/* Updates smaller than this are not worth the synchronization overhead
+ * of handing parts of the work to a helper thread. */
+#define MULTI_THREAD_THRESHOLD 0x10000
+
+/* Maximum number of checksum kinds in a svn_checksum__multi_ctx_t. */
+#define MULTI_MAX_KINDS 4
+
+struct svn_checksum__multi_ctx_t
+{
+  /* One context per checksum kind, COUNT in total. */
+  svn_checksum_ctx_t *contexts[MULTI_MAX_KINDS];
+  int count;
+
+  /* Hand work off to a helper thread for large updates. */
+  svn_boolean_t use_thread;
+
+#if APR_HAS_THREADS
+  /* Synchronization with the helper thread.  Created on first use. */
+  svn_mutex__t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Data passed to the helper thread and its result.  DONE gets set
+   * once the helper does not access this context anymore. */
+  const char *job_data;
+  apr_size_t job_len;
+  svn_error_t *job_result;
+  volatile svn_atomic_t done;
+#endif
+
+  /* Pool that the context has been allocated in. */
+  apr_pool_t *pool;
+};
+
+/* Update the checksums in CTX->CONTEXTS[FIRST] up to but not including
+ * CTX->CONTEXTS[LAST] with the LEN bytes in DATA.  Process one block of
+ * data for all of them before moving on to the next one. */
+static svn_error_t *
+multi_update_range(svn_checksum__multi_ctx_t *ctx,
+                   int first,
+                   int last,
+                   const char *data,
+                   apr_size_t len)
+{
+  while (len)
+    {
+      apr_size_t block = MIN(len, MULTI_BLOCK_SIZE);
+      int i;
+
+      for (i = first; i < last; ++i)
+        SVN_ERR(svn_checksum_update(ctx->contexts[i], data, block));
+
+      data += block;
+      len -= block;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Number of microseconds that the updating thread waits for the helper's
+ * notification before checking the job status again by itself. */
+#define HELPER_WAIT_TIMEOUT 10000
+
+/* Thread-pool task:  Update all but the first checksum of the
+ * svn_checksum__multi_ctx_t given by DATA with its job data. */
+static void * APR_THREAD_FUNC
+multi_update_task(apr_thread_t *tid,
+                  void *data)
+{
+  svn_checksum__multi_ctx_t *ctx = data;
+  svn_error_t *err;
+
+  ctx->job_result = multi_update_range(ctx, 1, ctx->count, ctx->job_data,
+                                       ctx->job_len);
+
+  /* Set the flag even if we can't notify the updating thread.  It will
+   * then pick it up after HELPER_WAIT_TIMEOUT. */
+  err = svn_mutex__lock(ctx->mutex);
+  if (err)
+    {
+      svn_error_clear(err);
+      svn_atomic_set(&ctx->done, TRUE);
+      return NULL;
+    }
+
+  /* Set the flag under the mutex, so the updating thread can't miss the
+   * notification. */
+  svn_atomic_set(&ctx->done, TRUE);
+  apr_thread_cond_broadcast(ctx->cond);
+  svn_error_clear(svn_mutex__unlock(ctx->mutex, SVN_NO_ERROR));
+
+  return NULL;
+}
+
+/* Wait for the helper thread to finish the job in CTX.  This never returns
+ * before that, not even if synchronization fails, because the helper
+ * still uses CTX and the caller's data. */
+static void
+wait_for_helper(svn_checksum__multi_ctx_t *ctx)
+{
+  svn_error_t *err;
+
+  while (!svn_atomic_read(&ctx->done))
+    {
+      err = svn_mutex__lock(ctx->mutex);
+      if (err)
+        {
+          svn_error_clear(err);
+          apr_sleep(HELPER_WAIT_TIMEOUT);
+          continue;
+        }
+
+      /* Time out and re-check the flag such that a lost notification
+       * cannot block us forever.  Spurious wake-ups are harmless. */
+      if (!svn_atomic_read(&ctx->done))
+        apr_thread_cond_timedwait(ctx->cond, svn_mutex__get(ctx->mutex),
+                                  HELPER_WAIT_TIMEOUT);
+
+      svn_error_clear(svn_mutex__unlock(ctx->mutex, SVN_NO_ERROR));
+    }
+
+  /* The helper may not have released the mutex yet.  Make sure it is done
+   * with it before our caller gets a chance to destroy CTX. */
+  err = svn_mutex__lock(ctx->mutex);
+  if (!err)
+    err = svn_mutex__unlock(ctx->mutex, SVN_NO_ERROR);
+
+  svn_error_clear(err);
+}
+
+/* Return TRUE if THREAD_POOL would start a new task right away, i.e. no
+ * other tasks are waiting and there is an idle thread or room for a new
+ * one.  This is only a hint because other threads may push tasks at the
+ * same time. */
+static svn_boolean_t
+has_free_thread(apr_thread_pool_t *thread_pool)
+{
+  return apr_thread_pool_tasks_count(thread_pool) == 0
+      && (   apr_thread_pool_idle_count(thread_pool) > 0
+          || apr_thread_pool_threads_count(thread_pool)
+               < apr_thread_pool_thread_max_get(thread_pool));
+}
+
+/* Update all checksums in CTX with the LEN bytes in DATA, calculating the
+ * first one in this thread and the others on a helper thread.  Set
+ * *HANDLED to FALSE if no helper thread is available.  If another thread
+ * takes the last free one in the meantime, our task gets queued and we
+ * simply wait for it. */
+static svn_error_t *
+multi_update_threaded(svn_boolean_t *handled,
+                      svn_checksum__multi_ctx_t *ctx,
+                      const char *data,
+                      apr_size_t len)
+{
+  apr_thread_pool_t *thread_pool;
+  svn_error_t *err;
+  apr_status_t status;
+
+  *handled = FALSE;
+
+  /* Don't wait for other tasks to finish.  Doing everything ourselves
+   * is faster than that. */
+  SVN_ERR(svn_thread_pool__get(&thread_pool));
+  if (!thread_pool || !has_free_thread(thread_pool))
+    return SVN_NO_ERROR;
+
+  if (!ctx->mutex)
+    {
+      SVN_ERR(svn_mutex__init(&ctx->mutex, TRUE, ctx->pool));
+      status = apr_thread_cond_create(&ctx->cond, ctx->pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create condition variable"));
+    }
+
+  ctx->job_data = data;
+  ctx->job_len = len;
+  ctx->job_result = SVN_NO_ERROR;
+  svn_atomic_set(&ctx->done, FALSE);
+
+  status = apr_thread_pool_push(thread_pool, multi_update_task, ctx, 0,
+                                ctx);
+  if (status)
+    return SVN_NO_ERROR;
+
+  /* DATA must remain valid until the helper is done with it, so always
+   * wait for it, even if our part failed. */
+  *handled = TRUE;
+  err = multi_update_range(ctx, 0, 1, data, len);
+  wait_for_helper(ctx);
+
+  return svn_error_trace(svn_error_compose_create(err, ctx->job_result));
+}
+
+#endif
+
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(const svn_checksum_kind_t *kinds,
+                               int count,
+                               svn_boolean_t use_thread,
+                               apr_pool_t *result_pool)
+{
+  svn_checksum__multi_ctx_t *ctx = apr_pcalloc(result_pool, sizeof(*ctx));
+  int i;
+
+  SVN_ERR_ASSERT_NO_RETURN(count >= 0 && count <= MULTI_MAX_KINDS);
+
+  for (i = 0; i < count; ++i)
+    ctx->contexts[i] = svn_checksum_ctx_create(kinds[i], result_pool);
+
+  ctx->count = count;
+  ctx->use_thread = use_thread;
+  ctx->pool = result_pool;
+
+  return ctx;
+}
+
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx)
+{
+  int i;
+
+  for (i = 0; i < ctx->count; ++i)
+    SVN_ERR(svn_checksum_ctx_reset(ctx->contexts[i]));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len)
+{
+#if APR_HAS_THREADS
+  if (ctx->use_thread && ctx->count > 1 && len >= MULTI_THREAD_THRESHOLD)
+    {
+      svn_boolean_t handled;
+      SVN_ERR(multi_update_threaded(&handled, ctx, data, len));
+      if (handled)
+        return SVN_NO_ERROR;
+    }
+#endif
+
+  return svn_error_trace(multi_update_range(ctx, 0, ctx->count, data, len));
+}
+
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          svn_checksum_kind_t kind,
+                          apr_pool_t *result_pool)
+{
+  int i;
+
+  for (i = 0; i < ctx->count; ++i)
+    if (ctx->contexts[i]->kind == kind)
+      return svn_error_trace(svn_checksum_final(checksum, ctx->contexts[i],
+                                                result_pool));
+
+  return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL, NULL);
+}
+
 /* Checksum calculating stream wrappers.
  */
 
@@ -854,3 +1130,87 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
 
   return result;
 }
+
+/* Baton used by md5_sha1_write_handler and md5_sha1_close_handler. */
+typedef struct md5_sha1_stream_baton_t
+{
+  /* Stream we are wrapping. Forward write() and close() operations to it. */
+  svn_stream_t *inner_stream;
+
+  /* Build the checksums in here. */
+  svn_checksum__multi_ctx_t *context;
+
+  /* Write the final checksums here.  Either may be NULL. */
+  svn_checksum_t **md5_checksum;
+  svn_checksum_t **sha1_checksum;
+
+  /* Allocate the resulting checksums here. */
+  apr_pool_t *pool;
+} md5_sha1_stream_baton_t;
+
+/* Implement svn_write_fn_t.
+ * Update checksums and pass data on to inner stream.
+ */
+static svn_error_t *
+md5_sha1_write_handler(void *baton,
+                       const char *data,
+                       apr_size_t *len)
+{
+  md5_sha1_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__multi_update(b->context, data, *len));
+  SVN_ERR(svn_stream_write(b->inner_stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_close_fn_t.
+ * Finalize checksum calculation and write results. Close inner stream.
+ */
+static svn_error_t *
+md5_sha1_close_handler(void *baton)
+{
+  md5_sha1_stream_baton_t *b = baton;
+
+  if (b->md5_checksum)
+    SVN_ERR(svn_checksum__multi_final(b->md5_checksum, b->context,
+                                      svn_checksum_md5, b->pool));
+  if (b->sha1_checksum)
+    SVN_ERR(svn_checksum__multi_final(b->sha1_checksum, b->context,
+                                      svn_checksum_sha1, b->pool));
+
+  /* Done here.  Now, close the underlying stream as well. */
+  return svn_error_trace(svn_stream_close(b->inner_stream));
+}
+
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         svn_boolean_t use_thread,
+                                         apr_pool_t *pool)
+{
+  svn_checksum_kind_t kinds[2];
+  int count = 0;
+  svn_stream_t *outer_stream;
+  md5_sha1_stream_baton_t *baton;
+
+  if (md5_checksum)
+    kinds[count++] = svn_checksum_md5;
+  if (sha1_checksum)
+    kinds[count++] = svn_checksum_sha1;
+
+  baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->inner_stream = inner_stream;
+  baton->context = svn_checksum__multi_ctx_create(kinds, count, use_thread,
+                                                  pool);
+  baton->md5_checksum = md5_checksum;
+  baton->sha1_checksum = sha1_checksum;
+  baton->pool = pool;
+
+  outer_stream = svn_stream_create(baton, pool);
+  svn_stream_set_write(outer_stream, md5_sha1_write_handler);
+  svn_stream_set_close(outer_stream, md5_sha1_close_handler);
+
+  return outer_stream;
+}
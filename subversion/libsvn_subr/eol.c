@@ -29,10 +29,175 @@
 #include "svn_io.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_simd.h"
+
+#if SVN__SIMD_AVX2
+
+/* AVX2 implementation of the vectorizable part of svn_eol__find_chars().
+ * Scan BUF in chunks of 32 bytes for any of C1, C2 and C3 and return the
+ * offset of the first match.  If there is none, return the offset of the
+ * last LEN % 32 bytes, which have not been scanned. */
+static SVN__SIMD_TARGET_AVX2 apr_size_t
+find_chars_avx2(const char *buf,
+                apr_size_t len,
+                char c1,
+                char c2,
+                char c3)
+{
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
+  apr_size_t pos;
+
+  for (pos = 0; len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      __m256i chunk = _mm256_loadu_si256((const __m256i *)(buf + pos));
+      __m256i found = _mm256_or_si256(
+                          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1),
+                                          _mm256_cmpeq_epi8(chunk, v2)),
+                          _mm256_cmpeq_epi8(chunk, v3));
+      apr_uint32_t mask = (apr_uint32_t)_mm256_movemask_epi8(found);
+
+      if (mask)
+        return pos + SVN_SIMD__LOWEST_BIT(mask);
+    }
+
+  return pos;
+}
+
+#endif
+
+#if SVN__SIMD_SSE2
+
+/* SSE2 implementation of the vectorizable part of svn_eol__find_chars().
+ * Scan BUF in chunks of 16 bytes for any of C1, C2 and C3 and return the
+ * offset of the first match.  If there is none, return the offset of the
+ * last LEN % 16 bytes, which have not been scanned. */
+static apr_size_t
+find_chars_sse2(const char *buf,
+                apr_size_t len,
+                char c1,
+                char c2,
+                char c3)
+{
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  const __m128i v3 = _mm_set1_epi8(c3);
+  apr_size_t pos;
+
+  for (pos = 0; len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(buf + pos));
+      __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+                                                _mm_cmpeq_epi8(chunk, v2)),
+                                   _mm_cmpeq_epi8(chunk, v3));
+      apr_uint32_t mask = (apr_uint32_t)_mm_movemask_epi8(found);
+
+      if (mask)
+        return pos + SVN_SIMD__LOWEST_BIT(mask);
+    }
+
+  return pos;
+}
+
+#endif
+
+#if SVN__SIMD_NEON
+
+/* NEON implementation of the vectorizable part of svn_eol__find_chars().
+ * Scan BUF in chunks of 16 bytes for any of C1, C2 and C3 and return the
+ * offset of the first chunk that contains a match.  The caller has to
+ * find the exact position within that chunk. */
+static apr_size_t
+find_chars_neon(const char *buf,
+                apr_size_t len,
+                char c1,
+                char c2,
+                char c3)
+{
+  const uint8x16_t v1 = vdupq_n_u8((uint8_t)c1);
+  const uint8x16_t v2 = vdupq_n_u8((uint8_t)c2);
+  const uint8x16_t v3 = vdupq_n_u8((uint8_t)c3);
+  apr_size_t pos;
+
+  for (pos = 0; len - pos >= sizeof(uint8x16_t); pos += sizeof(uint8x16_t))
+    {
+      uint8x16_t chunk = vld1q_u8((const uint8_t *)(buf + pos));
+      uint8x16_t found = vorrq_u8(vorrq_u8(vceqq_u8(chunk, v1),
+                                           vceqq_u8(chunk, v2)),
+                                  vceqq_u8(chunk, v3));
+      if (vmaxvq_u8(found))
+        break;
+    }
+
+  return pos;
+}
+
+#endif
+
+/* Return the number of bytes at the start of the LEN bytes in BUF that
+ * the vector code could verify not to contain any of C1, C2 and C3.
+ * This is 0 if the vector code cannot be used. */
+static apr_size_t
+skip_other_chars(const char *buf,
+                 apr_size_t len,
+                 char c1,
+                 char c2,
+                 char c3)
+{
+  apr_size_t pos = 0;
+
+#if SVN__SIMD_SSE2 || SVN__SIMD_NEON
+
+  if (len >= 16)
+    {
+      apr_uint32_t features = svn_simd__get_features();
+
+#if SVN__SIMD_AVX2
+      if (features & SVN_SIMD__AVX2)
+        pos = find_chars_avx2(buf, len, c1, c2, c3);
+      else
+#endif
+#if SVN__SIMD_SSE2
+      if (features & SVN_SIMD__SSE2)
+        pos = find_chars_sse2(buf, len, c1, c2, c3);
+#endif
+#if SVN__SIMD_NEON
+      if (features & SVN_SIMD__NEON)
+        pos = find_chars_neon(buf, len, c1, c2, c3);
+#endif
+    }
+
+#endif
+
+  return pos;
+}
+
+char *
+svn_eol__find_chars(char *buf,
+                    apr_size_t len,
+                    char c1,
+                    char c2,
+                    char c3)
+{
+  apr_size_t pos = skip_other_chars(buf, len, c1, c2, c3);
+
+  for (; pos < len; ++pos)
+    if (buf[pos] == c1 || buf[pos] == c2 || buf[pos] == c3)
+      return buf + pos;
+
+  return NULL;
+}
 
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len)
 {
+  /* Long runs without line endings can be skipped quickly using vector
+   * instructions.  The remainder gets processed as before. */
+  apr_size_t skipped = skip_other_chars(buf, len, '\r', '\n', '\n');
+  buf += skipped;
+  len -= skipped;
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
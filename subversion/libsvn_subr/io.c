@@ -69,6 +69,27 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_dep_compat.h"
 
+/* HAVE_LINUX_FS_H is defined in svn_private_config.h. */
+#ifdef HAVE_LINUX_FS_H
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#endif
+
+/* Read directories with readdir() and take the node kinds from the
+   directory entries themselves.  Only stat() entries relative to the
+   open directory and only if we need more than the node kind.  APR
+   can't do that as it always stats the full path.  The HAVE_* macros
+   are defined in svn_private_config.h. */
+#if !defined(WIN32) && defined(HAVE_DIRFD) && defined(HAVE_FSTATAT) \
+    && defined(HAVE_STRUCT_DIRENT_D_TYPE) && defined(HAVE_STRUCT_STAT_ST_MTIM)
+#define SVN__DIRENTS_USE_D_TYPE
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 #define SVN_SLEEP_ENV_VAR "SVN_I_LOVE_CORRUPTED_WORKING_COPIES_SO_DISABLE_SLEEP_FOR_TIMESTAMPS"
 
 /*
@@ -829,20 +850,180 @@ svn_io_temp_dir(const char **dir,
 
 /*** Creating, copying and appending files. ***/
 
-/* Transfer the contents of FROM_FILE to TO_FILE, using POOL for temporary
- * allocations.
+#if (defined(HAVE_LINUX_FS_H) && defined(FICLONE)) \
+    || defined(HAVE_COPY_FILE_RANGE)
+#define SVN_IO__KERNEL_COPY
+#endif
+
+#ifdef SVN_IO__KERNEL_COPY
+
+/* Maximum number of bytes to request per copy_file_range() call. */
+#define COPY_FILE_RANGE_CHUNK 0x40000000
+
+/* Like COPY_FILE_RANGE_CHUNK but used if we have to check for cancellation
+ * in between calls. */
+#define COPY_FILE_RANGE_CANCEL_CHUNK 0x1000000
+
+#endif /* SVN_IO__KERNEL_COPY */
+
+/* Return an error wrapping APR_ERR, a failure to copy from FROM_FILE to
+ * TO_FILE.  Use POOL for temporary allocations. */
+static svn_error_t *
+copy_contents_error(apr_status_t apr_err,
+                    apr_file_t *from_file,
+                    apr_file_t *to_file,
+                    apr_pool_t *pool)
+{
+  const char *from_name, *to_name;
+
+  SVN_ERR(svn_io_file_name_get(&from_name, from_file, pool));
+  SVN_ERR(svn_io_file_name_get(&to_name, to_file, pool));
+
+  return svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
+                            svn_dirent_local_style(from_name, pool),
+                            svn_dirent_local_style(to_name, pool));
+}
+
+#ifdef SVN_IO__KERNEL_COPY
+
+/* Try to let the kernel transfer the contents of FROM_FILE, starting at
+ * its current position, to TO_FILE at its current position.  If the file
+ * systems support it, clone the extents of FROM_FILE instead of copying
+ * the data.  Set *DONE if all data has been transferred.
  *
- * NOTE: We don't use apr_copy_file() for this, since it takes filenames
+ * Both files must be unbuffered, unless TO_FILE_IS_NEW is set.  In that
+ * case, TO_FILE has just been created and the caller will only close it
+ * afterwards, i.e. its (empty) APR buffer may be bypassed.
+ *
+ * Otherwise, the positions of both files reflect how much data has been
+ * copied so far and the caller shall continue with a read / write loop.
+ * This is the case for buffered APR files, for platforms, kernels and file
+ * systems that don't support in-kernel copies, and for copies across
+ * file systems that cannot be done in kernel space.
+ *
+ * If CANCEL_FUNC is not NULL, call it with CANCEL_BATON between chunks.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_contents_in_kernel(svn_boolean_t *done,
+                        apr_file_t *from_file,
+                        apr_file_t *to_file,
+                        svn_boolean_t to_file_is_new,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *pool)
+{
+  apr_os_file_t from_fd, to_fd;
+
+  *done = FALSE;
+
+  /* APR's buffers would get out of sync with the file positions. */
+  if (   apr_file_buffer_size_get(from_file)
+      || (apr_file_buffer_size_get(to_file) && !to_file_is_new))
+    return SVN_NO_ERROR;
+
+  if (   apr_os_file_get(&from_fd, from_file)
+      || apr_os_file_get(&to_fd, to_file))
+    return SVN_NO_ERROR;
+
+#if defined(HAVE_LINUX_FS_H) && defined(FICLONE)
+  /* A whole-file clone only makes sense if we would copy the whole file
+   * into an empty one.  FICLONE replaces the target's contents. */
+  {
+    struct stat to_info;
+
+    if (   lseek(from_fd, 0, SEEK_CUR) == 0
+        && lseek(to_fd, 0, SEEK_CUR) == 0
+        && fstat(to_fd, &to_info) == 0
+        && to_info.st_size == 0
+        && ioctl(to_fd, FICLONE, from_fd) == 0)
+      {
+        /* Leave both files at their end, just like the read / write loop
+         * would. */
+        if (lseek(from_fd, 0, SEEK_END) < 0 || lseek(to_fd, 0, SEEK_END) < 0)
+          return svn_error_trace(copy_contents_error(apr_get_os_error(),
+                                                     from_file, to_file,
+                                                     pool));
+
+        *done = TRUE;
+        return SVN_NO_ERROR;
+      }
+  }
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+  {
+    svn_boolean_t first = TRUE;
+    size_t chunk = cancel_func ? COPY_FILE_RANGE_CANCEL_CHUNK
+                               : COPY_FILE_RANGE_CHUNK;
+
+    while (TRUE)
+      {
+        ssize_t copied;
+
+        if (cancel_func)
+          SVN_ERR(cancel_func(cancel_baton));
+
+        copied = copy_file_range(from_fd, NULL, to_fd, NULL, chunk, 0);
+        if (copied > 0)
+          {
+            first = FALSE;
+            continue;
+          }
+
+        /* Some pseudo file systems report 0 bytes copied even though
+         * there is data to read.  Let the caller double-check. */
+        if (copied == 0)
+          {
+            *done = !first;
+            break;
+          }
+
+        if (errno == EINTR)
+          continue;
+
+        /* This combination of files is not supported.  The file
+         * positions have been updated for any data copied so far. */
+        if (   errno == EXDEV || errno == EINVAL || errno == ENOSYS
+            || errno == EOPNOTSUPP || errno == EBADF || errno == EPERM
+            || errno == ETXTBSY)
+          break;
+
+        return svn_error_trace(copy_contents_error(apr_get_os_error(),
+                                                   from_file, to_file,
+                                                   pool));
+      }
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* SVN_IO__KERNEL_COPY */
+
+/* NOTE: We don't use apr_copy_file() for this, since it takes filenames
  * as parameters.  Since we want to copy to a temporary file
  * and rename for atomicity (see below), this would require an extra
  * close/open pair, which can be expensive, especially on
  * remote file systems.
  */
-static apr_status_t
-copy_contents(apr_file_t *from_file,
-              apr_file_t *to_file,
-              apr_pool_t *pool)
+svn_error_t *
+svn_io__file_copy_contents(apr_file_t *to_file,
+                           apr_file_t *from_file,
+                           svn_boolean_t to_file_is_new,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
 {
+#ifdef SVN_IO__KERNEL_COPY
+  svn_boolean_t done;
+
+  SVN_ERR(copy_contents_in_kernel(&done, from_file, to_file, to_file_is_new,
+                                  cancel_func, cancel_baton, scratch_pool));
+  if (done)
+    return SVN_NO_ERROR;
+#endif
+
   /* Copy bytes till the cows come home. */
   while (1)
     {
@@ -851,24 +1032,29 @@ copy_contents(apr_file_t *from_file,
       apr_status_t read_err;
       apr_status_t write_err;
 
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
       /* Read 'em. */
       read_err = apr_file_read(from_file, buf, &bytes_this_time);
       if (read_err && !APR_STATUS_IS_EOF(read_err))
         {
-          return read_err;
+          return svn_error_trace(copy_contents_error(read_err, from_file,
+                                                     to_file, scratch_pool));
         }
 
       /* Write 'em. */
       write_err = apr_file_write_full(to_file, buf, bytes_this_time, NULL);
       if (write_err)
         {
-          return write_err;
+          return svn_error_trace(copy_contents_error(write_err, from_file,
+                                                     to_file, scratch_pool));
         }
 
       if (read_err && APR_STATUS_IS_EOF(read_err))
         {
           /* Return the results of this close: an error, or success. */
-          return APR_SUCCESS;
+          return SVN_NO_ERROR;
         }
     }
   /* NOTREACHED */
@@ -882,7 +1068,6 @@ svn_io_copy_file(const char *src,
                  apr_pool_t *pool)
 {
   apr_file_t *from_file, *to_file;
-  apr_status_t apr_err;
   const char *dst_tmp;
   svn_error_t *err;
 
@@ -914,16 +1099,8 @@ svn_io_copy_file(const char *src,
                                    svn_dirent_dirname(dst, pool),
                                    svn_io_file_del_none, pool, pool));
 
-  apr_err = copy_contents(from_file, to_file, pool);
-
-  if (apr_err)
-    {
-      err = svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
-                               svn_dirent_local_style(src, pool),
-                               svn_dirent_local_style(dst_tmp, pool));
-    }
-   else
-     err = NULL;
+  err = svn_io__file_copy_contents(to_file, from_file, TRUE, NULL, NULL,
+                                   pool);
 
   err = svn_error_compose_create(err,
                                  svn_io_file_close(from_file, pool));
@@ -2516,6 +2693,56 @@ svn_error_t *svn_io_file_flush_to_disk(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_io__file_flush_data_to_disk(apr_file_t *file,
+                                apr_pool_t *pool)
+{
+  /* On Darwin, only F_FULLFSYNC actually makes it to the disk. */
+#if defined(HAVE_FDATASYNC) && !defined(F_FULLFSYNC) && !defined(WIN32)
+  apr_os_file_t filehand;
+  const char *fname;
+  apr_status_t apr_err;
+  int rv;
+
+  apr_err = apr_file_name_get(&fname, file);
+  if (apr_err)
+    return svn_error_wrap_apr(apr_err, _("Can't get file name"));
+
+  SVN_ERR(svn_io_file_flush(file, pool));
+
+  apr_os_file_get(&filehand, file);
+  do {
+    rv = fdatasync(filehand);
+  } while (rv == -1 && APR_STATUS_IS_EINTR(apr_get_os_error()));
+
+  /* Same as in svn_io_file_flush_to_disk. */
+  if (rv == -1 && APR_STATUS_IS_EINVAL(apr_get_os_error()))
+    return SVN_NO_ERROR;
+
+  if (rv == -1)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't flush file '%s' to disk"),
+                              try_utf8_from_internal_style(fname, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_trace(svn_io_file_flush_to_disk(file, pool));
+#endif
+}
+
+void
+svn_io__file_start_writeback(apr_file_t *file)
+{
+#ifdef HAVE_SYNC_FILE_RANGE
+  apr_os_file_t filehand;
+  apr_os_file_get(&filehand, file);
+
+  /* This is merely a hint.  Any I/O error will be reported by the
+     actual flush later on. */
+  (void)sync_file_range(filehand, 0, 0, SYNC_FILE_RANGE_WRITE);
+#endif
+}
+
 
 
 /* TODO write test for these two functions, then refactor. */
@@ -2823,6 +3050,184 @@ svn_io_dirent2_dup(const svn_io_dirent2_t *item,
                      sizeof(*item));
 }
 
+#ifdef SVN__DIRENTS_USE_D_TYPE
+
+/* Set *KIND and *IS_SPECIAL for the lstat() result MODE, the same way
+   map_apr_finfo_to_node_kind() would do it. */
+static void
+map_stat_mode_to_node_kind(svn_node_kind_t *kind,
+                           svn_boolean_t *is_special,
+                           mode_t mode)
+{
+  *is_special = FALSE;
+
+  if (S_ISREG(mode))
+    *kind = svn_node_file;
+  else if (S_ISDIR(mode))
+    *kind = svn_node_dir;
+  else if (S_ISLNK(mode))
+    {
+      *is_special = TRUE;
+      *kind = svn_node_file;
+    }
+  else
+    *kind = svn_node_unknown;
+}
+
+/* Add all entries of directory PATH except "." and ".." to DIRENTS,
+   mapping their UTF-8 names to svn_io_dirent2_t allocated in RESULT_POOL.
+
+   Take the node kinds from the directory listing where possible.  Set the
+   FILESIZE and MTIME of entries of kind svn_node_file (i.e. including
+   symlinks) if STAT_FILES is set, and those of all other entries if
+   STAT_OTHERS is set.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_dirents_d_type(apr_hash_t *dirents,
+                    const char *path,
+                    svn_boolean_t stat_files,
+                    svn_boolean_t stat_others,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  const char *path_apr;
+  DIR *dir;
+  int dir_fd;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(cstring_from_utf8(&path_apr, path, scratch_pool));
+
+  /* Like APR, we don't like "" directories */
+  if (path_apr[0] == '\0')
+    path_apr = ".";
+
+  dir = opendir(path_apr);
+  if (dir == NULL)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't open directory '%s'"),
+                              svn_dirent_local_style(path, scratch_pool));
+
+  dir_fd = dirfd(dir);
+
+  while (TRUE)
+    {
+      struct dirent *entry;
+      struct stat info;
+      const char *name;
+      svn_io_dirent2_t *dirent;
+      svn_boolean_t need_stat;
+
+      errno = 0;
+      entry = readdir(dir);
+      if (entry == NULL)
+        {
+          if (errno)
+            err = svn_error_wrap_apr(apr_get_os_error(),
+                                     _("Can't read directory '%s'"),
+                                     svn_dirent_local_style(path,
+                                                            scratch_pool));
+          break;
+        }
+
+      if ((entry->d_name[0] == '.')
+          && ((entry->d_name[1] == '\0')
+              || ((entry->d_name[1] == '.')
+                  && (entry->d_name[2] == '\0'))))
+        continue;
+
+      dirent = svn_io_dirent2_create(result_pool);
+      switch (entry->d_type)
+        {
+          case DT_REG:
+            dirent->kind = svn_node_file;
+            need_stat = stat_files;
+            break;
+
+          case DT_DIR:
+            dirent->kind = svn_node_dir;
+            need_stat = stat_others;
+            break;
+
+          case DT_LNK:
+            dirent->kind = svn_node_file;
+            dirent->special = TRUE;
+            need_stat = stat_files;
+            break;
+
+          case DT_UNKNOWN:
+            /* The filesystem doesn't tell us. */
+            need_stat = TRUE;
+            break;
+
+          default:
+            dirent->kind = svn_node_unknown;
+            need_stat = stat_others;
+            break;
+        }
+
+      if (need_stat)
+        {
+          if (fstatat(dir_fd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW))
+            {
+              /* The entry got removed since we read the directory. */
+              if (APR_STATUS_IS_ENOENT(apr_get_os_error()))
+                continue;
+
+              err = svn_error_wrap_apr(apr_get_os_error(),
+                                       _("Can't read directory '%s'"),
+                                       svn_dirent_local_style(path,
+                                                              scratch_pool));
+              break;
+            }
+
+          map_stat_mode_to_node_kind(&dirent->kind, &dirent->special,
+                                     info.st_mode);
+
+          if (dirent->kind == svn_node_file ? stat_files : stat_others)
+            {
+              /* Same conversion as in APR, so recorded timestamps match. */
+              dirent->filesize = info.st_size;
+              dirent->mtime = apr_time_from_sec(info.st_mtime)
+                            + info.st_mtim.tv_nsec / APR_TIME_C(1000);
+            }
+        }
+
+      err = entry_name_to_utf8(&name, entry->d_name, path, result_pool);
+      if (err)
+        break;
+
+      svn_hash_sets(dirents, name, dirent);
+    }
+
+  if (closedir(dir) && !err)
+    err = svn_error_wrap_apr(apr_get_os_error(),
+                             _("Error closing directory '%s'"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  return svn_error_trace(err);
+}
+
+#endif /* SVN__DIRENTS_USE_D_TYPE */
+
+svn_error_t *
+svn_io__get_dirents(apr_hash_t **dirents,
+                    const char *path,
+                    svn_boolean_t file_stats,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+#ifdef SVN__DIRENTS_USE_D_TYPE
+  *dirents = apr_hash_make(result_pool);
+  return svn_error_trace(read_dirents_d_type(*dirents, path,
+                                             file_stats, FALSE,
+                                             result_pool, scratch_pool));
+#else
+  /* APR stats every entry anyway, so there is no gain in skipping
+     directories. */
+  return svn_error_trace(svn_io_get_dirents3(dirents, path, !file_stats,
+                                             result_pool, scratch_pool));
+#endif
+}
+
 svn_error_t *
 svn_io_get_dirents3(apr_hash_t **dirents,
                     const char *path,
@@ -2830,6 +3235,13 @@ svn_io_get_dirents3(apr_hash_t **dirents,
                     apr_pool_t *result_pool,
                     apr_pool_t *scratch_pool)
 {
+#ifdef SVN__DIRENTS_USE_D_TYPE
+  *dirents = apr_hash_make(result_pool);
+  return svn_error_trace(read_dirents_d_type(*dirents, path,
+                                             !only_check_type,
+                                             !only_check_type,
+                                             result_pool, scratch_pool));
+#else
   apr_status_t status;
   apr_dir_t *this_dir;
   apr_finfo_t this_entry;
@@ -2884,6 +3296,7 @@ svn_io_get_dirents3(apr_hash_t **dirents,
                               svn_dirent_local_style(path, scratch_pool));
 
   return SVN_NO_ERROR;
+#endif /* SVN__DIRENTS_USE_D_TYPE */
 }
 
 svn_error_t *
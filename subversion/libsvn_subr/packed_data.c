@@ -276,6 +276,47 @@ write_packed_uint_body(unsigned char *buffer, apr_uint64_t value)
   return buffer;
 }
 
+/* Write the 7b/8b representations of the COUNT numbers in VALUES into
+ * BUFFER.  BUFFER must provide at least 10 bytes space per number.
+ * Returns the first position behind the written data.
+ */
+static unsigned char *
+write_packed_uints(unsigned char *buffer,
+                   const apr_uint64_t *values,
+                   apr_size_t count)
+{
+  apr_size_t i = 0;
+
+  /* Most numbers in our containers are small.  Check them in groups of 4
+     and copy the whole group without further branching if all of them
+     fit into a single byte. */
+  for (; i + 4 <= count; i += 4)
+    {
+      const apr_uint64_t *v = values + i;
+      if ((v[0] | v[1] | v[2] | v[3]) < 0x80)
+        {
+          buffer[0] = (unsigned char)v[0];
+          buffer[1] = (unsigned char)v[1];
+          buffer[2] = (unsigned char)v[2];
+          buffer[3] = (unsigned char)v[3];
+          buffer += 4;
+        }
+      else
+        {
+          buffer = write_packed_uint_body(buffer, v[0]);
+          buffer = write_packed_uint_body(buffer, v[1]);
+          buffer = write_packed_uint_body(buffer, v[2]);
+          buffer = write_packed_uint_body(buffer, v[3]);
+        }
+    }
+
+  /* the remainder */
+  for (; i < count; ++i)
+    buffer = write_packed_uint_body(buffer, values[i]);
+
+  return buffer;
+}
+
 /* Return remapped VALUE.
  *
  * Due to sign conversion and diff underflow, values close to UINT64_MAX
@@ -362,8 +403,7 @@ data_flush_buffer(svn_packed__int_stream_t *stream)
           = svn_stringbuf_create_ensure(256, private_data->pool);
 
       /* encode numbers into our temp buffer. */
-      for (i = 0; i < stream->buffer_used; ++i)
-        p = write_packed_uint_body(p, stream->buffer[i]);
+      p = write_packed_uints(p, stream->buffer, stream->buffer_used);
 
       /* append them to the final packed data */
       svn_stringbuf_appendbytes(private_data->packed,
@@ -392,6 +432,27 @@ svn_packed__add_int(svn_packed__int_stream_t *stream,
   svn_packed__add_uint(stream, (apr_uint64_t)value);
 }
 
+void
+svn_packed__add_uints(svn_packed__int_stream_t *stream,
+                      const apr_uint64_t *values,
+                      apr_size_t count)
+{
+  while (count)
+    {
+      apr_size_t chunk = MIN(count, SVN__PACKED_DATA_BUFFER_SIZE
+                                    - stream->buffer_used);
+      memcpy(stream->buffer + stream->buffer_used, values,
+             chunk * sizeof(*values));
+
+      stream->buffer_used += chunk;
+      values += chunk;
+      count -= chunk;
+
+      if (stream->buffer_used == SVN__PACKED_DATA_BUFFER_SIZE)
+        data_flush_buffer(stream);
+    }
+}
+
 void
 svn_packed__add_bytes(svn_packed__byte_stream_t *stream,
                       const char *data,
@@ -721,6 +782,53 @@ read_packed_uint_body(unsigned char *p, apr_uint64_t *result)
   return ++p;
 }
 
+/* Read COUNT 7b/8b encoded values from *P and store them in VALUES in
+ * reverse order, i.e. the first value parsed ends up in VALUES[COUNT-1].
+ * Returns the first position after the parsed data.
+ *
+ * Like read_packed_uint_body, this does not check for the end of the
+ * input.  The caller must ensure that reading COUNT values one by one
+ * would not exceed the buffer.
+ */
+static unsigned char *
+read_packed_uints(unsigned char *p, apr_uint64_t *values, apr_size_t count)
+{
+  apr_size_t i = count;
+
+  /* Fast path for runs of single-byte values: test 4 bytes at once.
+     With at least 4 values left to parse, read_packed_uint_body would
+     consume at least 4 bytes as well, so this stays within bounds. */
+  while (i >= 4)
+    {
+      apr_uint32_t word;
+      memcpy(&word, p, sizeof(word));
+
+      if ((word & 0x80808080) == 0)
+        {
+          values[i-1] = p[0];
+          values[i-2] = p[1];
+          values[i-3] = p[2];
+          values[i-4] = p[3];
+
+          p += 4;
+          i -= 4;
+        }
+      else
+        {
+          /* There is a multi-byte value within the next 4 numbers.
+             Parse just one and try again. */
+          --i;
+          p = read_packed_uint_body(p, &values[i]);
+        }
+    }
+
+  /* the remainder */
+  for (; i > 0; --i)
+    p = read_packed_uint_body(p, &values[i-1]);
+
+  return p;
+}
+
 /* Read one 7b/8b encoded value from STREAM and return it in *RESULT.
  *
  * Overflows will be detected in the sense that it will end parsing the
@@ -823,8 +931,7 @@ svn_packed__data_fill_buffer(svn_packed__int_stream_t *stream)
 
       /* unpack numbers */
       start = p;
-      for (i = end; i > 0; --i)
-        p = read_packed_uint_body(p, &stream->buffer[i-1]);
+      p = read_packed_uints(p, stream->buffer, end);
 
       /* adjust remaining packed data buffer */
       packed_read = p - start;
@@ -870,6 +977,38 @@ svn_packed__get_int(svn_packed__int_stream_t *stream)
   return (apr_int64_t)svn_packed__get_uint(stream);
 }
 
+void
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count)
+{
+  while (count)
+    {
+      apr_size_t chunk;
+      apr_size_t i;
+
+      if (stream->buffer_used == 0)
+        {
+          svn_packed__data_fill_buffer(stream);
+
+          /* reading beyond the end of the stream */
+          if (stream->buffer_used == 0)
+            {
+              memset(values, 0, count * sizeof(*values));
+              return;
+            }
+        }
+
+      /* the buffer contents are stored in reverse order */
+      chunk = MIN(count, stream->buffer_used);
+      for (i = 0; i < chunk; ++i)
+        values[i] = stream->buffer[--stream->buffer_used];
+
+      values += chunk;
+      count -= chunk;
+    }
+}
+
 const char *
 svn_packed__get_bytes(svn_packed__byte_stream_t *stream,
                       apr_size_t *len)
@@ -0,0 +1,144 @@
+/* simd.c : runtime detection of vector instruction set support
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "private/svn_simd.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Marker bit in DETECTED_FEATURES telling us that the CPU detection
+ * has already been run. */
+#define FEATURES_DETECTED 0x80000000
+
+/* SVN_SIMD__* flags supported by the compiler and the CPU, plus the
+ * FEATURES_DETECTED marker.  Concurrent initialization is harmless as
+ * all threads will come up with the same value. */
+static volatile apr_uint32_t detected_features = 0;
+
+/* Mask set by svn_simd__set_feature_mask(). */
+static volatile apr_uint32_t feature_mask = SVN_SIMD__ALL;
+
+/* Return TRUE if the CPU and the OS support the AVX2 instructions and
+ * the YMM register state. */
+static svn_boolean_t
+have_avx2(void)
+{
+#if SVN__SIMD_AVX2 && defined(_MSC_VER)
+  int info[4];
+
+  /* OSXSAVE and AVX bits in leaf 1. */
+  __cpuid(info, 1);
+  if ((info[2] & 0x18000000) != 0x18000000)
+    return FALSE;
+
+  /* The OS must preserve the XMM and YMM state. */
+  if ((_xgetbv(0) & 6) != 6)
+    return FALSE;
+
+  /* AVX2 bit in leaf 7. */
+  __cpuidex(info, 7, 0);
+  return (info[1] & 0x20) != 0;
+
+#elif SVN__SIMD_AVX2
+  /* The builtin checks for OS support of the YMM state as well. */
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+
+#else
+  return FALSE;
+#endif
+}
+
+/* Return the SVN_SIMD__* flags supported by the current compiler and CPU.
+ */
+static apr_uint32_t
+detect_features(void)
+{
+  apr_uint32_t features = 0;
+
+#if SVN__SIMD_SSE2
+  features |= SVN_SIMD__SSE2;
+#endif
+#if SVN__SIMD_NEON
+  features |= SVN_SIMD__NEON;
+#endif
+
+  if (have_avx2())
+    features |= SVN_SIMD__AVX2;
+
+  return features;
+}
+
+apr_uint32_t
+svn_simd__get_features(void)
+{
+  apr_uint32_t features = detected_features;
+  if ((features & FEATURES_DETECTED) == 0)
+    {
+      features = detect_features() | FEATURES_DETECTED;
+      detected_features = features;
+    }
+
+  return features & feature_mask;
+}
+
+apr_uint32_t
+svn_simd__set_feature_mask(apr_uint32_t mask)
+{
+  apr_uint32_t old_mask = feature_mask;
+  feature_mask = mask & SVN_SIMD__ALL;
+
+  return old_mask;
+}
+
+unsigned
+svn_simd__lowest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long result;
+  _BitScanForward(&result, value);
+  return (unsigned)result;
+#else
+  unsigned result = 0;
+  for (; (value & 1) == 0; value >>= 1)
+    ++result;
+
+  return result;
+#endif
+}
+
+unsigned
+svn_simd__highest_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long result;
+  _BitScanReverse(&result, value);
+  return (unsigned)result;
+#else
+  unsigned result = 31;
+  for (; (value & 0x80000000) == 0; value <<= 1)
+    --result;
+
+  return result;
+#endif
+}
@@ -22,12 +22,17 @@
  */
 
 #include <apr_file_io.h>
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
 
 #include "svn_io.h"
 #include "svn_pools.h"
 
+#include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 
+#include "svn_private_config.h"
+
 
 struct memblock_t {
   apr_size_t size;
@@ -37,6 +42,20 @@ struct memblock_t {
 };
 
 
+/* A block of spilled content waiting to be written by the background
+   writer. */
+struct pending_t {
+  /* The spill file to append DATA to. */
+  apr_file_t *file;
+
+  /* Content of up to BLOCKSIZE bytes. */
+  apr_size_t size;
+  char *data;
+
+  struct pending_t *next;
+};
+
+
 struct svn_spillbuf_t {
   /* Pool for allocating blocks and the spill file.  */
   apr_pool_t *pool;
@@ -87,6 +106,50 @@ struct svn_spillbuf_t {
 
   /* The name of the temporary spill file. */
   const char *filename;
+
+  /* If not 0, spilled content is queued for a background writer instead
+     of being written to SPILL immediately.  At most this many bytes will
+     be queued.  */
+  apr_size_t max_pending;
+
+#if APR_HAS_THREADS
+  /* Guards all of the write-behind state below, except WRITE_POOL.
+     NULL until the first spill in write-behind mode.  */
+  svn_mutex__t *mutex;
+
+  /* Signaled whenever the writer made progress or finished.  */
+  apr_thread_cond_t *cond;
+
+  /* Serializes the use of the SPILL file position between the writer and
+     readers.  Never acquired while holding MUTEX.  */
+  svn_mutex__t *file_mutex;
+
+  /* FIFO of blocks not yet written, and their total size.  */
+  struct pending_t *pending_head;
+  struct pending_t *pending_tail;
+  apr_size_t pending_size;
+
+  /* Already written blocks, available for re-use.  */
+  struct pending_t *pending_avail;
+
+  /* How much content the writer has written to SPILL.  */
+  apr_off_t spill_written;
+
+  /* Whether a writer task has been scheduled and not finished yet.  */
+  svn_boolean_t writer_active;
+
+  /* Set when the spillbuf is being destroyed.  */
+  svn_boolean_t shutdown;
+
+  /* The first error encountered by the writer.  */
+  svn_error_t *write_error;
+
+  /* Scratch pool owned by the writer.  */
+  apr_pool_t *write_pool;
+
+  /* The shared helper thread pool.  NULL if we write synchronously.  */
+  apr_thread_pool_t *thread_pool;
+#endif
 };
 
 
@@ -155,6 +218,21 @@ svn_spillbuf__create(apr_size_t blocksize,
 }
 
 
+svn_spillbuf_t *
+svn_spillbuf__create_write_behind(apr_size_t blocksize,
+                                  apr_size_t maxsize,
+                                  apr_size_t max_pending,
+                                  apr_pool_t *result_pool)
+{
+  svn_spillbuf_t *buf = apr_pcalloc(result_pool, sizeof(*buf));
+  init_spillbuf(buf, blocksize, maxsize, result_pool);
+
+  /* Queue at least one block. */
+  buf->max_pending = max_pending < blocksize ? blocksize : max_pending;
+  return buf;
+}
+
+
 svn_spillbuf_t *
 svn_spillbuf__create_extended(apr_size_t blocksize,
                               apr_size_t maxsize,
@@ -230,6 +308,332 @@ return_buffer(svn_spillbuf_t *buf,
 }
 
 
+/*** Write-behind support ***/
+
+#if APR_HAS_THREADS
+
+/* Wake up everybody waiting on BUF->COND.  BUF->MUTEX must be held. */
+static svn_error_t *
+signal_progress(svn_spillbuf_t *buf)
+{
+  apr_status_t status = apr_thread_cond_broadcast(buf->cond);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't broadcast condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait for a signal on BUF->COND.  BUF->MUTEX must be held. */
+static svn_error_t *
+wait_for_progress(svn_spillbuf_t *buf)
+{
+  apr_status_t status = apr_thread_cond_wait(buf->cond,
+                                             svn_mutex__get(buf->mutex));
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't wait on condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all blocks queued in BUF to their spill files, in order, then
+   mark the writer as finished.  BUF->MUTEX must be held by the caller.
+   It will be released while writing. */
+static svn_error_t *
+write_pending(svn_spillbuf_t *buf)
+{
+  while (buf->pending_head && !buf->shutdown && !buf->write_error)
+    {
+      struct pending_t *block = buf->pending_head;
+      apr_off_t offset = 0;
+      svn_error_t *err;
+      svn_error_t *lock_err;
+
+      buf->pending_head = block->next;
+      if (buf->pending_head == NULL)
+        buf->pending_tail = NULL;
+
+      SVN_ERR(svn_mutex__unlock(buf->mutex, SVN_NO_ERROR));
+
+      /* Readers may have moved the file pointer. */
+      svn_pool_clear(buf->write_pool);
+      err = svn_mutex__lock(buf->file_mutex);
+      if (!err)
+        {
+          err = svn_io_file_seek(block->file, APR_END, &offset,
+                                 buf->write_pool);
+          if (!err)
+            err = svn_io_file_write_full(block->file, block->data,
+                                         block->size, NULL,
+                                         buf->write_pool);
+
+          err = svn_mutex__unlock(buf->file_mutex, err);
+        }
+
+      lock_err = svn_mutex__lock(buf->mutex);
+      if (lock_err)
+        return svn_error_compose_create(lock_err, err);
+
+      buf->pending_size -= block->size;
+      if (err)
+        buf->write_error = err;
+      else
+        buf->spill_written += block->size;
+
+      block->next = buf->pending_avail;
+      buf->pending_avail = block;
+
+      SVN_ERR(signal_progress(buf));
+    }
+
+  buf->writer_active = FALSE;
+
+  return svn_error_trace(signal_progress(buf));
+}
+
+/* Thread-pool task:  Write the blocks queued in the svn_spillbuf_t given
+ * by DATA. */
+static void * APR_THREAD_FUNC
+write_behind_task(apr_thread_t *tid,
+                  void *data)
+{
+  svn_spillbuf_t *buf = data;
+  svn_error_t *err;
+
+  /* The producer and readers may deadlock if this fails but there is no
+     way to tell them about the problem. */
+  err = svn_mutex__lock(buf->mutex);
+  if (!err)
+    err = svn_mutex__unlock(buf->mutex, write_pending(buf));
+
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+/* Make sure that the blocks queued in BUF will get written.  If no
+   writer thread is available, write them synchronously.  BUF->MUTEX
+   must be held by the caller. */
+static svn_error_t *
+start_writer(svn_spillbuf_t *buf)
+{
+  if (buf->writer_active || buf->pending_head == NULL)
+    return SVN_NO_ERROR;
+
+  buf->writer_active = TRUE;
+  if (buf->thread_pool
+      && !apr_thread_pool_push(buf->thread_pool, write_behind_task, buf, 0,
+                               buf))
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(write_pending(buf));
+}
+
+/* Append the LEN bytes of DATA to the write queue of BUF.  Wait for the
+   writer if the queue is full.  BUF->MUTEX must be held by the caller. */
+static svn_error_t *
+queue_data(svn_spillbuf_t *buf,
+           const char *data,
+           apr_size_t len)
+{
+  while (len > 0)
+    {
+      struct pending_t *block;
+      apr_size_t amt;
+
+      /* Only block the producer if the disk can't keep up. */
+      while (buf->pending_size >= buf->max_pending && !buf->write_error)
+        {
+          SVN_ERR(start_writer(buf));
+          if (buf->writer_active)
+            SVN_ERR(wait_for_progress(buf));
+        }
+
+      if (buf->write_error)
+        return svn_error_dup(buf->write_error);
+
+      /* Blocks still in the queue are not being written, yet.  Thus, we
+         may fill up the last one. */
+      block = buf->pending_tail;
+      if (   block == NULL
+          || block->file != buf->spill
+          || block->size == buf->blocksize)
+        {
+          block = buf->pending_avail;
+          if (block == NULL)
+            {
+              block = apr_palloc(buf->pool, sizeof(*block));
+              block->data = apr_palloc(buf->pool, buf->blocksize);
+            }
+          else
+            {
+              buf->pending_avail = block->next;
+            }
+
+          block->file = buf->spill;
+          block->size = 0;
+          block->next = NULL;
+
+          if (buf->pending_tail == NULL)
+            buf->pending_head = block;
+          else
+            buf->pending_tail->next = block;
+          buf->pending_tail = block;
+        }
+
+      amt = buf->blocksize - block->size;
+      if (amt > len)
+        amt = len;
+
+      memcpy(block->data + block->size, data, amt);
+      block->size += amt;
+      buf->pending_size += amt;
+      data += amt;
+      len -= amt;
+    }
+
+  return svn_error_trace(start_writer(buf));
+}
+
+/* Wait for the writer of BUF to finish.  Drop all content that has not
+   been written, yet.  Must be run as a pre-cleanup hook of BUF->POOL. */
+static apr_status_t
+write_behind_pre_cleanup(void *data)
+{
+  svn_spillbuf_t *buf = data;
+  svn_error_t *err;
+
+  err = svn_mutex__lock(buf->mutex);
+  if (!err)
+    {
+      buf->shutdown = TRUE;
+      while (buf->writer_active && !err)
+        err = wait_for_progress(buf);
+
+      err = svn_mutex__unlock(buf->mutex, err);
+    }
+
+  svn_error_clear(err);
+  svn_error_clear(buf->write_error);
+  svn_pool_destroy(buf->write_pool);
+
+  return APR_SUCCESS;
+}
+
+/* Prepare BUF for queueing spilled content. */
+static svn_error_t *
+init_write_behind(svn_spillbuf_t *buf)
+{
+  apr_status_t status;
+
+  SVN_ERR(svn_thread_pool__get(&buf->thread_pool));
+
+  SVN_ERR(svn_mutex__init(&buf->mutex, TRUE, buf->pool));
+  SVN_ERR(svn_mutex__init(&buf->file_mutex, TRUE, buf->pool));
+  status = apr_thread_cond_create(&buf->cond, buf->pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  /* The writer must not allocate from BUF->POOL. */
+  buf->write_pool = svn_pool_create(NULL);
+  apr_pool_pre_cleanup_register(buf->pool, buf, write_behind_pre_cleanup);
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_THREADS */
+
+/* Return TRUE if BUF hands spilled content to a background writer. */
+static svn_boolean_t
+writes_behind(const svn_spillbuf_t *buf)
+{
+#if APR_HAS_THREADS
+  return buf->mutex != NULL;
+#else
+  return FALSE;
+#endif
+}
+
+/* Append the LEN bytes of DATA to the spill file of BUF, either directly
+   or through the write queue. */
+static svn_error_t *
+spill_data(svn_spillbuf_t *buf,
+           const char *data,
+           apr_size_t len,
+           apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  if (writes_behind(buf))
+    {
+      SVN_ERR(svn_mutex__lock(buf->mutex));
+      return svn_error_trace(svn_mutex__unlock(buf->mutex,
+                                               queue_data(buf, data, len)));
+    }
+#endif
+
+  return svn_error_trace(svn_io_file_write_full(buf->spill, data, len,
+                                                NULL, scratch_pool));
+}
+
+/* Read up to *LEN bytes from the spill file of BUF into DATA, starting at
+   BUF->SPILL_START.  Set *LEN to the number of bytes actually read.  In
+   write-behind mode, wait for the writer to provide the data. */
+static svn_error_t *
+read_spill(char *data,
+           apr_size_t *len,
+           svn_spillbuf_t *buf,
+           apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  if (writes_behind(buf))
+    {
+      apr_off_t end = buf->spill_start + *len;
+      apr_off_t offset = buf->spill_start;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      SVN_ERR(svn_mutex__lock(buf->mutex));
+      while (!err && buf->spill_written < end && buf->writer_active
+             && !buf->write_error)
+        err = wait_for_progress(buf);
+
+      if (!err && buf->write_error)
+        err = svn_error_dup(buf->write_error);
+      SVN_ERR(svn_mutex__unlock(buf->mutex, err));
+
+      /* The writer moves the file pointer as well. */
+      SVN_ERR(svn_mutex__lock(buf->file_mutex));
+      err = svn_io_file_seek(buf->spill, APR_SET, &offset, scratch_pool);
+      if (!err)
+        err = svn_io_file_read(buf->spill, data, len, scratch_pool);
+
+      return svn_error_trace(svn_mutex__unlock(buf->file_mutex, err));
+    }
+#endif
+
+  /* Assume that the caller has seeked the spill file to the correct pos.  */
+  return svn_error_trace(svn_io_file_read(buf->spill, data, len,
+                                          scratch_pool));
+}
+
+/* Forget about the data written to the current spill file of BUF, which
+   is about to be closed. */
+static svn_error_t *
+reset_spill(svn_spillbuf_t *buf)
+{
+#if APR_HAS_THREADS
+  if (writes_behind(buf))
+    {
+      SVN_ERR(svn_mutex__lock(buf->mutex));
+      buf->spill_written = 0;
+      SVN_ERR(svn_mutex__unlock(buf->mutex, SVN_NO_ERROR));
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_spillbuf__write(svn_spillbuf_t *buf,
                     const char *data,
@@ -252,14 +656,18 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
                                         : svn_io_file_del_none),
                                        buf->pool, scratch_pool));
 
+#if APR_HAS_THREADS
+      if (buf->max_pending && !writes_behind(buf))
+        SVN_ERR(init_write_behind(buf));
+#endif
+
       /* Optionally write the memory contents into the file. */
       if (buf->spill_all_contents)
         {
           mem = buf->head;
           while (mem != NULL)
             {
-              SVN_ERR(svn_io_file_write_full(buf->spill, mem->data, mem->size,
-                                             NULL, scratch_pool));
+              SVN_ERR(spill_data(buf, mem->data, mem->size, scratch_pool));
               mem = mem->next;
             }
 
@@ -281,13 +689,14 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
       apr_off_t output_unused = 0;  /* ### stupid API  */
 
       /* Seek to the end of the spill file. We don't know if a read has
-         occurred since our last write, and moved the file position.  */
-      SVN_ERR(svn_io_file_seek(buf->spill,
-                               APR_END, &output_unused,
-                               scratch_pool));
-
-      SVN_ERR(svn_io_file_write_full(buf->spill, data, len,
-                                     NULL, scratch_pool));
+         occurred since our last write, and moved the file position.
+         The background writer takes care of that itself.  */
+      if (!writes_behind(buf))
+        SVN_ERR(svn_io_file_seek(buf->spill,
+                                 APR_END, &output_unused,
+                                 scratch_pool));
+
+      SVN_ERR(spill_data(buf, data, len, scratch_pool));
       buf->spill_size += len;
 
       return SVN_NO_ERROR;
@@ -378,8 +787,6 @@ read_data(struct memblock_t **mem,
       return SVN_NO_ERROR;
     }
 
-  /* Assume that the caller has seeked the spill file to the correct pos.  */
-
   /* Get a buffer that we can read content into.  */
   *mem = get_buffer(buf);
   /* NOTE: mem's size/next are uninitialized.  */
@@ -391,8 +798,7 @@ read_data(struct memblock_t **mem,
   (*mem)->next = NULL;
 
   /* Read some data from the spill file into the memblock.  */
-  err = svn_io_file_read(buf->spill, (*mem)->data, &(*mem)->size,
-                         scratch_pool);
+  err = read_spill((*mem)->data, &(*mem)->size, buf, scratch_pool);
   if (err)
     {
       return_buffer(buf, *mem);
@@ -406,6 +812,7 @@ read_data(struct memblock_t **mem,
   if ((buf->spill_size -= (*mem)->size) == 0)
     {
       /* Close and reset our spill file information.  */
+      SVN_ERR(reset_spill(buf));
       SVN_ERR(svn_io_file_close(buf->spill, scratch_pool));
       buf->spill = NULL;
       buf->spill_start = 0;
@@ -423,7 +830,8 @@ maybe_seek(svn_boolean_t *seeked,
            const svn_spillbuf_t *buf,
            apr_pool_t *scratch_pool)
 {
-  if (buf->head == NULL && buf->spill != NULL)
+  /* In write-behind mode, every read positions the file itself.  */
+  if (buf->head == NULL && buf->spill != NULL && !writes_behind(buf))
     {
       apr_off_t output_unused;
 
@@ -28,6 +28,7 @@
 #include <apr_pools.h>
 #include <apr_strings.h>
 #include <apr_file_io.h>
+#include <apr_mmap.h>
 #include <apr_errno.h>
 #include <apr_poll.h>
 #include <apr_portable.h>
@@ -50,6 +51,18 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_utf_private.h"
 
+/* On Linux, write install streams to an anonymous file (O_TMPFILE) and
+   give it a name only once it is complete.  For new files, this saves
+   the creation and removal of a temporary directory entry. */
+#if !defined(WIN32) && defined(HAVE_LINKAT)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(O_TMPFILE) && defined(AT_SYMLINK_FOLLOW)
+#define SVN__INSTALL_USE_O_TMPFILE
+#endif
+#endif
+
 
 struct svn_stream_t {
   void *baton;
@@ -1125,6 +1138,206 @@ svn_stream__aprfile(svn_stream_t *stream)
   return stream->file;
 }
 
+
+/*** Read-only stream for memory mapped files ***/
+
+/* Windows does not allow deleting a file while a view of it is mapped.
+   Pristines, however, may get removed while a stream is still reading
+   them.  So, use mapped streams on other platforms only. */
+#if APR_HAS_MMAP && !defined(WIN32)
+#define SVN__STREAM_USE_MMAP
+#endif
+
+#ifdef SVN__STREAM_USE_MMAP
+
+struct baton_mmap {
+  apr_file_t *file;
+  apr_mmap_t *mm;
+
+  /* The mapped file contents and their size. */
+  const char *data;
+  apr_size_t len;
+
+  /* Current read position within DATA. */
+  apr_size_t pos;
+
+  apr_pool_t *pool;
+};
+
+/* svn_stream_mark_t for memory mapped files. */
+struct mark_mmap {
+  apr_size_t pos;
+};
+
+static svn_error_t *
+read_handler_mmap(void *baton, char *buffer, apr_size_t *len)
+{
+  struct baton_mmap *btn = baton;
+  apr_size_t left_to_read = btn->len - btn->pos;
+
+  *len = (*len > left_to_read) ? left_to_read : *len;
+  memcpy(buffer, btn->data + btn->pos, *len);
+  btn->pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skip_handler_mmap(void *baton, apr_size_t len)
+{
+  struct baton_mmap *btn = baton;
+  apr_size_t left_to_read = btn->len - btn->pos;
+
+  btn->pos += (len > left_to_read) ? left_to_read : len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+mark_handler_mmap(void *baton, svn_stream_mark_t **mark, apr_pool_t *pool)
+{
+  struct baton_mmap *btn = baton;
+  struct mark_mmap *mark_mmap;
+
+  mark_mmap = apr_palloc(pool, sizeof(*mark_mmap));
+  mark_mmap->pos = btn->pos;
+  *mark = (svn_stream_mark_t *)mark_mmap;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+seek_handler_mmap(void *baton, const svn_stream_mark_t *mark)
+{
+  struct baton_mmap *btn = baton;
+
+  btn->pos = (mark != NULL) ? ((const struct mark_mmap *)mark)->pos : 0;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+data_available_handler_mmap(void *baton, svn_boolean_t *data_available)
+{
+  struct baton_mmap *btn = baton;
+
+  *data_available = btn->pos < btn->len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+readline_handler_mmap(void *baton,
+                      svn_stringbuf_t **stringbuf,
+                      const char *eol,
+                      svn_boolean_t *eof,
+                      apr_pool_t *pool)
+{
+  struct baton_mmap *btn = baton;
+  apr_size_t eol_len = strlen(eol);
+  const char *start = btn->data + btn->pos;
+  const char *end = btn->data + btn->len;
+  const char *eol_pos = NULL;
+  const char *p = start;
+
+  /* The mapping is not NUL-terminated, so we can't use strstr(). */
+  while ((apr_size_t)(end - p) >= eol_len)
+    {
+      p = memchr(p, eol[0], end - p - eol_len + 1);
+      if (p == NULL)
+        break;
+
+      if (memcmp(p, eol, eol_len) == 0)
+        {
+          eol_pos = p;
+          break;
+        }
+
+      ++p;
+    }
+
+  if (eol_pos)
+    {
+      *eof = FALSE;
+      *stringbuf = svn_stringbuf_ncreate(start, eol_pos - start, pool);
+      btn->pos += (eol_pos - start + eol_len);
+    }
+  else
+    {
+      *eof = TRUE;
+      *stringbuf = svn_stringbuf_ncreate(start, end - start, pool);
+      btn->pos = btn->len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+close_handler_mmap(void *baton)
+{
+  struct baton_mmap *btn = baton;
+  apr_status_t status;
+
+  status = apr_mmap_delete(btn->mm);
+  if (status)
+    return svn_error_compose_create(
+             svn_error_wrap_apr(status, _("Can't unmap file")),
+             svn_io_file_close(btn->file, btn->pool));
+
+  return svn_error_trace(svn_io_file_close(btn->file, btn->pool));
+}
+
+#endif /* SVN__STREAM_USE_MMAP */
+
+svn_error_t *
+svn_stream__from_aprfile_mapped(svn_stream_t **stream,
+                                apr_file_t *file,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+#ifdef SVN__STREAM_USE_MMAP
+  apr_finfo_t finfo;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, scratch_pool));
+  if (   finfo.size >= SVN__STREAM_MMAP_THRESHOLD
+      && finfo.size <= APR_SIZE_MAX)
+    {
+      apr_mmap_t *mm;
+
+      /* If mapping fails, e.g. due to address space limitations,
+       * simply fall back to reading the file. */
+      if (apr_mmap_create(&mm, file, 0, (apr_size_t)finfo.size,
+                          APR_MMAP_READ, result_pool) == APR_SUCCESS)
+        {
+          struct baton_mmap *baton = apr_palloc(result_pool, sizeof(*baton));
+
+          baton->file = file;
+          baton->mm = mm;
+          baton->data = mm->mm;
+          baton->len = (apr_size_t)finfo.size;
+          baton->pos = 0;
+          baton->pool = result_pool;
+
+          *stream = svn_stream_create(baton, result_pool);
+          svn_stream_set_read2(*stream, read_handler_mmap, read_handler_mmap);
+          svn_stream_set_skip(*stream, skip_handler_mmap);
+          svn_stream_set_mark(*stream, mark_handler_mmap);
+          svn_stream_set_seek(*stream, seek_handler_mmap);
+          svn_stream_set_data_available(*stream,
+                                        data_available_handler_mmap);
+          svn_stream_set_readline(*stream, readline_handler_mmap);
+          svn_stream_set_close(*stream, close_handler_mmap);
+
+          return SVN_NO_ERROR;
+        }
+    }
+#endif /* SVN__STREAM_USE_MMAP */
+
+  *stream = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Compressed stream support */
 
@@ -2171,9 +2384,202 @@ svn_stream_lazyopen_create(svn_stream_lazyopen_func_t open_func,
 struct install_baton_t
 {
   struct baton_apr baton_apr;
+
+  /* Path of the temporary file.  NULL, if the file is anonymous. */
   const char *tmp_path;
+
+  /* Directory to create temporary files in. */
+  const char *tmp_dir;
 };
 
+#ifdef SVN__INSTALL_USE_O_TMPFILE
+
+/* Linking anonymous files requires the /proc file system.
+   PROC_FD_AVAILABLE is only valid after PROC_FD_CHECKED got set. */
+static svn_atomic_t proc_fd_checked = 0;
+static svn_boolean_t proc_fd_available = FALSE;
+
+/* Implements svn_atomic__init_once's callback.  Set PROC_FD_AVAILABLE. */
+static svn_error_t *
+check_proc_fd(void *baton,
+              apr_pool_t *scratch_pool)
+{
+  proc_fd_available = access("/proc/self/fd", X_OK) == 0;
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function closing the anonymous file given by BATON, for
+   install streams that got neither installed nor deleted. */
+static apr_status_t
+anonymous_tempfile_cleanup(void *baton)
+{
+  return apr_file_close(baton);
+}
+
+/* Try to create an anonymous file in the directory TMP_ABSPATH.  Return
+   it in *FILE, allocated in RESULT_POOL.  If the OS or the file system
+   don't support this, set *FILE to NULL.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+create_anonymous_tempfile(apr_file_t **file,
+                          const char *tmp_abspath,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  const char *dir_apr;
+  apr_os_file_t fd;
+  apr_status_t status;
+  int flags = O_TMPFILE | O_RDWR;
+
+#ifdef O_CLOEXEC
+  flags |= O_CLOEXEC;
+#endif
+
+  *file = NULL;
+
+  SVN_ERR(svn_atomic__init_once(&proc_fd_checked, check_proc_fd, NULL,
+                                scratch_pool));
+  if (!proc_fd_available)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_path_cstring_from_utf8(&dir_apr, tmp_abspath, scratch_pool));
+
+  /* Like for any other file, the umask gets applied to these perms. */
+  do
+    fd = open(dir_apr, flags, 0666);
+  while (fd == -1 && errno == EINTR);
+
+  /* Old kernels and some file systems don't support O_TMPFILE.  Any other
+     problem will be reported when we try to create a named file instead. */
+  if (fd == -1)
+    return SVN_NO_ERROR;
+
+  /* Use buffered mode to match svn_io_open_unique_file3() behavior. */
+  status = apr_os_file_put(file, &fd,
+                           APR_READ | APR_WRITE | APR_BINARY | APR_BUFFERED,
+                           result_pool);
+  if (status)
+    {
+      close(fd);
+      *file = NULL;
+      return svn_error_wrap_apr(status, NULL);
+    }
+
+  apr_pool_cleanup_register(result_pool, *file, anonymous_tempfile_cleanup,
+                            apr_pool_cleanup_null);
+
+  return SVN_NO_ERROR;
+}
+
+/* Close the anonymous file FILE of an install stream.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+close_anonymous_tempfile(apr_file_t *file,
+                         apr_pool_t *scratch_pool)
+{
+  apr_pool_cleanup_kill(apr_file_pool_get(file), file,
+                        anonymous_tempfile_cleanup);
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Give the anonymous FILE the name FINAL_ABSPATH.  This fails if
+   FINAL_ABSPATH already exists.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+link_anonymous_tempfile(apr_file_t *file,
+                        const char *final_abspath,
+                        apr_pool_t *scratch_pool)
+{
+  apr_os_file_t fd;
+  const char *proc_path;
+  const char *final_apr;
+  int rv;
+
+  SVN_ERR(svn_io_file_flush(file, scratch_pool));
+  SVN_ERR(svn_path_cstring_from_utf8(&final_apr, final_abspath,
+                                     scratch_pool));
+
+  apr_os_file_get(&fd, file);
+  proc_path = apr_psprintf(scratch_pool, "/proc/self/fd/%d", fd);
+
+  do
+    rv = linkat(AT_FDCWD, proc_path, AT_FDCWD, final_apr, AT_SYMLINK_FOLLOW);
+  while (rv == -1 && errno == EINTR);
+
+  if (rv == -1)
+    return svn_error_wrap_apr(apr_get_os_error(), _("Can't create '%s'"),
+                              svn_dirent_local_style(final_abspath,
+                                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Give the anonymous file in IB a temporary name in IB->TMP_DIR and set
+   IB->TMP_PATH accordingly.  Use SCRATCH_POOL for temporary allocations.
+
+   This is necessary to replace existing files, which linkat() can't do.
+   If the file system does not support hard links, copy the contents. */
+static svn_error_t *
+name_anonymous_tempfile(struct install_baton_t *ib,
+                        apr_pool_t *scratch_pool)
+{
+  static svn_atomic_t tempname_counter;
+  int baseNr = 13 * svn_atomic_inc(&tempname_counter) + (int)getpid();
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_error_t *err;
+  apr_file_t *named_file;
+  apr_off_t offset = 0;
+  int i;
+
+  for (i = 0; i < 100; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = svn_dirent_join(ib->tmp_dir,
+                             apr_psprintf(iterpool, "svn-%X",
+                                          (unsigned)(baseNr + 7 * i)),
+                             iterpool);
+
+      err = link_anonymous_tempfile(ib->baton_apr.file, path, iterpool);
+      if (!err)
+        {
+          ib->tmp_path = apr_pstrdup(ib->baton_apr.pool, path);
+          svn_pool_destroy(iterpool);
+          return SVN_NO_ERROR;
+        }
+
+      if (!APR_STATUS_IS_EEXIST(err->apr_err))
+        {
+          svn_error_clear(err);
+          break;
+        }
+
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Fall back to copying the data into a named file. */
+  SVN_ERR(svn_io_open_unique_file3(&named_file, &ib->tmp_path, ib->tmp_dir,
+                                   svn_io_file_del_none, ib->baton_apr.pool,
+                                   scratch_pool));
+  SVN_ERR(svn_io_file_seek(ib->baton_apr.file, APR_SET, &offset,
+                           scratch_pool));
+  err = svn_io__file_copy_contents(named_file, ib->baton_apr.file, TRUE,
+                                   NULL, NULL, scratch_pool);
+  err = svn_error_compose_create(err,
+                                 svn_io_file_close(named_file, scratch_pool));
+  if (err)
+    return svn_error_compose_create(err,
+                                    svn_io_remove_file2(ib->tmp_path, TRUE,
+                                                        scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* SVN__INSTALL_USE_O_TMPFILE */
+
 #ifdef WIN32
 
 /* Create and open a tempfile in DIRECTORY. Return its handle and path */
@@ -2297,9 +2703,15 @@ svn_stream__create_for_install(svn_stream_t **install_stream,
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(tmp_abspath));
 
-  SVN_ERR(svn_io_open_unique_file3(&file, &tmp_path, tmp_abspath,
-                                   svn_io_file_del_none,
-                                   result_pool, scratch_pool));
+  tmp_path = NULL;
+#ifdef SVN__INSTALL_USE_O_TMPFILE
+  SVN_ERR(create_anonymous_tempfile(&file, tmp_abspath, result_pool,
+                                    scratch_pool));
+  if (!file)
+#endif
+    SVN_ERR(svn_io_open_unique_file3(&file, &tmp_path, tmp_abspath,
+                                     svn_io_file_del_none,
+                                     result_pool, scratch_pool));
 #endif
   /* Set the temporary file to be truncated on seeks. */
   *install_stream = svn_stream__from_aprfile(file, FALSE, TRUE,
@@ -2313,6 +2725,7 @@ svn_stream__create_for_install(svn_stream_t **install_stream,
   (*install_stream)->baton = ib;
 
   ib->tmp_path = tmp_path;
+  ib->tmp_dir = apr_pstrdup(result_pool, tmp_abspath);
 
   /* Don't close the file on stream close; flush instead */
   svn_stream_set_close(*install_stream, install_close);
@@ -2320,6 +2733,27 @@ svn_stream__create_for_install(svn_stream_t **install_stream,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_stream__install_copy_file(svn_stream_t *install_stream,
+                              const char *src_abspath,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool)
+{
+  struct install_baton_t *ib = install_stream->baton;
+  apr_file_t *src_file;
+  svn_error_t *err;
+
+  /* Unbuffered, so the kernel may do the copying. */
+  SVN_ERR(svn_io_file_open(&src_file, src_abspath, APR_READ,
+                           APR_OS_DEFAULT, scratch_pool));
+  err = svn_io__file_copy_contents(ib->baton_apr.file, src_file, TRUE,
+                                   cancel_func, cancel_baton, scratch_pool);
+
+  return svn_error_compose_create(err,
+                                  svn_io_file_close(src_file, scratch_pool));
+}
+
 svn_error_t *
 svn_stream__install_stream(svn_stream_t *install_stream,
                            const char *final_abspath,
@@ -2369,6 +2803,49 @@ svn_stream__install_stream(svn_stream_t *install_stream,
     }
 #endif
 
+#ifdef SVN__INSTALL_USE_O_TMPFILE
+  if (!ib->tmp_path)
+    {
+      /* The common case of installing a new file takes a single linkat()
+         call.  For anything else, give the file a temporary name and
+         continue as usual. */
+      err = link_anonymous_tempfile(ib->baton_apr.file, final_abspath,
+                                    scratch_pool);
+      if (make_parents && err && APR_STATUS_IS_ENOENT(err->apr_err))
+        {
+          svn_error_t *err2;
+
+          err2 = svn_io_make_dir_recursively(svn_dirent_dirname(final_abspath,
+                                                                scratch_pool),
+                                             scratch_pool);
+          if (err2)
+            return svn_error_trace(svn_error_compose_create(err, err2));
+
+          svn_error_clear(err);
+          err = link_anonymous_tempfile(ib->baton_apr.file, final_abspath,
+                                        scratch_pool);
+        }
+
+      if (!err)
+        return svn_error_trace(close_anonymous_tempfile(ib->baton_apr.file,
+                                                        scratch_pool));
+
+      if (APR_STATUS_IS_ENOENT(err->apr_err))
+        return svn_error_compose_create(err,
+                 close_anonymous_tempfile(ib->baton_apr.file, scratch_pool));
+
+      svn_error_clear(err);
+      err = name_anonymous_tempfile(ib, scratch_pool);
+      if (err)
+        return svn_error_compose_create(err,
+                 close_anonymous_tempfile(ib->baton_apr.file, scratch_pool));
+
+      /* From here on, this is a plain install of a named file. */
+      apr_pool_cleanup_kill(apr_file_pool_get(ib->baton_apr.file),
+                            ib->baton_apr.file, anonymous_tempfile_cleanup);
+    }
+#endif
+
   /* Close temporary file. */
   SVN_ERR(svn_io_file_close(ib->baton_apr.file, scratch_pool));
 
@@ -2439,6 +2916,13 @@ svn_stream__install_delete(svn_stream_t *install_stream,
   svn_error_clear(err);
 #endif
 
+#ifdef SVN__INSTALL_USE_O_TMPFILE
+  /* Anonymous files simply vanish. */
+  if (!ib->tmp_path)
+    return svn_error_trace(close_anonymous_tempfile(ib->baton_apr.file,
+                                                    scratch_pool));
+#endif
+
   SVN_ERR(svn_io_file_close(ib->baton_apr.file, scratch_pool));
 
   return svn_error_trace(svn_io_remove_file2(ib->tmp_path, FALSE,
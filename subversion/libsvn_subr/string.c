@@ -34,6 +34,7 @@
 #include "svn_ctype.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
+#include "private/svn_simd.h"
 
 #include "svn_private_config.h"
 
@@ -1501,6 +1502,150 @@ svn_string__similarity(const svn_string_t *stringa,
     return SVN_STRING__SIM_RANGE_MAX;
 }
 
+#if SVN__SIMD_AVX2
+
+/* AVX2 implementation of the vectorizable part of
+ * svn_cstring__match_length().  Compare A and B in chunks of 32 bytes
+ * and return the number of matching bytes found.  That result may be
+ * less than the actual match length if the mismatch lies within the
+ * last MAX_LEN % 32 bytes. */
+static SVN__SIMD_TARGET_AVX2 apr_size_t
+match_length_avx2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = 0; max_len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      __m256i lhs = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i rhs = _mm256_loadu_si256((const __m256i *)(b + pos));
+      apr_uint32_t equal
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs));
+
+      if (equal != 0xffffffff)
+        return pos + SVN_SIMD__LOWEST_BIT(~equal);
+    }
+
+  return pos;
+}
+
+/* Reverse counterpart to match_length_avx2. */
+static SVN__SIMD_TARGET_AVX2 apr_size_t
+reverse_match_length_avx2(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = sizeof(__m256i); pos <= max_len; pos += sizeof(__m256i))
+    {
+      __m256i lhs = _mm256_loadu_si256((const __m256i *)(a - pos));
+      __m256i rhs = _mm256_loadu_si256((const __m256i *)(b - pos));
+      apr_uint32_t equal
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs));
+
+      if (equal != 0xffffffff)
+        return pos - sizeof(__m256i) + 31 - SVN_SIMD__HIGHEST_BIT(~equal);
+    }
+
+  return pos - sizeof(__m256i);
+}
+
+#endif
+
+#if SVN__SIMD_SSE2
+
+/* SSE2 implementation of the vectorizable part of
+ * svn_cstring__match_length().  Compare A and B in chunks of 16 bytes
+ * and return the number of matching bytes found.  That result may be
+ * less than the actual match length if the mismatch lies within the
+ * last MAX_LEN % 16 bytes. */
+static apr_size_t
+match_length_sse2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = 0; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b + pos));
+      apr_uint32_t equal
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs));
+
+      if (equal != 0xffff)
+        return pos + SVN_SIMD__LOWEST_BIT(~equal);
+    }
+
+  return pos;
+}
+
+/* Reverse counterpart to match_length_sse2. */
+static apr_size_t
+reverse_match_length_sse2(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b - pos));
+      apr_uint32_t equal
+        = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs));
+
+      if (equal != 0xffff)
+        return pos - sizeof(__m128i) + 15
+             - SVN_SIMD__HIGHEST_BIT(~equal & 0xffff);
+    }
+
+  return pos - sizeof(__m128i);
+}
+
+#endif
+
+#if SVN__SIMD_NEON
+
+/* NEON implementation of the vectorizable part of
+ * svn_cstring__match_length().  Compare A and B in chunks of 16 bytes
+ * and return the offset of the first chunk that contains a mismatch.
+ * The caller has to find the exact mismatch position within that chunk. */
+static apr_size_t
+match_length_neon(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = 0; max_len - pos >= sizeof(uint8x16_t); pos += sizeof(uint8x16_t))
+    {
+      uint8x16_t equal = vceqq_u8(vld1q_u8((const uint8_t *)(a + pos)),
+                                  vld1q_u8((const uint8_t *)(b + pos)));
+      if (vminvq_u8(equal) != 0xff)
+        break;
+    }
+
+  return pos;
+}
+
+/* Reverse counterpart to match_length_neon. */
+static apr_size_t
+reverse_match_length_neon(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos;
+  for (pos = sizeof(uint8x16_t); pos <= max_len; pos += sizeof(uint8x16_t))
+    {
+      uint8x16_t equal = vceqq_u8(vld1q_u8((const uint8_t *)(a - pos)),
+                                  vld1q_u8((const uint8_t *)(b - pos)));
+      if (vminvq_u8(equal) != 0xff)
+        break;
+    }
+
+  return pos - sizeof(uint8x16_t);
+}
+
+#endif
+
 apr_size_t
 svn_cstring__match_length(const char *a,
                           const char *b,
@@ -1508,6 +1653,33 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN__SIMD_SSE2 || SVN__SIMD_NEON
+
+  /* Use vector instructions for longer sequences.  If those stopped
+   * short of MAX_LEN, either the remainder is too short for a full
+   * vector or they found a mismatch.  In the latter case, the scalar
+   * code below will stop right away resp. within the current vector. */
+  if (max_len >= 16)
+    {
+      apr_uint32_t features = svn_simd__get_features();
+
+#if SVN__SIMD_AVX2
+      if (features & SVN_SIMD__AVX2)
+        pos = match_length_avx2(a, b, max_len);
+      else
+#endif
+#if SVN__SIMD_SSE2
+      if (features & SVN_SIMD__SSE2)
+        pos = match_length_sse2(a, b, max_len);
+#endif
+#if SVN__SIMD_NEON
+      if (features & SVN_SIMD__NEON)
+        pos = match_length_neon(a, b, max_len);
+#endif
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1536,6 +1708,31 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN__SIMD_SSE2 || SVN__SIMD_NEON
+
+  /* Same as in svn_cstring__match_length.  A mismatch found by the
+   * vector code will terminate the scalar loops below quickly. */
+  if (max_len >= 16)
+    {
+      apr_uint32_t features = svn_simd__get_features();
+
+#if SVN__SIMD_AVX2
+      if (features & SVN_SIMD__AVX2)
+        pos = reverse_match_length_avx2(a, b, max_len);
+      else
+#endif
+#if SVN__SIMD_SSE2
+      if (features & SVN_SIMD__SSE2)
+        pos = reverse_match_length_sse2(a, b, max_len);
+#endif
+#if SVN__SIMD_NEON
+      if (features & SVN_SIMD__NEON)
+        pos = reverse_match_length_neon(a, b, max_len);
+#endif
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1544,7 +1741,7 @@ svn_cstring__reverse_match_length(const char *a,
    * because A and B will probably have different alignment. So, skipping
    * the first few chars until alignment is reached is not an option.
    */
-  for (pos = sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
+  for (pos += sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
     if (*(const apr_size_t*)(a - pos) != *(const apr_size_t*)(b - pos))
       break;
 
@@ -1125,24 +1125,17 @@ translate_chunk(svn_stream_t *dst,
 
               if (b->keywords)
                 {
-                  /* Check 4 bytes at once to allow for efficient pipelining
-                    and to reduce loop condition overhead. */
-                  while ((end - p) >= (len + 4))
-                    {
-                      if (interesting[(unsigned char)p[len]]
-                          || interesting[(unsigned char)p[len+1]]
-                          || interesting[(unsigned char)p[len+2]]
-                          || interesting[(unsigned char)p[len+3]])
-                        break;
-
-                      len += 4;
-                    }
-
-                  /* Found an interesting char or EOF in the next 4 bytes.
-                     Find its exact position. */
-                  while ((p + len) < end
-                         && !interesting[(unsigned char)p[len]])
-                    ++len;
+                  /* Find the next keyword start or EOL, whichever comes
+                     first.  Without EOL translation, only '$' is
+                     interesting. */
+                  const char *start = p + len;
+                  const char *next
+                    = svn_eol__find_chars((char *)start, end - start, '$',
+                                          b->eol_str ? '\r' : '$',
+                                          b->eol_str ? '\n' : '$');
+
+                  /* NEXT will be NULL if there is nothing to translate */
+                  len += (next ? next : end) - start;
                 }
               else
                 {
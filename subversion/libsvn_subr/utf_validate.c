@@ -59,6 +59,7 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_simd.h"
 
 /* Lookup table to categorise each octet in the string. */
 static const char octet_category[256] = {
@@ -276,11 +277,296 @@ first_non_fsm_start_char(const char *data, apr_size_t max_len)
   return data;
 }
 
+#if SVN__SIMD_AVX2
+
+/* Error flags used by valid_prefix_avx2().  Each one marks a specific
+ * kind of invalid pair of consecutive bytes.  The lookup tables below
+ * map the high and low nibble of the first and the high nibble of the
+ * second byte to the set of errors that pair might be part of.  A pair
+ * is invalid if all three lookups agree on at least one error.
+ *
+ * This is the algorithm described in "Validating UTF-8 In Less Than One
+ * Instruction Per Byte" by John Keiser and Daniel Lemire.
+ */
+#define UTF8_TOO_SHORT    0x01  /* lead byte not followed by continuation */
+#define UTF8_TOO_LONG     0x02  /* ASCII followed by continuation */
+#define UTF8_OVERLONG_3   0x04  /* E0 80..9F */
+#define UTF8_TOO_LARGE    0x08  /* F4 90..BF, F5..FF 90..BF */
+#define UTF8_SURROGATE    0x10  /* ED A0..BF */
+#define UTF8_OVERLONG_2   0x20  /* C0..C1 80..BF */
+#define UTF8_TOO_LARGE_80 0x40  /* F5..FF 80..8F */
+#define UTF8_OVERLONG_4   0x40  /* F0 80..8F */
+#define UTF8_TWO_CONTS    0x80  /* continuation followed by continuation */
+#define UTF8_CARRY        (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* Return the table lookup result for the nibbles in INDEXES (0..15) in
+ * the 16 byte TABLE that is being repeated in both lanes. */
+static SVN__SIMD_TARGET_AVX2 APR_INLINE __m256i
+lookup_avx2(__m256i table, __m256i indexes)
+{
+  return _mm256_shuffle_epi8(table, indexes);
+}
+
+/* AVX2 implementation of the vectorizable part of UTF-8 validation.
+ * Starting at the char boundary DATA, validate chunks of 32 bytes until
+ * END or the first chunk containing an error.  Return the position of
+ * the char boundary up to which the data has been found to be valid. */
+static SVN__SIMD_TARGET_AVX2 const char *
+valid_prefix_avx2(const char *data, const char *end)
+{
+  const __m256i byte_1_high = _mm256_setr_epi8(
+    /* 0_______ ________ */
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    /* 10______ ________ */
+    (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS,
+    (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS,
+    /* 1100____ ________ */
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    /* 1101____ ________ */
+    UTF8_TOO_SHORT,
+    /* 1110____ ________ */
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    /* 1111____ ________ */
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80 | UTF8_OVERLONG_4,
+
+    /* Same for the upper lane. */
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS,
+    (char)UTF8_TWO_CONTS, (char)UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80 | UTF8_OVERLONG_4);
+
+  const __m256i byte_1_low = _mm256_setr_epi8(
+    /* ____0000 ________ */
+    (char)(UTF8_CARRY | UTF8_OVERLONG_2 | UTF8_OVERLONG_3 | UTF8_OVERLONG_4),
+    /* ____0001 ________ */
+    (char)(UTF8_CARRY | UTF8_OVERLONG_2),
+    /* ____001_ ________ */
+    (char)(UTF8_CARRY),
+    (char)(UTF8_CARRY),
+    /* ____0100 ________ */
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE),
+    /* ____0101 ________ and above */
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    /* ____1101 ________ */
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80 | UTF8_SURROGATE),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+
+    /* Same for the upper lane. */
+    (char)(UTF8_CARRY | UTF8_OVERLONG_2 | UTF8_OVERLONG_3 | UTF8_OVERLONG_4),
+    (char)(UTF8_CARRY | UTF8_OVERLONG_2),
+    (char)(UTF8_CARRY),
+    (char)(UTF8_CARRY),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80 | UTF8_SURROGATE),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80),
+    (char)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_80));
+
+  const __m256i byte_2_high = _mm256_setr_epi8(
+    /* ________ 0_______ */
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    /* ________ 1000____ */
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_80 | UTF8_OVERLONG_4),
+    /* ________ 1001____ */
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+    /* ________ 101_____ */
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_SURROGATE | UTF8_TOO_LARGE),
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_SURROGATE | UTF8_TOO_LARGE),
+    /* ________ 11______ */
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+
+    /* Same for the upper lane. */
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_80 | UTF8_OVERLONG_4),
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_SURROGATE | UTF8_TOO_LARGE),
+    (char)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS
+           | UTF8_SURROGATE | UTF8_TOO_LARGE),
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i third_byte_min = _mm256_set1_epi8((char)(0xe0 - 0x80));
+  const __m256i fourth_byte_min = _mm256_set1_epi8((char)(0xf0 - 0x80));
+  const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+  const char *start = data;
+
+  /* DATA is at a char boundary, i.e. there is nothing to carry over
+   * from whatever precedes it.  Zeros look like ASCII. */
+  __m256i prev_input = _mm256_setzero_si256();
+
+  for (; end - data >= (apr_ssize_t)sizeof(__m256i);
+       data += sizeof(__m256i))
+    {
+      __m256i input = _mm256_loadu_si256((const __m256i *)data);
+      __m256i shifted, prev1, prev2, prev3, special, must_be_cont;
+
+      /* Plain ASCII can't be invalid by itself but may cut short an
+       * incomplete char at the end of the previous chunk.  That case is
+       * simply left to the scalar code. */
+      if (_mm256_movemask_epi8(input) == 0)
+        {
+          if (   data > start
+              && ((unsigned char)data[-1] >= 0xc0
+                  || (unsigned char)data[-2] >= 0xe0
+                  || (unsigned char)data[-3] >= 0xf0))
+            break;
+
+          prev_input = input;
+          continue;
+        }
+
+      /* The 1, 2 and 3 bytes preceding each byte of INPUT. */
+      shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+      prev1 = _mm256_alignr_epi8(input, shifted, 15);
+      prev2 = _mm256_alignr_epi8(input, shifted, 14);
+      prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+      /* Errors detectable from pairs of consecutive bytes. */
+      special = _mm256_and_si256(
+          _mm256_and_si256(
+              lookup_avx2(byte_1_high,
+                          _mm256_and_si256(_mm256_srli_epi16(prev1, 4),
+                                           nibble_mask)),
+              lookup_avx2(byte_1_low, _mm256_and_si256(prev1, nibble_mask))),
+          lookup_avx2(byte_2_high,
+                      _mm256_and_si256(_mm256_srli_epi16(input, 4),
+                                       nibble_mask)));
+
+      /* Bytes following a 3 or 4 byte lead at distance 2 or 3 must be
+       * continuation bytes.  Those are exactly the places where
+       * UTF8_TWO_CONTS is expected. */
+      must_be_cont = _mm256_and_si256(
+          _mm256_or_si256(_mm256_subs_epu8(prev2, third_byte_min),
+                          _mm256_subs_epu8(prev3, fourth_byte_min)),
+          high_bit);
+
+      special = _mm256_xor_si256(must_be_cont, special);
+      if (!_mm256_testz_si256(special, special))
+        break;
+
+      prev_input = input;
+    }
+
+  /* The last validated chunk may end in the middle of a char. */
+  if (data > start)
+    {
+      if ((unsigned char)data[-1] >= 0xc0)
+        return data - 1;
+      if ((unsigned char)data[-2] >= 0xe0)
+        return data - 2;
+      if ((unsigned char)data[-3] >= 0xf0)
+        return data - 3;
+    }
+
+  return data;
+}
+
+#endif
+
+#if SVN__SIMD_SSE2
+
+/* SSE2 implementation of the ASCII skipping part of
+ * first_non_fsm_start_char().  Return the position of the first non-ASCII
+ * char between DATA and END.  That result may be less than the actual
+ * position if it lies within the last (END - DATA) % 16 bytes. */
+static const char *
+skip_ascii_sse2(const char *data, const char *end)
+{
+  for (; end - data >= (apr_ssize_t)sizeof(__m128i); data += sizeof(__m128i))
+    {
+      apr_uint32_t non_ascii
+        = (apr_uint32_t)_mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i *)data));
+      if (non_ascii)
+        return data + SVN_SIMD__LOWEST_BIT(non_ascii);
+    }
+
+  return data;
+}
+
+#endif
+
+#if SVN__SIMD_NEON
+
+/* NEON implementation of the ASCII skipping part of
+ * first_non_fsm_start_char().  Return the start of the first chunk of
+ * 16 bytes that contains a non-ASCII char.  The caller has to find the
+ * exact position within that chunk. */
+static const char *
+skip_ascii_neon(const char *data, const char *end)
+{
+  for (; end - data >= (apr_ssize_t)sizeof(uint8x16_t);
+       data += sizeof(uint8x16_t))
+    if (vmaxvq_u8(vld1q_u8((const uint8_t *)data)) >= 0x80)
+      break;
+
+  return data;
+}
+
+#endif
+
+/* Return the end of the longest prefix of the string from DATA to END
+ * that the vector code resp. first_non_fsm_start_char() can quickly
+ * verify to consist of complete, valid UTF-8 chars.  The result is a char
+ * boundary.  DATA must be a char boundary as well.  SIMD is the set of
+ * vector instruction set extensions as returned by
+ * svn_simd__get_features().
+ */
+static const char *
+skip_valid_chars(const char *data, const char *end, apr_uint32_t simd)
+{
+#if SVN__SIMD_AVX2
+  if (simd & SVN_SIMD__AVX2)
+    data = valid_prefix_avx2(data, end);
+  else
+#endif
+#if SVN__SIMD_SSE2
+  if (simd & SVN_SIMD__SSE2)
+    data = skip_ascii_sse2(data, end);
+#endif
+#if SVN__SIMD_NEON
+  if (simd & SVN_SIMD__NEON)
+    data = skip_ascii_neon(data, end);
+#endif
+
+  return first_non_fsm_start_char(data, end - data);
+}
+
 const char *
 svn_utf__last_valid(const char *data, apr_size_t len)
 {
-  const char *start = first_non_fsm_start_char(data, len);
   const char *end = data + len;
+  apr_uint32_t simd = svn_simd__get_features();
+  const char *start = skip_valid_chars(data, end, simd);
   int state = FSM_START;
 
   data = start;
@@ -290,7 +576,18 @@ svn_utf__last_valid(const char *data, apr_size_t len)
       int category = octet_category[octet];
       state = machine[state][category];
       if (state == FSM_START)
-        start = data;
+        {
+          start = data;
+
+          /* Back to ASCII after some multi-byte chars? */
+          if (category == 0)
+            data = start = skip_valid_chars(data, end, simd);
+        }
+      else if (state == FSM_ERROR)
+        {
+          /* There is no way out of the error state. */
+          break;
+        }
     }
   return start;
 }
@@ -308,18 +605,26 @@ svn_boolean_t
 svn_utf__is_valid(const char *data, apr_size_t len)
 {
   const char *end = data + len;
+  apr_uint32_t simd;
   int state = FSM_START;
 
   if (!data)
     return FALSE;
 
-  data = first_non_fsm_start_char(data, len);
+  simd = svn_simd__get_features();
+  data = skip_valid_chars(data, end, simd);
 
   while (data < end)
     {
       unsigned char octet = *data++;
       int category = octet_category[octet];
       state = machine[state][category];
+
+      /* Same as in svn_utf__last_valid(). */
+      if (state == FSM_START && category == 0)
+        data = skip_valid_chars(data, end, simd);
+      else if (state == FSM_ERROR)
+        return FALSE;
     }
   return state == FSM_START;
 }
@@ -1045,8 +1045,8 @@ open_txdelta_stream(svn_txdelta_stream_t **txdelta_stream_p,
       SVN_ERR(svn_stream_reset(b->local_stream));
     }
 
-  svn_txdelta2(txdelta_stream_p, b->base_stream, b->local_stream,
-               FALSE, result_pool);
+  svn_txdelta3(txdelta_stream_p, b->base_stream, b->local_stream,
+               FALSE, FALSE, result_pool);
   b->need_reset = TRUE;
   return SVN_NO_ERROR;
 }
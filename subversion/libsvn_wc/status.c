@@ -47,6 +47,7 @@
 #include "wc.h"
 #include "props.h"
 
+#include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
@@ -1247,8 +1248,9 @@ get_dir_status(const struct walk_status_baton *wb,
 
   if (wb->check_working_copy)
     {
-      err = svn_io_get_dirents3(&dirents, local_abspath,
-                                wb->ignore_text_mods /* only_check_type*/,
+      /* We only need sizes and timestamps for the text mod checks. */
+      err = svn_io__get_dirents(&dirents, local_abspath,
+                                !wb->ignore_text_mods /* file_stats */,
                                 scratch_pool, iterpool);
       if (err
           && (APR_STATUS_IS_ENOENT(err->apr_err)
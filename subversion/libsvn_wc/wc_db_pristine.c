@@ -30,6 +30,7 @@
 #include "svn_dirent_uri.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -202,13 +203,15 @@ pristine_read_txn(svn_stream_t **contents,
    * We also don't enable APR_BUFFERED on this file to maximize throughput
    * e.g. for fulltext comparison.  As we use SVN__STREAM_CHUNK_SIZE buffers
    * where needed in streams, there is no point in having another layer of
-   * buffers. */
+   * buffers.  Pristines are never modified in place, so large ones can
+   * safely be memory mapped. */
   if (contents)
     {
       apr_file_t *file;
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
-      *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+      SVN_ERR(svn_stream__from_aprfile_mapped(contents, file, result_pool,
+                                              scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -388,12 +391,13 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
-  if (md5_checksum)
-    *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
-                                      svn_checksum_md5, FALSE, result_pool);
-  if (sha1_checksum)
-    *stream = svn_stream_checksummed2(*stream, NULL, sha1_checksum,
-                                      svn_checksum_sha1, FALSE, result_pool);
+  /* Calculate both checksums in a single pass over the data.  Large
+     writes may hash on a helper thread. */
+  if (md5_checksum || sha1_checksum)
+    *stream = svn_checksum__wrap_write_stream_md5_sha1(md5_checksum,
+                                                       sha1_checksum,
+                                                       *stream, TRUE,
+                                                       result_pool);
 
   return SVN_NO_ERROR;
 }
@@ -464,6 +464,7 @@ run_file_install(work_item_baton_t *wqb,
   svn_boolean_t use_commit_times;
   svn_boolean_t record_fileinfo;
   svn_boolean_t special;
+  svn_boolean_t translate;
   svn_stream_t *src_stream;
   svn_subst_eol_style_t style;
   const char *eol;
@@ -552,9 +553,10 @@ run_file_install(work_item_baton_t *wqb,
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
-                                     FALSE /* special */,
-                                     TRUE /* force_eol_check */))
+  translate = svn_subst_translation_required(style, eol, keywords,
+                                             FALSE /* special */,
+                                             TRUE /* force_eol_check */);
+  if (translate)
     {
       /* Wrap it in a translating (expanding) stream.  */
       src_stream = svn_subst_stream_translated(src_stream, eol,
@@ -575,11 +577,24 @@ run_file_install(work_item_baton_t *wqb,
   SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
-  /* Copy from the source to the dest, translating as we go. This will also
-     close both streams.  */
-  SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                           cancel_func, cancel_baton,
-                           scratch_pool));
+  if (translate)
+    {
+      /* Copy from the source to the dest, translating as we go. This will
+         also close both streams.  */
+      SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
+                               cancel_func, cancel_baton,
+                               scratch_pool));
+    }
+  else
+    {
+      /* The pristine is the working file.  Let the kernel clone or copy
+         it, where supported.  */
+      SVN_ERR(svn_stream_close(src_stream));
+      SVN_ERR(svn_stream__install_copy_file(dst_stream, source_abspath,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool));
+      SVN_ERR(svn_stream_close(dst_stream));
+    }
 
   /* All done. Move the file into place.  */
   /* With a single db we might want to install files in a missing directory.
@@ -425,6 +425,10 @@ const char *dav_svn__get_root_dir(request_rec *r);
 /* Return the data compression level to be used over the wire. */
 int dav_svn__get_compression_level(request_rec *r);
 
+/* Return the maximum number of threads to use for compressing a single
+   svndiff stream sent over the wire. */
+int dav_svn__get_compression_threads(request_rec *r);
+
 /* Return the hook script environment parsed from the configuration. */
 const char *dav_svn__get_hooks_env(request_rec *r);
 
@@ -530,6 +534,10 @@ int dav_svn__method_post(request_rec *r);
 /* Request handler to GET Subversion internal status (FSFS cache). */
 int dav_svn__status(request_rec *r);
 
+/* Request handler to GET the cache statistics in a machine-readable
+   format. */
+int dav_svn__metrics(request_rec *r);
+
 /*** repos.c ***/
 
 /* generate an ETag for RESOURCE and return it, allocated in POOL. */
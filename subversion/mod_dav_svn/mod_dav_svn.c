@@ -26,6 +26,10 @@
 
 #include <apr_strings.h>
 #include <apr_hash.h>
+#include <apr_shm.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#endif
 
 #include <httpd.h>
 #include <http_config.h>
@@ -40,8 +44,12 @@
 #include "svn_utf.h"
 #include "svn_ctype.h"
 #include "svn_dso.h"
+#include "svn_pools.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -67,6 +75,18 @@ typedef struct server_conf_t {
      compression level. */
   int compression_level;
 
+  /* The maximum number of svndiff windows to compress in parallel.
+     0 means "not configured". */
+  int compression_threads;
+
+  /* Name of the shared memory segment to put the in-memory cache into.
+     NULL for process-local caches. */
+  const char *memory_cache_path;
+
+  /* File to read the cache key snapshot from at startup and to write
+     it to when a worker process exits.  NULL if not configured. */
+  const char *cache_snapshot_path;
+
 } server_conf_t;
 
 
@@ -120,6 +140,11 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Flag in anonymous shared memory, inherited by all worker processes.
+   The first worker to set it warms up the shared in-memory cache.  NULL
+   if the shared cache shall not be warmed up. */
+static volatile svn_atomic_t *shared_warm_up_claimed = NULL;
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -150,9 +175,174 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* A shared in-memory cache must exist before Apache forks the worker
+     processes. */
+  if (conf->memory_cache_path)
+    {
+      serr = svn_cache__create_shared_global_membuffer_cache(
+                 conf->memory_cache_path);
+      if (serr)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, p,
+                        "mod_dav_svn: error creating the shared in-memory "
+                        "cache: '%s'",
+                        serr->message ? serr->message : "(no more info)");
+          svn_error_clear(serr);
+          return HTTP_INTERNAL_SERVER_ERROR;
+        }
+
+      /* All workers will share the cache, so only the first of them
+         shall warm it up.  That way, we neither block the server start
+         nor replay the snapshot in every post_config run.  The flag
+         lives in the process pool, i.e. survives restarts just like the
+         shared cache itself. */
+      if (conf->cache_snapshot_path && !shared_warm_up_claimed)
+        {
+          apr_shm_t *shm;
+          apr_status_t status = apr_shm_create(&shm,
+                                               sizeof(*shared_warm_up_claimed),
+                                               NULL, s->process->pool);
+          if (status)
+            ap_log_perror(APLOG_MARK, APLOG_WARNING, status, p,
+                          "mod_dav_svn: can't allocate shared memory; "
+                          "the in-memory cache will not be warmed up");
+          else
+            {
+              shared_warm_up_claimed = apr_shm_baseaddr_get(shm);
+              svn_atomic_set(shared_warm_up_claimed, FALSE);
+            }
+        }
+    }
+
   return OK;
 }
 
+/* Cache warm-up state of a worker process. */
+typedef struct cache_snapshot_baton_t
+{
+  /* The snapshot file to read and write. */
+  const char *path;
+
+  /* Non-zero when the warm-up shall be aborted. */
+  volatile svn_atomic_t cancelled;
+
+#if APR_HAS_THREADS
+  /* The thread replaying the snapshot.  NULL if none. */
+  apr_thread_t *thread;
+#endif
+
+  /* Root pool with its own allocator.  Only THREAD may use it while
+     that is running. */
+  apr_pool_t *pool;
+} cache_snapshot_baton_t;
+
+/* Implements svn_cancel_func_t for a cache_snapshot_baton_t. */
+static svn_error_t *
+check_warm_up_cancelled(void *baton)
+{
+  cache_snapshot_baton_t *b = baton;
+  if (svn_atomic_read(&b->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Thread function replaying the snapshot given by the
+   cache_snapshot_baton_t in DATA. */
+static void * APR_THREAD_FUNC
+warm_caches_thread(apr_thread_t *tid, void *data)
+{
+  cache_snapshot_baton_t *b = data;
+  svn_error_t *serr = svn_fs__warm_caches(b->path, NULL,
+                                          check_warm_up_cancelled, b,
+                                          b->pool);
+  if (serr && serr->apr_err != SVN_ERR_CANCELLED)
+    ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err, NULL,
+                 "mod_dav_svn: error warming up the in-memory cache: '%s'",
+                 serr->message ? serr->message : "(no more info)");
+
+  svn_error_clear(serr);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+#endif
+
+/* Pre-cleanup for the worker process pool.  Stop the warm-up thread of
+   the cache_snapshot_baton_t in DATA and write a new snapshot.  This must
+   run before the pool's sub-pools get destroyed. */
+static apr_status_t
+save_cache_snapshot(void *data)
+{
+  cache_snapshot_baton_t *b = data;
+  svn_error_t *serr;
+
+#if APR_HAS_THREADS
+  if (b->thread)
+    {
+      apr_status_t retval;
+
+      svn_atomic_set(&b->cancelled, TRUE);
+      apr_thread_join(&retval, b->thread);
+      b->thread = NULL;
+    }
+#endif
+
+  svn_pool_clear(b->pool);
+  serr = svn_cache__save_global_keys(b->path, b->pool);
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err, NULL,
+                   "mod_dav_svn: error writing the cache snapshot '%s': '%s'",
+                   b->path,
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(b->pool);
+
+  return APR_SUCCESS;
+}
+
+/* Implements the #child_init hook.  Replay the cache key snapshot in the
+   background, unless the cache is shared and another worker process has
+   already claimed that task.  Write the snapshot when the worker process
+   exits. */
+static void
+child_init(apr_pool_t *pchild, server_rec *s)
+{
+  server_conf_t *conf = ap_get_module_config(s->module_config,
+                                             &dav_svn_module);
+  cache_snapshot_baton_t *b;
+
+  if (!conf->cache_snapshot_path)
+    return;
+
+  b = apr_pcalloc(pchild, sizeof(*b));
+  b->path = conf->cache_snapshot_path;
+  b->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+#if APR_HAS_THREADS
+  if (   !conf->memory_cache_path
+      || (   shared_warm_up_claimed
+          && !svn_atomic_cas(shared_warm_up_claimed, TRUE, FALSE)))
+    {
+      apr_status_t status = apr_thread_create(&b->thread, NULL,
+                                              warm_caches_thread, b,
+                                              pchild);
+      if (status)
+        {
+          ap_log_error(APLOG_MARK, APLOG_WARNING, status, s,
+                       "mod_dav_svn: can't start the cache warm-up thread");
+          b->thread = NULL;
+        }
+    }
+#endif
+
+  apr_pool_pre_cleanup_register(pchild, b, save_cache_snapshot);
+}
+
 static svn_error_t *
 malfunction_handler(svn_boolean_t can_return,
                     const char *file, int line,
@@ -231,6 +421,13 @@ merge_server_config(apr_pool_t *p, void *base, void *overrides)
       newconf->compression_level = child->compression_level;
     }
 
+  newconf->compression_threads = INHERIT_VALUE(parent, child,
+                                               compression_threads);
+  newconf->memory_cache_path = INHERIT_VALUE(parent, child,
+                                             memory_cache_path);
+  newconf->cache_snapshot_path = INHERIT_VALUE(parent, child,
+                                               cache_snapshot_path);
+
   newconf->use_utf8 = INHERIT_VALUE(parent, child, use_utf8);                 
   svn_utf_initialize2(newconf->use_utf8, p); 
 
@@ -627,6 +824,41 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheSharedPath_cmd(cmd_parms *cmd, void *config,
+                               const char *arg1)
+{
+  server_conf_t *conf;
+  const char *path = ap_server_root_relative(cmd->pool, arg1);
+
+  if (path == NULL)
+    return apr_pstrcat(cmd->pool, "Invalid path for the SVN cache: ",
+                       arg1, SVN_VA_NULL);
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->memory_cache_path = path;
+
+  return NULL;
+}
+
+static const char *
+SVNCacheSnapshotPath_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  server_conf_t *conf;
+  const char *path = ap_server_root_relative(cmd->pool, arg1);
+
+  if (path == NULL)
+    return apr_pstrcat(cmd->pool, "Invalid path for the SVN cache snapshot: ",
+                       arg1, SVN_VA_NULL);
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->cache_snapshot_path = path;
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -655,6 +887,31 @@ SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNCompressionThreads_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  server_conf_t *conf;
+  int value = 0;
+  svn_error_t *err = svn_cstring_atoi(&value, arg1);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN compression thread count.";
+    }
+
+  if (value < 1 || value > 16)
+    return apr_psprintf(cmd->pool,
+                        "%d is not a valid compression thread count. "
+                        "The valid range is 1 .. 16.",
+                        value);
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->compression_threads = value;
+
+  return NULL;
+}
+
 static const char *
 SVNUseUTF8_cmd(cmd_parms *cmd, void *config, int arg)
 {
@@ -1048,6 +1305,17 @@ dav_svn__get_compression_level(request_rec *r)
     }
 }
 
+int
+dav_svn__get_compression_threads(request_rec *r)
+{
+  server_conf_t *conf;
+
+  conf = ap_get_module_config(r->server->module_config,
+                              &dav_svn_module);
+
+  return conf->compression_threads ? conf->compression_threads : 1;
+}
+
 const char *
 dav_svn__get_hooks_env(request_rec *r)
 {
@@ -1390,7 +1658,23 @@ static const command_rec cmds[] =
                 RSRC_CONF,
                 "specifies the maximum size in kB per process of Subversion's "
                 "in-memory object cache (default value is 16384; 0 switches "
-                "to dynamically sized caches)."),
+                "to dynamically sized caches).  With "
+                "SVNInMemoryCacheSharedPath, this is the size of the cache "
+                "shared by all processes."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheSharedPath", SVNInMemoryCacheSharedPath_cmd,
+                NULL, RSRC_CONF,
+                "specifies the name of a shared memory segment that holds "
+                "Subversion's in-memory object cache such that all worker "
+                "processes use the same cache (default is a separate cache "
+                "per process)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNCacheSnapshotPath", SVNCacheSnapshotPath_cmd,
+                NULL, RSRC_CONF,
+                "specifies a file that records which items are in "
+                "Subversion's in-memory object cache when a worker process "
+                "exits.  New processes re-read those items such that they "
+                "start with a warm cache (default is no snapshot)."),
   /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
@@ -1398,6 +1682,13 @@ static const command_rec cmds[] =
                 "content over the network (0 for no compression, 9 for "
                 "maximum, 5 is default)."),
 
+  /* per server */
+  AP_INIT_TAKE1("SVNCompressionThreads", SVNCompressionThreads_cmd, NULL,
+                RSRC_CONF,
+                "specifies the maximum number of threads compressing file "
+                "content of a single response before sending it over the "
+                "network (1 .. 16, default is 1)."),
+
   /* per server */
   AP_INIT_FLAG("SVNUseUTF8",
                SVNUseUTF8_cmd, NULL,
@@ -1432,6 +1723,7 @@ register_hooks(apr_pool_t *pconf)
 {
   ap_hook_pre_config(init_dso, NULL, NULL, APR_HOOK_REALLY_FIRST);
   ap_hook_post_config(init, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_hook_child_init(child_init, NULL, NULL, APR_HOOK_MIDDLE);
 
   /* our provider */
   dav_register_provider(pconf, "svn", &provider);
@@ -1448,6 +1740,9 @@ register_hooks(apr_pool_t *pconf)
   /* Handler to GET Subversion's FSFS cache stats, a bit like mod_status. */
   ap_hook_handler(dav_svn__status, NULL, NULL, APR_HOOK_MIDDLE);
 
+  /* Handler to GET the same stats per cache type for monitoring tools. */
+  ap_hook_handler(dav_svn__metrics, NULL, NULL, APR_HOOK_MIDDLE);
+
   /* live property handling */
   dav_hook_gather_propsets(dav_svn__gather_propsets, NULL, NULL,
                            APR_HOOK_MIDDLE);
@@ -40,6 +40,7 @@
 #include "svn_dav.h"
 #include "svn_props.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
 
@@ -92,6 +93,9 @@ typedef struct update_ctx_t {
   /* Compression level of SVNDIFF deltas. */
   int compression_level;
 
+  /* Maximum number of threads compressing a single SVNDIFF stream. */
+  int compression_threads;
+
   /* Did the client submit this REPORT request via the HTTPv2 "me
      resource" and are we advertising support for as much? */
   svn_boolean_t enable_v2_response;
@@ -828,9 +832,11 @@ upd_apply_textdelta(void *file_baton,
                                                      wb->uc->output,
                                                      file->pool);
 
-  svn_txdelta_to_svndiff3(&(wb->handler), &(wb->handler_baton),
-                          base64_stream, file->uc->svndiff_version,
-                          file->uc->compression_level, file->pool);
+  svn_txdelta__to_svndiff_parallel(&(wb->handler), &(wb->handler_baton),
+                                   base64_stream, file->uc->svndiff_version,
+                                   file->uc->compression_level,
+                                   file->uc->compression_threads,
+                                   file->pool);
 
   *handler = window_handler;
   *handler_baton = wb;
@@ -1198,6 +1204,8 @@ dav_svn__update_report(const dav_resource *resource,
 
   uc.svndiff_version = resource->info->svndiff_version;
   uc.compression_level = dav_svn__get_compression_level(resource->info->r);
+  uc.compression_threads
+    = dav_svn__get_compression_threads(resource->info->r);
   uc.resource = resource;
   uc.output = output;
   uc.anchor = src_path;
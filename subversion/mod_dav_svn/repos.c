@@ -53,6 +53,7 @@
 #include "mod_dav_svn.h"
 #include "svn_ra.h"  /* for SVN_RA_CAPABILITY_* */
 #include "svn_dirent_uri.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
@@ -3870,10 +3871,12 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
           svn_stream_set_close(o_stream, close_filter);
 
           /* get a handler/baton for writing into the output stream */
-          svn_txdelta_to_svndiff3(&handler, &h_baton,
-                                  o_stream, resource->info->svndiff_version,
-                                  dav_svn__get_compression_level(resource->info->r),
-                                  resource->pool);
+          svn_txdelta__to_svndiff_parallel(
+              &handler, &h_baton, o_stream,
+              resource->info->svndiff_version,
+              dav_svn__get_compression_level(resource->info->r),
+              dav_svn__get_compression_threads(resource->info->r),
+              resource->pool);
 
           /* got everything set up. read in delta windows and shove them into
              the handler, which pushes data into the output stream, which goes
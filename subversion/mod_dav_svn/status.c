@@ -117,3 +117,34 @@ int dav_svn__status(request_rec *r)
 
   return 0;
 }
+
+/* The machine-readable counterpart to svn-status: add a location
+
+     <Location /svn-metrics>
+       SetHandler svn-metrics
+     </Location>
+
+  and let your monitoring system scrape http://server/svn-metrics.  The
+  response lists the statistics of the membuffer cache as a whole and of
+  each cache type, e.g. "fsfs:DAG", in the Prometheus text format.
+  As with svn-status, the numbers are those of the process that happens
+  to handle the request.
+*/
+int dav_svn__metrics(request_rec *r)
+{
+  svn_cache__info_t *info;
+  apr_array_header_t *categories;
+  svn_string_t *text_stats;
+
+  if (r->method_number != M_GET || strcmp(r->handler, "svn-metrics"))
+    return DECLINED;
+
+  info = svn_cache__membuffer_get_global_info(r->pool);
+  categories = svn_cache__membuffer_get_global_category_info(r->pool);
+  text_stats = svn_cache__format_metrics(info, categories, r->pool);
+
+  ap_set_content_type(r, "text/plain; version=0.0.4; charset=utf-8");
+  ap_rwrite(text_stats->data, (int)text_stats->len, r);
+
+  return 0;
+}
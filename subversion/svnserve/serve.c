@@ -51,6 +51,7 @@
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
@@ -2832,9 +2833,12 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_write(stream, svndiff_handler);
       svn_stream_set_close(stream, svndiff_close_handler);
 
-      svn_txdelta_to_svndiff3(d_handler, d_baton, stream,
-                              svn_ra_svn__svndiff_version(frb->conn),
-                              svn_ra_svn_compression_level(frb->conn), pool);
+      svn_txdelta__to_svndiff_parallel(d_handler, d_baton, stream,
+                                       svn_ra_svn__svndiff_version(frb->conn),
+                                       svn_ra_svn_compression_level(frb->conn),
+                                       svn_ra_svn__compression_threads(
+                                         frb->conn),
+                                       pool);
     }
   else
     SVN_ERR(svn_ra_svn__write_cstring(frb->conn, pool, ""));
@@ -4383,6 +4387,8 @@ serve_interruptable(svn_boolean_t *terminate_p,
                                   connection->params->max_request_size,
                                   connection->params->max_response_size,
                                   connection->pool);
+      svn_ra_svn__set_compression_threads(
+          connection->conn, connection->params->compression_threads);
 
       /* Construct server baton and open the repository for the first time. */
       err = construct_server_baton(&connection->baton, connection->conn,
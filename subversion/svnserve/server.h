@@ -143,6 +143,10 @@ typedef struct serve_params_t {
      Defaults to SVN_DELTA_COMPRESSION_LEVEL_DEFAULT. */
   int compression_level;
 
+  /* Maximum number of svndiff windows to compress concurrently when
+     sending file contents.  Defaults to 1. */
+  int compression_threads;
+
   /* Item size up to which we use the zero-copy code path to transmit
      them over the network.  0 disables that code path. */
   apr_size_t zero_copy_limit;
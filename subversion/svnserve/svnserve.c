@@ -49,13 +49,17 @@
 #include "svn_version.h"
 #include "svn_io.h"
 #include "svn_hash.h"
+#include "svn_time.h"
 
 #include "svn_private_config.h"
 
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
 #include "private/svn_subr_private.h"
 
 #if APR_HAS_THREADS
@@ -155,6 +159,14 @@ enum run_mode {
  */
 #define ACCEPT_BACKLOG 128
 
+/* Maximum time in microseconds that the listener waits in accept() before
+ * it checks for pending cache snapshot or metrics requests.  We can't rely
+ * on the signals to interrupt accept():  apr_signal() asks the OS to
+ * restart system calls and in threaded mode, any thread may receive the
+ * signal.
+ */
+#define ACCEPT_TIMEOUT apr_time_from_sec(1)
+
 /* Default limit to the client request size in MBytes.  This effectively
  * limits the size of a paths and individual property values to about
  * this value.
@@ -222,6 +234,13 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_COMPRESSION_THREADS 277
+#define SVNSERVE_OPT_MEMORY_CACHE_PATH 278
+#define SVNSERVE_OPT_CACHE_SNAPSHOT  279
+#define SVNSERVE_OPT_CACHE_METRICS_INTERVAL 280
+#define SVNSERVE_OPT_DISK_CACHE      281
+#define SVNSERVE_OPT_DISK_CACHE_SIZE 282
+#define SVNSERVE_OPT_CACHE_TINYLFU   283
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -287,6 +306,12 @@ static const apr_getopt_option_t svnserve__options[] =
         "[0 .. no compression, 5 .. default, \n"
         "                             "
         " 9 .. maximum compression]")},
+    {"compression-threads", SVNSERVE_OPT_COMPRESSION_THREADS, 1,
+     N_("maximum number of threads compressing the contents\n"
+        "                             "
+        "of a single file for network transmission.\n"
+        "                             "
+        "Default is 1.")},
     {"memory-cache-size", 'M', 1,
      N_("size of the extra in-memory cache in MB used to\n"
         "                             "
@@ -297,6 +322,64 @@ static const apr_getopt_option_t svnserve__options[] =
         "0 switches to dynamically sized caches.\n"
         "                             "
         "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-path", SVNSERVE_OPT_MEMORY_CACHE_PATH, 1,
+     N_("put the in-memory cache into a shared memory\n"
+        "                             "
+        "segment with the given name, such that all\n"
+        "                             "
+        "connection processes share one cache of the\n"
+        "                             "
+        "size given by --memory-cache-size.\n"
+        "                             "
+        "[daemon mode with one process per connection only]")},
+    {"cache-snapshot", SVNSERVE_OPT_CACHE_SNAPSHOT, 1,
+     N_("re-populate the in-memory cache from the cache\n"
+        "                             "
+        "key snapshot in this file at startup.  Send\n"
+        "                             "
+        "SIGUSR1 to the server to update the snapshot,\n"
+        "                             "
+        "e.g. before stopping it.  Without --memory-\n"
+        "                             "
+        "cache-path, the snapshot only covers what the\n"
+        "                             "
+        "main process itself cached in fork mode.\n"
+        "                             "
+        "[daemon mode only]")},
+    {"cache-metrics-interval", SVNSERVE_OPT_CACHE_METRICS_INTERVAL, 1,
+     N_("write the in-memory cache statistics to the log\n"
+        "                             "
+        "file every ARG seconds.  Send SIGUSR2 to the\n"
+        "                             "
+        "server to write them immediately.  0 disables\n"
+        "                             "
+        "the periodic output.  Without --memory-cache-\n"
+        "                             "
+        "path, this only covers the main process in\n"
+        "                             "
+        "fork mode.\n"
+        "                             "
+        "[daemon mode with --log-file only]")},
+    {"disk-cache", SVNSERVE_OPT_DISK_CACHE, 1,
+     N_("keep large items evicted from the in-memory\n"
+        "                             "
+        "cache in this file, ideally on a local SSD.\n"
+        "                             "
+        "Its contents survive server restarts.\n"
+        "                             "
+        "[daemon mode with --threads only]")},
+    {"disk-cache-size", SVNSERVE_OPT_DISK_CACHE_SIZE, 1,
+     N_("maximum size of the --disk-cache file in MB.\n"
+        "                             "
+        "Default is 1024.")},
+    {"cache-tinylfu", SVNSERVE_OPT_CACHE_TINYLFU, 1,
+     N_("enable or disable keeping the in-memory cache\n"
+        "                             "
+        "contents based on recent lookup frequencies\n"
+        "                             "
+        "(experimental).  Default is no.\n"
+        "                             "
+        "[not supported with --memory-cache-path]")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
         "                             "
@@ -492,6 +575,91 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+/* Cache key snapshot file given by --cache-snapshot.  NULL if none. */
+static const char *cache_snapshot_path = NULL;
+
+#ifdef SIGUSR1
+/* Set when the cache key snapshot shall be written. */
+static volatile sig_atomic_t cache_snapshot_requested = FALSE;
+
+static void sigusr1_handler(int signo)
+{
+  /* Writing the snapshot is not async-signal-safe.  Leave that to the
+     main loop, which checks the flag at least every ACCEPT_TIMEOUT. */
+  cache_snapshot_requested = TRUE;
+}
+#endif
+
+/* Interval in seconds given by --cache-metrics-interval.  0 if the cache
+ * statistics shall not be logged periodically. */
+static unsigned int cache_metrics_interval = 0;
+
+/* When the cache statistics shall be logged next, if the interval is
+ * not 0.  The main loop checks that at least every ACCEPT_TIMEOUT. */
+static apr_time_t next_cache_metrics = 0;
+
+/* Set when the cache statistics shall be written to the log. */
+static volatile sig_atomic_t cache_metrics_requested = FALSE;
+
+#ifdef SIGUSR2
+static void sigusr2_handler(int signo)
+{
+  /* Like SIGUSR1, this is handled by the main loop. */
+  cache_metrics_requested = TRUE;
+}
+#endif
+
+/* Write the statistics of the global cache, per cache type, to the logger
+ * in PARAMS.  The format is the same as that of mod_dav_svn's svn-metrics
+ * handler, preceded by a comment line with a time stamp.  Log any error
+ * instead of returning it.  Use POOL for temporary allocations.
+ */
+static void
+log_cache_metrics(serve_params_t *params,
+                  apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_cache__info_t *info = svn_cache__membuffer_get_global_info(subpool);
+  apr_array_header_t *categories
+    = svn_cache__membuffer_get_global_category_info(subpool);
+  svn_string_t *metrics = svn_cache__format_metrics(info, categories,
+                                                    subpool);
+  const char *header = apr_psprintf(subpool, "# svnserve cache metrics %s\n",
+                                    svn_time_to_cstring(apr_time_now(),
+                                                        subpool));
+  svn_error_t *err = logger__write(params->logger, header, strlen(header));
+  if (!err)
+    err = logger__write(params->logger, metrics->data, metrics->len);
+
+  if (err)
+    {
+      logger__log_error(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(subpool);
+}
+
+/* Write the keys of the global cache to CACHE_SNAPSHOT_PATH.  Log any
+ * error to the logger in PARAMS instead of returning it.  Use POOL for
+ * temporary allocations.
+ */
+static void
+save_cache_snapshot(serve_params_t *params,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_error_t *err = svn_cache__save_global_keys(cache_snapshot_path,
+                                                 subpool);
+  if (err)
+    {
+      logger__log_error(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(subpool);
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -547,6 +715,32 @@ accept_connection(connection_t **connection,
 
       status = apr_socket_accept(&(*connection)->usock, sock,
                                  connection_pool);
+
+      /* The connection must not inherit the accept() timeout. */
+      if (!status)
+        status = apr_socket_timeout_set((*connection)->usock, -1);
+
+#ifdef SIGUSR1
+      if (cache_snapshot_requested)
+        {
+          cache_snapshot_requested = FALSE;
+          save_cache_snapshot(params, connection_pool);
+        }
+#endif
+
+      if (cache_metrics_interval && apr_time_now() >= next_cache_metrics)
+        {
+          next_cache_metrics
+            = apr_time_now() + apr_time_from_sec(cache_metrics_interval);
+          cache_metrics_requested = TRUE;
+        }
+
+      if (cache_metrics_requested)
+        {
+          cache_metrics_requested = FALSE;
+          log_cache_metrics(params, connection_pool);
+        }
+
       if (handling_mode == connection_mode_fork)
         {
           apr_proc_t proc;
@@ -558,6 +752,7 @@ accept_connection(connection_t **connection,
         }
     }
   while (APR_STATUS_IS_EINTR(status)
+    || APR_STATUS_IS_TIMEUP(status)
     || APR_STATUS_IS_ECONNABORTED(status)
     || APR_STATUS_IS_ECONNRESET(status));
 
@@ -656,6 +851,28 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+/* Re-populate the global cache from CACHE_SNAPSHOT_PATH using the
+   serve_params_t given by DATA.  Errors get logged. */
+static void * APR_THREAD_FUNC warm_caches_thread(apr_thread_t *tid,
+                                                 void *data)
+{
+  serve_params_t *params = data;
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  svn_error_t *err = svn_fs__warm_caches(cache_snapshot_path,
+                                         params->fs_config, NULL, NULL,
+                                         pool);
+  if (err)
+    {
+      logger__log_error(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  return NULL;
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -722,6 +939,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   enum connection_handling_mode handling_mode = CONNECTION_DEFAULT;
   svn_boolean_t cache_fulltexts = TRUE;
   svn_boolean_t cache_nodeprops = TRUE;
+  svn_boolean_t cache_tinylfu = FALSE;
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
@@ -739,6 +957,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *memory_cache_path = NULL;
+  const char *disk_cache_path = NULL;
+  apr_uint64_t disk_cache_size = APR_UINT64_C(1024) * 0x100000;
+  svn_boolean_t log_cache_metrics_enabled = FALSE;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -764,6 +986,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.base = NULL;
   params.cfg = NULL;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+  params.compression_threads = 1;
   params.logger = NULL;
   params.config_pool = NULL;
   params.fs_config = NULL;
@@ -900,6 +1123,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
             params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_MAX;
           break;
 
+        case SVNSERVE_OPT_COMPRESSION_THREADS:
+          params.compression_threads = atoi(arg);
+          if (params.compression_threads < 1)
+            params.compression_threads = 1;
+          break;
+
         case 'M':
           {
             apr_uint64_t sz_val;
@@ -909,6 +1138,56 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           }
           break;
 
+        case SVNSERVE_OPT_MEMORY_CACHE_PATH:
+          SVN_ERR(svn_utf_cstring_to_utf8(&memory_cache_path, arg, pool));
+          memory_cache_path = svn_dirent_internal_style(memory_cache_path,
+                                                        pool);
+          SVN_ERR(svn_dirent_get_absolute(&memory_cache_path,
+                                          memory_cache_path, pool));
+          break;
+
+        case SVNSERVE_OPT_DISK_CACHE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&disk_cache_path, arg, pool));
+          disk_cache_path = svn_dirent_internal_style(disk_cache_path, pool);
+          SVN_ERR(svn_dirent_get_absolute(&disk_cache_path, disk_cache_path,
+                                          pool));
+          break;
+
+        case SVNSERVE_OPT_DISK_CACHE_SIZE:
+          {
+            apr_uint64_t sz_val;
+            SVN_ERR(svn_cstring_atoui64(&sz_val, arg));
+            if (sz_val > APR_UINT64_MAX / 0x100000)
+              return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                       _("Invalid disk cache size '%s'"),
+                                       arg);
+
+            disk_cache_size = 0x100000 * sz_val;
+          }
+          break;
+
+        case SVNSERVE_OPT_CACHE_SNAPSHOT:
+          SVN_ERR(svn_utf_cstring_to_utf8(&cache_snapshot_path, arg, pool));
+          cache_snapshot_path = svn_dirent_internal_style(cache_snapshot_path,
+                                                          pool);
+          SVN_ERR(svn_dirent_get_absolute(&cache_snapshot_path,
+                                          cache_snapshot_path, pool));
+          break;
+
+        case SVNSERVE_OPT_CACHE_METRICS_INTERVAL:
+          {
+            apr_uint64_t interval;
+            SVN_ERR(svn_cstring_atoui64(&interval, arg));
+            if (interval > APR_UINT32_MAX)
+              return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                       _("Invalid cache metrics interval "
+                                         "'%s'"), arg);
+
+            cache_metrics_interval = (unsigned int)interval;
+            log_cache_metrics_enabled = TRUE;
+          }
+          break;
+
         case SVNSERVE_OPT_CACHE_TXDELTAS:
           cache_txdeltas = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -925,6 +1204,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_TINYLFU:
+          cache_tinylfu = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -1079,6 +1362,56 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                _("Option --tunnel-user is only valid in tunnel mode"));
     }
 
+  if (memory_cache_path
+      && (   run_mode != run_mode_daemon
+          || handling_mode != connection_mode_fork))
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --memory-cache-path is only valid in daemon mode "
+                 "with one process per connection"));
+    }
+
+  /* The TinyLFU sketch lives in the memory of a single process. */
+  if (memory_cache_path && cache_tinylfu)
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Options --cache-tinylfu and --memory-cache-path "
+                 "are mutually exclusive"));
+    }
+
+  /* The disk cache index lives in the memory of a single process. */
+  if (disk_cache_path
+      && (   run_mode == run_mode_inetd
+          || run_mode == run_mode_tunnel
+          || (   run_mode == run_mode_daemon
+              && handling_mode == connection_mode_fork)))
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --disk-cache is only valid in daemon mode "
+                 "with one thread per connection"));
+    }
+
+  if (cache_snapshot_path
+      && (run_mode == run_mode_inetd || run_mode == run_mode_tunnel))
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --cache-snapshot is only valid in daemon mode"));
+    }
+
+  if (log_cache_metrics_enabled
+      && (run_mode == run_mode_inetd || run_mode == run_mode_tunnel))
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --cache-metrics-interval is only valid in daemon "
+                 "mode"));
+    }
+
+  if (log_cache_metrics_enabled && !log_filename)
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --cache-metrics-interval requires --log-file"));
+    }
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       apr_pool_t *connection_pool;
@@ -1106,6 +1439,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                                      params.max_request_size,
                                      params.max_response_size,
                                      connection_pool);
+      svn_ra_svn__set_compression_threads(conn, params.compression_threads);
       err = serve(conn, &params, connection_pool);
       svn_pool_destroy(connection_pool);
 
@@ -1236,6 +1570,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       return svn_error_wrap_apr(status, _("Can't listen on server socket"));
     }
 
+  /* Let the accept() loop wake up regularly to handle cache snapshot and
+   * metrics requests, even while there are no connections coming in. */
+  if (cache_snapshot_path || log_cache_metrics_enabled)
+    {
+      status = apr_socket_timeout_set(sock, ACCEPT_TIMEOUT);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't set options on server socket"));
+    }
+
 #if APR_HAS_FORK
   if (run_mode != run_mode_listen_once && !foreground)
     /* ### ignoring errors... */
@@ -1256,6 +1600,20 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   apr_signal(SIGXFSZ, SIG_IGN);
 #endif
 
+#ifdef SIGUSR1
+  if (cache_snapshot_path)
+    apr_signal(SIGUSR1, sigusr1_handler);
+#endif
+
+#ifdef SIGUSR2
+  if (log_cache_metrics_enabled)
+    apr_signal(SIGUSR2, sigusr2_handler);
+#endif
+
+  if (cache_metrics_interval)
+    next_cache_metrics
+      = apr_time_now() + apr_time_from_sec(cache_metrics_interval);
+
   if (pid_filename)
     SVN_ERR(write_pid_file(pid_filename, pool));
 
@@ -1297,6 +1655,20 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_set(&settings);
   }
 
+  /* Select the admission policy before the global cache gets created. */
+  SVN_ERR(svn_cache__config_set_tinylfu(cache_tinylfu));
+
+  /* The connection processes can only share a cache that already exists
+   * when we fork them. */
+  if (memory_cache_path)
+    SVN_ERR(svn_cache__create_shared_global_membuffer_cache(
+                svn_dirent_local_style(memory_cache_path, pool)));
+
+  if (disk_cache_path)
+    SVN_ERR(svn_cache__create_global_disk_cache(
+                svn_dirent_local_style(disk_cache_path, pool),
+                disk_cache_size, pool));
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1330,6 +1702,32 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 #endif
 
+  /* Warm up the caches from the last snapshot.  In threaded mode, we can
+   * do that in the background.  Otherwise, finish it before the first
+   * connection process gets forked, so they all start with a warm cache. */
+  if (cache_snapshot_path)
+    {
+#if APR_HAS_THREADS
+      if (threads)
+        {
+          status = apr_thread_pool_push(threads, warm_caches_thread,
+                                        &params, 0, NULL);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't push task"));
+        }
+      else
+#endif
+        {
+          err = svn_fs__warm_caches(cache_snapshot_path, params.fs_config,
+                                    NULL, NULL, pool);
+          if (err)
+            {
+              logger__log_error(params.logger, err, NULL, NULL);
+              svn_error_clear(err);
+            }
+        }
+    }
+
   while (1)
     {
       connection_t *connection = NULL;
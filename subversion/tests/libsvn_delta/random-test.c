@@ -37,6 +37,9 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_simd.h"
+
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -334,10 +337,10 @@ do_random_test(apr_pool_t *pool,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
-      svn_txdelta2(&txdelta_stream,
+      svn_txdelta3(&txdelta_stream,
                    svn_stream_from_aprfile(source, delta_pool),
                    svn_stream_from_aprfile(target, delta_pool),
-                   FALSE,
+                   FALSE, FALSE,
                    delta_pool);
 
       SVN_ERR(svn_txdelta_send_txstream(txdelta_stream,
@@ -431,16 +434,16 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 1: create the text deltas.  */
 
-      svn_txdelta2(&txdelta_stream_A,
+      svn_txdelta3(&txdelta_stream_A,
                    svn_stream_from_aprfile(source, delta_pool),
                    svn_stream_from_aprfile(middle, delta_pool),
-                   FALSE,
+                   FALSE, FALSE,
                    delta_pool);
 
-      svn_txdelta2(&txdelta_stream_B,
+      svn_txdelta3(&txdelta_stream_B,
                    svn_stream_from_aprfile(middle_copy, delta_pool),
                    svn_stream_from_aprfile(target, delta_pool),
-                   FALSE,
+                   FALSE, FALSE,
                    delta_pool);
 
       {
@@ -565,10 +568,10 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
 
       /* Create a txdelta stream that turns the source into target;
          turn it into a generic readable svn_stream_t. */
-      svn_txdelta2(&txstream,
+      svn_txdelta3(&txstream,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
-                   FALSE, iterpool);
+                   FALSE, FALSE, iterpool);
       delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
                                                    iterpool);
 
@@ -605,6 +608,549 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Set *SVNDIFF to the svndiff representation of the delta between SOURCE
+   and TARGET, using the given SVNDIFF_VERSION and COMPRESSION_LEVEL.
+   Allocate the result in POOL. */
+static svn_error_t *
+svndiff_from_files(svn_stringbuf_t **svndiff,
+                   apr_file_t *source,
+                   apr_file_t *target,
+                   int svndiff_version,
+                   int compression_level,
+                   apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  rewind_file(source);
+  rewind_file(target);
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          svndiff_version, compression_level, pool);
+  svn_txdelta3(&txdelta_stream,
+               svn_stream_from_aprfile2(source, TRUE, pool),
+               svn_stream_from_aprfile2(target, TRUE, pool),
+               FALSE, FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(txdelta_stream,
+                                                   handler, handler_baton,
+                                                   pool));
+}
+
+/* (Note: *LAST_SEED is an output parameter.) */
+static svn_error_t *
+do_random_simd_test(apr_pool_t *pool,
+                    apr_uint32_t *last_seed)
+{
+  apr_uint32_t seed, maxlen;
+  apr_size_t bytes_range;
+  int i, iterations, dump_files, print_windows;
+  const char *random_bytes;
+  apr_pool_t *iterpool;
+
+  /* Initialize parameters and print out the seed in case we dump core
+     or something. */
+  init_params(&seed, &maxlen, &iterations, &dump_files, &print_windows,
+              &random_bytes, &bytes_range, pool);
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < iterations; i++)
+    {
+      apr_uint32_t subseed_base;
+      apr_file_t *source;
+      apr_file_t *target;
+      svn_stringbuf_t *scalar_svndiff;
+      svn_stringbuf_t *simd_svndiff;
+      apr_uint32_t old_mask;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      /* Generate source and target for the delta. */
+      *last_seed = seed;
+      subseed_base = svn_test_rand(&seed);
+      source = generate_random_file(maxlen, subseed_base, &seed,
+                                    random_bytes, bytes_range,
+                                    dump_files, iterpool);
+      target = generate_random_file(maxlen, subseed_base, &seed,
+                                    random_bytes, bytes_range,
+                                    dump_files, iterpool);
+
+      /* Deltify once using the scalar code only and once using whatever
+         vector code the CPU supports. */
+      old_mask = svn_simd__set_feature_mask(0);
+      err = svndiff_from_files(&scalar_svndiff, source, target, i % 3,
+                               i % 10, iterpool);
+      svn_simd__set_feature_mask(old_mask);
+      SVN_ERR(err);
+
+      SVN_ERR(svndiff_from_files(&simd_svndiff, source, target, i % 3,
+                                 i % 10, iterpool));
+
+      /* Both must produce the very same svndiff data. */
+      if (!svn_stringbuf_compare(scalar_svndiff, simd_svndiff))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "svndiff mismatch between scalar and SIMD"
+                                 " (features 0x%x)",
+                                 (unsigned)svn_simd__get_features());
+
+      apr_file_close(source);
+      apr_file_close(target);
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_simd_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_simd_test(pool, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+/* Fill BUF with LEN pseudo-random bytes based on *SEED.  Use the high
+   bits; the low byte of svn_test_rand() repeats every 256 calls. */
+static void
+fill_random(char *buf, apr_size_t len, apr_uint32_t *seed)
+{
+  apr_size_t i;
+  for (i = 0; i < len; ++i)
+    buf[i] = (char)(svn_test_rand(seed) >> 24);
+}
+
+/* Set *SVNDIFF to the svndiff (version 0) representation of the delta
+   between SOURCE and TARGET.  If MATCH_WHOLE_SOURCE is set, use a source
+   index.  Verify that the delta reconstructs TARGET. */
+static svn_error_t *
+whole_source_svndiff(svn_stringbuf_t **svndiff,
+                     svn_stringbuf_t *source,
+                     svn_stringbuf_t *target,
+                     svn_boolean_t match_whole_source,
+                     apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *parse_stream;
+  apr_size_t len;
+  svn_stringbuf_t *regenerated = svn_stringbuf_create_empty(pool);
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          0, SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+  svn_txdelta3(&txdelta_stream,
+               svn_stream_from_stringbuf(source, pool),
+               svn_stream_from_stringbuf(target, pool),
+               FALSE, match_whole_source, pool);
+  SVN_ERR(svn_txdelta_send_txstream(txdelta_stream, handler, handler_baton,
+                                    pool));
+
+  /* Parse it back and apply it. */
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_from_stringbuf(regenerated, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  parse_stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                           pool);
+  len = (*svndiff)->len;
+  SVN_ERR(svn_stream_write(parse_stream, (*svndiff)->data, &len));
+  SVN_ERR(svn_stream_close(parse_stream));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(target, regenerated));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+whole_source_delta_test(apr_pool_t *pool)
+{
+  enum { SOURCE_LEN = 1000000, INSERT_LEN = 30000, DELETE_LEN = 250000 };
+  apr_uint32_t seed = 0x5eed;
+  svn_stringbuf_t *source = svn_stringbuf_create_ensure(SOURCE_LEN, pool);
+  svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *windowed_svndiff;
+  svn_stringbuf_t *indexed_svndiff;
+  char *inserted = apr_palloc(pool, INSERT_LEN);
+
+  /* Random source data. */
+  fill_random(source->data, SOURCE_LEN, &seed);
+  source->len = SOURCE_LEN;
+  source->data[source->len] = '\0';
+
+  /* The target inserts some new data near the start and skips a larger
+     part of the source later on.  Both shift content across window
+     boundaries. */
+  fill_random(inserted, INSERT_LEN, &seed);
+  svn_stringbuf_appendbytes(target, source->data, 1000);
+  svn_stringbuf_appendbytes(target, inserted, INSERT_LEN);
+  svn_stringbuf_appendbytes(target, source->data + 1000, 400000);
+  svn_stringbuf_appendbytes(target, source->data + 401000 + DELETE_LEN,
+                            SOURCE_LEN - 401000 - DELETE_LEN);
+
+  SVN_ERR(whole_source_svndiff(&windowed_svndiff, source, target, FALSE,
+                               pool));
+  SVN_ERR(whole_source_svndiff(&indexed_svndiff, source, target, TRUE,
+                               pool));
+
+  /* With the index, the delta is basically the inserted data plus the
+     part of the window that spans the deleted section but can only be
+     matched against one side of it. */
+  SVN_TEST_ASSERT(indexed_svndiff->len < INSERT_LEN
+                                         + SVN_DELTA_WINDOW_SIZE / 2);
+  SVN_TEST_ASSERT(indexed_svndiff->len < windowed_svndiff->len / 4);
+
+  /* Unrelated data and empty sources must work as well. */
+  fill_random(source->data, SOURCE_LEN, &seed);
+  SVN_ERR(whole_source_svndiff(&indexed_svndiff, source, target, TRUE,
+                               pool));
+  svn_stringbuf_setempty(source);
+  SVN_ERR(whole_source_svndiff(&indexed_svndiff, source, target, TRUE,
+                               pool));
+  SVN_ERR(whole_source_svndiff(&indexed_svndiff, target, source, TRUE,
+                               pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a copy of DATA, allocated in POOL, with a few random
+   insertions, deletions and overwrites applied to it.  Use *SEED as
+   the random number generator state. */
+static svn_stringbuf_t *
+mutate_data(const svn_stringbuf_t *data,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_dup(data, pool);
+  int edits = 1 + svn_test_rand(seed) % 20;
+  int i;
+
+  for (i = 0; i < edits; ++i)
+    {
+      apr_size_t pos = result->len ? svn_test_rand(seed) % result->len : 0;
+      apr_size_t len = 1 + svn_test_rand(seed) % 2000;
+      char buf[2000];
+
+      fill_random(buf, len, seed);
+      switch (svn_test_rand(seed) % 3)
+        {
+          case 0:
+            svn_stringbuf_insert(result, pos, buf, len);
+            break;
+          case 1:
+            svn_stringbuf_remove(result, pos, len);
+            break;
+          default:
+            svn_stringbuf_replace(result, pos, len, buf, len);
+            break;
+        }
+    }
+
+  /* Keep everything within a single delta window. */
+  if (result->len > SVN_DELTA_WINDOW_SIZE)
+    svn_stringbuf_chop(result, result->len - SVN_DELTA_WINDOW_SIZE);
+
+  return result;
+}
+
+/* Set *WINDOW to the only delta window between SOURCE and TARGET.
+   Allocate it in POOL. */
+static svn_error_t *
+single_window_delta(svn_txdelta_window_t **window,
+                    svn_stringbuf_t *source,
+                    svn_stringbuf_t *target,
+                    apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta3(&txdelta_stream,
+               svn_stream_from_stringbuf(source, pool),
+               svn_stream_from_stringbuf(target, pool),
+               FALSE, FALSE, pool);
+
+  SVN_ERR(svn_txdelta_next_window(window, txdelta_stream, pool));
+  SVN_TEST_ASSERT(*window != NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_chain_combine_test(apr_pool_t *pool)
+{
+  enum { MAX_CHAIN = 16 };
+
+  apr_uint32_t seed = 0xc0ffee;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 100; ++i)
+    {
+      svn_stringbuf_t *versions[MAX_CHAIN + 1];
+      const svn_txdelta_window_t *windows[MAX_CHAIN];
+      svn_txdelta_window_t *window, *composite;
+      svn_stringbuf_t *target;
+      int count = 1 + svn_test_rand(&seed) % MAX_CHAIN;
+      int k;
+
+      svn_pool_clear(iterpool);
+
+      /* Create a sequence of revisions and the deltas between them. */
+      versions[0] = svn_stringbuf_create_ensure(SVN_DELTA_WINDOW_SIZE,
+                                                iterpool);
+      versions[0]->len = svn_test_rand(&seed) % SVN_DELTA_WINDOW_SIZE;
+      fill_random(versions[0]->data, versions[0]->len, &seed);
+      versions[0]->data[versions[0]->len] = '\0';
+
+      for (k = 0; k < count; ++k)
+        {
+          versions[k + 1] = mutate_data(versions[k], &seed, iterpool);
+          if (versions[k + 1]->len == 0)
+            svn_stringbuf_appendbyte(versions[k + 1], 'x');
+
+          SVN_ERR(single_window_delta(&window, versions[k], versions[k + 1],
+                                      iterpool));
+          windows[k] = window;
+        }
+
+      /* The composite must reproduce the latest revision from the
+         first one. */
+      composite = svn_txdelta__compose_window_chain(windows, count,
+                                                    iterpool);
+      SVN_TEST_ASSERT(composite->tview_len == versions[count]->len);
+      SVN_TEST_ASSERT(composite->sview_len == windows[0]->sview_len);
+
+      target = svn_stringbuf_create_ensure(composite->tview_len, iterpool);
+      target->len = composite->tview_len;
+      svn_txdelta_apply_instructions(composite, versions[0]->data,
+                                     target->data, &target->len);
+      SVN_TEST_ASSERT(svn_stringbuf_compare(target, versions[count]));
+
+      /* Same result as when composing pairwise. */
+      window = svn_txdelta_window_dup(windows[0], iterpool);
+      for (k = 1; k < count; ++k)
+        window = svn_txdelta_compose_windows(window, windows[k], iterpool);
+
+      target->len = window->tview_len;
+      svn_txdelta_apply_instructions(window, versions[0]->data,
+                                     target->data, &target->len);
+      SVN_TEST_ASSERT(svn_stringbuf_compare(target, versions[count]));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *SVNDIFF to the svndiff representation of the delta between SOURCE
+   and TARGET, produced by svn_txdelta__to_svndiff_parallel() with the
+   given SVNDIFF_VERSION, COMPRESSION_LEVEL and MAX_THREADS. */
+static svn_error_t *
+parallel_svndiff(svn_stringbuf_t **svndiff,
+                 svn_stringbuf_t *source,
+                 svn_stringbuf_t *target,
+                 int svndiff_version,
+                 int compression_level,
+                 int max_threads,
+                 apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                   svn_stream_from_stringbuf(*svndiff, pool),
+                                   svndiff_version, compression_level,
+                                   max_threads, pool);
+  svn_txdelta3(&txdelta_stream,
+               svn_stream_from_stringbuf(source, pool),
+               svn_stream_from_stringbuf(target, pool),
+               FALSE, FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(txdelta_stream,
+                                                   handler, handler_baton,
+                                                   pool));
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+parallel_svndiff_test(apr_pool_t *pool)
+{
+  enum { DATA_LEN = 2000000 };
+
+  apr_uint32_t seed = 0x5eed;
+  svn_stringbuf_t *source = svn_stringbuf_create_ensure(DATA_LEN, pool);
+  svn_stringbuf_t *target;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int version;
+  apr_size_t i;
+
+  /* Compressible source data, spanning many delta windows. */
+  for (i = 0; i < DATA_LEN; ++i)
+    source->data[i] = (char)('a' + (svn_test_rand(&seed) >> 24) % 4);
+  source->len = DATA_LEN;
+  source->data[DATA_LEN] = '\0';
+
+  /* Sprinkle some random changes over the target. */
+  target = svn_stringbuf_dup(source, pool);
+  for (i = 0; i < DATA_LEN; i += 1 + svn_test_rand(&seed) % 5000)
+    target->data[i] = (char)(svn_test_rand(&seed) >> 24);
+
+  for (version = 0; version <= 2; ++version)
+    {
+      svn_stringbuf_t *serial_svndiff;
+      int threads;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(parallel_svndiff(&serial_svndiff, source, target, version,
+                               SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 1,
+                               iterpool));
+
+      /* The output must not depend on the number of threads. */
+      for (threads = 2; threads <= 32; threads *= 4)
+        {
+          svn_stringbuf_t *parallel;
+          SVN_ERR(parallel_svndiff(&parallel, source, target, version,
+                                   SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                   threads, iterpool));
+          SVN_TEST_ASSERT(svn_stringbuf_compare(serial_svndiff, parallel));
+        }
+
+      /* Empty deltas have a header only. */
+      svn_stringbuf_setempty(target);
+      SVN_ERR(parallel_svndiff(&serial_svndiff, source, target, version,
+                               SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, 4,
+                               iterpool));
+      SVN_TEST_ASSERT(serial_svndiff->len == 4);
+      svn_stringbuf_appendstr(target, source);
+    }
+
+  /* Releasing the encoder with windows still in flight must be safe. */
+  {
+    svn_txdelta_window_handler_t handler;
+    void *handler_baton;
+    svn_txdelta_window_t *window;
+    svn_txdelta__ops_baton_t build_baton = { 0 };
+    apr_pool_t *encoder_pool = svn_pool_create(pool);
+
+    build_baton.new_data = svn_stringbuf_create_empty(pool);
+    svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                     svn_stream_empty(encoder_pool), 1,
+                                     SVN_DELTA_COMPRESSION_LEVEL_MAX, 4,
+                                     encoder_pool);
+    svn_txdelta__insert_op(&build_baton, svn_txdelta_new, 0,
+                           SVN_DELTA_WINDOW_SIZE, source->data, pool);
+    window = svn_txdelta__make_window(&build_baton, pool);
+    window->tview_len = SVN_DELTA_WINDOW_SIZE;
+    for (i = 0; i < 6; ++i)
+      SVN_ERR(handler(window, handler_baton));
+
+    svn_pool_destroy(encoder_pool);
+  }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+zero_copy_svndiff_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0xfeed;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < 30; ++i)
+    {
+      svn_stringbuf_t *source, *target, *svndiff, *result;
+      svn_txdelta_window_t *window, *parsed, *read;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *stream;
+      const char *raw;
+      apr_size_t raw_len;
+      svn_error_t *err;
+      int version = i % 3;
+      int j;
+
+      svn_pool_clear(iterpool);
+
+      /* Serialize a random single-window delta. */
+      source = svn_stringbuf_create_ensure(SVN_DELTA_WINDOW_SIZE, iterpool);
+      source->len = 1 + svn_test_rand(&seed) % (SVN_DELTA_WINDOW_SIZE - 1);
+      fill_random(source->data, source->len, &seed);
+      source->data[source->len] = '\0';
+      target = mutate_data(source, &seed, iterpool);
+      if (target->len == 0)
+        svn_stringbuf_appendbyte(target, 'x');
+      SVN_ERR(single_window_delta(&window, source, target, iterpool));
+
+      svndiff = svn_stringbuf_create_empty(iterpool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                              svn_stream_from_stringbuf(svndiff, iterpool),
+                              version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                              iterpool);
+      SVN_ERR(handler(window, handler_baton));
+
+      /* Strip the stream header and parse the raw window in-place. */
+      raw = svndiff->data + 4;
+      raw_len = svndiff->len - 4;
+      SVN_ERR(svn_txdelta__parse_svndiff_window(&parsed, raw, raw_len,
+                                                version, iterpool));
+      if (version == 0)
+        SVN_TEST_ASSERT(parsed->new_data->data
+                        == raw + raw_len - parsed->new_data->len);
+      SVN_TEST_ASSERT(parsed->new_data->data[parsed->new_data->len] == '\0');
+
+      /* Must match what the stream-based parser produces. */
+      stream = svn_stream_from_stringbuf(svndiff, iterpool);
+      SVN_ERR(svn_stream_skip(stream, 4));
+      SVN_ERR(svn_txdelta_read_svndiff_window(&read, stream, version,
+                                              iterpool));
+      SVN_TEST_ASSERT(parsed->sview_offset == read->sview_offset);
+      SVN_TEST_ASSERT(parsed->sview_len == read->sview_len);
+      SVN_TEST_ASSERT(parsed->tview_len == read->tview_len);
+      SVN_TEST_ASSERT(parsed->num_ops == read->num_ops);
+      SVN_TEST_ASSERT(parsed->src_ops == read->src_ops);
+      for (j = 0; j < parsed->num_ops; ++j)
+        {
+          SVN_TEST_ASSERT(parsed->ops[j].action_code
+                          == read->ops[j].action_code);
+          SVN_TEST_ASSERT(parsed->ops[j].offset == read->ops[j].offset);
+          SVN_TEST_ASSERT(parsed->ops[j].length == read->ops[j].length);
+        }
+      SVN_TEST_ASSERT(svn_string_compare(parsed->new_data, read->new_data));
+
+      result = svn_stringbuf_create_ensure(parsed->tview_len, iterpool);
+      result->len = parsed->tview_len;
+      svn_txdelta_apply_instructions(parsed, source->data, result->data,
+                                     &result->len);
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+      /* Truncated windows and trailing garbage must be detected. */
+      err = svn_txdelta__parse_svndiff_window(&parsed, raw, raw_len - 1,
+                                              version, iterpool);
+      SVN_TEST_ASSERT_ANY_ERROR(err);
+      svn_stringbuf_appendbyte(svndiff, 0);
+      raw = svndiff->data + 4;
+      err = svn_txdelta__parse_svndiff_window(&parsed, raw, raw_len + 1,
+                                              version, iterpool);
+      SVN_TEST_ASSERT_ANY_ERROR(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +1171,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_PASS2(random_simd_test,
+                   "random delta test comparing scalar and SIMD code"),
+    SVN_TEST_PASS2(whole_source_delta_test,
+                   "delta against an indexed source"),
+    SVN_TEST_PASS2(parallel_svndiff_test,
+                   "parallel svndiff encoder"),
+    SVN_TEST_PASS2(random_chain_combine_test,
+                   "random delta chain composition test"),
+    SVN_TEST_PASS2(zero_copy_svndiff_test,
+                   "zero-copy svndiff window parser"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -60,10 +60,10 @@ do_one_diff(apr_file_t *source_file, apr_file_t *target_file,
 
   *count = 0;
   *len = 0;
-  svn_txdelta2(&delta_stream,
+  svn_txdelta3(&delta_stream,
                svn_stream_from_aprfile(source_file, fpool),
                svn_stream_from_aprfile(target_file, fpool),
-               FALSE,
+               FALSE, FALSE,
                fpool);
   do {
     svn_error_t *err;
@@ -125,15 +125,15 @@ do_one_test_cycle(apr_file_t *source_file_A, apr_file_t *target_file_A,
         apr_file_seek(target_file_B, APR_SET, &offset);
       }
 
-      svn_txdelta2(&stream_A,
+      svn_txdelta3(&stream_A,
                    svn_stream_from_aprfile(source_file_A, fpool),
                    svn_stream_from_aprfile(target_file_A, fpool),
-                   FALSE,
+                   FALSE, FALSE,
                    fpool);
-      svn_txdelta2(&stream_B,
+      svn_txdelta3(&stream_B,
                    svn_stream_from_aprfile(source_file_B, fpool),
                    svn_stream_from_aprfile(target_file_B, fpool),
-                   FALSE,
+                   FALSE, FALSE,
                    fpool);
 
       for (count_AB = 0; count_AB < count_B; ++count_AB)
@@ -22,11 +22,18 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 #include <apr_lib.h>
+#include <apr_thread_proc.h>
 #include <apr_time.h>
 
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>   /* For _exit() */
+#endif
+
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
 
 #include "private/svn_cache.h"
@@ -591,6 +598,831 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
 }
 
 
+#if APR_HAS_THREADS
+
+/* Shared state of the threads in test_membuffer_concurrent_access. */
+typedef struct stress_baton_t
+{
+  svn_membuffer_t *membuffer;
+  apr_uint32_t seed;
+  svn_error_t *err;
+} stress_baton_t;
+
+/* Number of different keys used by the stress test.  That is enough to
+ * cause frequent evictions in the small cache that we use. */
+#define STRESS_KEY_COUNT 2000
+
+/* Return the value that the stress test stores for key number KEY.
+ * It is KEY repeated a key-dependent number of times, such that torn
+ * reads and key mix-ups will be detected. */
+static svn_stringbuf_t *
+stress_value(int key,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *value = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < 1 + key % 97; ++i)
+    svn_stringbuf_appendcstr(value, apr_psprintf(pool, "%d,", key));
+
+  return value;
+}
+
+/* Randomly write, read and check values in BATON->MEMBUFFER. */
+static svn_error_t *
+stress_cache(stress_baton_t *baton,
+             apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Use a separate front-end per thread such that only the membuffer's
+   * own synchronization is being tested. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            baton->membuffer,
+                                            NULL, NULL,
+                                            sizeof(int),
+                                            "stress:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < 20000; ++i)
+    {
+      int key = (int)(svn_test_rand(&baton->seed) % STRESS_KEY_COUNT);
+      svn_stringbuf_t *value;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+      switch (svn_test_rand(&baton->seed) % 4)
+        {
+          case 0:
+            SVN_ERR(svn_cache__set(cache, &key, stress_value(key, iterpool),
+                                   iterpool));
+            break;
+
+          case 1:
+            /* Occasionally, invalidate everything. */
+            if (key == 0)
+              SVN_ERR(svn_cache__membuffer_clear(baton->membuffer));
+            else
+              SVN_ERR(svn_cache__has_key(&found, cache, &key, iterpool));
+            break;
+
+          default:
+            SVN_ERR(svn_cache__get((void **)&value, &found, cache, &key,
+                                   iterpool));
+            if (found)
+              SVN_TEST_ASSERT(svn_stringbuf_compare(value,
+                                                    stress_value(key,
+                                                                 iterpool)));
+            break;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC stress_thread(apr_thread_t *tid, void *data)
+{
+  stress_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  /* give all threads a good chance to get started by the scheduler */
+  apr_thread_yield();
+
+  baton->err = stress_cache(baton, pool);
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_concurrent_access(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  enum { THREAD_COUNT = 8 };
+  svn_membuffer_t *membuffer;
+  apr_thread_t *threads[THREAD_COUNT];
+  stress_baton_t batons[THREAD_COUNT];
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  /* A small, thread-safe cache with only a few segments, such that
+   * readers and writers frequently hit the same entry groups. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024, 0, 2,
+                                            TRUE, TRUE, pool));
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t status;
+
+      batons[i].membuffer = membuffer;
+      batons[i].seed = (apr_uint32_t)i;
+      batons[i].err = SVN_NO_ERROR;
+
+      status = apr_thread_create(&threads[i], NULL, stress_thread,
+                                 &batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, "Can't create thread");
+    }
+
+  /* wait for the threads to finish */
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        return svn_error_wrap_apr(status, "Can't join thread");
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  return svn_error_trace(err);
+#else
+  return SVN_NO_ERROR;
+#endif
+}
+
+/* Create a front-end to MEMBUFFER for revnum values with fixed-size keys
+ * and the given PREFIX in *CACHE_P.  Fixed-size keys use the prefix pool.
+ */
+static svn_error_t *
+create_revnum_cache(svn_cache__t **cache_p,
+                    svn_membuffer_t *membuffer,
+                    const char *prefix,
+                    apr_pool_t *pool)
+{
+  return svn_error_trace(svn_cache__create_membuffer_cache(
+                             cache_p,
+                             membuffer,
+                             serialize_revnum,
+                             deserialize_revnum,
+                             sizeof(svn_revnum_t),
+                             prefix,
+                             SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                             FALSE,
+                             FALSE,
+                             pool, pool));
+}
+
+static svn_error_t *
+test_membuffer_shared_memory(apr_pool_t *pool)
+{
+#if APR_HAS_FORK && APR_HAVE_UNISTD_H
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  const char *sandbox;
+  svn_revnum_t key = 1;
+  svn_revnum_t value = 42;
+  svn_revnum_t *result;
+  svn_boolean_t found;
+  apr_proc_t proc;
+  apr_exit_why_e exit_why;
+  int exit_code;
+  apr_status_t status;
+  svn_error_t *err;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "cache-test-shared-memory",
+                                    pool));
+
+  err = svn_cache__membuffer_cache_create_shared(
+            &membuffer, 1024 * 1024, 0, 2, TRUE,
+            svn_dirent_join(sandbox, "cache", pool), pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err, NULL);
+  SVN_ERR(err);
+
+  SVN_ERR(create_revnum_cache(&cache, membuffer, "parent:", pool));
+  SVN_ERR(svn_cache__set(cache, &key, &value, pool));
+
+  /* The child sees the parent's data and adds some of its own using a
+   * prefix that the parent process has not seen, yet.  Use _exit() to
+   * keep the child from running the parent's pool cleanups. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_cache__t *child_cache;
+      svn_boolean_t child_found = FALSE;
+      void *child_result = NULL;
+
+      err = create_revnum_cache(&child_cache, membuffer, "parent:", pool);
+      if (!err)
+        err = svn_cache__get(&child_result, &child_found, child_cache, &key,
+                             pool);
+      if (!err && child_found)
+        err = create_revnum_cache(&child_cache, membuffer, "child:", pool);
+      if (!err && child_found)
+        err = svn_cache__set(child_cache, &key, child_result, pool);
+
+      _exit(   !err && child_found
+            && *(svn_revnum_t *)child_result == value
+            ? EXIT_SUCCESS
+            : EXIT_FAILURE);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  status = apr_proc_wait(&proc, &exit_code, &exit_why, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "Can't wait for child process");
+
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exit_why));
+  SVN_TEST_ASSERT(exit_code == EXIT_SUCCESS);
+
+  /* The prefix registered by the child must map to the same entries. */
+  SVN_ERR(create_revnum_cache(&cache, membuffer, "child:", pool));
+  SVN_ERR(svn_cache__get((void **)&result, &found, cache, &key, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*result == value);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+#endif
+}
+
+static svn_error_t *
+test_membuffer_tinylfu(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+  int hot_found = 0;
+
+  /* The basic semantics don't change. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_tinylfu(membuffer, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Scan through many more keys than fit into the cache while a small
+   * hot set keeps being accessed.  Every value found must be correct.
+   * The sketch will also get aged a couple of times. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 64*1024, 0, 1,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_tinylfu(membuffer, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&cache, membuffer, "tinylfu:", pool));
+
+  for (i = 0; i < 20000; ++i)
+    {
+      svn_revnum_t keys[2];
+      int k;
+
+      svn_pool_clear(iterpool);
+      keys[0] = i % 16;
+      keys[1] = 1000 + i;
+
+      for (k = 0; k < 2; ++k)
+        {
+          svn_revnum_t *answer;
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &keys[k],
+                                 iterpool));
+          if (found)
+            SVN_TEST_ASSERT(*answer == keys[k]);
+          else
+            SVN_ERR(svn_cache__set(cache, &keys[k], &keys[k], iterpool));
+        }
+    }
+
+  /* Switching the policy back must not corrupt anything either. */
+  SVN_ERR(svn_cache__membuffer_set_tinylfu(membuffer, FALSE, pool));
+  for (i = 0; i < 16; ++i)
+    {
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, &i, iterpool));
+      if (found)
+        {
+          SVN_TEST_ASSERT(*answer == i);
+          ++hot_found;
+        }
+    }
+
+  /* The hot set is tiny and gets accessed all the time. */
+  SVN_TEST_ASSERT(hot_found > 0);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_key_snapshot(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *fixed_cache;
+  svn_cache__t *short_lived_cache;
+  svn_cache__t *string_cache;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  apr_array_header_t *records;
+  int fixed_found = 0;
+  int short_lived_found = 0;
+  int strings_found = 0;
+  int i;
+
+  svn_revnum_t revs[] = { 0, 42, 0x12345678, SVN_INVALID_REVNUM };
+  const char *strings[] = { "twenty", "a key with more than 16 chars" };
+
+  /* Fill caches of the different key types into one membuffer. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 64*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&fixed_cache, membuffer, "fixed:", pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&short_lived_cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "short-lived:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            TRUE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "strings:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < 4; ++i)
+    {
+      SVN_ERR(svn_cache__set(fixed_cache, &revs[i], &revs[i], pool));
+      SVN_ERR(svn_cache__set(short_lived_cache, &revs[i], &revs[i], pool));
+    }
+
+  for (i = 0; i < 2; ++i)
+    SVN_ERR(svn_cache__set(string_cache, strings[i], &revs[i], pool));
+
+  /* Round-trip the keys. */
+  stream = svn_stream_from_stringbuf(buffer, pool);
+  SVN_ERR(svn_cache__membuffer_save_keys(stream, membuffer, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  stream = svn_stream_from_stringbuf(buffer, pool);
+  SVN_ERR(svn_cache__load_keys(&records, stream, pool, pool));
+  SVN_TEST_INT_ASSERT(records->nelts, 10);
+
+  /* Every key must come back exactly once and with its original
+   * prefix. */
+  for (i = 0; i < records->nelts; ++i)
+    {
+      const svn_cache__key_record_t *record
+        = APR_ARRAY_IDX(records, i, const svn_cache__key_record_t *);
+      int k;
+
+      if (   strcmp(record->prefix, "fixed:") == 0
+          || strcmp(record->prefix, "short-lived:") == 0)
+        {
+          svn_revnum_t rev;
+          SVN_TEST_ASSERT(record->key_len >= sizeof(rev));
+          memcpy(&rev, record->key, sizeof(rev));
+
+          for (k = 0; k < 4; ++k)
+            if (rev == revs[k])
+              {
+                if (record->prefix[0] == 'f')
+                  fixed_found |= 1 << k;
+                else
+                  short_lived_found |= 1 << k;
+              }
+        }
+      else
+        {
+          SVN_TEST_STRING_ASSERT(record->prefix, "strings:");
+          SVN_TEST_ASSERT(memchr(record->key, 0, record->key_len));
+
+          for (k = 0; k < 2; ++k)
+            if (strcmp(record->key, strings[k]) == 0)
+              strings_found |= 1 << k;
+        }
+    }
+
+  SVN_TEST_INT_ASSERT(fixed_found, 0xf);
+  SVN_TEST_INT_ASSERT(short_lived_found, 0xf);
+  SVN_TEST_INT_ASSERT(strings_found, 0x3);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_partitions(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *soft_cache;
+  svn_cache__t *hard_cache;
+  svn_cache__t *unpartitioned_cache;
+  svn_cache__info_t info;
+  svn_revnum_t i;
+  int hard_found = 0;
+
+  /* Revnums with short keys occupy one ITEM_ALIGNMENT unit each. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            64*1024, 0, TRUE, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&soft_cache, membuffer, "soft:", pool));
+  SVN_ERR(create_revnum_cache(&hard_cache, membuffer, "hard:", pool));
+  SVN_ERR(create_revnum_cache(&unpartitioned_cache, membuffer, "none:",
+                              pool));
+
+  SVN_ERR(svn_cache__membuffer_set_partition(soft_cache, "repo-a", 0, FALSE,
+                                             pool));
+  SVN_ERR(svn_cache__membuffer_set_partition(hard_cache, "repo-b", 1024,
+                                             TRUE, pool));
+
+  /* Caches without a partition don't report any. */
+  SVN_ERR(svn_cache__get_info(unpartitioned_cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.partition == NULL);
+
+  /* Usage is being accounted for even without a quota. */
+  for (i = 0; i < 10; ++i)
+    SVN_ERR(svn_cache__set(soft_cache, &i, &i, pool));
+
+  /* Overwriting existing entries must not change the accounting. */
+  for (i = 0; i < 10; ++i)
+    SVN_ERR(svn_cache__set(soft_cache, &i, &i, pool));
+
+  SVN_ERR(svn_cache__get_info(soft_cache, &info, FALSE, pool));
+  SVN_TEST_STRING_ASSERT(info.partition, "repo-a");
+  SVN_TEST_ASSERT(info.partition_quota == 0);
+  SVN_TEST_ASSERT(!info.partition_hard_quota);
+  SVN_TEST_ASSERT(info.partition_used == 10 * 16);
+
+  /* A hard quota limits what gets cached. */
+  for (i = 0; i < 200; ++i)
+    SVN_ERR(svn_cache__set(hard_cache, &i, &i, pool));
+
+  for (i = 0; i < 200; ++i)
+    {
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      SVN_ERR(svn_cache__get((void **)&answer, &found, hard_cache, &i,
+                             pool));
+      if (found)
+        {
+          SVN_TEST_ASSERT(*answer == i);
+          ++hard_found;
+        }
+    }
+
+  SVN_ERR(svn_cache__get_info(hard_cache, &info, FALSE, pool));
+  SVN_TEST_STRING_ASSERT(info.partition, "repo-b");
+  SVN_TEST_ASSERT(info.partition_quota == 1024);
+  SVN_TEST_ASSERT(info.partition_hard_quota);
+  SVN_TEST_ASSERT(info.partition_used <= 1024);
+  SVN_TEST_ASSERT(info.partition_used == hard_found * 16);
+  SVN_TEST_ASSERT(hard_found > 0 && hard_found <= 64);
+
+  /* Unrelated data is not affected by that quota. */
+  for (i = 0; i < 200; ++i)
+    SVN_ERR(svn_cache__set(unpartitioned_cache, &i, &i, pool));
+
+  SVN_ERR(svn_cache__get_info(soft_cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.partition_used == 10 * 16);
+
+  /* Overwriting an entry in-place is subject to the writer's hard quota,
+   * even if the entry has been written by another partition before. */
+  {
+    svn_cache__t *other_soft_cache;
+    svn_cache__t *other_hard_cache;
+    svn_revnum_t key = 1;
+    svn_revnum_t filler = 2;
+    svn_revnum_t *answer;
+    svn_boolean_t found;
+
+    SVN_ERR(create_revnum_cache(&other_soft_cache, membuffer, "shared:",
+                                pool));
+    SVN_ERR(create_revnum_cache(&other_hard_cache, membuffer, "shared:",
+                                pool));
+    SVN_ERR(svn_cache__membuffer_set_partition(other_soft_cache, "repo-c",
+                                               0, FALSE, pool));
+    SVN_ERR(svn_cache__membuffer_set_partition(other_hard_cache, "repo-d",
+                                               16, TRUE, pool));
+
+    SVN_ERR(svn_cache__set(other_hard_cache, &filler, &filler, pool));
+    SVN_ERR(svn_cache__set(other_soft_cache, &key, &key, pool));
+    SVN_ERR(svn_cache__set(other_hard_cache, &key, &key, pool));
+
+    SVN_ERR(svn_cache__get((void **)&answer, &found, other_soft_cache,
+                           &key, pool));
+    SVN_TEST_ASSERT(!found);
+
+    SVN_ERR(svn_cache__get_info(other_hard_cache, &info, FALSE, pool));
+    SVN_TEST_ASSERT(info.partition_used == 16);
+    SVN_ERR(svn_cache__get_info(other_soft_cache, &info, FALSE, pool));
+    SVN_TEST_ASSERT(info.partition_used == 0);
+  }
+
+  /* Clearing the cache releases all usage. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+
+  SVN_ERR(svn_cache__get_info(soft_cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.partition_used == 0);
+  SVN_ERR(svn_cache__get_info(hard_cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.partition_used == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_categories(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache_a;
+  svn_cache__t *cache_b;
+  apr_array_header_t *categories;
+  const svn_cache__info_t *info_a;
+  const svn_cache__info_t *info_b;
+  svn_cache__info_t info;
+  svn_string_t *metrics;
+  svn_revnum_t i;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            64*1024, 0, TRUE, TRUE, pool));
+
+  /* No categories, no per-category statistics. */
+  categories = svn_cache__membuffer_get_category_info(membuffer, pool);
+  SVN_TEST_ASSERT(categories->nelts == 0);
+
+  SVN_ERR(create_revnum_cache(&cache_a, membuffer, "a:", pool));
+  SVN_ERR(create_revnum_cache(&cache_b, membuffer, "b:", pool));
+  SVN_ERR(svn_cache__membuffer_set_category(cache_a, "type-a", pool));
+  SVN_ERR(svn_cache__membuffer_set_category(cache_b, "type-b", pool));
+
+  /* 10 entries in A, of which we look up 20 (10 hits);
+   * 5 entries in B, which we look up once each. */
+  for (i = 0; i < 10; ++i)
+    SVN_ERR(svn_cache__set(cache_a, &i, &i, pool));
+  for (i = 0; i < 5; ++i)
+    SVN_ERR(svn_cache__set(cache_b, &i, &i, pool));
+
+  for (i = 0; i < 20; ++i)
+    {
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache_a, &i, pool));
+      SVN_TEST_ASSERT(found == (i < 10));
+    }
+  for (i = 0; i < 5; ++i)
+    {
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache_b, &i, pool));
+      SVN_TEST_ASSERT(found);
+    }
+
+  categories = svn_cache__membuffer_get_category_info(membuffer, pool);
+  SVN_TEST_ASSERT(categories->nelts == 2);
+
+  info_a = APR_ARRAY_IDX(categories, 0, const svn_cache__info_t *);
+  info_b = APR_ARRAY_IDX(categories, 1, const svn_cache__info_t *);
+  SVN_TEST_STRING_ASSERT(info_a->id, "type-a");
+  SVN_TEST_STRING_ASSERT(info_b->id, "type-b");
+
+  SVN_TEST_ASSERT(info_a->gets == 20);
+  SVN_TEST_ASSERT(info_a->hits == 10);
+  SVN_TEST_ASSERT(info_a->sets == 10);
+  SVN_TEST_ASSERT(info_a->used_entries == 10);
+  SVN_TEST_ASSERT(info_a->evictions == 0);
+
+  SVN_TEST_ASSERT(info_b->gets == 5);
+  SVN_TEST_ASSERT(info_b->hits == 5);
+  SVN_TEST_ASSERT(info_b->sets == 5);
+  SVN_TEST_ASSERT(info_b->used_entries == 5);
+
+  /* The same data in the machine-readable format. */
+  SVN_ERR(svn_cache__get_info(cache_a, &info, FALSE, pool));
+  metrics = svn_cache__format_metrics(&info, categories, pool);
+  SVN_TEST_ASSERT(strstr(metrics->data,
+                         "# TYPE svn_cache_hits_total counter\n"));
+  SVN_TEST_ASSERT(strstr(metrics->data,
+                         "svn_cache_hits_total{category=\"type-a\"} 10\n"));
+  SVN_TEST_ASSERT(strstr(metrics->data,
+                         "svn_cache_misses_total{category=\"type-a\"} 10\n"));
+  SVN_TEST_ASSERT(strstr(metrics->data,
+                         "svn_cache_used_entries{category=\"type-b\"} 5\n"));
+  SVN_TEST_ASSERT(strstr(metrics->data, "\nsvn_cache_gets_total 20\n"));
+
+  /* Clearing the cache resets the fill levels but not the counters. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+
+  categories = svn_cache__membuffer_get_category_info(membuffer, pool);
+  info_a = APR_ARRAY_IDX(categories, 0, const svn_cache__info_t *);
+  SVN_TEST_ASSERT(info_a->used_entries == 0);
+  SVN_TEST_ASSERT(info_a->used_size == 0);
+  SVN_TEST_ASSERT(info_a->gets == 20);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the text stored for revision REV in the disk cache test. */
+static svn_stringbuf_t *
+make_text(svn_revnum_t rev,
+          apr_pool_t *pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_createf(pool, "r%ld:", rev);
+  while (text->len < 4000)
+    svn_stringbuf_appendbyte(text, (char)('a' + (text->len + rev) % 26));
+
+  return text;
+}
+
+/* Create a string cache in MEMBUFFER with fixed-size revnum keys in
+ * *SHORT_KEY_CACHE and one with string keys in *LONG_KEY_CACHE.  Make
+ * both demote their items to the on-disk tier.  Use POOL for all
+ * allocations. */
+static svn_error_t *
+create_text_caches(svn_cache__t **short_key_cache,
+                   svn_cache__t **long_key_cache,
+                   svn_membuffer_t *membuffer,
+                   apr_pool_t *pool)
+{
+  SVN_ERR(svn_cache__create_membuffer_cache(short_key_cache, membuffer,
+                                            NULL, NULL,
+                                            sizeof(svn_revnum_t),
+                                            "short:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(long_key_cache, membuffer,
+                                            NULL, NULL,
+                                            APR_HASH_KEY_STRING,
+                                            "long:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  /* Demotion is configured per category. */
+  SVN_ERR(svn_cache__membuffer_set_category(*short_key_cache, "texts",
+                                            pool));
+  SVN_ERR(svn_cache__membuffer_set_category(*long_key_cache, "texts",
+                                            pool));
+  SVN_ERR(svn_cache__membuffer_set_demotion(*short_key_cache, 1000, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Look up the texts for revisions 0 to COUNT-1 in SHORT_KEY_CACHE and
+ * LONG_KEY_CACHE.  Verify the contents of those found and return their
+ * number in *FOUND_COUNT.  Use POOL for temporary allocations. */
+static svn_error_t *
+check_texts(int *found_count,
+            svn_cache__t *short_key_cache,
+            svn_cache__t *long_key_cache,
+            svn_revnum_t count,
+            apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  *found_count = 0;
+  for (i = 0; i < count; ++i)
+    {
+      svn_stringbuf_t *text;
+      svn_boolean_t found;
+      const char *key;
+
+      svn_pool_clear(iterpool);
+      key = apr_psprintf(iterpool, "text-%ld", i);
+
+      SVN_ERR(svn_cache__get((void **)&text, &found, short_key_cache, &i,
+                             iterpool));
+      if (found)
+        {
+          SVN_TEST_STRING_ASSERT(text->data, make_text(i, iterpool)->data);
+          ++*found_count;
+        }
+
+      SVN_ERR(svn_cache__get((void **)&text, &found, long_key_cache, key,
+                             iterpool));
+      if (found)
+        {
+          SVN_TEST_STRING_ASSERT(text->data, make_text(i, iterpool)->data);
+          ++*found_count;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_disk_cache(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *short_key_cache;
+  svn_cache__t *long_key_cache;
+  const char *sandbox;
+  const char *path;
+  apr_file_t *file;
+  apr_off_t offset;
+  apr_off_t file_size;
+  int found_count;
+  svn_revnum_t i;
+
+  /* The texts total about 1.6MB, which is more than the membuffer holds
+   * but fits into the on-disk tier without wrapping around. */
+  const svn_revnum_t text_count = 200;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "cache-test-disk-cache",
+                                    pool));
+  path = svn_dirent_join(sandbox, "cache", pool);
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 512*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_disk_cache(membuffer, path,
+                                              16*1024*1024, pool, pool));
+  SVN_ERR(create_text_caches(&short_key_cache, &long_key_cache, membuffer,
+                             pool));
+
+  for (i = 0; i < text_count; ++i)
+    {
+      svn_stringbuf_t *text = make_text(i, pool);
+      const char *key = apr_psprintf(pool, "text-%ld", i);
+
+      SVN_ERR(svn_cache__set(short_key_cache, &i, text, pool));
+      SVN_ERR(svn_cache__set(long_key_cache, key, text, pool));
+    }
+
+  /* Nothing got lost, despite the evictions. */
+  SVN_ERR(check_texts(&found_count, short_key_cache, long_key_cache,
+                      text_count, pool));
+  SVN_TEST_INT_ASSERT(found_count, 2 * text_count);
+
+  /* Another cache picks up where the first one left, e.g. after a server
+   * restart.  All texts that did not fit into the first membuffer must be
+   * in the file.  A text takes more than 4kB in the membuffer. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 512*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_disk_cache(membuffer, path,
+                                              16*1024*1024, pool, pool));
+  SVN_ERR(create_text_caches(&short_key_cache, &long_key_cache, membuffer,
+                             pool));
+
+  SVN_ERR(check_texts(&found_count, short_key_cache, long_key_cache,
+                      text_count, pool));
+  SVN_TEST_ASSERT(found_count >= 2 * text_count - 512 / 4);
+
+  /* Damage every record.  The texts are longer than our 2000 byte stride,
+   * so every record gets hit. */
+  SVN_ERR(svn_io_file_open(&file, path, APR_READ | APR_WRITE | APR_BINARY,
+                           APR_OS_DEFAULT, pool));
+  file_size = 0;
+  SVN_ERR(svn_io_file_seek(file, APR_END, &file_size, pool));
+  for (offset = 1000; offset < file_size; offset += 2000)
+    {
+      apr_off_t pos = offset;
+      char c;
+
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &pos, pool));
+      SVN_ERR(svn_io_file_getc(&c, file, pool));
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &pos, pool));
+      SVN_ERR(svn_io_file_putc((char)~c, file, pool));
+    }
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Damaged records are misses, not errors. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 512*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_disk_cache(membuffer, path,
+                                              16*1024*1024, pool, pool));
+  SVN_ERR(create_text_caches(&short_key_cache, &long_key_cache, membuffer,
+                             pool));
+
+  SVN_ERR(check_texts(&found_count, short_key_cache, long_key_cache,
+                      text_count, pool));
+  SVN_TEST_INT_ASSERT(found_count, 0);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -616,6 +1448,21 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_SKIP2(test_membuffer_concurrent_access,
+                   ! APR_HAS_THREADS,
+                   "concurrent membuffer cache access"),
+    SVN_TEST_PASS2(test_membuffer_shared_memory,
+                   "membuffer cache in shared memory"),
+    SVN_TEST_PASS2(test_membuffer_tinylfu,
+                   "membuffer cache with TinyLFU admission"),
+    SVN_TEST_PASS2(test_membuffer_key_snapshot,
+                   "membuffer cache key snapshots"),
+    SVN_TEST_PASS2(test_membuffer_partitions,
+                   "membuffer cache memory quota partitions"),
+    SVN_TEST_PASS2(test_membuffer_categories,
+                   "membuffer cache statistics per category"),
+    SVN_TEST_PASS2(test_membuffer_disk_cache,
+                   "membuffer cache with on-disk tier"),
     SVN_TEST_NULL
   };
 
@@ -27,6 +27,12 @@
 
 #include "svn_error.h"
 #include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_adler32.h"
+#include "private/svn_simd.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -364,6 +370,223 @@ test_checksummed_stream_reset(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return the Adler-32 checksum of the LEN bytes at DATA, starting with
+ * CHECKSUM, calculated byte by byte as described in RFC 1950. */
+static apr_uint32_t
+reference_adler32(apr_uint32_t checksum,
+                  const unsigned char *data,
+                  apr_size_t len)
+{
+  apr_uint32_t s1 = checksum & 0xFFFF;
+  apr_uint32_t s2 = checksum >> 16;
+
+  for (; len; --len, ++data)
+    {
+      s1 = (s1 + *data) % 65521;
+      s2 = (s2 + s1) % 65521;
+    }
+
+  return (s2 << 16) | s1;
+}
+
+/* Verify that svn__adler32() on the LEN bytes at DATA, starting with
+ * CHECKSUM, matches the reference and zlib results with and without
+ * vector code. */
+static svn_error_t *
+check_adler32(apr_uint32_t checksum,
+              const unsigned char *data,
+              apr_size_t len)
+{
+  static const apr_uint32_t masks[] =
+    { 0, SVN_SIMD__SSE2 | SVN_SIMD__NEON, SVN_SIMD__ALL };
+
+  apr_uint32_t expected = reference_adler32(checksum, data, len);
+  int i;
+
+  SVN_TEST_ASSERT(adler32(checksum, data, (uInt)len) == expected);
+
+  for (i = 0; i < (int)(sizeof(masks) / sizeof(masks[0])); ++i)
+    {
+      apr_uint32_t old_mask = svn_simd__set_feature_mask(masks[i]);
+      apr_uint32_t actual = svn__adler32(checksum, (const char *)data, len);
+
+      svn_simd__set_feature_mask(old_mask);
+
+      if (actual != expected)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Adler-32 mismatch for %d bytes with "
+                                 "feature mask 0x%x: expected 0x%08x, "
+                                 "got 0x%08x", (int)len,
+                                 (unsigned)masks[i], (unsigned)expected,
+                                 (unsigned)actual);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_adler32(apr_pool_t *pool)
+{
+  /* Long enough for several overflow-avoiding reductions per call. */
+  enum { max_len = 3 * 5552 + 100 };
+
+  unsigned char *data = apr_palloc(pool, max_len);
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t len, k;
+  int i;
+
+  /* Edge cases: all bytes 0xff maximizes the intermediate sums.  Cover
+   * all lengths around the vector sizes and the reduction interval. */
+  memset(data, 0xff, max_len);
+  for (len = 0; len < 200; ++len)
+    {
+      SVN_ERR(check_adler32(1, data, len));
+      SVN_ERR(check_adler32(0xfff0fff0, data, len));
+    }
+  for (len = 5552 - 40; len < 5552 + 40; ++len)
+    SVN_ERR(check_adler32(1, data, len));
+  SVN_ERR(check_adler32(0xfff0fff0, data, max_len));
+
+  memset(data, 0, max_len);
+  SVN_ERR(check_adler32(1, data, max_len));
+
+  /* Random data with random length, alignment and start value. */
+  for (i = 0; i < 200; ++i)
+    {
+      apr_size_t offset = svn_test_rand(&seed) % 32;
+      apr_uint32_t checksum = ((svn_test_rand(&seed) % 65521) << 16)
+                            | (svn_test_rand(&seed) % 65521);
+
+      len = svn_test_rand(&seed) % (max_len - offset);
+      for (k = 0; k < max_len; ++k)
+        data[k] = (unsigned char)svn_test_rand(&seed);
+
+      SVN_ERR(check_adler32(checksum, data + offset, len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_multi_checksum(apr_pool_t *pool)
+{
+  static const svn_checksum_kind_t kinds[] =
+    { svn_checksum_md5, svn_checksum_sha1, svn_checksum_fnv1a_32x4 };
+
+  /* Chunk sizes below and above the block and threading thresholds. */
+  static const apr_size_t chunk_sizes[] = { 1, 1000, 0x2001, 0x30000 };
+
+  enum { data_size = 0x100000 };
+
+  char *data = apr_palloc(pool, data_size);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t i;
+  int k, use_thread;
+
+  for (i = 0; i < data_size; ++i)
+    data[i] = (char)svn_test_rand(&seed);
+
+  for (use_thread = 0; use_thread < 2; ++use_thread)
+    for (k = 0; k < (int)(sizeof(chunk_sizes) / sizeof(chunk_sizes[0])); ++k)
+      {
+        svn_checksum__multi_ctx_t *ctx;
+        apr_size_t offset;
+        int m;
+
+        svn_pool_clear(iterpool);
+
+        /* Calculate the checksums twice using the same context. */
+        ctx = svn_checksum__multi_ctx_create(kinds, 3, use_thread,
+                                             iterpool);
+        SVN_ERR(svn_checksum__multi_update(ctx, "garbage", 7));
+        SVN_ERR(svn_checksum__multi_ctx_reset(ctx));
+
+        for (offset = 0; offset < data_size; offset += chunk_sizes[k])
+          SVN_ERR(svn_checksum__multi_update(ctx, data + offset,
+                                             MIN(chunk_sizes[k],
+                                                 data_size - offset)));
+
+        /* Finalize in reverse order of the kinds. */
+        for (m = 2; m >= 0; --m)
+          {
+            svn_checksum_t *expected, *actual;
+
+            SVN_ERR(svn_checksum(&expected, kinds[m], data, data_size,
+                                 iterpool));
+            SVN_ERR(svn_checksum__multi_final(&actual, ctx, kinds[m],
+                                              iterpool));
+            SVN_TEST_ASSERT(svn_checksum_match(expected, actual));
+          }
+      }
+
+  /* Kinds that have not been requested cannot be finalized. */
+  {
+    svn_checksum__multi_ctx_t *ctx
+      = svn_checksum__multi_ctx_create(kinds, 1, FALSE, iterpool);
+    svn_checksum_t *checksum;
+
+    SVN_TEST_ASSERT_ERROR(svn_checksum__multi_final(&checksum, ctx,
+                                                    svn_checksum_sha1,
+                                                    iterpool),
+                          SVN_ERR_BAD_CHECKSUM_KIND);
+  }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_md5_sha1_stream(apr_pool_t *pool)
+{
+  enum { data_size = 0x40000 };
+
+  char *data = apr_palloc(pool, data_size);
+  apr_uint32_t seed = 0x5eed;
+  svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+  svn_checksum_t *md5_checksum, *sha1_checksum, *expected;
+  svn_stream_t *stream;
+  apr_size_t i, len;
+
+  for (i = 0; i < data_size; ++i)
+    data[i] = (char)svn_test_rand(&seed);
+
+  /* Both checksums, written in one go and in small pieces. */
+  stream = svn_checksum__wrap_write_stream_md5_sha1(
+             &md5_checksum, &sha1_checksum,
+             svn_stream_from_stringbuf(target, pool), TRUE, pool);
+
+  len = data_size / 2;
+  SVN_ERR(svn_stream_write(stream, data, &len));
+  for (i = data_size / 2; i < data_size; i += len)
+    {
+      len = MIN(100, data_size - i);
+      SVN_ERR(svn_stream_write(stream, data + i, &len));
+    }
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(target->len == data_size);
+  SVN_TEST_ASSERT(memcmp(target->data, data, data_size) == 0);
+
+  SVN_ERR(svn_checksum(&expected, svn_checksum_md5, data, data_size, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(expected, md5_checksum));
+  SVN_ERR(svn_checksum(&expected, svn_checksum_sha1, data, data_size, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(expected, sha1_checksum));
+
+  /* Only the SHA1 checksum. */
+  sha1_checksum = NULL;
+  stream = svn_checksum__wrap_write_stream_md5_sha1(NULL, &sha1_checksum,
+                                                    svn_stream_empty(pool),
+                                                    FALSE, pool);
+  len = data_size;
+  SVN_ERR(svn_stream_write(stream, data, &len));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_TEST_ASSERT(svn_checksum_match(expected, sha1_checksum));
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -389,6 +612,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "read from checksummed stream"),
     SVN_TEST_PASS2(test_checksummed_stream_reset,
                    "reset checksummed stream"),
+    SVN_TEST_PASS2(test_adler32,
+                   "Adler-32 with and without vector code"),
+    SVN_TEST_PASS2(test_multi_checksum,
+                   "single-pass multi-digest checksums"),
+    SVN_TEST_PASS2(test_md5_sha1_stream,
+                   "MD5 and SHA1 checksumming write stream"),
     SVN_TEST_NULL
   };
 
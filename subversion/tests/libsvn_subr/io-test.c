@@ -28,9 +28,11 @@
 #include <apr.h>
 #include <apr_version.h>
 
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_string.h"
 #include "svn_io.h"
+#include "private/svn_batch_fsync.h"
 #include "private/svn_skel.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_io_private.h"
@@ -1010,6 +1012,66 @@ test_install_stream_over_readonly_file(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_install_stream_replace_and_delete(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *final_abspath;
+  svn_stream_t *stream;
+  svn_stringbuf_t *actual_content;
+  apr_finfo_t finfo;
+  apr_hash_t *dirents;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir,
+                                    "test_install_stream_replace_and_delete",
+                                    pool));
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_join(tmp_dir, "tmp", pool),
+                                      pool));
+  final_abspath = svn_dirent_join(tmp_dir, "file", pool);
+
+  /* Install a new file. */
+  SVN_ERR(svn_stream__create_for_install(&stream,
+                                         svn_dirent_join(tmp_dir, "tmp", pool),
+                                         pool, pool));
+  SVN_ERR(svn_stream_puts(stream, "first"));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_stream__install_get_info(&finfo, stream, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size == 5);
+  SVN_ERR(svn_stream__install_stream(stream, final_abspath, FALSE, pool));
+
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content, final_abspath, pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "first");
+
+  /* Replace it. */
+  SVN_ERR(svn_stream__create_for_install(&stream,
+                                         svn_dirent_join(tmp_dir, "tmp", pool),
+                                         pool, pool));
+  SVN_ERR(svn_stream_puts(stream, "second"));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_stream__install_stream(stream, final_abspath, FALSE, pool));
+
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content, final_abspath, pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "second");
+
+  /* Delete an install stream. */
+  SVN_ERR(svn_stream__create_for_install(&stream,
+                                         svn_dirent_join(tmp_dir, "tmp", pool),
+                                         pool, pool));
+  SVN_ERR(svn_stream_puts(stream, "third"));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_stream__install_delete(stream, pool));
+
+  /* No temporary files must be left behind. */
+  SVN_ERR(svn_io_get_dirents3(&dirents, svn_dirent_join(tmp_dir, "tmp", pool),
+                              TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 0);
+
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content, final_abspath, pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "second");
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_file_size_get(apr_pool_t *pool)
 {
@@ -1147,6 +1209,230 @@ test_apr_trunc_workaround(apr_pool_t *pool)
   return SVN_NO_ERROR;  
 }
 
+static svn_error_t *
+test_file_copy_contents(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *src_path, *dst_path;
+  svn_stringbuf_t *data, *actual;
+  apr_file_t *src_file, *dst_file;
+  apr_off_t offset;
+  apr_size_t i;
+  int buffered;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_file_copy_contents",
+                                    pool));
+
+  /* Large enough to span several file system blocks. */
+  data = svn_stringbuf_create_ensure(300000, pool);
+  for (i = 0; i < 300000; ++i)
+    svn_stringbuf_appendbyte(data, (char)('a' + (i * 7 + i / 4096) % 26));
+
+  src_path = svn_dirent_join(tmp_dir, "src", pool);
+  dst_path = svn_dirent_join(tmp_dir, "dst", pool);
+  SVN_ERR(svn_io_file_create_bytes(src_path, data->data, data->len, pool));
+
+  /* Whole file copies. */
+  SVN_ERR(svn_io_copy_file(src_path, dst_path, TRUE, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&actual, dst_path, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(actual, data));
+
+  SVN_ERR(svn_io_remove_file2(src_path, FALSE, pool));
+  SVN_ERR(svn_io_file_create_empty(src_path, pool));
+  SVN_ERR(svn_io_copy_file(src_path, dst_path, TRUE, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&actual, dst_path, pool));
+  SVN_TEST_ASSERT(actual->len == 0);
+
+  /* Partial copies, appended to existing content.  Buffered files must
+   * fall back to the user-space copy. */
+  SVN_ERR(svn_io_remove_file2(src_path, FALSE, pool));
+  SVN_ERR(svn_io_file_create_bytes(src_path, data->data, data->len, pool));
+  for (buffered = 0; buffered < 2; ++buffered)
+    {
+      apr_int32_t flags = buffered ? APR_BUFFERED : 0;
+      svn_stringbuf_t *expected;
+
+      SVN_ERR(svn_io_remove_file2(dst_path, TRUE, pool));
+      SVN_ERR(svn_io_file_create(dst_path, "prefix", pool));
+      SVN_ERR(svn_io_file_open(&src_file, src_path, APR_READ | flags,
+                               APR_OS_DEFAULT, pool));
+      SVN_ERR(svn_io_file_open(&dst_file, dst_path,
+                               APR_READ | APR_WRITE | flags,
+                               APR_OS_DEFAULT, pool));
+
+      offset = 4321;
+      SVN_ERR(svn_io_file_seek(src_file, APR_SET, &offset, pool));
+      offset = 0;
+      SVN_ERR(svn_io_file_seek(dst_file, APR_END, &offset, pool));
+
+      SVN_ERR(svn_io__file_copy_contents(dst_file, src_file, FALSE,
+                                         NULL, NULL, pool));
+
+      /* Both files must be positioned behind the data copied. */
+      offset = 0;
+      SVN_ERR(svn_io_file_seek(src_file, APR_CUR, &offset, pool));
+      SVN_TEST_ASSERT(offset == (apr_off_t)data->len);
+      offset = 0;
+      SVN_ERR(svn_io_file_seek(dst_file, APR_CUR, &offset, pool));
+      SVN_TEST_ASSERT(offset == (apr_off_t)(data->len - 4321 + 6));
+
+      SVN_ERR(svn_io_file_close(src_file, pool));
+      SVN_ERR(svn_io_file_close(dst_file, pool));
+
+      expected = svn_stringbuf_create("prefix", pool);
+      svn_stringbuf_appendbytes(expected, data->data + 4321,
+                                data->len - 4321);
+      SVN_ERR(svn_stringbuf_from_file2(&actual, dst_path, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(actual, expected));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_get_dirents(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *file_path;
+  apr_hash_t *dirents;
+  const svn_io_dirent2_t *dirent;
+  apr_finfo_t finfo;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_get_dirents", pool));
+
+  file_path = svn_dirent_join(tmp_dir, "file", pool);
+  SVN_ERR(svn_io_file_create(file_path, "content", pool));
+  SVN_ERR(svn_io_dir_make(svn_dirent_join(tmp_dir, "dir", pool),
+                          APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_stat(&finfo, file_path, APR_FINFO_MTIME, pool));
+
+  /* Everything, as in svn_io_get_dirents3. */
+  SVN_ERR(svn_io_get_dirents3(&dirents, tmp_dir, FALSE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+
+  dirent = svn_hash_gets(dirents, "file");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+  SVN_TEST_ASSERT(!dirent->special);
+  SVN_TEST_ASSERT(dirent->filesize == 7);
+  SVN_TEST_ASSERT(dirent->mtime == finfo.mtime);
+
+  dirent = svn_hash_gets(dirents, "dir");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_dir);
+  SVN_TEST_ASSERT(dirent->mtime != 0);
+
+  /* Node kinds only. */
+  SVN_ERR(svn_io_get_dirents3(&dirents, tmp_dir, TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+
+  dirent = svn_hash_gets(dirents, "file");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+  dirent = svn_hash_gets(dirents, "dir");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_dir);
+
+  SVN_ERR(svn_io__get_dirents(&dirents, tmp_dir, FALSE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+
+  dirent = svn_hash_gets(dirents, "file");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+  dirent = svn_hash_gets(dirents, "dir");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_dir);
+
+  /* File sizes and timestamps must be available and match svn_io_stat. */
+  SVN_ERR(svn_io__get_dirents(&dirents, tmp_dir, TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+
+  dirent = svn_hash_gets(dirents, "file");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+  SVN_TEST_ASSERT(dirent->filesize == 7);
+  SVN_TEST_ASSERT(dirent->mtime == finfo.mtime);
+  dirent = svn_hash_gets(dirents, "dir");
+  SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_dir);
+
+  /* Missing directories. */
+  {
+    svn_error_t *err = svn_io__get_dirents(&dirents,
+                                           svn_dirent_join(tmp_dir, "missing",
+                                                           pool),
+                                           TRUE, pool, pool);
+    SVN_TEST_ASSERT(err && APR_STATUS_IS_ENOENT(err->apr_err));
+    svn_error_clear(err);
+
+    err = svn_io_get_dirents3(&dirents, file_path, TRUE, pool, pool);
+    SVN_TEST_ASSERT(err && SVN__APR_STATUS_IS_ENOTDIR(err->apr_err));
+    svn_error_clear(err);
+  }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_batch_fsync_add_file(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *path;
+  svn_stringbuf_t *contents;
+  svn_batch_fsync__t *batch;
+  apr_file_t *file;
+  apr_finfo_t finfo;
+  svn_boolean_t read_only;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_batch_fsync_add_file",
+                                    pool));
+  SVN_ERR(svn_batch_fsync__init(pool));
+  SVN_ERR(svn_batch_fsync__create(&batch, TRUE, pool));
+
+  /* Closed files, some of them read-only, plus their directory entries.
+   * Scheduling a file twice is fine. */
+  for (i = 0; i < 20; ++i)
+    {
+      path = svn_dirent_join(tmp_dir, apr_psprintf(pool, "%d", i), pool);
+      SVN_ERR(svn_io_file_create(path, path, pool));
+      if (i % 2)
+        SVN_ERR(svn_io_set_file_read_only(path, FALSE, pool));
+
+      SVN_ERR(svn_batch_fsync__add_file(batch, path, pool));
+      SVN_ERR(svn_batch_fsync__add_file(batch, path, pool));
+      SVN_ERR(svn_batch_fsync__new_path(batch, path, pool));
+    }
+
+  /* Mixed with an open file, scheduled after the fact. */
+  path = svn_dirent_join(tmp_dir, "open", pool);
+  SVN_ERR(svn_io_file_create(path, "", pool));
+  SVN_ERR(svn_batch_fsync__add_file(batch, path, pool));
+  SVN_ERR(svn_batch_fsync__open_file(&file, batch, path, pool));
+  SVN_ERR(svn_io_file_write_full(file, "data", 4, NULL, pool));
+
+  SVN_ERR(svn_batch_fsync__run(batch, pool));
+
+  /* The data must be intact and the batch reusable. */
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "data");
+  path = svn_dirent_join(tmp_dir, "0", pool);
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, path);
+
+  /* Read-only files must stay read-only. */
+  path = svn_dirent_join(tmp_dir, "1", pool);
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_PROT | APR_FINFO_OWNER, pool));
+  SVN_ERR(svn_io__is_finfo_read_only(&read_only, &finfo, pool));
+  SVN_TEST_ASSERT(read_only);
+
+  SVN_ERR(svn_batch_fsync__add_file(batch, path, pool));
+  SVN_ERR(svn_batch_fsync__run(batch, pool));
+
+  /* Missing files get reported. */
+  SVN_ERR(svn_batch_fsync__add_file(batch,
+                                    svn_dirent_join(tmp_dir, "missing", pool),
+                                    pool));
+  err = svn_batch_fsync__run(batch, pool);
+  SVN_TEST_ASSERT(err && APR_STATUS_IS_ENOENT(err->apr_err));
+  svn_error_clear(err);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 3;
@@ -1184,6 +1470,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_open_uniquely_named()"),
     SVN_TEST_PASS2(test_apr_trunc_workaround,
                    "test workaround for APR in svn_io_file_trunc"),
+    SVN_TEST_PASS2(test_file_copy_contents,
+                   "test svn_io__file_copy_contents"),
+    SVN_TEST_PASS2(test_get_dirents,
+                   "test svn_io_get_dirents3 and svn_io__get_dirents"),
+    SVN_TEST_PASS2(test_batch_fsync_add_file,
+                   "test svn_batch_fsync__add_file"),
+    SVN_TEST_PASS2(test_install_stream_replace_and_delete,
+                   "test replacing and deleting install streams"),
     SVN_TEST_NULL
   };
 
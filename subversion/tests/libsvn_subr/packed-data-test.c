@@ -36,6 +36,7 @@
 
 #include "svn_error.h"
 #include "svn_string.h"   /* This includes <apr_*.h> */
+#include "svn_sorts.h"
 #include "private/svn_packed_data.h"
 
 /* Take the WRITE_ROOT, serialize its contents, parse it again into a new
@@ -553,6 +554,104 @@ test_full_structure(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Check that COUNT numbers from VALUES written in blocks of varying sizes
+ * with svn_packed__add_uints can be read back in blocks of other sizes
+ * with svn_packed__get_uints.  Use a stream with SUBSTREAMS sub-streams
+ * and deltify data if DIFF is set.  Use POOL for allocations.
+ */
+static svn_error_t *
+verify_uints_stream(const apr_uint64_t *values,
+                    apr_size_t count,
+                    int substreams,
+                    svn_boolean_t diff,
+                    apr_pool_t *pool)
+{
+  svn_packed__data_root_t *root = svn_packed__data_create_root(pool);
+  svn_packed__int_stream_t *stream
+    = svn_packed__create_int_stream(root, diff, FALSE);
+  apr_uint64_t *read_values = apr_palloc(pool, (count + 3)
+                                               * sizeof(*read_values));
+  apr_size_t i;
+  apr_size_t block;
+  int k;
+
+  for (k = 0; k < substreams; ++k)
+    svn_packed__create_int_substream(stream, diff, FALSE);
+
+  /* write in blocks of 0 .. 22 numbers, interleaved with single numbers */
+  for (i = 0, block = 0; i < count; block = (block + 5) % 23)
+    {
+      apr_size_t to_add = MIN(block, count - i);
+      svn_packed__add_uints(stream, values + i, to_add);
+      i += to_add;
+
+      if (i < count)
+        svn_packed__add_uint(stream, values[i++]);
+    }
+
+  SVN_ERR(get_read_root(&root, root, pool));
+  stream = svn_packed__first_int_stream(root);
+  SVN_TEST_ASSERT(stream);
+
+  /* read in blocks of 0 .. 16 numbers, interleaved with single numbers */
+  for (i = 0, block = 0; i < count; block = (block + 3) % 17)
+    {
+      apr_size_t to_get = MIN(block, count - i);
+      svn_packed__get_uints(stream, read_values + i, to_get);
+      i += to_get;
+
+      if (i < count)
+        read_values[i++] = svn_packed__get_uint(stream);
+    }
+
+  for (i = 0; i < count; ++i)
+    SVN_TEST_ASSERT(read_values[i] == values[i]);
+
+  /* reading beyond eos should return 0 values */
+  read_values[count] = 1;
+  read_values[count + 1] = 1;
+  read_values[count + 2] = 1;
+  svn_packed__get_uints(stream, read_values + count, 3);
+  SVN_TEST_ASSERT(read_values[count] == 0);
+  SVN_TEST_ASSERT(read_values[count + 1] == 0);
+  SVN_TEST_ASSERT(read_values[count + 2] == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_uints_stream(apr_pool_t *pool)
+{
+  enum { COUNT = 1000 };
+  apr_uint64_t *values = apr_palloc(pool, COUNT * sizeof(*values));
+  apr_uint64_t seed = 0x1234567;
+  apr_size_t i;
+
+  /* Runs of small numbers that fit into a single byte, interrupted by
+     occasional multi-byte and extreme values. */
+  for (i = 0; i < COUNT; ++i)
+    {
+      seed = seed * APR_UINT64_C(6364136223846793005)
+           + APR_UINT64_C(1442695040888963407);
+      if (i % 37 == 0)
+        values[i] = APR_UINT64_MAX - (i % 3);
+      else if (i % 11 == 0)
+        values[i] = seed;
+      else if (i % 7 == 0)
+        values[i] = (seed >> 40) & 0x3fff;
+      else
+        values[i] = (seed >> 33) & 0x3f;
+    }
+
+  SVN_ERR(verify_uints_stream(values, COUNT, 0, FALSE, pool));
+  SVN_ERR(verify_uints_stream(values, COUNT, 0, TRUE, pool));
+  SVN_ERR(verify_uints_stream(values, COUNT, 3, FALSE, pool));
+  SVN_ERR(verify_uints_stream(values, COUNT, 3, TRUE, pool));
+  SVN_ERR(verify_uints_stream(values, 5, 0, FALSE, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -572,6 +671,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test empty, nested structure"),
     SVN_TEST_PASS2(test_full_structure,
                    "test nested structure"),
+    SVN_TEST_PASS2(test_uints_stream,
+                   "test bulk uint reads and writes"),
     SVN_TEST_NULL
   };
 
@@ -22,6 +22,7 @@
  */
 
 #include "svn_types.h"
+#include "svn_pools.h"
 
 #include "private/svn_subr_private.h"
 
@@ -102,6 +103,15 @@ test_spillbuf_basic_spill_all(apr_pool_t *pool)
   return test_spillbuf__basic(pool, len, buf);
 }
 
+static svn_error_t *
+test_spillbuf_basic_write_behind(apr_pool_t *pool)
+{
+  apr_size_t len = strlen(basic_data);  /* Don't include basic_data's NUL  */
+  svn_spillbuf_t *buf =
+    svn_spillbuf__create_write_behind(len, 10 * len, 2 * len, pool);
+  return test_spillbuf__basic(pool, len, buf);
+}
+
 static svn_error_t *
 read_callback(svn_boolean_t *stop,
               void *baton,
@@ -165,6 +175,17 @@ test_spillbuf_callback_spill_all(apr_pool_t *pool)
   return test_spillbuf__callback(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_callback_write_behind(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(
+                          sizeof(basic_data) /* blocksize */,
+                          10 * sizeof(basic_data) /* maxsize */,
+                          2 * sizeof(basic_data) /* max_pending */,
+                          pool);
+  return test_spillbuf__callback(pool, buf);
+}
+
 static svn_error_t *
 test_spillbuf__file(apr_pool_t *pool, apr_size_t altsize, svn_spillbuf_t *buf)
 {
@@ -253,6 +274,18 @@ test_spillbuf_file_spill_all(apr_pool_t *pool)
   return test_spillbuf__file(pool, altsize, buf);
 }
 
+static svn_error_t *
+test_spillbuf_file_write_behind(apr_pool_t *pool)
+{
+  apr_size_t altsize = sizeof(basic_data) + 2;
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(
+                          altsize /* blocksize */,
+                          2 * sizeof(basic_data) /* maxsize */,
+                          altsize /* max_pending */,
+                          pool);
+  return test_spillbuf__file(pool, altsize, buf);
+}
+
 static svn_error_t *
 test_spillbuf__interleaving(apr_pool_t *pool, svn_spillbuf_t* buf)
 {
@@ -304,6 +337,16 @@ test_spillbuf_interleaving_spill_all(apr_pool_t *pool)
   return test_spillbuf__interleaving(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_interleaving_write_behind(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(8 /* blocksize */,
+                                                          15 /* maxsize */,
+                                                          8 /* max_pending */,
+                                                          pool);
+  return test_spillbuf__interleaving(pool, buf);
+}
+
 static svn_error_t *
 test_spillbuf_reader(apr_pool_t *pool)
 {
@@ -439,6 +482,16 @@ test_spillbuf_rwfile_spill_all(apr_pool_t *pool)
   return test_spillbuf__rwfile(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_rwfile_write_behind(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(4 /* blocksize */,
+                                                          10 /* maxsize */,
+                                                          4 /* max_pending */,
+                                                          pool);
+  return test_spillbuf__rwfile(pool, buf);
+}
+
 static svn_error_t *
 test_spillbuf__eof(apr_pool_t *pool, svn_spillbuf_t *buf)
 {
@@ -510,6 +563,16 @@ test_spillbuf_eof_spill_all(apr_pool_t *pool)
   return test_spillbuf__eof(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_eof_write_behind(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(4 /* blocksize */,
+                                                          10 /* maxsize */,
+                                                          4 /* max_pending */,
+                                                          pool);
+  return test_spillbuf__eof(pool, buf);
+}
+
 static svn_error_t *
 test_spillbuf__file_attrs(apr_pool_t *pool, svn_boolean_t spill_all,
                           svn_spillbuf_t *buf)
@@ -558,6 +621,67 @@ test_spillbuf_file_attrs_spill_all(apr_pool_t *pool)
   return test_spillbuf__file_attrs(pool, TRUE, buf);
 }
 
+static svn_error_t *
+test_spillbuf_write_behind_stress(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_write_behind(100 /* blocksize */,
+                                                          1000 /* maxsize */,
+                                                          300 /* max_pending */,
+                                                          pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  char data[250];
+  apr_size_t nwritten = 0;
+  apr_size_t nread = 0;
+  const char *readptr;
+  apr_size_t readlen;
+  apr_size_t i, k;
+
+  /* Write chunks of varying size, interleaved with reads, and verify
+     that everything comes back in order.  The queue is small enough to
+     make the producer wait for the writer every now and then. */
+  for (i = 0; i < 500; ++i)
+    {
+      apr_size_t len = (i * 7) % sizeof(data) + 1;
+
+      svn_pool_clear(iterpool);
+
+      for (k = 0; k < len; ++k)
+        data[k] = (char)((nwritten + k) % 251);
+      SVN_ERR(svn_spillbuf__write(buf, data, len, iterpool));
+      nwritten += len;
+
+      if (i % 3 == 0)
+        {
+          SVN_ERR(svn_spillbuf__read(&readptr, &readlen, buf, iterpool));
+          SVN_TEST_ASSERT(readptr != NULL);
+          for (k = 0; k < readlen; ++k)
+            SVN_TEST_ASSERT(readptr[k] == (char)((nread + k) % 251));
+          nread += readlen;
+        }
+
+      SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) == nwritten - nread);
+    }
+
+  while (TRUE)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_spillbuf__read(&readptr, &readlen, buf, iterpool));
+      if (readptr == NULL)
+        break;
+
+      for (k = 0; k < readlen; ++k)
+        SVN_TEST_ASSERT(readptr[k] == (char)((nread + k) % 251));
+      nread += readlen;
+    }
+
+  SVN_TEST_ASSERT(nread == nwritten);
+  SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) == 0);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -589,6 +713,20 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_PASS2(test_spillbuf_file_attrs, "check spill file properties"),
     SVN_TEST_PASS2(test_spillbuf_file_attrs_spill_all,
                    "check spill file properties (spill-all-data)"),
+    SVN_TEST_PASS2(test_spillbuf_basic_write_behind,
+                   "basic spill buffer test (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_callback_write_behind,
+                   "spill buffer read callback (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_file_write_behind,
+                   "spill buffer file test (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_interleaving_write_behind,
+                   "interleaving reads and writes (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_rwfile_write_behind,
+                   "read/write spill file (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_eof_write_behind,
+                   "validate reaching EOF (write-behind)"),
+    SVN_TEST_PASS2(test_spillbuf_write_behind_stress,
+                   "interleaved reads and writes with a full queue"),
     SVN_TEST_NULL
   };
 
@@ -1000,6 +1000,86 @@ test_stream_readline_file_crlf(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_stream_mapped_file(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *tmp_file;
+  svn_stringbuf_t *data;
+  svn_stringbuf_t *line;
+  svn_stream_t *stream;
+  svn_stream_mark_t *mark;
+  apr_file_t *file;
+  svn_boolean_t eof;
+  svn_boolean_t available;
+  char buffer[100];
+  apr_size_t len;
+  int i;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_stream_mapped_file",
+                                    pool));
+
+  /* Numbered lines with mixed EOLs, large enough to get mapped. */
+  data = svn_stringbuf_create_ensure(SVN__STREAM_MMAP_THRESHOLD + 100, pool);
+  for (i = 0; data->len < SVN__STREAM_MMAP_THRESHOLD; ++i)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "line %d%s", i,
+                                                i % 3 ? "\n" : "\r\n"));
+  svn_stringbuf_appendcstr(data, "last\r");
+
+  tmp_file = svn_dirent_join(tmp_dir, "large", pool);
+  SVN_ERR(svn_io_file_create_bytes(tmp_file, data->data, data->len, pool));
+
+  SVN_ERR(svn_io_file_open(&file, tmp_file, APR_READ, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_stream__from_aprfile_mapped(&stream, file, pool, pool));
+
+  /* Read and skip. */
+  len = 6;
+  SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+  SVN_TEST_ASSERT(len == 6 && memcmp(buffer, "line 0", 6) == 0);
+  SVN_ERR(svn_stream_skip(stream, 2));
+  SVN_ERR(svn_stream_mark(stream, &mark, pool));
+
+  SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "line 1");
+  SVN_TEST_ASSERT(!eof);
+  SVN_ERR(svn_stream_readline(stream, &line, "\r\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "line 2\nline 3");
+  SVN_TEST_ASSERT(!eof);
+
+  /* Seek back to the mark and to the start. */
+  SVN_ERR(svn_stream_seek(stream, mark));
+  SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "line 1");
+
+  SVN_ERR(svn_stream_reset(stream));
+  SVN_ERR(svn_stream_readline(stream, &line, "\r\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "line 0");
+
+  /* Skip to the very end.  Partial EOLs must not match. */
+  SVN_ERR(svn_stream_skip(stream, data->len - 5 - 8));
+  SVN_ERR(svn_stream_data_available(stream, &available));
+  SVN_TEST_ASSERT(available);
+  SVN_ERR(svn_stream_readline(stream, &line, "\r\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "last\r");
+  SVN_TEST_ASSERT(eof);
+
+  SVN_ERR(svn_stream_data_available(stream, &available));
+  SVN_TEST_ASSERT(!available);
+  len = sizeof(buffer);
+  SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+  SVN_TEST_ASSERT(len == 0);
+  SVN_ERR(svn_stream_skip(stream, 10));
+
+  /* Full contents. */
+  SVN_ERR(svn_stream_reset(stream));
+  SVN_ERR(svn_stringbuf_from_stream(&line, stream, 0, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(line, data));
+
+  SVN_ERR(svn_stream_close(stream));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1037,6 +1117,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading LF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_crlf,
                    "test reading CRLF-terminated lines from file"),
+    SVN_TEST_PASS2(test_stream_mapped_file,
+                   "test memory mapped file streams"),
     SVN_TEST_NULL
   };
 
@@ -31,6 +31,9 @@
 #include "svn_string.h"
 #include "svn_subst.h"
 #include "svn_hash.h"
+#include "svn_pools.h"
+
+#include "private/svn_simd.h"
 
 #define ARRAY_LEN(ary) ((sizeof (ary)) / (sizeof ((ary)[0])))
 
@@ -500,6 +503,88 @@ test_svn_subst_long_keywords(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Translate SOURCE with the EOL_STR, KEYWORDS and EXPAND parameters as
+ * for svn_subst_translate_cstring2() once with and once without vector
+ * code and verify that both produce the same result.  Use POOL for
+ * allocations. */
+static svn_error_t *
+check_simd_translation(const char *source,
+                       const char *eol_str,
+                       apr_hash_t *keywords,
+                       svn_boolean_t expand,
+                       apr_pool_t *pool)
+{
+  const char *scalar_result, *simd_result;
+  apr_uint32_t old_mask = svn_simd__set_feature_mask(0);
+  svn_error_t *err = svn_subst_translate_cstring2(source, &scalar_result,
+                                                  eol_str, TRUE, keywords,
+                                                  expand, pool);
+
+  svn_simd__set_feature_mask(SVN_SIMD__ALL);
+  if (!err)
+    err = svn_subst_translate_cstring2(source, &simd_result, eol_str, TRUE,
+                                       keywords, expand, pool);
+
+  svn_simd__set_feature_mask(old_mask);
+  SVN_ERR(err);
+
+  SVN_TEST_STRING_ASSERT(simd_result, scalar_result);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_svn_subst_translate_simd(apr_pool_t *pool)
+{
+  /* Things that need translation, mixed with some that don't. */
+  static const char *specials[] =
+    { "\n", "\r\n", "\r", "\n\r", "$", "$$", "$Rev$", "$Rev: 1 $",
+      "$Id$", "$Unknown$", "$Rev\n$", "x" };
+  static const char *eol_strs[] = { "\n", "\r\n", NULL };
+  apr_hash_t *keywords = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0x5eed;
+  int i, k;
+
+  svn_hash_sets(keywords, "Rev", svn_string_create("42", pool));
+  svn_hash_sets(keywords, "Id", svn_string_create("file 42", pool));
+
+  for (i = 0; i < 200; ++i)
+    {
+      svn_stringbuf_t *source;
+
+      svn_pool_clear(iterpool);
+      source = svn_stringbuf_create_empty(iterpool);
+
+      /* Runs of boring text of various lengths, such that the interesting
+         chars end up at all positions within the vectors. */
+      while (source->len < 2000)
+        {
+          apr_uint32_t run = svn_test_rand(&seed) % 80;
+          apr_uint32_t special = svn_test_rand(&seed) % ARRAY_LEN(specials);
+
+          while (run--)
+            svn_stringbuf_appendbyte(source, (char)('a' + run % 26));
+
+          svn_stringbuf_appendcstr(source, specials[special]);
+        }
+
+      for (k = 0; k < (int)ARRAY_LEN(eol_strs); ++k)
+        {
+          SVN_ERR(check_simd_translation(source->data, eol_strs[k], NULL,
+                                         FALSE, iterpool));
+          SVN_ERR(check_simd_translation(source->data, eol_strs[k],
+                                         keywords, TRUE, iterpool));
+          SVN_ERR(check_simd_translation(source->data, eol_strs[k],
+                                         keywords, FALSE, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -519,6 +604,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test truncated keywords (issue 4349)"),
     SVN_TEST_PASS2(test_svn_subst_long_keywords,
                    "test long keywords (issue 4350)"),
+    SVN_TEST_PASS2(test_svn_subst_translate_simd,
+                   "test vectorized EOL and keyword scanning"),
     SVN_TEST_NULL
   };
 
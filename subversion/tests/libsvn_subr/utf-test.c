@@ -27,6 +27,7 @@
 
 #include "private/svn_string_private.h"
 #include "private/svn_utf_private.h"
+#include "private/svn_simd.h"
 
 /* Random number seed.  Yes, it's global, just pretend you can't see it. */
 static apr_uint32_t diff_diff3_seed;
@@ -215,6 +216,171 @@ utf_validate2(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Verify that svn_utf__last_valid() and svn_utf__is_valid() agree with
+   svn_utf__last_valid2() on the LEN bytes at DATA, regardless of which
+   vectorized code paths may be used.  Use TEST_NAME and I to identify
+   the failing case. */
+static svn_error_t *
+check_simd_validation(const char *data,
+                      apr_size_t len,
+                      const char *test_name,
+                      int i)
+{
+  static const apr_uint32_t masks[] =
+    { SVN_SIMD__ALL, SVN_SIMD__ALL & ~SVN_SIMD__AVX2, 0 };
+  const char *expected = svn_utf__last_valid2(data, len);
+  int k;
+
+  for (k = 0; k < (int)(sizeof(masks) / sizeof(masks[0])); ++k)
+    {
+      apr_uint32_t old_mask = svn_simd__set_feature_mask(masks[k]);
+      const char *last_valid = svn_utf__last_valid(data, len);
+      svn_boolean_t is_valid = svn_utf__is_valid(data, len);
+
+      svn_simd__set_feature_mask(old_mask);
+
+      if (last_valid != expected)
+        return svn_error_createf
+          (SVN_ERR_TEST_FAILED, NULL,
+           "%s test %d failed for feature mask 0x%x: "
+           "last_valid returned %d instead of %d",
+           test_name, i, masks[k],
+           (int)(last_valid - data), (int)(expected - data));
+
+      if (is_valid != (expected == data + len))
+        return svn_error_createf
+          (SVN_ERR_TEST_FAILED, NULL,
+           "%s test %d failed for feature mask 0x%x: is_valid returned %d",
+           test_name, i, masks[k], is_valid);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Compare the vectorized implementations against the FSM for all short
+   sequences of interesting octets, placed around a vector boundary. */
+static svn_error_t *
+utf_validate_simd(apr_pool_t *pool)
+{
+  /* Octets close to the boundaries of the UTF-8 octet categories. */
+  static const unsigned char octets[] =
+    { 0x00, 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf,
+      0xc0, 0xc1, 0xc2, 0xdf, 0xe0, 0xed, 0xef, 0xf0,
+      0xf4, 0xf5, 0xff };
+  const int octet_count = sizeof(octets) / sizeof(octets[0]);
+  char str[64];
+  int offset, first, second, third, fourth;
+  int i = 0;
+
+  /* All pairs of octets. */
+  for (offset = 28; offset < 34; ++offset)
+    for (first = 0; first < 256; ++first)
+      for (second = 0; second < 256; ++second, ++i)
+        {
+          memset(str, 'x', sizeof(str));
+          str[offset] = (char)first;
+          str[offset + 1] = (char)second;
+
+          SVN_ERR(check_simd_validation(str, sizeof(str), "pairs", i));
+          SVN_ERR(check_simd_validation(str, offset + 2, "pairs", i));
+        }
+
+  /* Any lead octet followed by three interesting octets, crossing the
+     vector boundary at all possible positions. */
+  for (offset = 29; offset < 33; ++offset)
+    for (first = 0xc0; first < 256; ++first)
+      for (second = 0; second < octet_count; ++second)
+        for (third = 0; third < octet_count; ++third)
+          for (fourth = 0; fourth < octet_count; ++fourth, ++i)
+            {
+              memset(str, 'x', sizeof(str));
+              str[offset] = (char)first;
+              str[offset + 1] = (char)octets[second];
+              str[offset + 2] = (char)octets[third];
+              str[offset + 3] = (char)octets[fourth];
+
+              SVN_ERR(check_simd_validation(str, sizeof(str), "sequences",
+                                            i));
+            }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the UTF-8 encoding of CODE_POINT to BUFFER and return its
+   length. */
+static apr_size_t
+encode_utf8(char *buffer,
+            apr_uint32_t code_point)
+{
+  if (code_point < 0x80)
+    {
+      buffer[0] = (char)code_point;
+      return 1;
+    }
+  if (code_point < 0x800)
+    {
+      buffer[0] = (char)(0xc0 | (code_point >> 6));
+      buffer[1] = (char)(0x80 | (code_point & 0x3f));
+      return 2;
+    }
+  if (code_point < 0x10000)
+    {
+      buffer[0] = (char)(0xe0 | (code_point >> 12));
+      buffer[1] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+      buffer[2] = (char)(0x80 | (code_point & 0x3f));
+      return 3;
+    }
+
+  buffer[0] = (char)(0xf0 | (code_point >> 18));
+  buffer[1] = (char)(0x80 | ((code_point >> 12) & 0x3f));
+  buffer[2] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+  buffer[3] = (char)(0x80 | (code_point & 0x3f));
+  return 4;
+}
+
+/* Compare the vectorized implementations against the FSM using long
+   random UTF-8 strings with the occasional corruption. */
+static svn_error_t *
+utf_validate_simd_random(apr_pool_t *pool)
+{
+  int i;
+
+  seed_val();
+
+  for (i = 0; i < 20000; ++i)
+    {
+      char str[1024];
+      apr_size_t len = 0;
+      apr_uint32_t ascii_percentage = range_rand(0, 100);
+
+      while (len + 4 <= sizeof(str))
+        {
+          apr_uint32_t code_point;
+          if (range_rand(0, 99) < ascii_percentage)
+            code_point = range_rand(0x20, 0x7e);
+          else
+            code_point = range_rand(0x80, 0x10ffff);
+
+          /* Surrogates are not valid in UTF-8. */
+          if (code_point >= 0xd800 && code_point < 0xe000)
+            continue;
+
+          len += encode_utf8(str + len, code_point);
+        }
+
+      /* Corrupt about half of the strings. */
+      if (range_rand(0, 1))
+        str[range_rand(0, (apr_uint32_t)len - 1)]
+          ^= (char)(1 << range_rand(0, 7));
+
+      SVN_ERR(check_simd_validation(str, len, "random", i));
+      SVN_ERR(check_simd_validation(str, range_rand(0, (apr_uint32_t)len),
+                                    "random", i));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Test conversion from different codepages to utf8. */
 static svn_error_t *
 test_utf_cstring_to_utf8_ex2(apr_pool_t *pool)
@@ -1010,6 +1176,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test is_valid/last_valid"),
     SVN_TEST_PASS2(utf_validate2,
                    "test last_valid/last_valid2"),
+    SVN_TEST_PASS2(utf_validate_simd,
+                   "test vectorized validation for short sequences"),
+    SVN_TEST_PASS2(utf_validate_simd_random,
+                   "test vectorized validation for random strings"),
     SVN_TEST_PASS2(test_utf_cstring_to_utf8_ex2,
                    "test svn_utf_cstring_to_utf8_ex2"),
     SVN_TEST_PASS2(test_utf_cstring_from_utf8_ex2,
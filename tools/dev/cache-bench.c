@@ -0,0 +1,408 @@
+/* cache-bench.c -- replay synthetic access traces against membuffer caches
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool simulates a server whose interactive users keep working on
+ * a "hot" set of items while some bulk operation, e.g. a checkout of a
+ * large tree or "svnadmin dump", scans through lots of items that are
+ * being used only once.  Every access is a cache lookup, followed by
+ * inserting the item upon a miss.
+ *
+ * The trace is replayed once per admission policy and each run prints
+ * one CSV line:
+ *
+ *   policy,cache_bytes,hot_keys,item_bytes,scan_percent,accesses,
+ *   hot_hit_rate,total_hit_rate,sec
+ *
+ * Before each measured run, the hot set gets accessed a few times without
+ * any scan traffic to warm up the cache.
+ */
+
+#include <string.h>
+
+#include <apr_getopt.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_error.h"
+#include "svn_string.h"
+
+#include "private/svn_cache.h"
+
+#include "svn_private_config.h"
+
+/* Defaults for the command line options. */
+#define DEFAULT_CACHE_SIZE   (16 * 1024 * 1024)
+#define DEFAULT_HOT_KEYS     1500
+#define DEFAULT_ITEM_SIZE    4096
+#define DEFAULT_SCAN_PERCENT 50
+#define DEFAULT_ACCESSES     1000000
+#define DEFAULT_SEED         0x5eed
+
+/* Number of accesses per hot key during warm-up. */
+#define WARMUP_ROUNDS        4
+
+/* Scan keys are numbered from here on to never collide with hot keys. */
+#define SCAN_KEY_BASE        APR_UINT64_C(0x100000000)
+
+
+/*** Trace generation. ***/
+
+/* Simple linear congruential generator, so the traces don't depend on
+ * the platform's rand() implementation.  Returns the next value for
+ * *SEED and updates it. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* The trace parameters. */
+typedef struct trace_t
+{
+  apr_size_t cache_size;
+  apr_uint32_t hot_keys;
+  apr_size_t item_size;
+  apr_uint32_t scan_percent;
+  apr_uint32_t accesses;
+  apr_uint32_t seed;
+} trace_t;
+
+/* Access statistics of a single run. */
+typedef struct stats_t
+{
+  apr_uint32_t hot_accesses;
+  apr_uint32_t hot_hits;
+  apr_uint32_t hits;
+} stats_t;
+
+
+/*** Cache access. ***/
+
+/* Implements svn_cache__serialize_func_t for svn_string_t items.
+ * The data need not be copied as the cache does that anyway. */
+static svn_error_t *
+serialize_item(void **data,
+               apr_size_t *data_len,
+               void *in,
+               apr_pool_t *pool)
+{
+  svn_string_t *item = in;
+
+  *data = (void *)item->data;
+  *data_len = item->len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for svn_string_t items. */
+static svn_error_t *
+deserialize_item(void **out,
+                 void *data,
+                 apr_size_t data_len,
+                 apr_pool_t *pool)
+{
+  *out = svn_string_ncreate(data, data_len, pool);
+  return SVN_NO_ERROR;
+}
+
+/* Look up KEY in CACHE and insert ITEM upon a miss.  Set *HIT to whether
+ * KEY has been found.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+access_key(svn_boolean_t *hit,
+           svn_cache__t *cache,
+           apr_uint64_t key,
+           svn_string_t *item,
+           apr_pool_t *scratch_pool)
+{
+  void *value;
+
+  SVN_ERR(svn_cache__get(&value, hit, cache, &key, scratch_pool));
+  if (!*hit)
+    SVN_ERR(svn_cache__set(cache, &key, item, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay TRACE against a new cache using the TinyLFU policy if TINYLFU
+ * is set.  Accumulate the results in *STATS and return the time spent
+ * in *DURATION.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+replay(stats_t *stats,
+       apr_interval_time_t *duration,
+       const trace_t *trace,
+       svn_boolean_t tinylfu,
+       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_stringbuf_t *buffer;
+  svn_string_t item;
+  apr_uint64_t next_scan_key = SCAN_KEY_BASE;
+  apr_uint32_t seed = trace->seed;
+  apr_uint32_t i;
+  apr_time_t start;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, trace->cache_size,
+                                            trace->cache_size / 10, 0,
+                                            FALSE, TRUE, scratch_pool));
+  SVN_ERR(svn_cache__membuffer_set_tinylfu(membuffer, tinylfu,
+                                           scratch_pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(
+              &cache, membuffer, serialize_item, deserialize_item,
+              sizeof(apr_uint64_t), "cache-bench",
+              SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+              scratch_pool, scratch_pool));
+
+  /* All items have the same contents. */
+  buffer = svn_stringbuf_create_ensure(trace->item_size, scratch_pool);
+  memset(buffer->data, 'x', trace->item_size);
+  buffer->len = trace->item_size;
+  item.data = buffer->data;
+  item.len = buffer->len;
+
+  /* Warm up. */
+  for (i = 0; i < WARMUP_ROUNDS * trace->hot_keys; ++i)
+    {
+      svn_boolean_t hit;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(access_key(&hit, cache, i % trace->hot_keys, &item,
+                         iterpool));
+    }
+
+  /* The measured, mixed workload. */
+  memset(stats, 0, sizeof(*stats));
+  start = apr_time_now();
+  for (i = 0; i < trace->accesses; ++i)
+    {
+      svn_boolean_t is_hot = next_rand(&seed) % 100 >= trace->scan_percent;
+      apr_uint64_t key = is_hot ? next_rand(&seed) % trace->hot_keys
+                                : next_scan_key++;
+      svn_boolean_t hit;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(access_key(&hit, cache, key, &item, iterpool));
+
+      if (hit)
+        stats->hits++;
+      if (is_hot)
+        {
+          stats->hot_accesses++;
+          if (hit)
+            stats->hot_hits++;
+        }
+    }
+
+  *duration = apr_time_now() - start;
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Replay TRACE with the TinyLFU policy enabled, if TINYLFU is set, and
+ * print the results.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_benchmark(const trace_t *trace,
+              svn_boolean_t tinylfu,
+              apr_pool_t *scratch_pool)
+{
+  stats_t stats;
+  apr_interval_time_t duration;
+
+  SVN_ERR(replay(&stats, &duration, trace, tinylfu, scratch_pool));
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s,%" APR_SIZE_T_FMT ",%u,%" APR_SIZE_T_FMT
+                             ",%u,%u,%.4f,%.4f,%.6f\n",
+                             tinylfu ? "tinylfu" : "hits",
+                             trace->cache_size, trace->hot_keys,
+                             trace->item_size, trace->scan_percent,
+                             trace->accesses,
+                             stats.hot_accesses
+                               ? (double)stats.hot_hits / stats.hot_accesses
+                               : 0.0,
+                             trace->accesses
+                               ? (double)stats.hits / trace->accesses
+                               : 0.0,
+                             (double)duration / APR_USEC_PER_SEC));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** Main. ***/
+
+static const apr_getopt_option_t options[] =
+  {
+    { "cache-size",   's', 1, "cache size in bytes" },
+    { "hot-keys",     'k', 1, "number of keys in the hot set" },
+    { "item-size",    'i', 1, "size of each cached item in bytes" },
+    { "scan-percent", 'p', 1, "percentage of accesses that are scans" },
+    { "accesses",     'n', 1, "number of measured accesses" },
+    { "seed",         'r', 1, "seed for the trace generator" },
+    { "policy",       'P', 1, "only run policies whose name contains ARG" },
+    { "help",         'h', 0, "show this help" },
+    { NULL }
+  };
+
+/* Print usage information for PROGNAME to stdout. */
+static svn_error_t *
+print_usage(const char *progname,
+            apr_pool_t *pool)
+{
+  int i;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "Usage: %s [OPTIONS]\n"
+                             "Replay a mixed hot-set and scan trace against "
+                             "membuffer caches and\nprint the hit rates per "
+                             "admission policy as CSV.\n\n",
+                             progname));
+  for (i = 0; options[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  -%c, --%-14s %s\n",
+                               options[i].optch, options[i].name,
+                               options[i].description));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the decimal number in ARG into *VALUE and make sure it is within
+ * MINIMUM and MAXIMUM. */
+static svn_error_t *
+parse_number(apr_int64_t *value,
+             const char *arg,
+             apr_int64_t minimum,
+             apr_int64_t maximum)
+{
+  return svn_error_trace(svn_cstring_strtoi64(value, arg, minimum,
+                                              maximum, 10));
+}
+
+/* Parse the command line given by ARGC and ARGV, and run the selected
+ * benchmarks. */
+static svn_error_t *
+sub_main(int argc,
+         const char *argv[],
+         apr_pool_t *pool)
+{
+  apr_getopt_t *os;
+  apr_int64_t cache_size = DEFAULT_CACHE_SIZE;
+  apr_int64_t hot_keys = DEFAULT_HOT_KEYS;
+  apr_int64_t item_size = DEFAULT_ITEM_SIZE;
+  apr_int64_t scan_percent = DEFAULT_SCAN_PERCENT;
+  apr_int64_t accesses = DEFAULT_ACCESSES;
+  apr_int64_t seed = DEFAULT_SEED;
+  const char *policy_filter = "";
+  apr_pool_t *iterpool;
+  trace_t trace;
+
+  apr_getopt_init(&os, pool, argc, argv);
+  while (1)
+    {
+      int opt;
+      const char *arg;
+      apr_status_t status = apr_getopt_long(os, options, &opt, &arg);
+
+      if (APR_STATUS_IS_EOF(status))
+        break;
+      if (status != APR_SUCCESS)
+        return svn_error_wrap_apr(status, "Invalid command line");
+
+      switch (opt)
+        {
+          case 's':
+            SVN_ERR(parse_number(&cache_size, arg, 1024 * 1024,
+                                 APR_SIZE_MAX < APR_INT64_MAX
+                                   ? (apr_int64_t)APR_SIZE_MAX
+                                   : APR_INT64_MAX));
+            break;
+          case 'k':
+            SVN_ERR(parse_number(&hot_keys, arg, 1, APR_INT32_MAX));
+            break;
+          case 'i':
+            SVN_ERR(parse_number(&item_size, arg, 1, APR_INT32_MAX));
+            break;
+          case 'p':
+            SVN_ERR(parse_number(&scan_percent, arg, 0, 100));
+            break;
+          case 'n':
+            SVN_ERR(parse_number(&accesses, arg, 1, APR_INT32_MAX));
+            break;
+          case 'r':
+            SVN_ERR(parse_number(&seed, arg, 0, APR_INT32_MAX));
+            break;
+          case 'P':
+            policy_filter = arg;
+            break;
+          default:
+            return svn_error_trace(print_usage(argv[0], pool));
+        }
+    }
+
+  if (os->ind < argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            "Too many arguments");
+
+  trace.cache_size = (apr_size_t)cache_size;
+  trace.hot_keys = (apr_uint32_t)hot_keys;
+  trace.item_size = (apr_size_t)item_size;
+  trace.scan_percent = (apr_uint32_t)scan_percent;
+  trace.accesses = (apr_uint32_t)accesses;
+  trace.seed = (apr_uint32_t)seed;
+
+  SVN_ERR(svn_cmdline_printf(pool, "policy,cache_bytes,hot_keys,item_bytes,"
+                                   "scan_percent,accesses,hot_hit_rate,"
+                                   "total_hit_rate,sec\n"));
+
+  /* Each run uses its own cache.  Release it before the next one. */
+  iterpool = svn_pool_create(pool);
+  if (strstr("hits", policy_filter))
+    SVN_ERR(run_benchmark(&trace, FALSE, iterpool));
+
+  svn_pool_clear(iterpool);
+  if (strstr("tinylfu", policy_filter))
+    SVN_ERR(run_benchmark(&trace, TRUE, iterpool));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("cache-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "cache-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,750 @@
+/* delta-bench.c -- microbenchmarks for libsvn_delta
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool runs the core libsvn_delta operations over a set of
+ * synthetic, reproducible corpora and prints one CSV line per
+ * benchmark and corpus:
+ *
+ *   benchmark,corpus,bytes,iterations,best_sec,mean_sec,mb_per_sec,
+ *   pool_bytes
+ *
+ * MB_PER_SEC is based on BEST_SEC and the size of the delta target.
+ * POOL_BYTES is the amount of pool memory allocated by one iteration
+ * and can only be determined if APR has been built with pool debugging.
+ * Otherwise, it will be reported as -1.
+ */
+
+#include <string.h>
+
+#include <apr_getopt.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_delta.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "svn_private_config.h"
+
+/* Defaults for the command line options. */
+#define DEFAULT_SIZE       (4 * 1024 * 1024)
+#define DEFAULT_ITERATIONS 5
+#define DEFAULT_SEED       0x5eed
+
+/* Size of the chunks that we compose windows for.  Must not exceed the
+ * delta window size such that each chunk results in a single window. */
+#define COMPOSE_CHUNK_SIZE (64 * 1024)
+
+
+/*** Corpus generation. ***/
+
+/* Simple linear congruential generator, so the corpora don't depend on
+ * the platform's rand() implementation.  Returns the next value for
+ * *SEED and updates it. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Append LEN random bytes from SEED to BUF. */
+static void
+append_random(svn_stringbuf_t *buf,
+              apr_size_t len,
+              apr_uint32_t *seed)
+{
+  apr_size_t i;
+
+  svn_stringbuf_ensure(buf, buf->len + len);
+  for (i = 0; i < len; ++i)
+    buf->data[buf->len + i] = (char)next_rand(seed);
+
+  buf->len += len;
+  buf->data[buf->len] = '\0';
+}
+
+/* Append a line of text made from common words to BUF. */
+static void
+append_line(svn_stringbuf_t *buf,
+            apr_uint32_t *seed)
+{
+  static const char *const words[] =
+    {
+      "static", "svn_error_t", "*", "pool", "return", "if", "(", ")",
+      "{", "}", "const", "char", "apr_size_t", "len", "=", ";", "for",
+      "the", "a", "of", "window", "delta", "data", "NULL", "SVN_ERR"
+    };
+  int count = 1 + next_rand(seed) % 12;
+  int i;
+
+  svn_stringbuf_appendfill(buf, ' ', 2 * (next_rand(seed) % 4));
+  for (i = 0; i < count; ++i)
+    {
+      svn_stringbuf_appendcstr(buf,
+                               words[next_rand(seed) % (sizeof(words)
+                                                        / sizeof(*words))]);
+      svn_stringbuf_appendbyte(buf, ' ');
+    }
+
+  svn_stringbuf_appendbyte(buf, '\n');
+}
+
+/* Return the text that SOURCE becomes after editing about 1% of its
+ * lines.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+edit_text(const svn_stringbuf_t *source,
+          apr_uint32_t *seed,
+          apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(source->len, pool);
+  const char *p = source->data;
+  const char *end = source->data + source->len;
+
+  while (p < end)
+    {
+      const char *eol = memchr(p, '\n', end - p);
+      apr_size_t len = eol ? eol - p + 1 : end - p;
+
+      switch (next_rand(seed) % 300)
+        {
+          case 0:   /* delete line */
+            break;
+
+          case 1:   /* insert line */
+            append_line(result, seed);
+            svn_stringbuf_appendbytes(result, p, len);
+            break;
+
+          case 2:   /* replace line */
+            append_line(result, seed);
+            break;
+
+          default:
+            svn_stringbuf_appendbytes(result, p, len);
+            break;
+        }
+
+      p += len;
+    }
+
+  return result;
+}
+
+/* Return a copy of SOURCE with random blocks of binary data inserted at
+ * random positions.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+insert_binary(const svn_stringbuf_t *source,
+              apr_uint32_t *seed,
+              apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(source->len, pool);
+  apr_size_t pos = 0;
+
+  while (pos < source->len)
+    {
+      apr_size_t len = next_rand(seed) % 40000;
+      if (len > source->len - pos)
+        len = source->len - pos;
+
+      svn_stringbuf_appendbytes(result, source->data + pos, len);
+      append_random(result, 1 + next_rand(seed) % 200, seed);
+      pos += len;
+    }
+
+  return result;
+}
+
+/* A corpus for our benchmarks, i.e. a delta source and a target plus a
+ * second generation target that has been derived from TARGET the same
+ * way that TARGET has been derived from SOURCE. */
+typedef struct corpus_t
+{
+  const char *name;
+  svn_stringbuf_t *source;
+  svn_stringbuf_t *target;
+  svn_stringbuf_t *target2;
+} corpus_t;
+
+/* The kinds of corpora that we support. */
+typedef enum corpus_kind_t
+{
+  corpus_text,
+  corpus_binary,
+  corpus_append,
+  corpus_random,
+  corpus_kind_count
+} corpus_kind_t;
+
+/* Names of the corpora, indexed by corpus_kind_t. */
+static const char *const corpus_names[corpus_kind_count]
+  = { "text-edits", "binary-inserts", "appends", "random" };
+
+/* Derive the next generation from DATA according to KIND.  Allocate the
+ * result in POOL. */
+static svn_stringbuf_t *
+derive(corpus_kind_t kind,
+       const svn_stringbuf_t *data,
+       apr_uint32_t *seed,
+       apr_pool_t *pool)
+{
+  svn_stringbuf_t *result;
+
+  switch (kind)
+    {
+      case corpus_text:
+        return edit_text(data, seed, pool);
+
+      case corpus_binary:
+        return insert_binary(data, seed, pool);
+
+      case corpus_append:
+        result = svn_stringbuf_dup(data, pool);
+        append_random(result, data->len / 10, seed);
+        return result;
+
+      default:
+        result = svn_stringbuf_create_empty(pool);
+        append_random(result, data->len, seed);
+        return result;
+    }
+}
+
+/* Create the corpus of the given KIND with a source of about SIZE bytes.
+ * Allocate it in POOL. */
+static corpus_t *
+create_corpus(corpus_kind_t kind,
+              apr_size_t size,
+              apr_uint32_t seed,
+              apr_pool_t *pool)
+{
+  corpus_t *corpus = apr_pcalloc(pool, sizeof(*corpus));
+
+  corpus->name = corpus_names[kind];
+  corpus->source = svn_stringbuf_create_ensure(size, pool);
+  if (kind == corpus_text)
+    while (corpus->source->len < size)
+      append_line(corpus->source, &seed);
+  else
+    append_random(corpus->source, size, &seed);
+
+  corpus->target = derive(kind, corpus->source, &seed, pool);
+  corpus->target2 = derive(kind, corpus->target, &seed, pool);
+
+  return corpus;
+}
+
+
+/*** Benchmark helpers. ***/
+
+/* Pre-computed data shared by all benchmarks for a given corpus. */
+typedef struct bench_baton_t
+{
+  corpus_t *corpus;
+
+  /* Windows transforming CORPUS->SOURCE into CORPUS->TARGET. */
+  apr_array_header_t *windows;
+
+  /* Per COMPOSE_CHUNK_SIZE chunk, the single-window deltas from SOURCE
+   * to TARGET and from TARGET to TARGET2, i.e. two arrays of the same
+   * length. */
+  apr_array_header_t *chunk_windows;
+  apr_array_header_t *chunk_windows2;
+
+  /* The svndiff representations of WINDOWS, indexed by version. */
+  svn_stringbuf_t *svndiff[3];
+
+  /* Parameter for the svndiff benchmarks. */
+  int svndiff_version;
+} bench_baton_t;
+
+/* Implements svn_txdelta_window_handler_t, adding a copy of each window
+ * to the apr_array_header_t * BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window,
+               void *baton)
+{
+  apr_array_header_t *windows = baton;
+  if (window)
+    APR_ARRAY_PUSH(windows, svn_txdelta_window_t *)
+      = svn_txdelta_window_dup(window, windows->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_window_handler_t, counting the windows in
+ * the int * BATON. */
+static svn_error_t *
+count_window(svn_txdelta_window_t *window,
+             void *baton)
+{
+  int *count = baton;
+  if (window)
+    ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the windows of the delta between SOURCE and TARGET to WINDOWS. */
+static svn_error_t *
+get_windows(apr_array_header_t *windows,
+            const char *source,
+            apr_size_t source_len,
+            const char *target,
+            apr_size_t target_len,
+            apr_pool_t *scratch_pool)
+{
+  svn_string_t source_str, target_str;
+  source_str.data = source;
+  source_str.len = source_len;
+  target_str.data = target;
+  target_str.len = target_len;
+
+  return svn_error_trace(svn_txdelta_run(
+                           svn_stream_from_string(&source_str, scratch_pool),
+                           svn_stream_from_string(&target_str, scratch_pool),
+                           collect_window, windows,
+                           svn_checksum_md5, NULL, NULL, NULL,
+                           scratch_pool, scratch_pool));
+}
+
+/* Write the svndiff representation of WINDOWS in SVNDIFF_VERSION to
+ * OUTPUT. */
+static svn_error_t *
+encode_windows(svn_stringbuf_t *output,
+               const apr_array_header_t *windows,
+               int svndiff_version,
+               apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  int i;
+
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(output, scratch_pool),
+                          svndiff_version,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                          scratch_pool);
+  for (i = 0; i < windows->nelts; ++i)
+    SVN_ERR(handler(APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *),
+                    handler_baton));
+
+  return svn_error_trace(handler(NULL, handler_baton));
+}
+
+/* Fill in the pre-computed fields of BATON for CORPUS.  Allocate them in
+ * POOL. */
+static svn_error_t *
+prepare(bench_baton_t *baton,
+        corpus_t *corpus,
+        apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_size_t pos;
+  int i;
+
+  baton->corpus = corpus;
+  baton->windows = apr_array_make(pool, 0, sizeof(svn_txdelta_window_t *));
+  SVN_ERR(get_windows(baton->windows,
+                      corpus->source->data, corpus->source->len,
+                      corpus->target->data, corpus->target->len,
+                      iterpool));
+
+  baton->chunk_windows
+    = apr_array_make(pool, 0, sizeof(svn_txdelta_window_t *));
+  baton->chunk_windows2
+    = apr_array_make(pool, 0, sizeof(svn_txdelta_window_t *));
+  for (pos = 0;
+       pos < corpus->target->len && pos < corpus->target2->len;
+       pos += COMPOSE_CHUNK_SIZE)
+    {
+      apr_size_t source_len, target_len, target2_len;
+      source_len = MIN(COMPOSE_CHUNK_SIZE,
+                       corpus->source->len - MIN(pos, corpus->source->len));
+      target_len = MIN(COMPOSE_CHUNK_SIZE, corpus->target->len - pos);
+      target2_len = MIN(COMPOSE_CHUNK_SIZE, corpus->target2->len - pos);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(get_windows(baton->chunk_windows,
+                          corpus->source->data + pos, source_len,
+                          corpus->target->data + pos, target_len,
+                          iterpool));
+      SVN_ERR(get_windows(baton->chunk_windows2,
+                          corpus->target->data + pos, target_len,
+                          corpus->target2->data + pos, target2_len,
+                          iterpool));
+    }
+
+  for (i = 0; i < 3; ++i)
+    {
+      svn_pool_clear(iterpool);
+      baton->svndiff[i] = svn_stringbuf_create_empty(pool);
+      SVN_ERR(encode_windows(baton->svndiff[i], baton->windows, i,
+                             iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+
+/*** The benchmarks. ***/
+
+/* Signature of a benchmark function.  It shall run one iteration of the
+ * benchmark on the data in BATON and return the number of bytes that it
+ * processed in *BYTES. */
+typedef svn_error_t *(*bench_func_t)(apr_size_t *bytes,
+                                     bench_baton_t *baton,
+                                     apr_pool_t *scratch_pool);
+
+/* Implements bench_func_t: Run xdelta on the corpus. */
+static svn_error_t *
+bench_delta(apr_size_t *bytes,
+            bench_baton_t *baton,
+            apr_pool_t *scratch_pool)
+{
+  int count = 0;
+  svn_string_t source, target;
+
+  source.data = baton->corpus->source->data;
+  source.len = baton->corpus->source->len;
+  target.data = baton->corpus->target->data;
+  target.len = baton->corpus->target->len;
+
+  SVN_ERR(svn_txdelta_run(svn_stream_from_string(&source, scratch_pool),
+                          svn_stream_from_string(&target, scratch_pool),
+                          count_window, &count,
+                          svn_checksum_md5, NULL, NULL, NULL,
+                          scratch_pool, scratch_pool));
+
+  *bytes = target.len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements bench_func_t: Apply the pre-computed delta windows. */
+static svn_error_t *
+bench_apply(apr_size_t *bytes,
+            bench_baton_t *baton,
+            apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_string_t source;
+  int i;
+
+  source.data = baton->corpus->source->data;
+  source.len = baton->corpus->source->len;
+
+  svn_txdelta_apply(svn_stream_from_string(&source, scratch_pool),
+                    svn_stream_empty(scratch_pool), NULL, NULL,
+                    scratch_pool, &handler, &handler_baton);
+  for (i = 0; i < baton->windows->nelts; ++i)
+    SVN_ERR(handler(APR_ARRAY_IDX(baton->windows, i, svn_txdelta_window_t *),
+                    handler_baton));
+  SVN_ERR(handler(NULL, handler_baton));
+
+  *bytes = baton->corpus->target->len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements bench_func_t: Compose the per-chunk windows. */
+static svn_error_t *
+bench_compose(apr_size_t *bytes,
+              bench_baton_t *baton,
+              apr_pool_t *scratch_pool)
+{
+  int i;
+
+  *bytes = 0;
+  for (i = 0;
+       i < baton->chunk_windows->nelts && i < baton->chunk_windows2->nelts;
+       ++i)
+    {
+      svn_txdelta_window_t *composite;
+      composite = svn_txdelta_compose_windows(
+                      APR_ARRAY_IDX(baton->chunk_windows, i,
+                                    svn_txdelta_window_t *),
+                      APR_ARRAY_IDX(baton->chunk_windows2, i,
+                                    svn_txdelta_window_t *),
+                      scratch_pool);
+      *bytes += composite->tview_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements bench_func_t: Encode the windows as svndiff. */
+static svn_error_t *
+bench_encode(apr_size_t *bytes,
+             bench_baton_t *baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *output = svn_stringbuf_create_empty(scratch_pool);
+  SVN_ERR(encode_windows(output, baton->windows, baton->svndiff_version,
+                         scratch_pool));
+
+  *bytes = baton->corpus->target->len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements bench_func_t: Parse the svndiff data. */
+static svn_error_t *
+bench_decode(apr_size_t *bytes,
+             bench_baton_t *baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *svndiff = baton->svndiff[baton->svndiff_version];
+  apr_size_t len = svndiff->len;
+  int count = 0;
+  svn_stream_t *stream = svn_txdelta_parse_svndiff(count_window, &count,
+                                                   TRUE, scratch_pool);
+
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  *bytes = baton->corpus->target->len;
+  return SVN_NO_ERROR;
+}
+
+/* Description of a single benchmark. */
+typedef struct bench_t
+{
+  const char *name;
+  bench_func_t func;
+
+  /* For the svndiff benchmarks, the format version.  Ignored otherwise. */
+  int svndiff_version;
+} bench_t;
+
+static const bench_t benchmarks[] =
+  {
+    { "delta",           bench_delta,   0 },
+    { "apply",           bench_apply,   0 },
+    { "compose",         bench_compose, 0 },
+    { "svndiff0-encode", bench_encode,  0 },
+    { "svndiff1-encode", bench_encode,  1 },
+    { "svndiff2-encode", bench_encode,  2 },
+    { "svndiff0-decode", bench_decode,  0 },
+    { "svndiff1-decode", bench_decode,  1 },
+    { "svndiff2-decode", bench_decode,  2 },
+    { NULL }
+  };
+
+/* Run BENCH on the data in BATON ITERATIONS times and print the result.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_benchmark(const bench_t *bench,
+              bench_baton_t *baton,
+              int iterations,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_interval_time_t best = 0;
+  apr_interval_time_t total = 0;
+  apr_size_t bytes = 0;
+  apr_int64_t pool_bytes = -1;
+  double best_sec;
+  int i;
+
+  baton->svndiff_version = bench->svndiff_version;
+  for (i = 0; i < iterations; ++i)
+    {
+      apr_time_t start;
+      apr_interval_time_t duration;
+
+      svn_pool_clear(iterpool);
+      start = apr_time_now();
+      SVN_ERR(bench->func(&bytes, baton, iterpool));
+      duration = apr_time_now() - start;
+
+      if (i == 0 || duration < best)
+        best = duration;
+      total += duration;
+
+#if APR_POOL_DEBUG
+      pool_bytes = (apr_int64_t)apr_pool_num_bytes(iterpool, TRUE);
+#endif
+    }
+
+  best_sec = (double)best / APR_USEC_PER_SEC;
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s,%s,%" APR_SIZE_T_FMT ",%d,%.6f,%.6f,"
+                             "%.2f,%" APR_INT64_T_FMT "\n",
+                             bench->name, baton->corpus->name, bytes,
+                             iterations, best_sec,
+                             (double)total / iterations / APR_USEC_PER_SEC,
+                             best_sec > 0
+                               ? bytes / best_sec / (1024 * 1024)
+                               : 0.0,
+                             pool_bytes));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+
+/*** Main. ***/
+
+static const apr_getopt_option_t options[] =
+  {
+    { "size",       's', 1, "size of each corpus in bytes" },
+    { "iterations", 'n', 1, "number of runs per benchmark" },
+    { "seed",       'r', 1, "seed for the corpus generator" },
+    { "bench",      'b', 1, "only run benchmarks whose name contains ARG" },
+    { "corpus",     'c', 1, "only use corpora whose name contains ARG" },
+    { "help",       'h', 0, "show this help" },
+    { NULL }
+  };
+
+/* Print usage information for PROGNAME to stdout. */
+static svn_error_t *
+print_usage(const char *progname,
+            apr_pool_t *pool)
+{
+  int i;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "Usage: %s [OPTIONS]\n"
+                             "Run the libsvn_delta microbenchmarks and "
+                             "print the results as CSV.\n\n",
+                             progname));
+  for (i = 0; options[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  -%c, --%-12s %s\n",
+                               options[i].optch, options[i].name,
+                               options[i].description));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the decimal number in ARG into *VALUE and make sure it is at
+ * least MINIMUM. */
+static svn_error_t *
+parse_number(apr_int64_t *value,
+             const char *arg,
+             apr_int64_t minimum)
+{
+  return svn_error_trace(svn_cstring_strtoi64(value, arg, minimum,
+                                              APR_INT32_MAX, 10));
+}
+
+/* Parse the command line given by ARGC and ARGV, and run the selected
+ * benchmarks. */
+static svn_error_t *
+sub_main(int argc,
+         const char *argv[],
+         apr_pool_t *pool)
+{
+  apr_getopt_t *os;
+  apr_int64_t size = DEFAULT_SIZE;
+  apr_int64_t iterations = DEFAULT_ITERATIONS;
+  apr_int64_t seed = DEFAULT_SEED;
+  const char *bench_filter = "";
+  const char *corpus_filter = "";
+  apr_pool_t *iterpool;
+  int kind;
+
+  apr_getopt_init(&os, pool, argc, argv);
+  while (1)
+    {
+      int opt;
+      const char *arg;
+      apr_status_t status = apr_getopt_long(os, options, &opt, &arg);
+
+      if (APR_STATUS_IS_EOF(status))
+        break;
+      if (status != APR_SUCCESS)
+        return svn_error_wrap_apr(status, "Invalid command line");
+
+      switch (opt)
+        {
+          case 's':
+            SVN_ERR(parse_number(&size, arg, 1));
+            break;
+          case 'n':
+            SVN_ERR(parse_number(&iterations, arg, 1));
+            break;
+          case 'r':
+            SVN_ERR(parse_number(&seed, arg, 0));
+            break;
+          case 'b':
+            bench_filter = arg;
+            break;
+          case 'c':
+            corpus_filter = arg;
+            break;
+          default:
+            return svn_error_trace(print_usage(argv[0], pool));
+        }
+    }
+
+  if (os->ind < argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            "Too many arguments");
+
+  SVN_ERR(svn_cmdline_printf(pool, "benchmark,corpus,bytes,iterations,"
+                                   "best_sec,mean_sec,mb_per_sec,"
+                                   "pool_bytes\n"));
+
+  iterpool = svn_pool_create(pool);
+  for (kind = 0; kind < corpus_kind_count; ++kind)
+    {
+      bench_baton_t baton = { 0 };
+      corpus_t *corpus;
+      int i;
+
+      if (!strstr(corpus_names[kind], corpus_filter))
+        continue;
+
+      svn_pool_clear(iterpool);
+      corpus = create_corpus(kind, (apr_size_t)size, (apr_uint32_t)seed,
+                             iterpool);
+      SVN_ERR(prepare(&baton, corpus, iterpool));
+      for (i = 0; benchmarks[i].name; ++i)
+        if (strstr(benchmarks[i].name, bench_filter))
+          SVN_ERR(run_benchmark(&benchmarks[i], &baton, (int)iterations,
+                                iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("delta-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "delta-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
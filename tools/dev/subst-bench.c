@@ -0,0 +1,396 @@
+/* subst-bench.c -- measure EOL translation and keyword expansion throughput
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool pushes text through svn_subst_stream_translated() the same
+ * way checkout and commit do, once for each vector instruction set
+ * extension that is available on this machine.  Each combination of
+ * input, translation and instruction set prints one CSV line:
+ *
+ *   input,translation,simd,bytes,iterations,sec,mb_per_sec
+ *
+ * The synthetic inputs are "source" (C-like code with LF line endings and
+ * a few keywords), "crlf" (the same with CRLF line endings), "long-lines"
+ * (few line endings, e.g. generated or minified files) and "dollar"
+ * (many '$' that don't start keywords, like shell or Perl scripts).  Any
+ * files given on the command line are used as additional inputs, so the
+ * benchmark can be run over a real source tree, e.g.
+ *
+ *   subst-bench `find subversion/libsvn_subr -name '*.[ch]'`
+ *
+ * The translations are "lf" (svn:eol-style=LF), "crlf" (svn:eol-style=CRLF)
+ * and "keywords" (LF plus expansion of Id, Rev and Author).  The "scalar"
+ * mode disables all vector code.
+ */
+
+#include <string.h>
+
+#include <apr_getopt.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+#include "svn_subst.h"
+#include "svn_utf.h"
+
+#include "private/svn_simd.h"
+#include "private/svn_string_private.h"
+
+#include "svn_private_config.h"
+
+/* Defaults for the command line options. */
+#define DEFAULT_SIZE         0x100000
+#define DEFAULT_TOTAL        0x10000000
+#define DEFAULT_SEED         0x5eed
+
+/* The vector instruction sets to compare. */
+typedef struct simd_mode_t
+{
+  const char *name;
+  apr_uint32_t mask;
+} simd_mode_t;
+
+static const simd_mode_t simd_modes[] =
+  {
+    { "scalar", 0 },
+    { "sse2",   SVN_SIMD__SSE2 },
+    { "avx2",   SVN_SIMD__SSE2 | SVN_SIMD__AVX2 },
+    { "neon",   SVN_SIMD__NEON }
+  };
+
+/* The types of synthetic input text. */
+static const char *input_names[] = { "source", "crlf", "long-lines",
+                                     "dollar" };
+
+/* The translations to apply. */
+typedef struct translation_t
+{
+  const char *name;
+  const char *eol_str;
+  svn_boolean_t keywords;
+} translation_t;
+
+static const translation_t translations[] =
+  {
+    { "lf",       "\n",   FALSE },
+    { "crlf",     "\r\n", FALSE },
+    { "keywords", "\n",   TRUE }
+  };
+
+
+/*** Workload. ***/
+
+/* Simple linear congruential generator, so the workload doesn't depend on
+ * the platform's rand() implementation.  Returns the next value for
+ * *SEED and updates it. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return a SIZE bytes long text of the type called INPUT.  Use SEED to
+ * generate the text.  Allocate the result in RESULT_POOL. */
+static svn_string_t *
+create_text(const char *input,
+            apr_size_t size,
+            apr_uint32_t seed,
+            apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_create_ensure(size, result_pool);
+  const char *eol = strcmp(input, "crlf") == 0 ? "\r\n" : "\n";
+  apr_uint32_t max_line = strcmp(input, "long-lines") == 0 ? 4000 : 80;
+
+  svn_stringbuf_appendcstr(text, "/* $Id$ */");
+  svn_stringbuf_appendcstr(text, eol);
+
+  while (text->len < size)
+    {
+      apr_uint32_t indent = next_rand(&seed) % 12;
+      apr_uint32_t line_len = next_rand(&seed) % max_line;
+      apr_uint32_t i;
+
+      for (i = 0; i < indent; ++i)
+        svn_stringbuf_appendbyte(text, ' ');
+
+      for (i = 0; i < line_len; ++i)
+        {
+          apr_uint32_t value = next_rand(&seed);
+          char c = (char)('!' + (value >> 4) % 94);
+
+          if (strcmp(input, "dollar") == 0 && value % 12 == 0)
+            svn_stringbuf_appendbyte(text, '$');
+          else if (value % 2000 == 0)
+            svn_stringbuf_appendcstr(text, "$Rev$");
+          else
+            svn_stringbuf_appendbyte(text, c == '$' ? ' ' : c);
+        }
+
+      svn_stringbuf_appendcstr(text, eol);
+    }
+
+  svn_stringbuf_chop(text, text->len - size);
+  return svn_stringbuf__morph_into_string(text);
+}
+
+
+/*** Benchmark. ***/
+
+/* Translate TEXT, which is called INPUT, ITERATIONS times as specified by
+ * TRANSLATION and using the vector code selected by MODE.  KEYWORDS is the
+ * keyword hash to use, if TRANSLATION asks for it.  Print the results.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_benchmark(const char *input,
+              const svn_string_t *text,
+              apr_uint32_t iterations,
+              const translation_t *translation,
+              apr_hash_t *keywords,
+              const simd_mode_t *mode,
+              apr_pool_t *scratch_pool)
+{
+  apr_uint32_t old_mask = svn_simd__set_feature_mask(mode->mask);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_time_t start;
+  apr_interval_time_t duration;
+  apr_uint32_t i;
+
+  start = apr_time_now();
+  for (i = 0; i < iterations && !err; ++i)
+    {
+      svn_stream_t *source, *target;
+
+      svn_pool_clear(iterpool);
+
+      /* Like checkout, repair inconsistent line endings. */
+      source = svn_stream_from_string(text, iterpool);
+      target = svn_subst_stream_translated(svn_stream_empty(iterpool),
+                                           translation->eol_str, TRUE,
+                                           translation->keywords
+                                             ? keywords
+                                             : NULL,
+                                           TRUE, iterpool);
+      err = svn_stream_copy3(source, target, NULL, NULL, iterpool);
+    }
+  duration = apr_time_now() - start;
+
+  svn_pool_destroy(iterpool);
+  svn_simd__set_feature_mask(old_mask);
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s,%s,%s,%" APR_SIZE_T_FMT ",%u,%.6f,%.1f\n",
+                             input, translation->name, mode->name,
+                             text->len, iterations,
+                             (double)duration / APR_USEC_PER_SEC,
+                             duration
+                               ? (double)text->len * iterations
+                                 / duration
+                                 * APR_USEC_PER_SEC / 0x100000
+                               : 0.0));
+
+  return SVN_NO_ERROR;
+}
+
+/* Run all translations with all available vector code over TEXT, which is
+ * called INPUT.  Translate about TOTAL bytes in each run.  KEYWORDS is
+ * the keyword hash to use.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_input(const char *input,
+          const svn_string_t *text,
+          apr_int64_t total,
+          apr_hash_t *keywords,
+          apr_pool_t *scratch_pool)
+{
+  apr_uint32_t available = svn_simd__get_features();
+  apr_uint32_t iterations
+    = (apr_uint32_t)MIN(APR_UINT32_MAX,
+                        MAX(1, total / (apr_int64_t)MAX(1, text->len)));
+  int i, k;
+
+  for (i = 0; i < (int)(sizeof(translations) / sizeof(translations[0])); ++i)
+    for (k = 0; k < (int)(sizeof(simd_modes) / sizeof(simd_modes[0])); ++k)
+      if ((simd_modes[k].mask & available) == simd_modes[k].mask)
+        SVN_ERR(run_benchmark(input, text, iterations, &translations[i],
+                              keywords, &simd_modes[k], scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** Main. ***/
+
+static const apr_getopt_option_t options[] =
+  {
+    { "size",         's', 1, "size of the synthetic inputs in bytes" },
+    { "total",        'n', 1, "total number of bytes to translate per run" },
+    { "seed",         'r', 1, "seed for the text generator" },
+    { "input",        'i', 1, "only run synthetic inputs whose name "
+                              "contains ARG" },
+    { "help",         'h', 0, "show this help" },
+    { NULL }
+  };
+
+/* Print usage information for PROGNAME to stdout. */
+static svn_error_t *
+print_usage(const char *progname,
+            apr_pool_t *pool)
+{
+  int i;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "Usage: %s [OPTIONS] [FILE...]\n"
+                             "Translate synthetic text and the given FILEs "
+                             "with and without vector\ncode and print the "
+                             "throughput as CSV.\n\n",
+                             progname));
+  for (i = 0; options[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  -%c, --%-14s %s\n",
+                               options[i].optch, options[i].name,
+                               options[i].description));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the decimal number in ARG into *VALUE and make sure it is within
+ * MINIMUM and MAXIMUM. */
+static svn_error_t *
+parse_number(apr_int64_t *value,
+             const char *arg,
+             apr_int64_t minimum,
+             apr_int64_t maximum)
+{
+  return svn_error_trace(svn_cstring_strtoi64(value, arg, minimum,
+                                              maximum, 10));
+}
+
+/* Parse the command line given by ARGC and ARGV, and run the selected
+ * benchmarks. */
+static svn_error_t *
+sub_main(int argc,
+         const char *argv[],
+         apr_pool_t *pool)
+{
+  apr_getopt_t *os;
+  apr_int64_t size = DEFAULT_SIZE;
+  apr_int64_t total = DEFAULT_TOTAL;
+  apr_int64_t seed = DEFAULT_SEED;
+  const char *input_filter = "";
+  apr_hash_t *keywords;
+  apr_pool_t *iterpool;
+  int i;
+
+  apr_getopt_init(&os, pool, argc, argv);
+  while (1)
+    {
+      int opt;
+      const char *arg;
+      apr_status_t status = apr_getopt_long(os, options, &opt, &arg);
+
+      if (APR_STATUS_IS_EOF(status))
+        break;
+      if (status != APR_SUCCESS)
+        return svn_error_wrap_apr(status, "Invalid command line");
+
+      switch (opt)
+        {
+          case 's':
+            SVN_ERR(parse_number(&size, arg, 1, APR_INT32_MAX));
+            break;
+          case 'n':
+            SVN_ERR(parse_number(&total, arg, 1, APR_INT64_MAX));
+            break;
+          case 'r':
+            SVN_ERR(parse_number(&seed, arg, 0, APR_INT32_MAX));
+            break;
+          case 'i':
+            input_filter = arg;
+            break;
+          default:
+            return svn_error_trace(print_usage(argv[0], pool));
+        }
+    }
+
+  SVN_ERR(svn_subst_build_keywords3(&keywords, "Id Rev Author", "1234",
+                                    "http://example.com/repos/trunk/file.c",
+                                    "http://example.com/repos",
+                                    apr_time_now(), "jrandom", pool));
+
+  SVN_ERR(svn_cmdline_printf(pool, "input,translation,simd,bytes,"
+                                   "iterations,sec,mb_per_sec\n"));
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < (int)(sizeof(input_names) / sizeof(input_names[0])); ++i)
+    {
+      if (!strstr(input_names[i], input_filter))
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(run_input(input_names[i],
+                        create_text(input_names[i], (apr_size_t)size,
+                                    (apr_uint32_t)seed, iterpool),
+                        total, keywords, iterpool));
+    }
+
+  /* Real-world files, e.g. from a source tree. */
+  for (i = os->ind; i < argc; ++i)
+    {
+      const char *path;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_utf_cstring_to_utf8(&path, argv[i], iterpool));
+      path = svn_dirent_internal_style(path, iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&contents, path, iterpool));
+
+      SVN_ERR(run_input(svn_dirent_basename(path, iterpool),
+                        svn_stringbuf__morph_into_string(contents),
+                        total, keywords, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("subst-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "subst-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}
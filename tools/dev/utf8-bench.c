@@ -0,0 +1,325 @@
+/* utf8-bench.c -- measure UTF-8 validation throughput
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This tool runs svn_utf__is_valid() and svn_utf__last_valid() over
+ * buffers of different types of text, once for each vector instruction
+ * set extension that is available on this machine.  Each combination of
+ * input and instruction set prints one CSV line:
+ *
+ *   input,simd,bytes,iterations,sec,mb_per_sec
+ *
+ * The inputs are "ascii" (plain ASCII), "mixed" (mostly ASCII with some
+ * accented Latin chars), "cjk" (3 byte chars only) and "invalid" (ASCII
+ * with a single invalid octet at the very end).  The "scalar" mode
+ * disables all vector code.
+ */
+
+#include <string.h>
+
+#include <apr_getopt.h>
+#include <apr_time.h>
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_error.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "private/svn_simd.h"
+#include "private/svn_utf_private.h"
+
+#include "svn_private_config.h"
+
+/* Defaults for the command line options. */
+#define DEFAULT_SIZE         0x10000
+#define DEFAULT_TOTAL        0x40000000
+#define DEFAULT_SEED         0x5eed
+
+/* The vector instruction sets to compare. */
+typedef struct simd_mode_t
+{
+  const char *name;
+  apr_uint32_t mask;
+} simd_mode_t;
+
+static const simd_mode_t simd_modes[] =
+  {
+    { "scalar", 0 },
+    { "sse2",   SVN_SIMD__SSE2 },
+    { "avx2",   SVN_SIMD__SSE2 | SVN_SIMD__AVX2 },
+    { "neon",   SVN_SIMD__NEON }
+  };
+
+/* The types of input text. */
+static const char *input_names[] = { "ascii", "mixed", "cjk", "invalid" };
+
+
+/*** Workload. ***/
+
+/* Simple linear congruential generator, so the workload doesn't depend on
+ * the platform's rand() implementation.  Returns the next value for
+ * *SEED and updates it. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return a SIZE bytes buffer of the text type called INPUT.  Use SEED to
+ * generate the text.  Allocate the result in RESULT_POOL. */
+static char *
+create_text(const char *input,
+            apr_size_t size,
+            apr_uint32_t seed,
+            apr_pool_t *result_pool)
+{
+  char *text = apr_palloc(result_pool, size);
+  apr_size_t i = 0;
+
+  while (i < size)
+    {
+      apr_uint32_t value = next_rand(&seed);
+
+      if (strcmp(input, "cjk") == 0 && i + 3 <= size)
+        {
+          /* U+4E00 .. U+8DFF */
+          apr_uint32_t code_point = 0x4e00 + value % 0x4000;
+          text[i++] = (char)(0xe0 | (code_point >> 12));
+          text[i++] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+          text[i++] = (char)(0x80 | (code_point & 0x3f));
+        }
+      else if (strcmp(input, "mixed") == 0 && value % 16 == 0
+               && i + 2 <= size)
+        {
+          /* U+00C0 .. U+00FF */
+          text[i++] = (char)0xc3;
+          text[i++] = (char)(0x80 + (value >> 4) % 0x40);
+        }
+      else
+        {
+          text[i++] = (char)(' ' + (value >> 4) % 95);
+        }
+    }
+
+  if (strcmp(input, "invalid") == 0)
+    text[size - 1] = (char)0xff;
+
+  return text;
+}
+
+
+/*** Benchmark. ***/
+
+/* Validate the SIZE bytes of TEXT, which is of type INPUT, ITERATIONS
+ * times using the vector code selected by MODE.  Print the results.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_benchmark(const char *input,
+              const char *text,
+              apr_size_t size,
+              apr_uint32_t iterations,
+              const simd_mode_t *mode,
+              apr_pool_t *scratch_pool)
+{
+  apr_uint32_t old_mask = svn_simd__set_feature_mask(mode->mask);
+  apr_uint32_t valid = 0;
+  apr_time_t start;
+  apr_interval_time_t duration;
+  apr_uint32_t i;
+
+  start = apr_time_now();
+  for (i = 0; i < iterations; ++i)
+    {
+      /* Exercise both entry points.  Counting the results keeps the
+       * compiler from optimizing the calls away. */
+      if (i & 1)
+        valid += svn_utf__last_valid(text, size) == text + size;
+      else
+        valid += svn_utf__is_valid(text, size);
+    }
+  duration = apr_time_now() - start;
+
+  svn_simd__set_feature_mask(old_mask);
+
+  /* All implementations must agree with what we generated. */
+  if (valid != (strcmp(input, "invalid") ? iterations : 0))
+    return svn_error_createf(SVN_ERR_ASSERTION_FAIL, NULL,
+                             "Wrong validation result for %s text with %s",
+                             input, mode->name);
+
+  SVN_ERR(svn_cmdline_printf(scratch_pool,
+                             "%s,%s,%" APR_SIZE_T_FMT ",%u,%.6f,%.1f\n",
+                             input, mode->name, size, iterations,
+                             (double)duration / APR_USEC_PER_SEC,
+                             duration
+                               ? (double)size * iterations
+                                 / duration
+                                 * APR_USEC_PER_SEC / 0x100000
+                               : 0.0));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** Main. ***/
+
+static const apr_getopt_option_t options[] =
+  {
+    { "size",         's', 1, "size of the input buffers in bytes" },
+    { "total",        'n', 1, "total number of bytes to validate per run" },
+    { "seed",         'r', 1, "seed for the text generator" },
+    { "input",        'i', 1, "only run inputs whose name contains ARG" },
+    { "help",         'h', 0, "show this help" },
+    { NULL }
+  };
+
+/* Print usage information for PROGNAME to stdout. */
+static svn_error_t *
+print_usage(const char *progname,
+            apr_pool_t *pool)
+{
+  int i;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "Usage: %s [OPTIONS]\n"
+                             "Validate UTF-8 text of various kinds with "
+                             "and without vector code and\nprint the "
+                             "throughput as CSV.\n\n",
+                             progname));
+  for (i = 0; options[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  -%c, --%-14s %s\n",
+                               options[i].optch, options[i].name,
+                               options[i].description));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the decimal number in ARG into *VALUE and make sure it is within
+ * MINIMUM and MAXIMUM. */
+static svn_error_t *
+parse_number(apr_int64_t *value,
+             const char *arg,
+             apr_int64_t minimum,
+             apr_int64_t maximum)
+{
+  return svn_error_trace(svn_cstring_strtoi64(value, arg, minimum,
+                                              maximum, 10));
+}
+
+/* Parse the command line given by ARGC and ARGV, and run the selected
+ * benchmarks. */
+static svn_error_t *
+sub_main(int argc,
+         const char *argv[],
+         apr_pool_t *pool)
+{
+  apr_getopt_t *os;
+  apr_int64_t size = DEFAULT_SIZE;
+  apr_int64_t total = DEFAULT_TOTAL;
+  apr_int64_t seed = DEFAULT_SEED;
+  const char *input_filter = "";
+  apr_uint32_t available = svn_simd__get_features();
+  apr_uint32_t iterations;
+  apr_pool_t *iterpool;
+  int i, k;
+
+  apr_getopt_init(&os, pool, argc, argv);
+  while (1)
+    {
+      int opt;
+      const char *arg;
+      apr_status_t status = apr_getopt_long(os, options, &opt, &arg);
+
+      if (APR_STATUS_IS_EOF(status))
+        break;
+      if (status != APR_SUCCESS)
+        return svn_error_wrap_apr(status, "Invalid command line");
+
+      switch (opt)
+        {
+          case 's':
+            SVN_ERR(parse_number(&size, arg, 1, APR_INT32_MAX));
+            break;
+          case 'n':
+            SVN_ERR(parse_number(&total, arg, 1, APR_INT64_MAX));
+            break;
+          case 'r':
+            SVN_ERR(parse_number(&seed, arg, 0, APR_INT32_MAX));
+            break;
+          case 'i':
+            input_filter = arg;
+            break;
+          default:
+            return svn_error_trace(print_usage(argv[0], pool));
+        }
+    }
+
+  if (os->ind < argc)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            "Too many arguments");
+
+  iterations = (apr_uint32_t)MIN(APR_UINT32_MAX,
+                                 MAX(1, total / size));
+
+  SVN_ERR(svn_cmdline_printf(pool, "input,simd,bytes,iterations,"
+                                   "sec,mb_per_sec\n"));
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < (int)(sizeof(input_names) / sizeof(input_names[0])); ++i)
+    {
+      const char *text;
+
+      if (!strstr(input_names[i], input_filter))
+        continue;
+
+      svn_pool_clear(iterpool);
+      text = create_text(input_names[i], (apr_size_t)size,
+                         (apr_uint32_t)seed, iterpool);
+
+      for (k = 0; k < (int)(sizeof(simd_modes) / sizeof(simd_modes[0])); ++k)
+        if ((simd_modes[k].mask & available) == simd_modes[k].mask)
+          SVN_ERR(run_benchmark(input_names[i], text, (apr_size_t)size,
+                                iterations, &simd_modes[k], iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("utf8-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  err = sub_main(argc, argv, pool);
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "utf8-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}